@@ -0,0 +1,146 @@
+/*!
+ *  @file
+ *     AsyncStorage.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the asynchronous storage of raw container records. The writer thread
+ *	   submits the record of a frame and goes on with the next frame, the frame
+ *	   buffer is handed back (and re-queued to the camera) only once the record
+ *	   is on the disk.
+ *
+ *	   Two engines:
+ *	   - io_uring (Linux, built with HAVE_LIBURING): batched submissions, the
+ *	     frame buffers are registered buffers and the segment is a fixed file
+ *	   - a pool of threads doing positional writes, available everywhere
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef ASYNCSTORAGE_H_INCLUDE
+#define ASYNCSTORAGE_H_INCLUDE
+
+#include "Utility.h"
+#include "RawContainer.h"
+#include "FrameArena.h"
+
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+#include <liburing.h>
+#endif
+
+#define STORAGE_MAX_FRAMES		32		// frame buffers a storage can register
+#define STORAGE_BATCH			4		// submissions are flushed every STORAGE_BATCH records
+#define STORAGE_URING_DEPTH		128
+#define STORAGE_POOL_THREADS	2
+
+typedef enum
+{
+	eStorageSync	= 0,				// RawContainerWrite() on the writer thread
+	eStoragePool	= 1,				// pool of threads doing positional writes
+	eStorageUring	= 2					// io_uring, Linux only
+
+} tStorageKind;
+
+/*
+	Called when the record of a frame is on the disk (or failed), from a storage thread
+*/
+typedef void (*tStorageDoneCallback)(void *Context,tPvFrame *pFrame,bool Success,unsigned long long Latency);
+
+/*!
+ * @brief
+ *		One in-flight record. Header and metadata are kept next to each other so
+ *		they stay valid (and registered) until the write completes. With direct
+ *		I/O they are in the record block in front of the data instead
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct tStorageRequest
+{
+	tRawRecordHeader		Header;
+	tRawMetadata			Metadata;
+	char					Padding[RAW_ALIGNMENT];
+
+	tPvFrame*				pFrame;
+	const void*				pData;			// image buffer or packed area of the frame
+	tRawFile				File;
+	unsigned long long		Offset;
+	tRawContainer*			pContainer;		// index entry of the record, dropped if the write fails
+	unsigned long			Entry;
+	unsigned long			PadSize;		// after the pixels
+	unsigned long			PieceSize[3];	// bytes of each io_uring write, a shorter one fails the record
+	bool					Direct;			// one write from the record block in front of pData
+	unsigned long long		SubmittedAt;
+	volatile long			Pending;		// pieces of the record not yet written
+	volatile long			Failed;
+	struct tStorageRequest*	Next;			// pool queue
+
+} tStorageRequest;
+
+/*!
+ * @brief
+ *		Asynchronous storage of one camera
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct tAsyncStorage
+{
+	tStorageKind			Kind;
+	bool					Running;
+	volatile bool			Stop;
+
+	tPvFrame*				Frames;			// frame buffers of the camera, one request per frame
+	unsigned long			FrameCount;
+	const tFrameArena*		pArena;			// where the frame buffers come from, NULL if not from an arena
+	tStorageRequest*		Requests;
+	tRawFile				File;			// current segment
+
+	tStorageDoneCallback	Done;
+	void*					DoneContext;
+
+	volatile long			InFlight;
+	tEvent					Idle;			// signaled when InFlight drops to 0
+	unsigned long			Unsubmitted;	// records prepared but not yet submitted (io_uring)
+
+	/*
+	Thread pool
+	*/
+	tThread					Workers[STORAGE_POOL_THREADS];
+	tLock					QueueLock;
+	tEvent					QueueReady;
+	tStorageRequest*		QueueHead;
+	tStorageRequest*		QueueTail;
+
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+	struct io_uring			Ring;
+	tThread					Reaper;			// waits for the completions
+	bool					FileRegistered;
+	volatile bool			Broken;			// the reaper gave up, nothing completes anymore
+#endif
+
+	/*
+	Counters
+	*/
+	unsigned long			Submitted;
+	volatile long			Completed;		// updated by the storage threads
+	volatile long			Errors;
+	unsigned long			Batches;		// io_uring_submit() calls
+
+} tAsyncStorage;
+
+bool AsyncStorageAvailable(tStorageKind Kind);
+bool AsyncStorageStart(tAsyncStorage *pStorage,tStorageKind Kind,tPvFrame *Frames,unsigned long FrameCount,
+					   const tFrameArena *pArena,tStorageDoneCallback Done,void *DoneContext);
+void AsyncStorageStop(tAsyncStorage *pStorage);
+bool AsyncStorageSetFile(tAsyncStorage *pStorage,tRawFile File);
+bool AsyncStorageSubmit(tAsyncStorage *pStorage,tRawContainer *pContainer,tPvFrame *pFrame,
+						const tRawMetadata *pMetadata,const tRawPayload *pPayload);
+void AsyncStorageFlush(tAsyncStorage *pStorage);
+void AsyncStorageDrain(tAsyncStorage *pStorage);
+const char *AsyncStorageName(tStorageKind Kind);
+
+void AsyncStorageBenchmark();
+
+#endif // ASYNCSTORAGE_H_INCLUDE
@@ -0,0 +1,87 @@
+/*!
+ *  @file
+ *     AttributeCache.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the attribute cache of a camera. A refresher thread reads the
+ *	   attributes stored with the frames at a fixed rate, and right away when
+ *	   the camera sends an event, so the writer reads a snapshot in memory
+ *	   instead of making GigE round trips for every frame
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef ATTRIBUTECACHE_H_INCLUDE
+#define ATTRIBUTECACHE_H_INCLUDE
+
+#include "Utility.h"
+#include "RawContainer.h"
+#include "AttributeTable.h"
+
+#define ATTR_DEFAULT_REFRESH	250			// milliseconds between two refreshes
+#define ATTR_MIN_INTERVAL		20			// events do not refresh more often than that (milliseconds)
+
+/*
+	Camera events that wake the refresher up (EventsEnable1, bit n is event 40000 + n)
+*/
+#define ATTR_EVENT_BASE			40000
+#define ATTR_EVENT_ACQ_START	40000
+#define ATTR_EVENT_EXPOSURE_END	40003
+#define ATTR_EVENTS_MASK		((1 << (ATTR_EVENT_ACQ_START - ATTR_EVENT_BASE)) | (1 << (ATTR_EVENT_EXPOSURE_END - ATTR_EVENT_BASE)))
+
+/*!
+ * @brief
+ *		Attribute snapshot of one camera, its refresher and the staleness counters
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	tPvHandle			Handle;
+	tAttributeTable		*pTable;			// handles of the attributes of the camera
+	tThread				Thread;
+	tEvent				Wake;
+	bool				Running;
+	volatile bool		Stop;
+	bool				Events;				// camera events registered
+	volatile long		EventsPending;		// counted up by the event callback
+	long				EventsServed;
+	unsigned long		RefreshPeriod;		// milliseconds
+
+	/*
+	Snapshot, only the refresher writes it: Sequence is odd while it changes
+	*/
+	volatile long				Sequence;
+	volatile unsigned int		Exposure;
+	volatile unsigned int		Gain;
+	volatile unsigned int		WhitebalRed;
+	volatile unsigned int		WhitebalBlue;
+	volatile unsigned long long	UpdatedAt;	// GetMicroseconds() of the refresh, 0 before the first one
+
+	/*
+	Counters: refresher side
+	*/
+	unsigned long		Refreshes;
+	unsigned long		EventRefreshes;		// refreshes caused by a camera event
+
+	/*
+	Counters: reader side (writer thread of the camera)
+	*/
+	unsigned long		Reads;
+	unsigned long long	StalenessTotal;		// microseconds
+	unsigned long long	StalenessMax;
+
+} tAttributeCache;
+
+void AttributeReadCamera(tAttributeTable *pTable,tRawMetadata *pMetadata);
+bool AttributeCacheStart(tAttributeCache *pCache,tAttributeTable *pTable,unsigned long RefreshPeriod);
+void AttributeCacheStop(tAttributeCache *pCache);
+void AttributeCacheInvalidate(tAttributeCache *pCache);
+bool AttributeCacheRead(tAttributeCache *pCache,tRawMetadata *pMetadata);
+double AttributeCacheStaleness(const tAttributeCache *pCache);
+void AttributeCacheBenchmark();
+
+#endif // ATTRIBUTECACHE_H_INCLUDE
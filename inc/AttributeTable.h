@@ -0,0 +1,92 @@
+/*!
+ *  @file
+ *     AttributeTable.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the attribute table of a camera. The attributes read while the
+ *	   camera streams (statistics, metadata of the frames) are interned once
+ *	   when the camera is opened: PvAttrInfo() (PvAttrExists() where it is not
+ *	   available) validates the name, its datatype and flags are kept. The
+ *	   readers use typed handles, a name that does not exist or has another
+ *	   type fails without a call to the camera, and an ePvFlagConst attribute
+ *	   is read from the camera only the first time.
+ *
+ *	   The information of an attribute is static for each camera, a camera
+ *	   that comes back after an unplug keeps its table and its const values.
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef ATTRIBUTETABLE_H_INCLUDE
+#define ATTRIBUTETABLE_H_INCLUDE
+
+#include "Utility.h"
+
+#define ATTR_TABLE_SIZE			32
+
+/*!
+ * @brief
+ *		One interned attribute. Name is not copied, it is a string literal
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	const char			*Name;
+	tPvDatatype			Type;
+	unsigned long		Flags;				// tPvAttributeFlags
+	tPvErr				Error;				// ePvErrNotFound or ePvErrWrongType: every read fails with it
+
+	volatile long		Known;				// the const value has been read
+	tPvUint32			Uint32;
+	tPvFloat32			Float32;
+
+} tAttributeEntry;
+
+/*
+	Typed handles, an index in the table of the camera
+*/
+typedef struct { unsigned long Index; } tAttrUint32;
+typedef struct { unsigned long Index; } tAttrFloat32;
+
+/*!
+ * @brief
+ *		Interned attributes of one camera, and the handles of the statistics
+ *		and metadata paths
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	tPvHandle			Camera;
+	tAttributeEntry		Entries[ATTR_TABLE_SIZE];
+	unsigned long		Count;
+
+	tAttrUint32			FramesCompleted;
+	tAttrUint32			FramesDropped;
+	tAttrUint32			PacketsMissed;
+	tAttrUint32			PacketsErroneous;
+	tAttrFloat32		FrameRate;			// StatFrameRate
+	tAttrUint32			Exposure;
+	tAttrUint32			Gain;
+	tAttrUint32			WhitebalRed;
+	tAttrUint32			WhitebalBlue;
+	tAttrUint32			TotalBytesPerFrame;
+	tAttrUint32			TimeStampFrequency;
+
+	volatile long		CameraReads;
+	volatile long		ConstReads;			// served from the table
+
+} tAttributeTable;
+
+void AttributeTableOpen(tAttributeTable *pTable,tPvHandle Camera);
+tAttrUint32 AttributeInternUint32(tAttributeTable *pTable,const char *Name);
+tAttrFloat32 AttributeInternFloat32(tAttributeTable *pTable,const char *Name);
+tPvErr AttributeUint32Get(tAttributeTable *pTable,tAttrUint32 Handle,tPvUint32 *pValue);
+tPvErr AttributeFloat32Get(tAttributeTable *pTable,tAttrFloat32 Handle,tPvFloat32 *pValue);
+
+#endif // ATTRIBUTETABLE_H_INCLUDE
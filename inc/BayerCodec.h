@@ -0,0 +1,34 @@
+/*!
+ *  @file
+ *     BayerCodec.h
+ *  @brief
+ *     OTC project: This file contains functions declaration for the lossless
+ *	   codec of raw Bayer frames (Bayer8, Bayer16, Bayer12Packed). Each pixel
+ *	   is predicted from pixels of its own color only:
+ *	   - red and blue: median predictor (LOCO-I) on the neighbours two pixels away
+ *	   - green: average of the two green diagonal neighbours of the row above
+ *	   the residuals are packed by groups of 8 at the width of the largest one.
+ *	   Residuals are computed 8 pixels at a time with SSE2 when available
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef BAYERCODEC_H_INCLUDE
+#define BAYERCODEC_H_INCLUDE
+
+#include "Utility.h"
+
+#define BAYER_MAX_WIDTH		8192
+
+bool BayerCodecSupports(tPvImageFormat Format,unsigned long Width);
+unsigned long BayerRowBytes(tPvImageFormat Format,unsigned long Width);
+unsigned long BayerEncode(const void *pSource,unsigned long Width,unsigned long Rows,tPvImageFormat Format,
+						  tPvBayerPattern Pattern,void *pTarget,unsigned long TargetCapacity);
+bool BayerDecode(const void *pSource,unsigned long SourceSize,void *pTarget,unsigned long Width,unsigned long Rows,
+				 tPvImageFormat Format,tPvBayerPattern Pattern);
+
+void BayerCodecBenchmark(const char *Segment);
+
+#endif // BAYERCODEC_H_INCLUDE
@@ -0,0 +1,110 @@
+/*!
+ *  @file
+ *     CameraBringup.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the bring-up of a plugged camera. Each camera is brought up by a
+ *	   thread of its own, through the states
+ *
+ *	   Prepare    directory, segment files and metadata log of the camera
+ *	   Open       PvCameraOpen()
+ *	   Start      buffers, writer, attributes, frames queued (CameraStart())
+ *	   WaitFrame  the thread is over, the first frame has not come yet
+ *	   Streaming  the first frame is done
+ *
+ *	   so a camera that is slow to answer its attribute calls no longer holds
+ *	   up the others, nor the control loop. The thread checks Cancel between
+ *	   two states, an unplug cancels it and waits for the state it is in.
+ *
+ *	   The time of each state is kept, the time to first frame is counted from
+ *	   the link event of the camera.
+ *
+ *	   A camera that comes back after an unplug keeps its frame buffers and its
+ *	   configuration (-reconnect fast, CameraConfig.h). Its reconnect gap, from
+ *	   the unplug to the first frame after the plug, is kept with the camera.
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef CAMERABRINGUP_H_INCLUDE
+#define CAMERABRINGUP_H_INCLUDE
+
+#include "Utility.h"
+
+#define BRINGUP_DIR_SIZE		100
+
+typedef enum
+{
+	eBringupIdle			= 0,			// never plugged, or unplugged
+	eBringupPrepare			= 1,
+	eBringupOpen			= 2,
+	eBringupStart			= 3,
+	eBringupWaitFrame		= 4,
+	eBringupStreaming		= 5,
+	eBringupFailed			= 6				// a state failed, or the bring-up was cancelled
+
+} tBringupState;
+
+struct tCamera;
+
+// called on the bring-up thread when it is over, then on the frame thread with the first frame
+typedef void (*tBringupDone)(struct tCamera *tCamInstance);
+
+/*!
+ * @brief
+ *		Bring-up of one camera: its thread, its state and the time it reached
+ *		each one (GetMicroseconds(), 0 not yet)
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	volatile tBringupState	State;
+	tThread				Thread;
+	bool				Running;			// Thread has to be joined
+	volatile bool		Cancel;
+	char				Directory[BRINGUP_DIR_SIZE];
+	tBringupDone		Done;				// NULL: nobody is told
+
+	unsigned long long	PluggedAt;
+	unsigned long long	PreparedAt;
+	unsigned long long	OpenedAt;
+	unsigned long long	StartedAt;
+	volatile unsigned long long	FirstFrameAt;
+	volatile long		FirstFrames;		// calls of CameraBringupFirstFrame(), only the first one counts
+	volatile long		Handoff;			// the thread is over and the first frame came, 2 when both did
+	bool				Reported;
+
+} tCameraBringup;
+
+/*!
+ * @brief
+ *		Reconnects of one camera, across its bring-ups
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned long long	UnpluggedAt;		// 0: the camera is not coming back from an unplug
+	unsigned long		Count;
+	double				LastGap;			// milliseconds from the unplug to the first frame
+	double				MaxGap;
+	double				TotalGap;
+	bool				BuffersKept;		// the last start reused the frame buffers
+
+} tCameraReconnect;
+
+bool CameraBringupStart(struct tCamera *tCamInstance,const char *Directory,tBringupDone Done);
+void CameraBringupJoin(struct tCamera *tCamInstance);
+void CameraBringupCancel(struct tCamera *tCamInstance);
+void CameraBringupFirstFrame(struct tCamera *tCamInstance);
+double CameraBringupTimeToFirstFrame(const struct tCamera *tCamInstance);
+bool CameraReconnectAccount(struct tCamera *tCamInstance);
+void CameraBringupReport(const struct tCamera *tCamInstance);
+const char *CameraBringupStateName(tBringupState State);
+
+#endif // CAMERABRINGUP_H_INCLUDE
@@ -0,0 +1,101 @@
+/*!
+ *  @file
+ *     CameraConfig.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the configuration of a camera: the attributes CameraStart() sets, with
+ *	   their values. The configuration stays with the camera instance once it
+ *	   has been applied; when the camera comes back after an unplug only the
+ *	   attributes whose value on the camera differs from it are written again
+ *	   (CameraConfigApply() with Diff). A camera that kept its power kept its
+ *	   attributes, one that did not gets them all back.
+ *
+ *	   The configuration is a profile of a text file (-profile), or the one
+ *	   built in CameraStart() without it:
+ *
+ *	   # comment
+ *	   [day]
+ *	   ExposureMode           enum     Auto
+ *	   ExposureAutoMax        uint32   30000
+ *	   FrameRate              float32  15.0     required
+ *
+ *	   types are enum, uint32, float32 and boolean. The values are written in
+ *	   dependency order whatever their order in the file: acquisition and
+ *	   trigger, image format, modes, values, then the rates and bandwidth that
+ *	   the others bound. With Diff every value is read back in one pass before
+ *	   the first write; a rate is read again when one of the values it depends
+ *	   on was written, the camera may have clamped it.
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef CAMERACONFIG_H_INCLUDE
+#define CAMERACONFIG_H_INCLUDE
+
+#include "Utility.h"
+
+#define CONFIG_MAX_VALUES		32
+#define CONFIG_NAME_SIZE		32
+#define CONFIG_ENUM_SIZE		32
+#define CONFIG_FLOAT_TOLERANCE	0.001f		// relative, the camera rounds the floats it is given
+#define CONFIG_LINE_SIZE		256
+#define CONFIG_MAX_PROFILES		16
+#define CONFIG_PROFILE_FILE		"cameraProfiles.txt"	// -bench profile without a file
+#define CONFIG_BENCH_WAIT		2000		// milliseconds for the first frame after a profile
+
+/*!
+ * @brief
+ *		One attribute of the configuration, of type ePvDatatypeEnum, Uint32,
+ *		Float32 or Boolean (in Uint32)
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	char				Name[CONFIG_NAME_SIZE];
+	tPvDatatype			Type;
+	char				Enum[CONFIG_ENUM_SIZE];
+	tPvUint32			Uint32;
+	tPvFloat32			Float32;
+	bool				Required;			// the camera does not start without it
+
+} tConfigValue;
+
+/*!
+ * @brief
+ *		Attributes of a camera, in the order they are written, and what the
+ *		last CameraConfigApply() did
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	char				Profile[CONFIG_NAME_SIZE];	// "built-in" without a file
+	tConfigValue		Values[CONFIG_MAX_VALUES];
+	unsigned long		Count;
+	bool				Applied;			// every value was written once, a reconnect writes the differences
+
+	unsigned long		Reads;
+	unsigned long		Rereads;			// read again after a value it depends on was written
+	unsigned long		Writes;
+	unsigned long		Skipped;			// the camera had the value already
+	unsigned long		Failed;
+	unsigned long long	AppliedAt;			// GetMicroseconds() at the start of the apply
+	unsigned long long	ReadTime;			// microseconds of the read back
+	unsigned long long	ApplyTime;
+
+} tCameraConfig;
+
+void CameraConfigInit(tCameraConfig *pConfig);
+bool CameraConfigSet(tCameraConfig *pConfig,const char *Name,tPvDatatype Type,const char *Value,bool Required);
+bool CameraConfigLoad(tCameraConfig *pConfig,const char *File,const char *Profile);
+unsigned long CameraConfigProfiles(const char *File,char Names[][CONFIG_NAME_SIZE],unsigned long Max);
+bool CameraConfigApply(tPvHandle Camera,tCameraConfig *pConfig,bool Diff);
+double CameraConfigTimeToStream(const tCameraConfig *pConfig,unsigned long long FirstFrameAt);
+void CameraConfigBenchmark(const char *File);
+
+#endif // CAMERACONFIG_H_INCLUDE
@@ -0,0 +1,38 @@
+/*!
+ *  @file
+ *     CameraRegistry.h
+ *  @brief
+ *     OTC project: This file contains functions declaration for the camera
+ *	   registry. Every camera that shows up gets its own tCamera, found by UID
+ *	   when its link events come, and from the frame context (Context[2]) when
+ *	   its frames complete. The instances are cache line aligned and padded, so
+ *	   the callback and writer threads of a camera never share a line with the
+ *	   ones of another camera.
+ *
+ *	   A slot is kept when its camera is unplugged: the camera gets the same
+ *	   instance when it comes back, and callbacks still in flight never see
+ *	   freed memory. The slots are only released by CameraRegistryDestroy().
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef CAMERAREGISTRY_H_INCLUDE
+#define CAMERAREGISTRY_H_INCLUDE
+
+#include "Utility.h"
+
+#define REGISTRY_MAX_CAMERAS	16
+#define REGISTRY_CACHE_LINE		64
+
+struct tCamera;
+
+void CameraRegistryInit();
+void CameraRegistryDestroy();
+struct tCamera *CameraRegistryAdd(unsigned long UID);
+struct tCamera *CameraRegistryFind(unsigned long UID);
+struct tCamera *CameraRegistryGet(unsigned long Index);
+unsigned long CameraRegistryCount();
+
+#endif // CAMERAREGISTRY_H_INCLUDE
@@ -0,0 +1,46 @@
+/*!
+ *  @file
+ *     CaptureBenchmark.h
+ *  @brief
+ *     OTC project: This file contains functions declaration for the end to end
+ *	   capture benchmark. The whole pipeline (frame done callback, writer,
+ *	   metadata, storage) runs over a sweep of camera counts, frame sizes, pixel
+ *	   formats, storage backends, acquisition and processing modes, the results
+ *	   are written as JSON.
+ *
+ *	   The cameras of a run are brought up one after the other (serial, the way
+ *	   the link callback did) or all at once (parallel, CameraBringup.h); the
+ *	   time to first frame of each camera is counted from the start of the run.
+ *	   control=MS makes every control transaction of the simulator take MS
+ *	   milliseconds, the bring-up of a real camera is mostly made of them.
+ *
+ *	   With reconnect=full or fast the simulator unplugs every camera once after
+ *	   the measurement and plugs it back a second later: the run waits for the
+ *	   cameras to stream again and reports their reconnect gap (-reconnect).
+ *
+ *	   The frames come from the PvAPI simulator (PvSimulator.h): every run sets
+ *	   PVSIM before PvInitialize(). The real PvAPI library ignores PVSIM, so
+ *	   main() only runs the benchmark in simulator builds (PV_SIMULATOR, the
+ *	   Linux Makefile without PVAPI_LIB). The same goes for -bench profile and
+ *	   -bench stats.
+ *
+ *	   AVCameraThreaded -bench capture [results.json [sweep]]
+ *
+ *	   sweep is a list of key=value, several values separated by ':'
+ *
+ *	   cameras=1:2:4,size=640x480:1360x1024,format=Bayer8:Bayer16,storage=tiff:raw:pool:uring:compress,acquire=callback:poll,process=writer:pool,bringup=serial:parallel,reconnect=none:full:fast,control=5,workers=3,seconds=10,warmup=2,fps=30
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef CAPTUREBENCHMARK_H_INCLUDE
+#define CAPTUREBENCHMARK_H_INCLUDE
+
+#define BENCH_CAPTURE_JSON		"capture_bench.json"
+#define BENCH_CAPTURE_SWEEP		"cameras=1:2,size=640x480:1360x1024,format=Bayer8,storage=tiff:raw:pool,acquire=callback,process=writer,bringup=parallel,reconnect=none,seconds=5,warmup=1,fps=30"
+
+void CaptureBenchmark(const char *JsonFile,const char *Sweep);
+
+#endif // CAPTUREBENCHMARK_H_INCLUDE
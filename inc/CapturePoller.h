@@ -0,0 +1,71 @@
+/*!
+ *  @file
+ *     CapturePoller.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the polling acquisition mode (-acquire poll). The frames are queued
+ *	   without a callback and a thread of the camera waits for them with
+ *	   PvCaptureWaitForFrameDone(), in the order they were queued, then hands
+ *	   them to FrameDoneCB() like the PvAPI thread does in callback mode. The
+ *	   thread can be pinned on a processor and given a real-time priority, the
+ *	   PvAPI thread cannot.
+ *
+ *	   Every frame given back to the camera goes through CaptureQueueFrame(),
+ *	   which queues it the way the camera acquires.
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef CAPTUREPOLLER_H_INCLUDE
+#define CAPTUREPOLLER_H_INCLUDE
+
+#include "Utility.h"
+
+#define POLL_MAX_FRAMES			16			// frames of a camera, at least FRAMESCOUNT
+#define POLL_WAIT_SLICE			100			// milliseconds, the thread looks at Stop this often
+
+typedef enum
+{
+	eAcquireCallback		= 0,			// FrameDoneCB() on the PvAPI thread
+	eAcquirePoll			= 1				// PvCaptureWaitForFrameDone() on a thread of the camera
+
+} tAcquireMode;
+
+struct tCamera;
+
+/*!
+ * @brief
+ *		Polling thread of a camera and the frames it waits for, in queue order
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	bool				Enabled;			// frames are queued without a callback
+	tThread				Thread;
+	tEvent				Wake;				// a frame was queued while none was
+	volatile bool		Stop;
+	long				Processor;			// -1 not pinned
+	int					Priority;			// 0 normal
+
+	tLock				Lock;
+	tPvFrame			*Queued[POLL_MAX_FRAMES];
+	unsigned long		Head;
+	unsigned long		Count;
+
+	/*
+	Counters, polling thread only
+	*/
+	unsigned long		FramesPolled;
+	unsigned long		Timeouts;
+
+} tCapturePoller;
+
+bool CapturePollerStart(struct tCamera *tCamInstance,long Processor,int Priority);
+void CapturePollerStop(struct tCamera *tCamInstance);
+tPvErr CaptureQueueFrame(struct tCamera *tCamInstance,tPvFrame *pFrame);
+
+#endif // CAPTUREPOLLER_H_INCLUDE
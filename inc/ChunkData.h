@@ -0,0 +1,53 @@
+/*!
+ *  @file
+ *     ChunkData.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the chunk data of the frames. With ChunkModeActive the camera sends
+ *	   in the ancillary buffer of each frame the exposure and gain the frame was
+ *	   taken with and its acquisition counters
+ *
+ *	   Chunk layout (48 bytes, 32 bits values unless stated otherwise):
+ *	   - 0: acquisition count
+ *	   - 4: user value
+ *	   - 8: exposure (us)
+ *	   - 12: gain (dB)
+ *	   - 16: sync in levels (16 bits), 18: sync out levels (16 bits)
+ *	   - 20 to 39: not used
+ *	   - 40: chunk ID (CHUNK_ID), 44: chunk length
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef CHUNKDATA_H_INCLUDE
+#define CHUNKDATA_H_INCLUDE
+
+#include "Utility.h"
+
+#define CHUNK_SIZE			48
+#define CHUNK_ID			1000
+
+/*!
+ * @brief
+ *		Values of the chunk of one frame
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned int		AcquisitionCount;
+	unsigned int		UserValue;
+	unsigned int		Exposure;
+	unsigned int		Gain;
+	unsigned short		SyncInLevels;
+	unsigned short		SyncOutLevels;
+
+} tChunkData;
+
+unsigned long ChunkEnable(tPvHandle Camera);
+bool ChunkParse(const tPvFrame *pFrame,tChunkData *pChunk);
+
+#endif // CHUNKDATA_H_INCLUDE
@@ -0,0 +1,92 @@
+/*!
+ *  @file
+ *     CompressStage.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the compression stage of the raw recorder. The writer thread of a
+ *	   camera cuts the frame into strips, the strips are compressed in parallel
+ *	   by the work pool shared by all the cameras (WorkPool.h, the writer works
+ *	   on them too) and the record stores the compressed strips: eRawCompressionBayer for the
+ *	   Bayer formats the CFA codec supports, eRawCompressionLz otherwise
+ *
+ *	   The stage steps aside while the writer queue of the camera backs up:
+ *	   the frames are then stored as they are until the queue is empty again
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef COMPRESSSTAGE_H_INCLUDE
+#define COMPRESSSTAGE_H_INCLUDE
+
+#include "Utility.h"
+#include "RawContainer.h"
+#include "WorkPool.h"
+
+#define COMPRESS_STRIPS			16
+#define COMPRESS_BACKLOG_HIGH	8		// frames waiting in the writer queue before the stage steps aside
+#define COMPRESS_INLINE			0xFFFFFFFF	// home of a compressor that compresses its strips itself
+
+/*
+	Packed area needed by a frame: strip table, then at worst the strips stored as they are
+*/
+#define COMPRESS_PACKED_SIZE(imageSize)	(sizeof(tRawStripTable) + COMPRESS_STRIPS * sizeof(unsigned int) + (imageSize))
+
+struct tCompressor;
+
+typedef struct tCompressStrip
+{
+	const unsigned char*	pSource;
+	unsigned long			SourceSize;
+	unsigned char*			pTarget;		// SourceSize bytes available
+	unsigned long			PackedSize;		// 0 when the strip did not get smaller
+	tRawCompression			Codec;
+	unsigned long			Rows;			// eRawCompressionBayer: rows of the strip and frame layout
+	unsigned long			Width;
+	tPvImageFormat			Format;
+	tPvBayerPattern			Pattern;
+	struct tCompressor*		pOwner;
+	tWorkJob				Job;
+
+} tCompressStrip;
+
+/*!
+ * @brief
+ *		Compression state and counters of one camera
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct tCompressor
+{
+	tCompressStrip		Strips[COMPRESS_STRIPS];
+	volatile long		Remaining;			// strips of the current frame not compressed yet
+	tEvent				Done;				// signaled when Remaining drops to 0
+	bool				Bypassing;
+	unsigned long		Home;				// work pool home of the camera, COMPRESS_INLINE
+
+	/*
+	Counters
+	*/
+	unsigned long		FramesCompressed;
+	unsigned long		FramesStored;		// did not get smaller, stored as they are
+	unsigned long		FramesBypassed;		// no time to compress them
+	unsigned long long	RawBytes;			// of the compressed frames
+	unsigned long long	PackedBytes;
+	unsigned long long	CompressTime;		// microseconds
+
+} tCompressor;
+
+void CompressorInit(tCompressor *pCompressor,unsigned long Home);
+void CompressorDestroy(tCompressor *pCompressor);
+void CompressorAccount(tCompressor *pCompressor,tCompressor *pFrameCompressor);
+bool CompressBypass(tCompressor *pCompressor,unsigned long Backlog);
+bool CompressFrame(tCompressor *pCompressor,const tPvFrame *pFrame,void *pPacked,unsigned long Backlog,tRawPayload *pPayload);
+bool CompressDecode(const tRawRecordHeader *pHeader,const void *pPacked,void *pImage);
+double CompressRatio(const tCompressor *pCompressor);
+double CompressThroughput(const tCompressor *pCompressor);
+
+void CompressBenchmark();
+
+#endif // COMPRESSSTAGE_H_INCLUDE
@@ -0,0 +1,68 @@
+/*!
+ *  @file
+ *     ControlLoop.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the control loop of main(). Link events, timers and the shutdown
+ *	   request are posted to one queue, and the main thread sleeps on it until
+ *	   there is something to do: an idle recorder does not use any CPU.
+ *
+ *	   The link callbacks of PvAPI only post the event, the cameras are set up
+ *	   and stopped on the main thread. CTRL-C posts the shutdown: on Windows from
+ *	   the console handler thread, on POSIX from a thread waiting in sigwait(),
+ *	   which needs SIGINT and SIGTERM blocked in every other thread, so
+ *	   ControlLoopCatchInterrupt() has to be called before any thread is started
+ *	   (PvInitialize() starts some).
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef CONTROLLOOP_H_INCLUDE
+#define CONTROLLOOP_H_INCLUDE
+
+#include "Utility.h"
+
+#define CONTROL_QUEUE_SIZE		64			// events waiting for the loop
+#define CONTROL_MAX_TIMERS		16			// events posted for later
+#define CONTROL_BENCH_SECONDS	5
+
+typedef enum
+{
+	eControlLinkAdd			= 0,			// camera UID plugged
+	eControlLinkRemove		= 1,			// camera UID unplugged
+	eControlTimer			= 2,			// UID is the timer number of the application
+	eControlShutdown		= 3,			// CTRL-C, the loop returns once it is handled
+	eControlBringup			= 4,			// bring-up of camera UID is over, or its first frame came
+	eControlAlert			= 5,			// camera UID has frames that failed or a disk that is full
+	eControlTrigger			= 6				// ring recorder trigger from the UDP port, for camera UID or 0 for all
+
+} tControlKind;
+
+/*!
+ * @brief
+ *		One event of the control loop
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	tControlKind		Kind;
+	unsigned long		UID;
+	unsigned long long	Due;				// GetMicroseconds() of a timer, 0 right away
+
+} tControlEvent;
+
+typedef void (*tControlHandler)(const tControlEvent *pEvent,void *pContext);
+
+void ControlLoopInit();
+void ControlLoopDestroy();
+bool ControlLoopCatchInterrupt();
+bool ControlLoopPost(tControlKind Kind,unsigned long UID);
+bool ControlLoopPostAfter(tControlKind Kind,unsigned long UID,unsigned long Delay);
+void ControlLoopRun(tControlHandler Handler,void *pContext);
+void ControlLoopBenchmark();
+
+#endif // CONTROLLOOP_H_INCLUDE
@@ -0,0 +1,126 @@
+/*!
+ *  @file
+ *     Demosaic.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the demosaic of the Bayer frames (Bayer8, Bayer16), in place of
+ *	   PvUtilityColorInterpolate() which is Windows only, scalar and single
+ *	   threaded. The four patterns of tPvBayerPattern, two methods:
+ *	   - bilinear: average of the 2 or 4 nearest pixels of the color
+ *	   - edge: green interpolated along the edge, with the gradients and the
+ *	     Laplacian correction of Hamilton-Adams, then red and blue as bilinear
+ *	     color differences to the green
+ *	   the borders are mirrored. The output has the depth of the input, 8 or
+ *	   16 bits, RGB or BGR interleaved, or three planes R, G, B.
+ *
+ *	   The frame is cut in row tiles, run as jobs of the work pool, the calling
+ *	   thread helps until they are done. A tile widens its rows to 16 bits in
+ *	   a few line buffers and computes 8 pixels at a time with SSE2 when the
+ *	   data has DEMOSAIC_SIMD_BITS at most (every intermediate value then fits
+ *	   in 16 signed bits); deeper data goes through the scalar reference,
+ *	   DemosaicReference(), which the SSE2 kernels match bit for bit.
+ *
+ *	   Limits: there is no AVX2 kernel, SSE2 is the widest (the one VS2008
+ *	   compiles). Bayer16 frames deeper than DEMOSAIC_SIMD_BITS, full 16 bits
+ *	   data, have no SIMD kernel at all: they run the scalar code, still over
+ *	   the tiles of the pool. DemosaicFrame() says so the first time it
+ *	   happens, DemosaicKernel() tells which kernel a frame gets.
+ *
+ *	   AVCameraThreaded -preview-color bilinear|edge saves the frames of the
+ *	   previewer in color, -bench demosaic compares the kernels with the
+ *	   reference, their quality and their speed.
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef DEMOSAIC_H_INCLUDE
+#define DEMOSAIC_H_INCLUDE
+
+#include "Utility.h"
+#include "WorkPool.h"
+
+#define DEMOSAIC_TILES			16			// row tiles of a frame, jobs of the work pool
+#define DEMOSAIC_TILE_MIN_ROWS	32
+#define DEMOSAIC_INLINE			0xFFFFFFFF	// home that keeps the tiles on the calling thread
+#define DEMOSAIC_SIMD_BITS		12
+#define DEMOSAIC_MIN_SIZE		4			// pixels of the smallest width and height
+
+typedef enum
+{
+	eDemosaicBilinear		= 0,
+	eDemosaicEdge			= 1
+
+} tDemosaicMethod;
+
+typedef enum
+{
+	eDemosaicRgb			= 0,			// interleaved
+	eDemosaicBgr			= 1,
+	eDemosaicPlanar			= 2				// Width * Height red samples, then green, then blue
+
+} tDemosaicLayout;
+
+struct tDemosaic;
+
+/*!
+ * @brief
+ *		Rows of a frame converted by one job, and the line buffers it works in
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct tDemosaicTile
+{
+	unsigned long			FirstRow;
+	unsigned long			Rows;
+	unsigned short			*pLines;		// source, green and channel lines
+	unsigned long			Stride;			// samples of a line, 0 until they are allocated
+	struct tDemosaic		*pOwner;
+	tWorkJob				Job;
+
+} tDemosaicTile;
+
+/*!
+ * @brief
+ *		Demosaic state of one user (a camera, the benchmark), the frame being
+ *		converted and the counters
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct tDemosaic
+{
+	tDemosaicTile			Tiles[DEMOSAIC_TILES];
+	volatile long			Remaining;		// tiles of the current frame not done yet
+	tEvent					Done;			// signaled when Remaining drops to 0
+	unsigned long			Home;			// work pool home, DEMOSAIC_INLINE
+
+	const tPvFrame			*pFrame;
+	void					*pTarget;
+	tDemosaicMethod			Method;
+	tDemosaicLayout			Layout;
+	unsigned long			Maximum;		// largest sample value, (1 << BitDepth) - 1
+	bool					Simd;
+
+	/*
+	Counters
+	*/
+	unsigned long			Frames;
+	unsigned long			FramesScalar;	// deeper than DEMOSAIC_SIMD_BITS, or no SSE2
+	unsigned long long		Time;			// microseconds
+
+} tDemosaic;
+
+void DemosaicInit(tDemosaic *pDemosaic,unsigned long Home);
+void DemosaicDestroy(tDemosaic *pDemosaic);
+bool DemosaicSupports(const tPvFrame *pFrame);
+unsigned long DemosaicTargetSize(const tPvFrame *pFrame);
+const char *DemosaicKernel(const tPvFrame *pFrame);
+bool DemosaicFrame(tDemosaic *pDemosaic,const tPvFrame *pFrame,void *pTarget,tDemosaicMethod Method,tDemosaicLayout Layout);
+bool DemosaicReference(const tPvFrame *pFrame,void *pTarget,tDemosaicMethod Method,tDemosaicLayout Layout);
+
+void DemosaicBenchmark();
+
+#endif // DEMOSAIC_H_INCLUDE
@@ -0,0 +1,64 @@
+/*!
+ *  @file
+ *     FrameArena.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the frame buffer arena. All the frame buffers of a camera come from
+ *	   one aligned allocation so the raw container can write them with direct
+ *	   I/O, straight from the buffer the camera filled
+ *
+ *	   Slot layout, every part a multiple of the block size:
+ *	   - record block: header and metadata of the raw record, filled before the write
+ *	   - image buffer handed to PvAPI (tPvFrame::ImageBuffer), rounded up to the block size
+ *	   - optional packed area (compressed image), preceded by its own record block
+ *	   - optional ancillary area (chunk data of the frame, tPvFrame::AncillaryBuffer)
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef FRAMEARENA_H_INCLUDE
+#define FRAMEARENA_H_INCLUDE
+
+#include "Utility.h"
+
+#define ARENA_BLOCK_SIZE	4096		// sector/page size used for direct I/O
+
+#define ARENA_ROUND_UP(size,block)	(((size) + (block) - 1) / (block) * (block))
+
+/*
+	Record block in front of the image buffer of a frame allocated from an arena
+*/
+#define ARENA_RECORD_BLOCK(pFrame,block)	((char*)(pFrame)->ImageBuffer - (block))
+
+/*!
+ * @brief
+ *		Aligned storage of the frame buffers of one camera
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	char*			Base;
+	unsigned long	BlockSize;
+	unsigned long	BufferSize;			// image buffer of one frame, rounded up to BlockSize
+	unsigned long	PackedSize;			// packed area of one frame, 0 when there is none
+	unsigned long	AncillarySize;		// ancillary area of one frame, 0 when there is none
+	unsigned long	SlotSize;			// record block + image buffer [+ record block + packed area] [+ ancillary area]
+	unsigned long	Count;
+
+} tFrameArena;
+
+unsigned long FrameArenaSlotSize(unsigned long FrameSize,unsigned long PackedSize,unsigned long AncillarySize,
+								unsigned long BlockSize);
+bool FrameArenaInit(tFrameArena *pArena,tPvFrame *Frames,unsigned long Count,unsigned long FrameSize,
+					unsigned long PackedSize,unsigned long AncillarySize,unsigned long BlockSize);
+bool FrameArenaReuse(tFrameArena *pArena,tPvFrame *Frames,unsigned long Count,unsigned long FrameSize,
+					unsigned long PackedSize,unsigned long AncillarySize,unsigned long BlockSize);
+void FrameArenaDestroy(tFrameArena *pArena,tPvFrame *Frames);
+void *FrameArenaSlot(const tFrameArena *pArena,unsigned long Index);
+void *FrameArenaPacked(const tFrameArena *pArena,const tPvFrame *pFrame);
+
+#endif // FRAMEARENA_H_INCLUDE
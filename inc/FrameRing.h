@@ -0,0 +1,66 @@
+/*!
+ *  @file
+ *     FrameRing.h
+ *  @brief
+ *     OTC project: This file contains the declaration of the lock-free single
+ *	   producer / single consumer ring of frames between FrameDoneCB() (producer)
+ *	   and the writer thread of the camera (consumer)
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef FRAMERING_H_INCLUDE
+#define FRAMERING_H_INCLUDE
+
+#include "Utility.h"
+
+#define RING_CACHE_LINE 64
+
+#ifdef _WINDOWS
+#define RING_ALIGN		__declspec(align(RING_CACHE_LINE))
+#define RING_BARRIER()	MemoryBarrier()
+#else
+#define RING_ALIGN		__attribute__((aligned(RING_CACHE_LINE)))
+#define RING_BARRIER()	__sync_synchronize()
+#endif
+
+/*!
+ * @brief
+ *		Bounded ring of frame pointers. Head is only written by the consumer
+ *		and Tail only by the producer, each one sits on its own cache line so
+ *		the two threads never share a line they write to
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct RING_ALIGN
+{
+	volatile unsigned long	Head;			// next slot to pop, consumer owned
+	char					_padHead[RING_CACHE_LINE - sizeof(unsigned long)];
+
+	volatile unsigned long	Tail;			// next slot to push, producer owned
+	char					_padTail[RING_CACHE_LINE - sizeof(unsigned long)];
+
+	volatile long			ConsumerWaiting;// consumer is (about to be) asleep on Ready, cleared by the push that signals it
+	char					_padWait[RING_CACHE_LINE - sizeof(long)];
+
+	tPvFrame**				Slots;
+	unsigned long			Capacity;		// power of two
+	unsigned long			Mask;
+	tEvent					Ready;			// signaled when a frame is pushed to an empty ring
+
+} tFrameRing;
+
+bool FrameRingInit(tFrameRing *pRing,unsigned long Capacity);
+void FrameRingDestroy(tFrameRing *pRing);
+bool FrameRingPush(tFrameRing *pRing,tPvFrame *pFrame);
+tPvFrame *FrameRingPop(tFrameRing *pRing);
+tPvFrame *FrameRingWaitPop(tFrameRing *pRing,unsigned long Timeout);
+void FrameRingWake(tFrameRing *pRing);
+unsigned long FrameRingDepth(const tFrameRing *pRing);
+
+void FrameRingBenchmark();
+
+#endif // FRAMERING_H_INCLUDE
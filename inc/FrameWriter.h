@@ -0,0 +1,124 @@
+/*!
+ *  @file
+ *     FrameWriter.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the asynchronous frame writer. The frame-done callback only hands the
+ *	   frame over, the writer thread saves it and gives it back to the camera
+ *
+ *	   With -process pool the writer hands the processing of every frame
+ *	   (attributes, chunk data, compression) to the work pool shared by the
+ *	   cameras and only stores the processed frames, in the order they were
+ *	   captured: a frame done early waits for the older ones of its camera
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef FRAMEWRITER_H_INCLUDE
+#define FRAMEWRITER_H_INCLUDE
+
+#include "Utility.h"
+#include "FrameRing.h"
+#include "CompressStage.h"
+
+/*
+	Default ring capacity, must hold every frame that can be in flight for a
+	camera (FRAMESCOUNT)
+*/
+#define WRITER_QUEUE_SIZE 16
+#define WRITER_DRAIN_WAIT 1			// ms between two looks at the ring and the jobs of the pool once stopped
+
+typedef enum
+{
+	eProcessWriter			= 0,			// the writer thread of the camera does everything
+	eProcessPool			= 1				// the frames are processed on the work pool
+
+} tProcessMode;
+
+struct tCamera;
+
+/*!
+ * @brief
+ *		Processing of one frame on the work pool, indexed like tCamera::Frames
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	tWorkJob			Job;
+	struct tCamera*		pCamera;
+	tPvFrame*			pFrame;
+	bool				Compress;			// decided by the writer when it hands the frame over
+	tCompressor			Compressor;			// the frame only, its counters go to the camera once stored
+	tRawMetadata		Metadata;
+	tRawPayload			Payload;
+	bool				Packed;				// Payload holds the compressed image
+	volatile long		Done;
+	unsigned long long	SubmittedAt;
+	unsigned long long	DoneAt;
+
+} tFrameJob;
+
+/*!
+ * @brief
+ *		Per camera writer state: ring of pending frames, writer thread and counters
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	tFrameRing			Ring;				// FrameDoneCB() pushes, the writer thread pops
+	tThread				Thread;
+	bool				Running;
+	volatile bool		Stop;
+
+	/*
+	Counters, read by the status line
+	*/
+	unsigned long		QueueDepthMax;		// written by the producer only
+	unsigned long		FramesWritten;
+	unsigned long		FramesFailed;		// frames that could not be queued, producer only
+	unsigned long long	WriteLatencyLast;	// microseconds spent writing the last frame
+	unsigned long long	WriteLatencyMax;
+	unsigned long long	WriteLatencyTotal;
+
+	/*
+	Time spent in the queue by each camera frame, indexed like tCamera::Frames
+	(FrameWriter.cpp checks that FRAMESCOUNT fits)
+	*/
+	unsigned long long	PushedAt[WRITER_QUEUE_SIZE];	// written by the producer only
+	unsigned long		QueueLatency[WRITER_QUEUE_SIZE];	// microseconds, written by the writer thread
+
+	/*
+	Frame done callback to record written, camera frames only
+	*/
+	tLatencyHistogram	DiskLatency;
+
+	/*
+	-process pool: the frames on the pool and the order to store them in,
+	writer thread only but Processing
+	*/
+	tFrameJob*			Jobs;				// indexed like the camera frames
+	unsigned long		Order[WRITER_QUEUE_SIZE];	// frame indexes, oldest first
+	unsigned long		OrderHead;
+	unsigned long		OrderCount;
+	unsigned long		OrderMax;			// frames on the pool at once
+	unsigned long		FramesHeld;			// done before an older frame of the camera
+	unsigned long long	LastDoneAt;			// of the last frame stored
+	volatile long		Processing;			// jobs not over, they still touch the writer
+
+} tFrameWriter;
+
+bool FrameWriterStart(struct tCamera *tCamInstance,unsigned long QueueSize);
+void FrameWriterStop(struct tCamera *tCamInstance);
+bool FrameWriterPush(struct tCamera *tCamInstance,tPvFrame *pFrame);
+void FrameWriterStored(void *Context,tPvFrame *pFrame,bool Success,unsigned long long Latency);
+unsigned long FrameWriterQueueDepth(const tFrameWriter *pWriter);
+double FrameWriterAverageLatency(const tFrameWriter *pWriter);
+unsigned long FrameQueueLatency(const struct tCamera *tCamInstance,const tPvFrame *pFrame);
+
+#endif // FRAMEWRITER_H_INCLUDE
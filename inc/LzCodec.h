@@ -0,0 +1,20 @@
+/*!
+ *  @file
+ *     LzCodec.h
+ *  @brief
+ *     OTC project: This file contains functions declaration for the LZ codec of
+ *	   the compression stage. The blocks use the LZ4 block format (sequences of
+ *	   literals and 64KB window matches) so any LZ4 decoder can read them back
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef LZCODEC_H_INCLUDE
+#define LZCODEC_H_INCLUDE
+
+unsigned long LzCompress(const void *pSource,unsigned long SourceSize,void *pTarget,unsigned long TargetCapacity);
+bool LzDecompress(const void *pSource,unsigned long SourceSize,void *pTarget,unsigned long TargetSize);
+
+#endif // LZCODEC_H_INCLUDE
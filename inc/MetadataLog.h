@@ -0,0 +1,116 @@
+/*!
+ *  @file
+ *     MetadataLog.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the per-frame metadata log. One record per saved frame goes in a
+ *	   block held in memory, column by column, and the block is appended to the
+ *	   metadata.avm file of the camera when it is full or old enough.
+ *	   MetadataLogExport() turns a log into CSV
+ *
+ *	   File layout:
+ *	   - tMetadataFileHeader
+ *	   - blocks: tMetadataBlockHeader, then each column of the block in the
+ *	     order of the record (Count values of the width of the column)
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef METADATALOG_H_INCLUDE
+#define METADATALOG_H_INCLUDE
+
+#include "Utility.h"
+
+#define METADATA_MAGIC			"AVMETA01"
+#define METADATA_BLOCK_MAGIC	0x4B4C424D		// "MBLK"
+#define METADATA_VERSION		2
+#define METADATA_COLUMNS		10
+#define METADATA_COLUMNS_V1		9				// version 1 logs have no AcquisitionCount
+#define METADATA_BLOCK_RECORDS	1024
+#define METADATA_FLUSH_SECONDS	5				// age of the oldest record before the block is written
+
+#pragma pack(push,4)
+
+typedef struct
+{
+	char				Magic[8];			// METADATA_MAGIC
+	unsigned int		Version;
+	unsigned int		HeaderSize;
+	unsigned int		CameraUID;
+	unsigned int		Columns;			// METADATA_COLUMNS
+	unsigned int		BlockRecords;		// most records in a block
+
+} tMetadataFileHeader;
+
+typedef struct
+{
+	unsigned int		Magic;				// METADATA_BLOCK_MAGIC
+	unsigned int		Count;				// records in the block
+
+} tMetadataBlockHeader;
+
+#pragma pack(pop)
+
+/*!
+ * @brief
+ *		One frame, the columns of the log in their order
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned long long	Timestamp;			// camera timestamp (TimestampHi:TimestampLo)
+	unsigned int		UID;
+	unsigned int		FrameCount;
+	unsigned int		Status;				// tPvErr
+	unsigned int		Exposure;
+	unsigned int		Gain;
+	unsigned int		WhitebalRed;
+	unsigned int		WhitebalBlue;
+	unsigned int		QueueLatency;		// microseconds between the frame done callback and the writer
+	unsigned int		AcquisitionCount;	// from the chunk data of the frame, 0 without it
+
+} tMetadataRecord;
+
+/*!
+ * @brief
+ *		Metadata log of one camera: the file and the block being filled
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	FILE*				pFile;
+	unsigned long		Count;
+	unsigned long long	FirstAt;			// GetMicroseconds() of the first record of the block
+
+	unsigned long long	Timestamp[METADATA_BLOCK_RECORDS];
+	unsigned int		UID[METADATA_BLOCK_RECORDS];
+	unsigned int		FrameCount[METADATA_BLOCK_RECORDS];
+	unsigned int		Status[METADATA_BLOCK_RECORDS];
+	unsigned int		Exposure[METADATA_BLOCK_RECORDS];
+	unsigned int		Gain[METADATA_BLOCK_RECORDS];
+	unsigned int		WhitebalRed[METADATA_BLOCK_RECORDS];
+	unsigned int		WhitebalBlue[METADATA_BLOCK_RECORDS];
+	unsigned int		QueueLatency[METADATA_BLOCK_RECORDS];
+	unsigned int		AcquisitionCount[METADATA_BLOCK_RECORDS];
+
+	/*
+	Counters
+	*/
+	unsigned long		Records;
+	unsigned long		Blocks;
+
+} tMetadataLog;
+
+bool MetadataLogOpen(tMetadataLog *pLog,const char *Directory,unsigned long UID);
+void MetadataLogAppend(tMetadataLog *pLog,const tMetadataRecord *pRecord);
+bool MetadataLogFlush(tMetadataLog *pLog);
+void MetadataLogClose(tMetadataLog *pLog);
+bool MetadataLogExport(const char *LogFile,const char *CsvFile);
+
+#endif // METADATALOG_H_INCLUDE
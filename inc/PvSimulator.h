@@ -0,0 +1,91 @@
+/*!
+ *  @file
+ *     PvSimulator.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the simulated PvAPI backend. PvSimulator.cpp implements the part of
+ *	   PvApi.h the application uses over N virtual GigE cameras, so the capture
+ *	   path can be run and benchmarked without any camera. It is linked in place
+ *	   of the PvAPI library, with PV_SIMULATOR defined, by the Linux Makefile
+ *	   when no PVAPI_LIB is given (it is not part of the Windows build):
+ *
+ *	   make && PVSIM="cameras=2" Linux/AVCameraThreaded
+ *
+ *	   The cameras are set up by PvSimConfigure() before PvInitialize(), or
+ *	   else from the PVSIM environment variable, a list of key=value:
+ *
+ *	   PVSIM="cameras=2,fps=30,format=Bayer8,width=1360,height=1024,loss=0.01,jitter=2,unplug=60,replug=5"
+ *
+ *	   - cameras     number of virtual cameras (SIM_MAX_CAMERAS at most)
+ *	   - uid         UniqueId of the first camera, the next ones follow
+ *	   - fps         frame rate of every camera, 0 to follow the FrameRate attribute
+ *	   - format      tPvImageFormat name without ePvFmt (Mono8, Bayer16, Rgb24, ...)
+ *	   - width/height
+ *	   - loss        share of the frames completed with ePvErrDataLost
+ *	   - missing     share of the frames completed with ePvErrDataMissing
+ *	   - jitter      frames are completed up to this many milliseconds early or late
+ *	   - unplug      seconds after which a camera is unplugged (0.5 to 1.5 times that), 0 never
+ *	   - replug      seconds after which an unplugged camera that has been closed comes back, 0 never
+ *	   - discovery   milliseconds between PvInitialize() and the ePvLinkAdd of the cameras
+ *	   - control     milliseconds of a control transaction (PvCameraOpen(), an attribute
+ *	                 read or write, a command), the GVCP round trip of a real camera
+ *	   - seed        random seed of the injections
+ *
+ *	   PvRegisterRead() (PvRegIo.h) reads the stream statistics block of a
+ *	   camera, SIM_REG_STATS and the registers after it, all of them in one
+ *	   control transaction. The cameras report part number SIM_PART_NUMBER.
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef PVSIMULATOR_H_INCLUDE
+#define PVSIMULATOR_H_INCLUDE
+
+#include "Utility.h"
+
+#define SIM_MAX_CAMERAS			16
+#define SIM_QUEUE_SIZE			64			// frames queued per camera, then ePvErrQueueFull
+#define SIM_MAX_CALLBACKS		8			// link callbacks
+#define SIM_FIRST_UID			112322
+#define SIM_DEFAULT_FPS			15.0f		// FrameRate of a camera that was never set
+#define SIM_MAX_FPS				200.0f
+#define SIM_TIMESTAMP_FREQUENCY	1000000		// timestamps are in microseconds
+#define SIM_PART_NUMBER			2100
+#define SIM_REG_STATS			0x00011000	// frames completed, dropped, packets missed, erroneous, received, frame rate (float)
+#define SIM_REG_STATS_COUNT		6
+
+/*!
+ * @brief
+ *		Virtual cameras and the faults injected in them
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned long		Cameras;
+	unsigned long		FirstUID;
+	float				FrameRate;			// 0: the FrameRate attribute of the camera
+	tPvImageFormat		Format;
+	unsigned long		Width;
+	unsigned long		Height;
+	double				LossRate;			// 0 to 1
+	double				MissingRate;		// 0 to 1
+	unsigned long		Jitter;				// milliseconds
+	unsigned long		UnplugAfter;		// seconds, 0 never
+	unsigned long		ReplugAfter;		// seconds, 0 never
+	unsigned long		Discovery;			// milliseconds
+	unsigned long		Control;			// milliseconds per control transaction
+	unsigned long		Seed;
+
+} tPvSimConfig;
+
+void PvSimDefaults(tPvSimConfig *pConfig);
+bool PvSimParse(const char *Spec,tPvSimConfig *pConfig);
+bool PvSimConfigure(const tPvSimConfig *pConfig);
+bool PvSimUnplug(unsigned long UID);
+bool PvSimPlug(unsigned long UID);
+
+#endif // PVSIMULATOR_H_INCLUDE
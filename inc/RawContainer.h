@@ -0,0 +1,219 @@
+/*!
+ *  @file
+ *     RawContainer.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the append-only raw stream container. Every camera writes its frames
+ *	   sequentially in large preallocated segment files instead of one TIFF and
+ *	   one stat file per frame
+ *
+ *	   Segment layout:
+ *	   - tRawSegmentHeader, padded to tRawSegmentHeader::HeaderSize
+ *	   - one record per frame: tRawRecordHeader and tRawMetadata padded to
+ *	     tRawRecordHeader::HeaderSize, then the pixels (or their compressed
+ *	     strips) padded to the alignment of the segment (8 bytes, or the block
+ *	     size when written with direct I/O)
+ *	   - index: one tRawIndexEntry per record
+ *	   - tRawSegmentTrailer (last bytes of the file)
+ *	   Records are self-describing, so a segment left without its index (power
+ *	   loss) can still be read by walking the records from the segment header
+ *
+ *	   With direct I/O every record is one block aligned write from the frame
+ *	   arena: the header goes in the record block in front of the image buffer
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef RAWCONTAINER_H_INCLUDE
+#define RAWCONTAINER_H_INCLUDE
+
+#include "Utility.h"
+
+#define RAW_SEGMENT_MAGIC	"AVRAWSEG"
+#define RAW_TRAILER_MAGIC	"AVRAWIDX"
+#define RAW_RECORD_MAGIC	0x314D5246		// "FRM1"
+#define RAW_VERSION			3
+
+#define RAW_ALIGNMENT		8				// of the records without direct I/O
+#define RAW_WRITE_BEHIND	(8*1024*1024)	// write-behind window
+
+#define RAW_STRIP_STORED	0x80000000		// in a strip size: strip kept uncompressed
+
+#define RAW_DEFAULT_SEGMENT_MB		1024
+#define RAW_DEFAULT_SEGMENT_SECONDS	300
+
+#ifdef _WINDOWS
+typedef HANDLE tRawFile;
+#else
+typedef int tRawFile;
+#endif
+
+struct tAsyncStorage;
+
+typedef enum
+{
+	eRawIoBuffered		= 0,			// through the cache of the system
+	eRawIoDirect		= 1,			// O_DIRECT / FILE_FLAG_NO_BUFFERING, needs frame arena buffers
+	eRawIoWriteBehind	= 2				// cached, but written back and dropped from the cache behind the writer
+
+} tRawIoMode;
+
+typedef enum
+{
+	eRawCompressionNone	= 0,			// pixels as the camera sent them
+	eRawCompressionLz	= 1,			// tRawStripTable, then one LZ4 block per strip
+	eRawCompressionBayer = 2			// tRawStripTable, then one BayerEncode() stream per strip
+
+} tRawCompression;
+
+#pragma pack(push,4)
+
+typedef struct
+{
+	char				Magic[8];			// RAW_SEGMENT_MAGIC
+	unsigned int		Version;
+	unsigned int		HeaderSize;
+	unsigned int		CameraUID;
+	unsigned int		Segment;			// rolling segment number for the camera
+	unsigned long long	CreatedAt;			// seconds since the epoch
+	unsigned long long	Preallocated;		// bytes reserved when the segment was opened
+	unsigned int		Alignment;			// of the records and of their sizes
+	unsigned int		Reserved;
+
+} tRawSegmentHeader;
+
+typedef struct
+{
+	unsigned int		Magic;				// RAW_RECORD_MAGIC
+	unsigned int		HeaderSize;			// offset of the pixels in the record
+	unsigned int		RecordSize;			// header + metadata + pixels + padding
+	unsigned int		Status;
+	unsigned int		Width;
+	unsigned int		Height;
+	unsigned int		RegionX;
+	unsigned int		RegionY;
+	unsigned int		Format;				// tPvImageFormat
+	unsigned int		BitDepth;
+	unsigned int		BayerPattern;		// tPvBayerPattern
+	unsigned int		FrameCount;
+	unsigned int		TimestampLo;
+	unsigned int		TimestampHi;
+	unsigned int		ImageSize;			// bytes of pixels once decompressed
+	unsigned int		MetadataSize;		// bytes of tRawMetadata following this header
+	unsigned int		Compression;		// tRawCompression
+	unsigned int		StoredSize;			// bytes at HeaderSize
+
+} tRawRecordHeader;
+
+typedef struct
+{
+	unsigned int		Exposure;
+	unsigned int		Gain;
+	unsigned int		WhitebalRed;
+	unsigned int		WhitebalBlue;
+
+} tRawMetadata;
+
+/*
+	Start of a compressed image, followed by StripCount sizes then by the strips
+*/
+typedef struct
+{
+	unsigned int		StripCount;
+	unsigned int		StripRows;			// rows per strip, the last one may be shorter
+
+} tRawStripTable;
+
+typedef struct
+{
+	unsigned long long	Offset;				// of the record header in the segment
+	unsigned long long	Timestamp;			// camera timestamp (TimestampHi:TimestampLo)
+	unsigned int		FrameCount;
+	unsigned int		RecordSize;
+
+} tRawIndexEntry;
+
+typedef struct
+{
+	unsigned long long	IndexOffset;
+	unsigned int		IndexCount;
+	unsigned int		Reserved;
+	char				Magic[8];			// RAW_TRAILER_MAGIC
+
+} tRawSegmentTrailer;
+
+#pragma pack(pop)
+
+/*!
+ * @brief
+ *		What a record stores when it is not the image buffer of the frame.
+ *		With direct I/O the data must come from the frame arena (FrameArenaPacked())
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	const void*			pData;
+	unsigned long		Size;
+	tRawCompression		Compression;
+
+} tRawPayload;
+
+/*!
+ * @brief
+ *		Recorder state of one camera: the open segment and its in-memory index
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	char				Directory[100];
+	unsigned long		UID;
+	unsigned long long	SegmentSize;		// preallocated bytes per segment
+	unsigned long		SegmentSeconds;		// rotation period
+	tRawIoMode			IoMode;
+	unsigned long		Alignment;			// RAW_ALIGNMENT, or the block size with direct I/O
+
+	tRawFile			File;
+	bool				IsOpen;
+	unsigned long		Segment;			// open or next segment, numbered after the ones already in the directory
+	unsigned long		OpenedAt;			// seconds since the epoch when the segment was opened
+	unsigned long long	WriteOffset;
+	unsigned long long	WriteBehindOffset;	// write-back started up to here
+	unsigned long long	DroppedOffset;		// dropped from the cache up to here
+
+	struct tAsyncStorage*	pStorage;		// asynchronous writes, NULL when writing on the caller thread
+
+	tRawIndexEntry*		Index;
+	unsigned long		IndexCount;
+	unsigned long		IndexCapacity;
+	tLock				IndexLock;			// growing the index against RawContainerDrop(), while a segment is open
+
+	/*
+	Counters
+	*/
+	unsigned long		SegmentsClosed;
+	unsigned long long	BytesWritten;
+	unsigned long		RecordsDropped;		// failed asynchronous writes left out of the index
+
+} tRawContainer;
+
+void RawContainerInit(tRawContainer *pContainer,const char *Directory,unsigned long UID,
+					  unsigned long SegmentMB,unsigned long SegmentSeconds,tRawIoMode IoMode,unsigned long BlockSize);
+bool RawContainerReuse(tRawContainer *pContainer,const char *Directory,unsigned long UID,
+					   unsigned long SegmentMB,unsigned long SegmentSeconds,tRawIoMode IoMode,unsigned long BlockSize);
+bool RawContainerReserve(tRawContainer *pContainer,tPvFrame *pFrame,const tRawMetadata *pMetadata,
+						 const tRawPayload *pPayload,tRawRecordHeader *pHeader,unsigned long long *pOffset);
+bool RawContainerWrite(tRawContainer *pContainer,tPvFrame *pFrame,const tRawMetadata *pMetadata,const tRawPayload *pPayload);
+void RawContainerDrop(tRawContainer *pContainer,unsigned long Entry,unsigned long long Offset);
+const char *RawContainerIoName(tRawIoMode IoMode);
+const void *RawRecordData(const tPvFrame *pFrame,const tRawPayload *pPayload);
+void RawContainerClose(tRawContainer *pContainer);
+
+bool RawFileWriteAt(tRawFile File,unsigned long long Offset,const void *pBuffer,unsigned long Size);
+
+#endif // RAWCONTAINER_H_INCLUDE
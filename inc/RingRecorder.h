@@ -0,0 +1,102 @@
+/*!
+ *  @file
+ *     RingRecorder.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the pre-trigger ring recorder. While armed, the writer thread of a
+ *	   camera only copies the frames in a pool of RAM slots, the oldest one
+ *	   overwritten first, and nothing goes to the disk. A trigger (API call,
+ *	   message on the local trigger port or error condition) flushes the frames
+ *	   of the last pre-roll seconds, then the live frames are saved as usual for
+ *	   the post-roll seconds before the recorder arms again
+ *
+ *	   The slots are laid out like the frame arena of the camera (record block,
+ *	   image buffer, packed area, chunk data) so FrameSave() writes the copies
+ *	   like camera frames, direct I/O and compression included
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef RINGRECORDER_H_INCLUDE
+#define RINGRECORDER_H_INCLUDE
+
+#include "Utility.h"
+#include "FrameArena.h"
+#include "RawContainer.h"
+
+#define RING_DEFAULT_MB				512
+#define RING_DEFAULT_POSTROLL		5			// seconds
+#define RING_MIN_SLOTS				2
+
+struct tCamera;
+
+typedef enum
+{
+	eRingTriggerNone		= 0,
+	eRingTriggerApi			= 1,			// RingRecorderTrigger() called by the application
+	eRingTriggerPort		= 2,			// message on the local trigger port
+	eRingTriggerFrameError	= 3,			// frame completed with lost or missing data
+	eRingTriggerOverflow	= 4,			// the writer queue could not take a frame
+	eRingTriggerUnplug		= 5				// camera unplugged, what is in RAM is saved
+
+} tRingTrigger;
+
+/*!
+ * @brief
+ *		Pre-trigger recorder of one camera: the slot pool and the trigger state
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	bool				Enabled;
+	tFrameArena			Arena;				// buffers of the slots
+	tPvFrame*			Frames;				// copies of the camera frames
+	tRawMetadata*		Metadata;			// attributes read when the frame was kept
+	unsigned long long*	KeptAt;				// GetMicroseconds() when the frame was kept
+	unsigned long*		QueueLatency;		// FrameQueueLatency() of the camera frame
+	unsigned long		Count;				// slots in the memory budget
+	unsigned long		Head;				// oldest frame
+	unsigned long		Used;
+
+	unsigned long long	PreRoll;			// microseconds
+	unsigned long long	PostRoll;
+
+	/*
+	Triggers: any thread counts them up, the writer thread serves them
+	*/
+	volatile long		Triggers;
+	long				TriggersServed;
+	volatile tRingTrigger	LastTrigger;
+
+	unsigned long		FlushLeft;			// pre-roll frames still to write, from Head
+	unsigned long long	PostRollUntil;		// live frames are saved until then, 0 when armed
+
+	/*
+	Counters, read by the status line
+	*/
+	unsigned long		FramesKept;
+	unsigned long		FramesOverwritten;
+	unsigned long		FramesFlushed;
+
+} tRingRecorder;
+
+bool RingRecorderStart(struct tCamera *tCamInstance,unsigned long BudgetMB,unsigned long PreRollSeconds,
+					   unsigned long PostRollSeconds,unsigned long FrameSize,unsigned long PackedSize,
+					   unsigned long AncillarySize);
+void RingRecorderStop(struct tCamera *tCamInstance);
+void RingRecorderTrigger(struct tCamera *tCamInstance,tRingTrigger Reason);
+bool RingRecorderKeep(struct tCamera *tCamInstance,tPvFrame *pFrame);
+bool RingRecorderService(struct tCamera *tCamInstance);
+bool RingRecorderOwns(const tRingRecorder *pRecorder,const tPvFrame *pFrame);
+const char *RingRecorderState(const tRingRecorder *pRecorder);
+
+typedef void (*tRingTriggerCallback)(unsigned long UID);
+
+bool RingTriggerListenerStart(unsigned short Port,tRingTriggerCallback Callback);
+void RingTriggerListenerStop();
+
+#endif // RINGRECORDER_H_INCLUDE
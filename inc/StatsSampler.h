@@ -0,0 +1,82 @@
+/*!
+ *  @file
+ *     StatsSampler.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the stream statistics sampler of a camera. The statistics task
+ *	   reads five values every 20 ms, one control transaction each as
+ *	   attributes. Where the part number of the camera has a known register
+ *	   map, the sampler fetches all of them with one PvRegisterRead()
+ *	   (PvRegIo.h); the statistics without a register, and every one of them
+ *	   on an unknown camera, are read as attributes through the attribute
+ *	   table. A batch that fails sends the camera back to the attributes.
+ *
+ *	   AVCameraThreaded -stats attributes keeps the attribute reads,
+ *	   -bench stats counts the control transactions of both.
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef STATSSAMPLER_H_INCLUDE
+#define STATSSAMPLER_H_INCLUDE
+
+#include "Utility.h"
+#include "AttributeTable.h"
+
+#define STATS_PERIOD			20			// milliseconds between two samples of the statistics task, -stats-ms
+#define STATS_BENCH_SECONDS		3
+
+typedef enum
+{
+	eStatFramesCompleted	= 0,
+	eStatFramesDropped		= 1,
+	eStatPacketsMissed		= 2,
+	eStatPacketsErroneous	= 3,
+	eStatFrameRate			= 4,			// IEEE float in its register
+	eStatCount				= 5
+
+} tStatIndex;
+
+/*!
+ * @brief
+ *		One sample of the stream statistics
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	tPvUint32			FramesCompleted;
+	tPvUint32			FramesDropped;
+	tPvUint32			PacketsMissed;
+	tPvUint32			PacketsErroneous;
+	tPvFloat32			FrameRate;
+
+} tStreamStats;
+
+/*!
+ * @brief
+ *		Sampler of one camera: the registers read in a batch, in the order of
+ *		tStatIndex, and the control transactions it made
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	tAttributeTable		*pTable;
+	unsigned long		Address[eStatCount];	// 0: read as an attribute
+	unsigned long		Mapped;				// statistics read in the batch
+
+	volatile long		Samples;
+	volatile long		Transactions;
+
+} tStatsSampler;
+
+void StatsSamplerOpen(tStatsSampler *pSampler,tAttributeTable *pTable,unsigned long UID,bool Registers);
+tPvErr StatsSamplerRead(tStatsSampler *pSampler,tStreamStats *pStats);
+void StatsSamplerBenchmark();
+
+#endif // STATSSAMPLER_H_INCLUDE
@@ -0,0 +1,66 @@
+/*!
+ *  @file
+ *     TiffWriter.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the native TIFF writer. The header of the file (IFD included) only
+ *	   depends on the format and the geometry of the frames, it is built once
+ *	   and every frame is written as that header followed by the untouched
+ *	   image buffer, in one gathered write
+ *
+ *	   Uncompressed little-endian TIFF, one strip:
+ *	   - Mono8, Mono16: grayscale
+ *	   - Bayer8, Bayer16: CFA image (TIFF/EP CFARepeatPatternDim, CFAPattern)
+ *	   - Rgb24, Rgb48: interleaved RGB
+ *	   16 bits data are kept LSB aligned, as the camera sends them
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef TIFFWRITER_H_INCLUDE
+#define TIFFWRITER_H_INCLUDE
+
+#include "Utility.h"
+
+#define TIFF_HEADER_MAX		256
+
+/*!
+ * @brief
+ *		Cached TIFF header of one camera, rebuilt when the frames change
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	/*
+	Frame description the header was built for
+	*/
+	tPvImageFormat		Format;
+	unsigned long		Width;
+	unsigned long		Height;
+	unsigned long		BitDepth;
+	tPvBayerPattern		BayerPattern;
+	unsigned long		ImageSize;
+
+	unsigned char		Header[TIFF_HEADER_MAX];
+	unsigned long		HeaderSize;			// 0 until the first frame
+
+	/*
+	Counters
+	*/
+	unsigned long		HeadersBuilt;
+	unsigned long		FilesWritten;
+	unsigned long long	BytesWritten;
+
+} tTiffWriter;
+
+void TiffWriterInit(tTiffWriter *pWriter);
+bool TiffWriterSupports(const tPvFrame *pFrame);
+bool TiffWriterWrite(tTiffWriter *pWriter,const char *Filename,const tPvFrame *pFrame);
+
+void TiffWriterBenchmark();
+
+#endif // TIFFWRITER_H_INCLUDE
@@ -0,0 +1,93 @@
+/*!
+ *  @file
+ *     TimerWheel.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the timer wheel. The periodic work of the cameras (statistics and
+ *	   status line, previewer refresh, alerts, disk checks) used to run on a
+ *	   statistics thread per camera, waking up every 20 ms. It runs now on one
+ *	   scheduler thread for the whole process: a hashed wheel of WHEEL_SLOTS
+ *	   slots of one tick each, a timer sits in the slot of the tick it is due.
+ *
+ *	   A timer is aligned on a multiple of its period, the timers of the same
+ *	   period (or of its multiples) fall in the same tick whatever the time they
+ *	   were added, and the thread runs all of them in one wake-up. It sleeps
+ *	   until the next slot that has a timer due, at most one revolution.
+ *
+ *	   The tasks run on the scheduler thread, one after the other: they must not
+ *	   block, the other cameras wait for them. TimerWheelCancel() returns once
+ *	   the task is not running any more, it must not be called from a task.
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef TIMERWHEEL_H_INCLUDE
+#define TIMERWHEEL_H_INCLUDE
+
+#include "Utility.h"
+
+#define WHEEL_TICK_MS			5			// default resolution of the timers
+#define WHEEL_SLOTS				256			// ticks of one revolution
+#define WHEEL_MAX_TIMERS		128			// four per camera of the registry, and some
+#define WHEEL_NO_TIMER			0xFFFFFFFF
+#define WHEEL_PREVIEW_MS		3000		// periods of the tasks of a camera, main() -preview-ms
+#define WHEEL_ALERT_MS			1000		// at most one alert per camera in this time, -alert-ms
+#define WHEEL_DISK_MS			5000		// free space of the camera directory, -disk-ms
+#define WHEEL_BENCH_CAMERAS		16
+#define WHEEL_BENCH_SECONDS		5
+
+typedef void (*tWheelTask)(void *pContext);
+
+/*!
+ * @brief
+ *		One periodic timer, in the list of the slot of its tick
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	const char			*Name;
+	tWheelTask			Task;
+	void				*pContext;
+	unsigned long		Period;				// ticks
+	unsigned long long	Due;				// tick
+	unsigned long		Next;				// next timer of the slot
+	bool				Used;
+	bool				Cancelled;			// TimerWheelCancel() waits for the task
+
+	unsigned long		Runs;
+	unsigned long long	Late;				// microseconds behind the tick, all the runs
+	unsigned long long	LateMax;
+
+} tWheelTimer;
+
+/*!
+ * @brief
+ *		Counters of the scheduler thread since it started
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned long		Timers;				// armed now
+	unsigned long		Wakeups;
+	unsigned long		Ticks;				// ticks that had a timer due, each one a wake-up or less
+	unsigned long		Runs;				// tasks run, Runs / Ticks timers coalesced per tick
+	double				LateAverage;		// milliseconds behind the tick
+	double				LateMax;
+
+} tWheelStats;
+
+bool TimerWheelStart(unsigned long TickMs);
+void TimerWheelStop();
+bool TimerWheelRunning();
+unsigned long TimerWheelAdd(const char *Name,tWheelTask Task,void *pContext,unsigned long Period);
+void TimerWheelCancel(unsigned long Timer);
+void TimerWheelSnapshot(tWheelStats *pStats);
+void TimerWheelBenchmark();
+
+#endif // TIMERWHEEL_H_INCLUDE
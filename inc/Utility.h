@@ -10,11 +10,103 @@
  ***********************************************************************
  */
 
+#ifndef UTILITY_H_INCLUDE
+#define UTILITY_H_INCLUDE
+
 /*
 	Include all the required header files here :
 	Check for windows or Linux compatibility also
 */
 #include "stdio.h"
+#ifdef _WINDOWS
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <pthread.h>
+#endif
 #include "PvApi.h"
 
-void convertandPrintErrorCode(tPvErr errorCode);
\ No newline at end of file
+/*
+	Thin wrappers over the Win32 / pthread primitives so that the worker
+	modules do not have to repeat the platform checks
+*/
+#ifdef _WINDOWS
+typedef HANDLE				tThread;
+typedef CRITICAL_SECTION	tLock;
+typedef HANDLE				tEvent;
+#define THREADPROC			unsigned long __stdcall
+typedef unsigned long (__stdcall *tThreadProc)(void *pContext);
+#else
+typedef pthread_t			tThread;
+typedef pthread_mutex_t		tLock;
+typedef struct
+{
+	pthread_mutex_t	Mutex;
+	pthread_cond_t	Cond;
+	bool			Signaled;
+} tEvent;
+#define THREADPROC			void *
+typedef void *(*tThreadProc)(void *pContext);
+#endif
+
+#define EVENT_INFINITE		0xFFFFFFFF
+
+/*
+	VS2008 only has _snprintf, big enough buffers keep it terminated
+*/
+#if defined(_MSC_VER) && _MSC_VER < 1900
+#define snprintf			_snprintf
+#endif
+
+/*
+	Latency histogram, 32 buckets per power of two up to about an hour
+*/
+#define LATENCY_SUB_BUCKETS	32
+#define LATENCY_BUCKETS		(LATENCY_SUB_BUCKETS * 28)
+
+typedef struct
+{
+	volatile long		Count[LATENCY_BUCKETS];
+
+} tLatencyHistogram;
+
+void convertandPrintErrorCode(tPvErr errorCode);
+
+#ifndef _WINDOWS
+void Sleep(unsigned int time);
+#endif
+
+unsigned long long GetMicroseconds();
+unsigned long long ProcessCpuMicroseconds();
+unsigned long ProcessorCount();
+bool MakeDirectory(const char *Directory);
+unsigned long long DiskFreeMegabytes(const char *Directory);
+
+bool ThreadSpawn(tThread *pThread,tThreadProc Proc,void *pContext);
+void ThreadJoin(tThread *pThread);
+bool ThreadSetAffinity(unsigned long Processor);
+bool ThreadSetRealtime(int Priority);
+
+void LockInit(tLock *pLock);
+void LockDestroy(tLock *pLock);
+void LockAcquire(tLock *pLock);
+void LockRelease(tLock *pLock);
+
+void *AlignedAlloc(unsigned long Size,unsigned long Alignment);
+void AlignedFree(void *pBuffer);
+
+long AtomicIncrement(volatile long *pValue);
+long AtomicDecrement(volatile long *pValue);
+long AtomicExchange(volatile long *pValue,long Value);
+
+void EventInit(tEvent *pEvent);
+void EventDestroy(tEvent *pEvent);
+void EventSignal(tEvent *pEvent);
+bool EventWait(tEvent *pEvent,unsigned long Timeout);
+
+void LatencyRecord(tLatencyHistogram *pHistogram,unsigned long long Microseconds);
+unsigned long long LatencyPercentile(const tLatencyHistogram *pHistogram,double Fraction);
+
+#endif // UTILITY_H_INCLUDE
@@ -0,0 +1,83 @@
+/*!
+ *  @file
+ *     WorkPool.h
+ *  @brief
+ *     OTC project: This file contains functions and data structures declaration
+ *	   for the work-stealing pool shared by all the cameras. Every worker has a
+ *	   queue of jobs: it takes the oldest one of its own queue, and when it is
+ *	   empty it steals the oldest one of another worker. A camera always
+ *	   submits to the same worker (its home), the idle workers come and take
+ *	   the jobs of the busy cameras. Oldest first everywhere: the frames are
+ *	   stored in capture order, the oldest job is the one a writer waits for.
+ *
+ *	   The pool runs the compression strips (-compress) and, with
+ *	   -process pool, the processing of whole frames (attributes, chunk data,
+ *	   compression); the writer thread of the camera stores the processed
+ *	   frames in the order they were captured (see FrameWriter.h).
+ *
+ *	   The threads waiting for their jobs help: WorkPoolHelp() runs any job of
+ *	   the pool, they are counted as the helpers
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#ifndef WORKPOOL_H_INCLUDE
+#define WORKPOOL_H_INCLUDE
+
+#include "Utility.h"
+
+#define WORKPOOL_MAX_THREADS	16
+#define WORKPOOL_QUEUE_SIZE		512			// jobs waiting on one worker, a power of 2
+#define WORKPOOL_CACHE_LINE		64
+
+struct tWorkJob;
+
+typedef void (*tWorkProc)(struct tWorkJob *pJob);
+
+/*!
+ * @brief
+ *		One job, embedded in the structure of its owner which keeps it alive
+ *		until Run returns
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct tWorkJob
+{
+	tWorkProc			Run;
+	void*				pContext;
+
+} tWorkJob;
+
+/*!
+ * @brief
+ *		Counters of a worker (or of all the helpers), since the pool started.
+ *		WorkPoolSnapshot() fills WORKPOOL_MAX_THREADS + 1 of them: the workers,
+ *		then the helpers
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned long long	JobsRun;
+	unsigned long long	Steals;				// jobs taken from the queue of another worker
+	unsigned long long	BusyTime;			// microseconds running jobs
+	unsigned long long	Elapsed;			// microseconds since the pool started
+
+} tWorkStats;
+
+bool WorkPoolStart(unsigned long Threads);
+void WorkPoolStop();
+bool WorkPoolRunning();
+unsigned long WorkPoolThreadCount();
+
+void WorkPoolSubmit(tWorkJob *pJob,unsigned long Home);
+bool WorkPoolHelp(unsigned long Home);
+
+unsigned long WorkPoolSnapshot(tWorkStats *pStats);
+void WorkPoolReport(const tWorkStats *pBegin,const tWorkStats *pEnd);
+
+#endif // WORKPOOL_H_INCLUDE
@@ -10,6 +10,9 @@
  ***********************************************************************
  */
 
+#ifndef MAINHEADER_H_INCLUDE
+#define MAINHEADER_H_INCLUDE
+
 /*
 	Include all the required header files here :
 	Check for windows or Linux compatibility also
@@ -20,7 +23,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _MSC_VER
 #pragma warning (disable : 4996)
+#endif
 #ifdef _WINDOWS
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
@@ -41,8 +46,66 @@
 //#include "Utility.h"
 #include "snapCallback.h"
 #include "Utility.h"
+#include "FrameWriter.h"
+#include "FrameArena.h"
+#include "RawContainer.h"
+#include "AsyncStorage.h"
+#include "TiffWriter.h"
+#include "CompressStage.h"
+#include "BayerCodec.h"
+#include "RingRecorder.h"
+#include "MetadataLog.h"
+#include "AttributeTable.h"
+#include "StatsSampler.h"
+#include "AttributeCache.h"
+#include "ChunkData.h"
+#include "CaptureBenchmark.h"
+#include "CameraRegistry.h"
+#include "ControlLoop.h"
+#include "CapturePoller.h"
+#include "WorkPool.h"
+#include "CameraBringup.h"
+#include "CameraConfig.h"
+#include "TimerWheel.h"
+#include "Demosaic.h"
 
 #define FRAMESCOUNT 10
+#define MONITOR_DISK_MIN_MB		1024		// free space under which the disk check alerts, -disk-min
+
+
+/*!
+ * @brief 
+ *		Periodic tasks of a camera on the timer wheel (TimerWheel.h), armed
+ *		while it streams, and what they keep from one run to the next
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned long	Stats;			// timers, WHEEL_NO_TIMER when a task is off
+	unsigned long	Preview;
+	unsigned long	Alert;
+	unsigned long	Disk;
+	bool			Armed;
+
+	unsigned long	Before;			// status line
+	unsigned long	Elapsed;
+	unsigned long	Total;
+	unsigned long	Done;
+	double			Fps;
+
+	volatile long	PreviewDue;		// the writer saves its next frame for the previewer
+	volatile long	Failed;			// frames that did not complete, counted by the writer
+	long			Alerted;		// Failed at the last alert
+	bool			DiskLow;
+
+	tDemosaic		Demosaic;		// previewer in color, -preview-color
+	tTiffWriter		ColorTiff;
+	void			*pColor;
+	unsigned long	ColorSize;
+
+} tCameraMonitor;
 
 
 /*!
@@ -53,9 +116,10 @@
  * @author Waazim Reza
  * @version 1.0
  */
-typedef struct 
+typedef struct tCamera
 {
 	unsigned long   UID;
+	unsigned long	Index;			// slot in the camera registry
 	tPvHandle       Handle;
 	tPvFrame        Frames[FRAMESCOUNT];
 #ifdef _WINDOWS
@@ -67,6 +131,22 @@ typedef struct
 	bool            Abort;
 	bool            readyToCapture;
 	bool			isUnplugged;
+	tFrameArena		Arena;			// aligned storage of the frame buffers
+	tFrameWriter	Writer;			// saves the frames off the callback thread
+	tRawContainer	Container;		// segment files, when recording with -raw
+	tAsyncStorage	Storage;		// asynchronous writes of the segments, -storage
+	tTiffWriter		Tiff;			// cached TIFF header of the camera
+	tCompressor		Compressor;		// compression of the records, -compress
+	tRingRecorder	Recorder;		// pre-trigger RAM ring, -preroll
+	tMetadataLog	Log;			// metadata of the saved frames
+	tAttributeTable	AttrTable;		// typed handles of the attributes read while streaming
+	tStatsSampler	Stats;			// stream statistics of the statistics task
+	tAttributeCache	Attributes;		// attributes stored with the frames, -attr-refresh
+	tCapturePoller	Poller;			// polling thread, -acquire poll
+	tCameraBringup	Bringup;		// open and start on a thread of the camera
+	tCameraConfig	Config;			// attributes set by CameraStart(), kept for the reconnects
+	tCameraReconnect	Reconnect;
+	tCameraMonitor	Monitor;		// statistics, previewer, alerts and disk checks on the timer wheel
 
 } tCamera;
 
@@ -75,6 +155,25 @@ bool CameraGrab(tCamera *tCamInstance,unsigned long UID);
 tPvErr CameraSetup(tCamera *tCamInstance);
 bool CameraStart(tCamera *tCamInstance);
 void CameraUnsetup(tCamera *tCamInstance);
-void WaitThread(tCamera *tCamInstance);
+void CameraDetach(tCamera *tCamInstance);
+void CameraUnplugged(tCamera *tCamInstance);
 void CameraStop(tCamera *tCamInstance);
-void WaitForEver(tCamera *tCamInstance);
\ No newline at end of file
+void FrameReadMetadata(tCamera *tCamInstance,const tPvFrame *pFrame,tRawMetadata *pMetadata);
+bool FrameSave(tCamera *tCamInstance,tPvFrame *pFrame,const tRawMetadata *pMetadata);
+bool FrameStore(tCamera *tCamInstance,tPvFrame *pFrame,const tRawMetadata *pMetadata,const tRawPayload *pPayload);
+
+/*
+	Recording options of main(), set again by the capture benchmark for each run
+*/
+extern char surveyDir[64];
+extern bool rawContainer;
+extern tStorageKind storageKind;
+extern tRawIoMode ioMode;
+extern bool compressFrames;
+extern unsigned long segmentSizeMB;
+extern unsigned long segmentSeconds;
+extern tAcquireMode acquireMode;
+extern tProcessMode processMode;
+extern bool fastReconnect;
+
+#endif // MAINHEADER_H_INCLUDE
@@ -0,0 +1,791 @@
+/*!
+ *  @file
+ *     AsyncStorage.cpp
+ *  @brief
+ *     OTC project: Asynchronous storage of raw container records, io_uring on
+ *	   Linux recorders and a pool of positional-write threads everywhere else
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "AsyncStorage.h"
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WINDOWS
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+/*!
+ * @brief
+ *		Hand a finished request back to its owner
+ * @param
+ *		storage
+ * @param
+ *		request whose last piece has been written
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+static void AsyncStorageComplete(tAsyncStorage *pStorage,tStorageRequest *pRequest)
+{
+	bool success = !pRequest->Failed;
+
+	if(success)
+		AtomicIncrement(&(pStorage->Completed));
+	else
+	{
+		AtomicIncrement(&(pStorage->Errors));
+		RawContainerDrop(pRequest->pContainer,pRequest->Entry,pRequest->Offset);
+	}
+
+	pStorage->Done(pStorage->DoneContext,pRequest->pFrame,success,GetMicroseconds() - pRequest->SubmittedAt);
+
+	if(!AtomicDecrement(&(pStorage->InFlight)))
+		EventSignal(&(pStorage->Idle));
+}
+
+
+/*
+	Thread pool engine
+*/
+static THREADPROC AsyncStorageWorker(void *pContext)
+{
+	tAsyncStorage *pStorage = (tAsyncStorage*)pContext;
+	tStorageRequest *pRequest;
+	const tRawRecordHeader *pHeader;
+
+	while(true)
+	{
+		LockAcquire(&(pStorage->QueueLock));
+		pRequest = pStorage->QueueHead;
+		if(pRequest)
+		{
+			pStorage->QueueHead = pRequest->Next;
+			if(!pStorage->QueueHead)
+				pStorage->QueueTail = NULL;
+		}
+		LockRelease(&(pStorage->QueueLock));
+
+		if(!pRequest)
+		{
+			if(pStorage->Stop)
+				break;
+			EventWait(&(pStorage->QueueReady),EVENT_INFINITE);
+			continue;
+		}
+
+		/*
+		More work may be left for the other workers
+		*/
+		if(pStorage->QueueHead)
+			EventSignal(&(pStorage->QueueReady));
+
+		pHeader = &(pRequest->Header);
+		if(pRequest->Direct)
+		{
+			if(!RawFileWriteAt(pRequest->File,pRequest->Offset,(const char*)pRequest->pData - pHeader->HeaderSize,pHeader->RecordSize))
+				pRequest->Failed = 1;
+		}
+		else if(!RawFileWriteAt(pRequest->File,pRequest->Offset,pHeader,pHeader->HeaderSize) ||
+			!RawFileWriteAt(pRequest->File,pRequest->Offset + pHeader->HeaderSize,pRequest->pData,pHeader->StoredSize) ||
+			(pRequest->PadSize && !RawFileWriteAt(pRequest->File,pRequest->Offset + pHeader->HeaderSize + pHeader->StoredSize,
+				pRequest->Padding,pRequest->PadSize)))
+			pRequest->Failed = 1;
+
+		AsyncStorageComplete(pStorage,pRequest);
+	}
+
+	/*
+	Wake the next worker up so it sees Stop as well
+	*/
+	EventSignal(&(pStorage->QueueReady));
+
+	return 0;
+}
+
+static void AsyncStoragePoolQueue(tAsyncStorage *pStorage,tStorageRequest *pRequest)
+{
+	pRequest->Next = NULL;
+
+	LockAcquire(&(pStorage->QueueLock));
+	if(pStorage->QueueTail)
+		pStorage->QueueTail->Next = pRequest;
+	else
+		pStorage->QueueHead = pRequest;
+	pStorage->QueueTail = pRequest;
+	LockRelease(&(pStorage->QueueLock));
+
+	EventSignal(&(pStorage->QueueReady));
+}
+
+
+/*
+	io_uring engine
+*/
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+
+#define URING_STOP_TAG		0
+#define URING_PIECE_MASK	3		// user data of a write: request address | piece of the record
+
+static THREADPROC AsyncStorageReaper(void *pContext)
+{
+	tAsyncStorage *pStorage = (tAsyncStorage*)pContext;
+	struct io_uring_cqe *pCqe;
+	tStorageRequest *pRequest;
+	size_t data;
+	unsigned long i;
+	int err;
+
+	while(true)
+	{
+		err = io_uring_wait_cqe(&(pStorage->Ring),&pCqe);
+		if(err == -EINTR)
+			continue;
+		if(err < 0)
+		{
+			printf("Error in %s:%d at AsyncStorageReaper() ----> io_uring_wait_cqe failed (%d)\n", __FILE__, __LINE__, err);
+			/*
+			No completion will come anymore: fail whatever is in flight so
+			the frames go back to the camera and the drain does not hang
+			*/
+			pStorage->Broken = true;
+			for(i=0;i<pStorage->FrameCount;i++)
+			{
+				pRequest = &(pStorage->Requests[i]);
+				if(pRequest->Pending && AtomicExchange(&(pRequest->Pending),0))
+				{
+					pRequest->Failed = 1;
+					AsyncStorageComplete(pStorage,pRequest);
+				}
+			}
+			break;
+		}
+
+		data = (size_t)io_uring_cqe_get_data(pCqe);
+		if(!data)
+		{
+			io_uring_cqe_seen(&(pStorage->Ring),pCqe);
+			break;
+		}
+		pRequest = (tStorageRequest*)(data & ~(size_t)URING_PIECE_MASK);
+
+		/*
+		A short write (disk full) fails the record just like an error
+		*/
+		if(pCqe->res < 0 || (unsigned long)pCqe->res != pRequest->PieceSize[data & URING_PIECE_MASK])
+			pRequest->Failed = 1;
+		io_uring_cqe_seen(&(pStorage->Ring),pCqe);
+
+		if(!AtomicDecrement(&(pRequest->Pending)))
+			AsyncStorageComplete(pStorage,pRequest);
+	}
+
+	return 0;
+}
+
+static struct io_uring_sqe *AsyncStorageGetSqe(tAsyncStorage *pStorage)
+{
+	struct io_uring_sqe *pSqe = io_uring_get_sqe(&(pStorage->Ring));
+
+	/*
+	Submission queue full: push what we have to the kernel and retry
+	*/
+	if(!pSqe)
+	{
+		io_uring_submit(&(pStorage->Ring));
+		pStorage->Batches++;
+		pStorage->Unsubmitted = 0;
+		pSqe = io_uring_get_sqe(&(pStorage->Ring));
+	}
+	return pSqe;
+}
+
+static bool AsyncStorageUringStart(tAsyncStorage *pStorage)
+{
+	struct iovec buffers[STORAGE_MAX_FRAMES + 1];
+	unsigned long i;
+	int err;
+
+	err = io_uring_queue_init(STORAGE_URING_DEPTH,&(pStorage->Ring),0);
+	if(err < 0)
+	{
+		printf("Error in %s:%d at AsyncStorageUringStart() ----> io_uring_queue_init failed (%d)\n", __FILE__, __LINE__, err);
+		return false;
+	}
+
+	/*
+	Register the frame buffers (whole arena slots, record blocks and packed
+	areas included) and the request array once, the kernel does not have to
+	pin them again for every write
+	*/
+	for(i=0;i<pStorage->FrameCount;i++)
+	{
+		if(pStorage->pArena)
+		{
+			buffers[i].iov_base = FrameArenaSlot(pStorage->pArena,i);
+			buffers[i].iov_len = pStorage->pArena->SlotSize;
+		}
+		else
+		{
+			buffers[i].iov_base = pStorage->Frames[i].ImageBuffer;
+			buffers[i].iov_len = pStorage->Frames[i].ImageBufferSize;
+		}
+	}
+	buffers[pStorage->FrameCount].iov_base = pStorage->Requests;
+	buffers[pStorage->FrameCount].iov_len = pStorage->FrameCount * sizeof(tStorageRequest);
+
+	err = io_uring_register_buffers(&(pStorage->Ring),buffers,pStorage->FrameCount + 1);
+	if(err < 0)
+	{
+		printf("Error in %s:%d at AsyncStorageUringStart() ----> io_uring_register_buffers failed (%d)\n", __FILE__, __LINE__, err);
+		io_uring_queue_exit(&(pStorage->Ring));
+		return false;
+	}
+
+	pStorage->FileRegistered = false;
+	if(!ThreadSpawn(&(pStorage->Reaper),AsyncStorageReaper,pStorage))
+	{
+		io_uring_unregister_buffers(&(pStorage->Ring));
+		io_uring_queue_exit(&(pStorage->Ring));
+		return false;
+	}
+
+	return true;
+}
+
+static void AsyncStorageUringStop(tAsyncStorage *pStorage)
+{
+	struct io_uring_sqe *pSqe = AsyncStorageGetSqe(pStorage);
+
+	/*
+	A NOP without data tells the reaper to leave
+	*/
+	io_uring_prep_nop(pSqe);
+	io_uring_sqe_set_data(pSqe,URING_STOP_TAG);
+	io_uring_submit(&(pStorage->Ring));
+	ThreadJoin(&(pStorage->Reaper));
+
+	if(pStorage->FileRegistered)
+		io_uring_unregister_files(&(pStorage->Ring));
+	io_uring_unregister_buffers(&(pStorage->Ring));
+	io_uring_queue_exit(&(pStorage->Ring));
+}
+
+static bool AsyncStorageUringSetFile(tAsyncStorage *pStorage,tRawFile File)
+{
+	int err;
+
+	if(pStorage->FileRegistered)
+		err = io_uring_register_files_update(&(pStorage->Ring),0,&File,1);
+	else
+		err = io_uring_register_files(&(pStorage->Ring),&File,1);
+	if(err < 0)
+		return false;
+
+	pStorage->FileRegistered = true;
+	return true;
+}
+
+static void AsyncStorageUringWrite(tAsyncStorage *pStorage,tStorageRequest *pRequest,unsigned long Piece,
+								   const void *pBuffer,unsigned long Size,unsigned long long Offset,unsigned long BufferIndex)
+{
+	struct io_uring_sqe *pSqe = AsyncStorageGetSqe(pStorage);
+
+	pRequest->PieceSize[Piece] = Size;
+	io_uring_prep_write_fixed(pSqe,0,pBuffer,Size,Offset,BufferIndex);
+	pSqe->flags |= IOSQE_FIXED_FILE;
+	io_uring_sqe_set_data(pSqe,(char*)pRequest + Piece);
+}
+
+static void AsyncStorageUringQueue(tAsyncStorage *pStorage,tStorageRequest *pRequest,unsigned long FrameIndex)
+{
+	unsigned long long offset = pRequest->Offset;
+	unsigned long headerSize = pRequest->Header.HeaderSize;
+	unsigned long storedSize = pRequest->Header.StoredSize;
+
+	if(pRequest->Direct)
+	{
+		pRequest->Pending = 1;
+		AsyncStorageUringWrite(pStorage,pRequest,0,(const char*)pRequest->pData - headerSize,pRequest->Header.RecordSize,offset,FrameIndex);
+	}
+	else
+	{
+		pRequest->Pending = pRequest->PadSize ? 3 : 2;
+		AsyncStorageUringWrite(pStorage,pRequest,0,&(pRequest->Header),headerSize,offset,pStorage->FrameCount);
+		AsyncStorageUringWrite(pStorage,pRequest,1,pRequest->pData,storedSize,offset + headerSize,FrameIndex);
+		if(pRequest->PadSize)
+			AsyncStorageUringWrite(pStorage,pRequest,2,pRequest->Padding,pRequest->PadSize,offset + headerSize + storedSize,pStorage->FrameCount);
+	}
+
+	if(++pStorage->Unsubmitted >= STORAGE_BATCH)
+		AsyncStorageFlush(pStorage);
+}
+
+#endif
+
+
+/*!
+ * @brief
+ *		Tell if a storage engine can be used in this build
+ * @param
+ *		engine
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		bool
+ */
+bool AsyncStorageAvailable(tStorageKind Kind)
+{
+	if(Kind == eStorageUring)
+	{
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+		return true;
+#else
+		return false;
+#endif
+	}
+	return true;
+}
+
+const char *AsyncStorageName(tStorageKind Kind)
+{
+	switch(Kind)
+	{
+	case eStoragePool:
+		return "pool";
+	case eStorageUring:
+		return "uring";
+	default:
+		return "sync";
+	}
+}
+
+/*!
+ * @brief
+ *		Start the asynchronous storage of a camera. Falls back to the thread
+ *		pool when io_uring is not available or cannot be set up
+ * @param
+ *		storage
+ * @param
+ *		requested engine
+ * @param
+ *		frame buffers of the camera, already allocated
+ * @param
+ *		number of frame buffers
+ * @param
+ *		arena the frame buffers come from, NULL if they were allocated otherwise
+ * @param
+ *		called when the record of a frame is written
+ * @param
+ *		context of the callback
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		bool
+ */
+bool AsyncStorageStart(tAsyncStorage *pStorage,tStorageKind Kind,tPvFrame *Frames,unsigned long FrameCount,
+					   const tFrameArena *pArena,tStorageDoneCallback Done,void *DoneContext)
+{
+	unsigned long i;
+
+	if(Kind == eStorageSync || FrameCount > STORAGE_MAX_FRAMES)
+		return false;
+
+	memset(pStorage,0,sizeof(tAsyncStorage));
+	pStorage->Frames = Frames;
+	pStorage->FrameCount = FrameCount;
+	pStorage->pArena = pArena;
+	pStorage->Done = Done;
+	pStorage->DoneContext = DoneContext;
+	pStorage->Requests = (tStorageRequest*)calloc(FrameCount,sizeof(tStorageRequest));
+	if(!pStorage->Requests)
+		return false;
+	EventInit(&(pStorage->Idle));
+
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+	if(Kind == eStorageUring && AsyncStorageUringStart(pStorage))
+	{
+		pStorage->Kind = eStorageUring;
+		pStorage->Running = true;
+		return true;
+	}
+#endif
+	if(Kind == eStorageUring)
+		printf("io_uring storage not available, using the write thread pool\n");
+
+	LockInit(&(pStorage->QueueLock));
+	EventInit(&(pStorage->QueueReady));
+	for(i=0;i<STORAGE_POOL_THREADS;i++)
+	{
+		if(!ThreadSpawn(&(pStorage->Workers[i]),AsyncStorageWorker,pStorage))
+		{
+			printf("Error in %s:%d at AsyncStorageStart() ----> could not start the storage threads\n", __FILE__, __LINE__);
+			pStorage->Stop = true;
+			while(i--)
+				ThreadJoin(&(pStorage->Workers[i]));
+			EventDestroy(&(pStorage->QueueReady));
+			LockDestroy(&(pStorage->QueueLock));
+			EventDestroy(&(pStorage->Idle));
+			free(pStorage->Requests);
+			pStorage->Requests = NULL;
+			return false;
+		}
+	}
+	pStorage->Kind = eStoragePool;
+	pStorage->Running = true;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Wait for every record in flight and stop the storage threads
+ * @param
+ *		storage
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void AsyncStorageStop(tAsyncStorage *pStorage)
+{
+	unsigned long i;
+
+	if(!pStorage->Running)
+		return;
+
+	AsyncStorageDrain(pStorage);
+	pStorage->Stop = true;
+
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+	if(pStorage->Kind == eStorageUring)
+		AsyncStorageUringStop(pStorage);
+#endif
+	if(pStorage->Kind == eStoragePool)
+	{
+		EventSignal(&(pStorage->QueueReady));
+		for(i=0;i<STORAGE_POOL_THREADS;i++)
+			ThreadJoin(&(pStorage->Workers[i]));
+		EventDestroy(&(pStorage->QueueReady));
+		LockDestroy(&(pStorage->QueueLock));
+	}
+
+	EventDestroy(&(pStorage->Idle));
+	free(pStorage->Requests);
+	pStorage->Requests = NULL;
+	pStorage->Running = false;
+}
+
+/*!
+ * @brief
+ *		A new segment was opened, following records go to it. Only called when
+ *		nothing is in flight (the previous segment has been drained)
+ * @param
+ *		storage
+ * @param
+ *		file of the new segment
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		RawContainerOpenSegment()
+ * @return
+ *		bool
+ */
+bool AsyncStorageSetFile(tAsyncStorage *pStorage,tRawFile File)
+{
+	pStorage->File = File;
+
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+	if(pStorage->Kind == eStorageUring)
+		return AsyncStorageUringSetFile(pStorage,File);
+#endif
+	return true;
+}
+
+/*!
+ * @brief
+ *		Reserve the record of a frame in the container and queue its write.
+ *		The frame belongs to the storage until the done callback is called
+ * @param
+ *		storage
+ * @param
+ *		container of the camera
+ * @param
+ *		frame to record
+ * @param
+ *		metadata of the frame
+ * @param
+ *		compressed image (packed area of the frame), NULL to store the image buffer
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if the record could not be queued, the frame still belongs to the caller
+ */
+bool AsyncStorageSubmit(tAsyncStorage *pStorage,tRawContainer *pContainer,tPvFrame *pFrame,
+						const tRawMetadata *pMetadata,const tRawPayload *pPayload)
+{
+	unsigned long frameIndex = (unsigned long)(pFrame - pStorage->Frames);
+	tStorageRequest *pRequest;
+
+	if(!pStorage->Running || frameIndex >= pStorage->FrameCount)
+		return false;
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+	if(pStorage->Broken)
+		return false;
+#endif
+
+	/*
+	Reserving may rotate the segment, which drains the storage first
+	*/
+	pRequest = &(pStorage->Requests[frameIndex]);
+	if(!RawContainerReserve(pContainer,pFrame,pMetadata,pPayload,&(pRequest->Header),&(pRequest->Offset)))
+		return false;
+
+	pRequest->pContainer = pContainer;
+	pRequest->Entry = pContainer->IndexCount - 1;
+	pRequest->Metadata = *pMetadata;
+	memset(pRequest->Padding,0,sizeof(pRequest->Padding));
+	pRequest->Direct = pContainer->IoMode == eRawIoDirect;
+	pRequest->PadSize = pRequest->Header.RecordSize - pRequest->Header.HeaderSize - pRequest->Header.StoredSize;
+	pRequest->pFrame = pFrame;
+	pRequest->pData = RawRecordData(pFrame,pPayload);
+	pRequest->File = pStorage->File;
+	pRequest->Failed = 0;
+	pRequest->SubmittedAt = GetMicroseconds();
+
+	AtomicIncrement(&(pStorage->InFlight));
+	pStorage->Submitted++;
+
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+	if(pStorage->Kind == eStorageUring)
+	{
+		AsyncStorageUringQueue(pStorage,pRequest,frameIndex);
+		return true;
+	}
+#endif
+	AsyncStoragePoolQueue(pStorage,pRequest);
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Push the prepared records to the kernel. The writer calls it when its
+ *		queue is empty so a lonely frame does not wait for a full batch
+ * @param
+ *		storage
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+void AsyncStorageFlush(tAsyncStorage *pStorage)
+{
+	if(pStorage->Running && pStorage->Kind == eStorageUring && pStorage->Unsubmitted)
+	{
+		io_uring_submit(&(pStorage->Ring));
+		pStorage->Batches++;
+		pStorage->Unsubmitted = 0;
+	}
+}
+#else
+void AsyncStorageFlush(tAsyncStorage * /*pStorage*/)
+{
+}
+#endif
+
+/*!
+ * @brief
+ *		Wait until every submitted record is on the disk
+ * @param
+ *		storage
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void AsyncStorageDrain(tAsyncStorage *pStorage)
+{
+	if(!pStorage->Running)
+		return;
+
+	AsyncStorageFlush(pStorage);
+	while(pStorage->InFlight)
+	{
+#if defined(_LINUX) && defined(HAVE_LIBURING)
+		if(pStorage->Broken)
+			break;
+#endif
+		EventWait(&(pStorage->Idle),10);
+	}
+}
+
+
+/*
+	Benchmark: the frames are recycled by the done callback, the writer only
+	waits when every buffer is in flight
+*/
+#define BENCH_STORAGE_FRAMES	10
+#define BENCH_STORAGE_COUNT		600
+
+typedef struct
+{
+	tLock				FreeLock;
+	tEvent				FreeReady;
+	tPvFrame*			Free[BENCH_STORAGE_FRAMES];
+	unsigned long		FreeCount;
+	unsigned long long	LatencyTotal;
+	unsigned long long	LatencyMax;
+
+} tStorageBench;
+
+static void AsyncStorageBenchDone(void *Context,tPvFrame *pFrame,bool /*Success*/,unsigned long long Latency)
+{
+	tStorageBench *pBench = (tStorageBench*)Context;
+
+	LockAcquire(&(pBench->FreeLock));
+	pBench->Free[pBench->FreeCount++] = pFrame;
+	pBench->LatencyTotal += Latency;
+	if(Latency > pBench->LatencyMax)
+		pBench->LatencyMax = Latency;
+	LockRelease(&(pBench->FreeLock));
+
+	EventSignal(&(pBench->FreeReady));
+}
+
+static void AsyncStorageBenchRun(tStorageKind Kind,tRawIoMode IoMode,unsigned long Width,unsigned long Height)
+{
+	tPvFrame frames[BENCH_STORAGE_FRAMES];
+	tFrameArena arena;
+	tStorageBench bench;
+	tAsyncStorage storage;
+	tRawContainer container;
+	tRawMetadata metadata;
+	tPvFrame *pFrame;
+	unsigned long frameSize = Width * Height;
+	unsigned long long start,elapsed;
+	unsigned long i,firstSegment = 0;
+
+	if(!AsyncStorageAvailable(Kind))
+	{
+		printf("%-6s not available in this build\n",AsyncStorageName(Kind));
+		return;
+	}
+
+	memset(frames,0,sizeof(frames));
+	memset(&storage,0,sizeof(tAsyncStorage));
+	memset(&bench,0,sizeof(tStorageBench));
+	memset(&metadata,0,sizeof(tRawMetadata));
+	if(!FrameArenaInit(&arena,frames,BENCH_STORAGE_FRAMES,frameSize,0,0,ARENA_BLOCK_SIZE))
+		return;
+	LockInit(&(bench.FreeLock));
+	EventInit(&(bench.FreeReady));
+	for(i=0;i<BENCH_STORAGE_FRAMES;i++)
+	{
+		frames[i].ImageSize = frameSize;
+		frames[i].Width = Width;
+		frames[i].Height = Height;
+		memset(frames[i].ImageBuffer,(int)i,frameSize);
+		bench.Free[bench.FreeCount++] = &(frames[i]);
+	}
+
+	RawContainerInit(&container,".",0,RAW_DEFAULT_SEGMENT_MB,RAW_DEFAULT_SEGMENT_SECONDS,IoMode,ARENA_BLOCK_SIZE);
+	if(Kind != eStorageSync)
+	{
+		if(AsyncStorageStart(&storage,Kind,frames,BENCH_STORAGE_FRAMES,&arena,AsyncStorageBenchDone,&bench))
+			container.pStorage = &storage;
+		else
+			Kind = eStorageSync;
+	}
+
+	start = GetMicroseconds();
+	for(i=0;i<BENCH_STORAGE_COUNT;i++)
+	{
+		while(true)
+		{
+			LockAcquire(&(bench.FreeLock));
+			pFrame = bench.FreeCount ? bench.Free[--bench.FreeCount] : NULL;
+			LockRelease(&(bench.FreeLock));
+			if(pFrame)
+				break;
+			AsyncStorageFlush(&storage);
+			EventWait(&(bench.FreeReady),10);
+		}
+		pFrame->FrameCount = i;
+
+		if(Kind == eStorageSync)
+		{
+			unsigned long long before = GetMicroseconds();
+			RawContainerWrite(&container,pFrame,&metadata,NULL);
+			AsyncStorageBenchDone(&bench,pFrame,true,GetMicroseconds() - before);
+		}
+		else if(!AsyncStorageSubmit(&storage,&container,pFrame,&metadata,NULL))
+			AsyncStorageBenchDone(&bench,pFrame,false,0);
+
+		/*
+		Segments already in the directory are skipped, only ours are removed
+		*/
+		if(!i)
+			firstSegment = container.Segment;
+	}
+	if(Kind != eStorageSync)
+		AsyncStorageDrain(&storage);
+	elapsed = GetMicroseconds() - start;
+
+	printf("%-6s %-11s %5lux%-5lu %8.1f MB/s %7.1f frames/s | write latency avg %8.2f ms max %8.2f ms",
+		AsyncStorageName(Kind),RawContainerIoName(container.IoMode),Width,Height,
+		(double)container.BytesWritten / (double)elapsed,
+		(double)BENCH_STORAGE_COUNT * 1000000.0 / (double)elapsed,
+		(double)bench.LatencyTotal / BENCH_STORAGE_COUNT / 1000.0,(double)bench.LatencyMax / 1000.0);
+	if(Kind == eStorageUring)
+		printf(" | %lu submits",storage.Batches);
+	printf("\n");
+
+	RawContainerClose(&container);
+	if(Kind != eStorageSync)
+		AsyncStorageStop(&storage);
+	FrameArenaDestroy(&arena,frames);
+	EventDestroy(&(bench.FreeReady));
+	LockDestroy(&(bench.FreeLock));
+	for(i=firstSegment;i<container.Segment;i++)
+	{
+		char filename[64];
+		snprintf(filename,sizeof(filename),"./segment%05lu.avr",i);
+		remove(filename);
+	}
+}
+
+/*!
+ * @brief
+ *		Compare the synchronous writer, the write thread pool and io_uring, with
+ *		cached, direct and write-behind I/O, on segment files created in the
+ *		current directory
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void AsyncStorageBenchmark()
+{
+	static const unsigned long sizes[][2] = {{640,480},{1360,1024},{2448,2050}};
+	static const tRawIoMode modes[] = {eRawIoBuffered,eRawIoDirect,eRawIoWriteBehind};
+	unsigned int s,m;
+
+	printf("Storage benchmark, %d frames per run\n",BENCH_STORAGE_COUNT);
+	for(s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+	{
+		for(m=0;m<sizeof(modes)/sizeof(modes[0]);m++)
+		{
+			AsyncStorageBenchRun(eStorageSync,modes[m],sizes[s][0],sizes[s][1]);
+			AsyncStorageBenchRun(eStoragePool,modes[m],sizes[s][0],sizes[s][1]);
+			AsyncStorageBenchRun(eStorageUring,modes[m],sizes[s][0],sizes[s][1]);
+		}
+	}
+}
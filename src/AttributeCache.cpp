@@ -0,0 +1,352 @@
+/*!
+ *  @file
+ *     AttributeCache.cpp
+ *  @brief
+ *     OTC project: Attribute cache of a camera. The refresher thread owns the
+ *	   GigE reads, the writer thread copies the snapshot under a sequence
+ *	   counter and never waits for it
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "AttributeCache.h"
+#include "FrameRing.h"
+#include <string.h>
+
+#define ATTR_BENCH_DIRECT_READS		200
+#define ATTR_BENCH_CACHED_READS		1000000
+#define ATTR_BENCH_SECONDS			3
+
+
+/*!
+ * @brief
+ *		Read the attributes stored with a frame from the camera, four control
+ *		round trips
+ * @param
+ *		attribute table of the camera
+ * @param
+ *		exposure, gain and white balance, 0 when an attribute cannot be read
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void AttributeReadCamera(tAttributeTable *pTable,tRawMetadata *pMetadata)
+{
+	tPvUint32 value;
+
+	memset(pMetadata,0,sizeof(tRawMetadata));
+	if(!AttributeUint32Get(pTable,pTable->Exposure,&value))
+		pMetadata->Exposure = value;
+	if(!AttributeUint32Get(pTable,pTable->Gain,&value))
+		pMetadata->Gain = value;
+	if(!AttributeUint32Get(pTable,pTable->WhitebalRed,&value))
+		pMetadata->WhitebalRed = value;
+	if(!AttributeUint32Get(pTable,pTable->WhitebalBlue,&value))
+		pMetadata->WhitebalBlue = value;
+}
+
+/*
+	Read the camera, then publish: the readers retry while Sequence is odd or has moved
+*/
+static void AttributeCacheRefresh(tAttributeCache *pCache)
+{
+	tRawMetadata values;
+
+	AttributeReadCamera(pCache->pTable,&values);
+
+	AtomicIncrement(&(pCache->Sequence));
+	pCache->Exposure = values.Exposure;
+	pCache->Gain = values.Gain;
+	pCache->WhitebalRed = values.WhitebalRed;
+	pCache->WhitebalBlue = values.WhitebalBlue;
+	pCache->UpdatedAt = GetMicroseconds();
+	AtomicIncrement(&(pCache->Sequence));
+
+	pCache->Refreshes++;
+}
+
+/*
+	Camera event: the attributes may have changed, the refresher reads them now.
+	Runs on a PvAPI thread, it must not make any round trip itself
+*/
+static void PVDECL AttributeCacheEventCB(void* Context,tPvHandle /*Camera*/,const tPvCameraEvent* /*EventList*/,unsigned long /*EventListLength*/)
+{
+	tAttributeCache *pCache = (tAttributeCache*)Context;
+
+	AtomicIncrement(&(pCache->EventsPending));
+	EventSignal(&(pCache->Wake));
+}
+
+static THREADPROC AttributeCacheThread(void *pContext)
+{
+	tAttributeCache *pCache = (tAttributeCache*)pContext;
+	unsigned long long last;
+	unsigned long elapsed;
+	long events;
+
+	while(!pCache->Stop)
+	{
+		AttributeCacheRefresh(pCache);
+		last = GetMicroseconds();
+
+		EventWait(&(pCache->Wake),pCache->RefreshPeriod);
+		if(pCache->Stop)
+			break;
+
+		events = pCache->EventsPending;
+		if(events != pCache->EventsServed)
+		{
+			pCache->EventsServed = events;
+			pCache->EventRefreshes++;
+		}
+
+		// a burst of events costs one refresh every ATTR_MIN_INTERVAL at most
+		elapsed = (unsigned long)((GetMicroseconds() - last) / 1000);
+		if(elapsed < ATTR_MIN_INTERVAL)
+			Sleep(ATTR_MIN_INTERVAL - elapsed);
+	}
+
+	return 0;
+}
+
+/*!
+ * @brief
+ *		Fill the cache and start its refresher. The camera events that change
+ *		the attributes are turned on when the camera has them
+ * @param
+ *		cache
+ * @param
+ *		attribute table of the open camera
+ * @param
+ *		milliseconds between two refreshes without any event
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart()
+ * @return
+ *		false if the refresher could not start, the attributes are then read for every frame
+ */
+bool AttributeCacheStart(tAttributeCache *pCache,tAttributeTable *pTable,unsigned long RefreshPeriod)
+{
+	tPvHandle Camera = pTable->Camera;
+
+	memset(pCache,0,sizeof(tAttributeCache));
+	pCache->Handle = Camera;
+	pCache->pTable = pTable;
+	pCache->RefreshPeriod = RefreshPeriod;
+	EventInit(&(pCache->Wake));
+
+	// first snapshot before any frame can be saved
+	AttributeCacheRefresh(pCache);
+
+	if(!ThreadSpawn(&(pCache->Thread),AttributeCacheThread,pCache))
+	{
+		printf("Error in %s:%d at AttributeCacheStart() ----> could not start the refresher thread\n", __FILE__, __LINE__);
+		EventDestroy(&(pCache->Wake));
+		return false;
+	}
+	pCache->Running = true;
+
+	if(!PvCameraEventCallbackRegister(Camera,AttributeCacheEventCB,pCache))
+	{
+		pCache->Events = true;
+		if(PvAttrUint32Set(Camera,"EventsEnable1",ATTR_EVENTS_MASK) || PvAttrEnumSet(Camera,"EventNotification","On"))
+			printf("camera events not available, attributes refreshed every %lu ms\n",RefreshPeriod);
+	}
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Stop the refresher, before the camera is closed
+ * @param
+ *		cache
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraUnsetup()
+ * @return
+ *		void
+ */
+void AttributeCacheStop(tAttributeCache *pCache)
+{
+	if(!pCache->Running)
+		return;
+
+	if(pCache->Events)
+		PvCameraEventCallbackUnRegister(pCache->Handle,AttributeCacheEventCB);
+	pCache->Events = false;
+
+	pCache->Stop = true;
+	EventSignal(&(pCache->Wake));
+	ThreadJoin(&(pCache->Thread));
+	EventDestroy(&(pCache->Wake));
+	pCache->Running = false;
+}
+
+/*
+	The application changed an attribute itself, read them again now
+*/
+void AttributeCacheInvalidate(tAttributeCache *pCache)
+{
+	if(pCache->Running)
+		EventSignal(&(pCache->Wake));
+}
+
+/*!
+ * @brief
+ *		Copy the snapshot, lock free. Single reader: the writer thread of the camera
+ * @param
+ *		cache
+ * @param
+ *		exposure, gain and white balance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameReadMetadata()
+ * @return
+ *		false if the cache is not running, the caller reads the camera
+ */
+bool AttributeCacheRead(tAttributeCache *pCache,tRawMetadata *pMetadata)
+{
+	unsigned long long updatedAt,staleness;
+	long sequence;
+
+	if(!pCache->Running)
+		return false;
+
+	do
+	{
+		sequence = pCache->Sequence;
+		RING_BARRIER();
+		pMetadata->Exposure = pCache->Exposure;
+		pMetadata->Gain = pCache->Gain;
+		pMetadata->WhitebalRed = pCache->WhitebalRed;
+		pMetadata->WhitebalBlue = pCache->WhitebalBlue;
+		updatedAt = pCache->UpdatedAt;
+		RING_BARRIER();
+	} while((sequence & 1) || sequence != pCache->Sequence);
+
+	staleness = GetMicroseconds() - updatedAt;
+	pCache->Reads++;
+	pCache->StalenessTotal += staleness;
+	if(staleness > pCache->StalenessMax)
+		pCache->StalenessMax = staleness;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Average age of the attributes stored with the frames
+ * @param
+ *		cache
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		milliseconds
+ */
+double AttributeCacheStaleness(const tAttributeCache *pCache)
+{
+	if(!pCache->Reads)
+		return 0.0;
+
+	return (double)pCache->StalenessTotal / (double)pCache->Reads / 1000.0;
+}
+
+
+/*
+	Benchmark: cost of the attributes of one frame, read from the first camera
+	found, then from the cache, and staleness of the cache at 30 frames per second.
+	The const TimeStampFrequency by name and through its handle
+*/
+void AttributeCacheBenchmark()
+{
+	static tAttributeCache cache;
+	static tAttributeTable table;
+	tPvCameraInfo info;
+	tPvHandle handle;
+	tRawMetadata metadata;
+	tPvUint32 value;
+	unsigned long long start,elapsed,worst = 0,end;
+	unsigned long i,waited = 0;
+
+	printf("Attribute cache benchmark\n");
+	if(PvInitialize())
+	{
+		printf("Error in %s:%d at AttributeCacheBenchmark() ----> PvInitialize failed\n", __FILE__, __LINE__);
+		return;
+	}
+
+	while(!PvCameraCount() && waited < 5000)
+	{
+		Sleep(250);
+		waited += 250;
+	}
+	if(!PvCameraList(&info,1,NULL) || PvCameraOpen(info.UniqueId,ePvAccessMaster,&handle))
+	{
+		printf("Error in %s:%d at AttributeCacheBenchmark() ----> no camera to open\n", __FILE__, __LINE__);
+		PvUnInitialize();
+		return;
+	}
+
+	AttributeTableOpen(&table,handle);
+	start = GetMicroseconds();
+	for(i=0;i<ATTR_BENCH_DIRECT_READS;i++)
+	{
+		elapsed = GetMicroseconds();
+		AttributeReadCamera(&table,&metadata);
+		elapsed = GetMicroseconds() - elapsed;
+		if(elapsed > worst)
+			worst = elapsed;
+	}
+	elapsed = GetMicroseconds() - start;
+	printf("camera %lu, per frame\n",info.UniqueId);
+	printf("  PvAttrUint32Get x4 : %10.2f us (max %8.1f us)\n",(double)elapsed / ATTR_BENCH_DIRECT_READS,(double)worst);
+
+	start = GetMicroseconds();
+	for(i=0;i<ATTR_BENCH_DIRECT_READS;i++)
+		PvAttrUint32Get(handle,"TimeStampFrequency",&value);
+	elapsed = GetMicroseconds() - start;
+	printf("  const, by name     : %10.2f us\n",(double)elapsed / ATTR_BENCH_DIRECT_READS);
+	start = GetMicroseconds();
+	for(i=0;i<ATTR_BENCH_CACHED_READS;i++)
+		AttributeUint32Get(&table,table.TimeStampFrequency,&value);
+	elapsed = GetMicroseconds() - start;
+	printf("  const, by handle   : %10.4f us (%ld read(s) from the camera)\n",(double)elapsed / ATTR_BENCH_CACHED_READS,
+		table.CameraReads - 4 * ATTR_BENCH_DIRECT_READS);
+
+	if(!AttributeCacheStart(&cache,&table,ATTR_DEFAULT_REFRESH))
+	{
+		PvCameraClose(handle);
+		PvUnInitialize();
+		return;
+	}
+
+	start = GetMicroseconds();
+	for(i=0;i<ATTR_BENCH_CACHED_READS;i++)
+		AttributeCacheRead(&cache,&metadata);
+	elapsed = GetMicroseconds() - start;
+	printf("  cached snapshot    : %10.4f us\n",(double)elapsed / ATTR_BENCH_CACHED_READS);
+
+	// staleness as the writer sees it
+	cache.Reads = 0;
+	cache.StalenessTotal = 0;
+	cache.StalenessMax = 0;
+	end = GetMicroseconds() + ATTR_BENCH_SECONDS * 1000000ULL;
+	while(GetMicroseconds() < end)
+	{
+		AttributeCacheRead(&cache,&metadata);
+		Sleep(33);
+	}
+	printf("  staleness          : %10.2f ms (max %6.2f ms), %lu refreshes, %lu on events, refresh every %d ms\n",
+		AttributeCacheStaleness(&cache),(double)cache.StalenessMax / 1000.0,cache.Refreshes,cache.EventRefreshes,ATTR_DEFAULT_REFRESH);
+
+	AttributeCacheStop(&cache);
+	PvCameraClose(handle);
+	PvUnInitialize();
+}
@@ -0,0 +1,198 @@
+/*!
+ *  @file
+ *     AttributeTable.cpp
+ *  @brief
+ *     OTC project: Attribute table of a camera, names validated once and read
+ *	   through typed handles
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "AttributeTable.h"
+#include <string.h>
+
+
+/*
+	Entry of a name, added and validated the first time
+*/
+static unsigned long AttributeIntern(tAttributeTable *pTable,const char *Name,tPvDatatype Type)
+{
+	tAttributeEntry *pEntry;
+	tPvAttributeInfo info;
+	unsigned long i;
+	tPvErr err;
+
+	for(i=0;i<pTable->Count;i++)
+		if(!strcmp(pTable->Entries[i].Name,Name))
+			return i;
+	if(pTable->Count == ATTR_TABLE_SIZE)
+	{
+		printf("Error in %s:%d at AttributeIntern() ----> more than %d attributes, %s is not interned\n", __FILE__, __LINE__, ATTR_TABLE_SIZE, Name);
+		return ATTR_TABLE_SIZE;
+	}
+
+	pEntry = &(pTable->Entries[pTable->Count]);
+	memset(pEntry,0,sizeof(tAttributeEntry));
+	pEntry->Name = Name;
+	pEntry->Type = Type;
+
+	err = PvAttrInfo(pTable->Camera,Name,&info);
+	if(!err)
+	{
+		pEntry->Flags = info.Flags;
+		if(info.Datatype != Type)
+			pEntry->Error = ePvErrWrongType;
+	}
+	// no information on this camera: the type is trusted, the value read every time
+	else if(err != ePvErrNotFound && !PvAttrExists(pTable->Camera,Name))
+		pEntry->Flags = ePvFlagRead;
+	else
+		pEntry->Error = ePvErrNotFound;
+
+	if(pEntry->Error)
+	{
+		printf("Error in %s:%d at AttributeIntern() ----> %s : ", __FILE__, __LINE__, Name);
+		convertandPrintErrorCode(pEntry->Error);
+	}
+
+	return pTable->Count++;
+}
+
+/*!
+ * @brief
+ *		Attach the table to the camera once it is open. The first time the
+ *		handles of the statistics and metadata paths are interned, a camera
+ *		that comes back keeps them
+ * @param
+ *		table of the camera, zeroed with the camera instance
+ * @param
+ *		handle of the open camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraSetup()
+ * @return
+ *		void
+ */
+void AttributeTableOpen(tAttributeTable *pTable,tPvHandle Camera)
+{
+	pTable->Camera = Camera;
+	if(pTable->Count)
+		return;
+
+	pTable->FramesCompleted = AttributeInternUint32(pTable,"StatFramesCompleted");
+	pTable->FramesDropped = AttributeInternUint32(pTable,"StatFramesDropped");
+	pTable->PacketsMissed = AttributeInternUint32(pTable,"StatPacketsMissed");
+	pTable->PacketsErroneous = AttributeInternUint32(pTable,"StatPacketsErroneous");
+	pTable->FrameRate = AttributeInternFloat32(pTable,"StatFrameRate");
+	pTable->Exposure = AttributeInternUint32(pTable,"ExposureValue");
+	pTable->Gain = AttributeInternUint32(pTable,"GainValue");
+	pTable->WhitebalRed = AttributeInternUint32(pTable,"WhitebalValueRed");
+	pTable->WhitebalBlue = AttributeInternUint32(pTable,"WhitebalValueBlue");
+	pTable->TotalBytesPerFrame = AttributeInternUint32(pTable,"TotalBytesPerFrame");
+	pTable->TimeStampFrequency = AttributeInternUint32(pTable,"TimeStampFrequency");
+}
+
+/*!
+ * @brief
+ *		Handle of a Uint32 attribute
+ * @param
+ *		table of the camera, open
+ * @param
+ *		name of the attribute, a string literal
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		handle, its reads fail if the attribute does not exist or is not a Uint32
+ */
+tAttrUint32 AttributeInternUint32(tAttributeTable *pTable,const char *Name)
+{
+	tAttrUint32 handle;
+
+	handle.Index = AttributeIntern(pTable,Name,ePvDatatypeUint32);
+	return handle;
+}
+
+tAttrFloat32 AttributeInternFloat32(tAttributeTable *pTable,const char *Name)
+{
+	tAttrFloat32 handle;
+
+	handle.Index = AttributeIntern(pTable,Name,ePvDatatypeFloat32);
+	return handle;
+}
+
+/*!
+ * @brief
+ *		Read a Uint32 attribute through its handle, a const one from the table
+ *		once it has been read
+ * @param
+ *		table of the camera
+ * @param
+ *		handle
+ * @param
+ *		value
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStatsTask(), AttributeReadCamera()
+ * @return
+ *		tPvErr of PvAttrUint32Get(), or the error found when it was interned
+ */
+tPvErr AttributeUint32Get(tAttributeTable *pTable,tAttrUint32 Handle,tPvUint32 *pValue)
+{
+	tAttributeEntry *pEntry;
+	tPvErr err;
+
+	if(Handle.Index >= pTable->Count)
+		return ePvErrBadParameter;
+	pEntry = &(pTable->Entries[Handle.Index]);
+	if(pEntry->Error)
+		return pEntry->Error;
+	if(pEntry->Known)
+	{
+		*pValue = pEntry->Uint32;
+		AtomicIncrement(&(pTable->ConstReads));
+		return ePvErrSuccess;
+	}
+
+	err = PvAttrUint32Get(pTable->Camera,pEntry->Name,pValue);
+	AtomicIncrement(&(pTable->CameraReads));
+	// the value before the flag, the increment is a barrier
+	if(!err && (pEntry->Flags & ePvFlagConst))
+	{
+		pEntry->Uint32 = *pValue;
+		AtomicIncrement(&(pEntry->Known));
+	}
+
+	return err;
+}
+
+tPvErr AttributeFloat32Get(tAttributeTable *pTable,tAttrFloat32 Handle,tPvFloat32 *pValue)
+{
+	tAttributeEntry *pEntry;
+	tPvErr err;
+
+	if(Handle.Index >= pTable->Count)
+		return ePvErrBadParameter;
+	pEntry = &(pTable->Entries[Handle.Index]);
+	if(pEntry->Error)
+		return pEntry->Error;
+	if(pEntry->Known)
+	{
+		*pValue = pEntry->Float32;
+		AtomicIncrement(&(pTable->ConstReads));
+		return ePvErrSuccess;
+	}
+
+	err = PvAttrFloat32Get(pTable->Camera,pEntry->Name,pValue);
+	AtomicIncrement(&(pTable->CameraReads));
+	if(!err && (pEntry->Flags & ePvFlagConst))
+	{
+		pEntry->Float32 = *pValue;
+		AtomicIncrement(&(pEntry->Known));
+	}
+
+	return err;
+}
@@ -0,0 +1,821 @@
+/*!
+ *  @file
+ *     BayerCodec.cpp
+ *  @brief
+ *     OTC project: Lossless codec of raw Bayer frames. The rows are widened to
+ *	   16 bits, each pixel is predicted from pixels of its own color and the
+ *	   residuals (modulo 2^16, zigzag mapped) are packed 8 at a time at the
+ *	   width of the largest one. Groups fill whole bytes, there is no bit
+ *	   stream to serialize the coder on: a header byte holds the widths of the
+ *	   next two groups
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "BayerCodec.h"
+#include "RawContainer.h"
+#include "CompressStage.h"
+#include "LzCodec.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define BAYER_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define BAYER_GROUP			8				// codes packed together, at the width of the largest one
+#define BAYER_GROUP_MAX		(1 + 2 * 2 * BAYER_GROUP)	// bytes of two groups and of their header byte, at most
+#define BAYER_SIMD_LIMIT	0x4000			// rows below 2^14 keep the predictor inside 16 signed bits
+#define BAYER_WIDTH_CODES	13
+
+/*
+	Widths of the groups, 4 bits each: 0 to 8 bits, then only even widths so
+	that a group always fills whole bytes
+*/
+static const unsigned char BayerWidths[16] = {0,1,2,3,4,5,6,7,8,10,12,14,16,0,0,0};
+static const unsigned char BayerWidthCodes[17] = {0,1,2,3,4,5,6,7,8,9,9,10,10,11,11,12,12};
+
+
+static unsigned int BayerBitLength(unsigned int Value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+
+	if(!_BitScanReverse(&index,Value))
+		return 0;
+	return index + 1;
+#else
+	return Value ? 32 - __builtin_clz(Value) : 0;
+#endif
+}
+
+#ifdef BAYER_SSE2
+static unsigned long long BayerLow64(__m128i Value)
+{
+	unsigned long long low;
+
+	_mm_storel_epi64((__m128i*)&low,Value);
+	return low;
+}
+#endif
+
+/*!
+ * @brief
+ *		Pack a group of 8 codes at the same width, the group takes Width bytes.
+ *		Writes 8 bytes (16 above 8 bits) whatever the width: the caller keeps
+ *		that much room at the end of the buffer
+ * @param
+ *		output position
+ * @param
+ *		8 codes
+ * @param
+ *		width in bits, one of BayerWidths
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		next output position
+ */
+static unsigned char *BayerPackGroup(unsigned char *p,const unsigned short *pCodes,unsigned int Width)
+{
+	unsigned long long low = 0,high = 0;
+#ifdef BAYER_SSE2
+	__m128i codes,pairs;
+
+	if(Width == 16)
+	{
+		memcpy(p,pCodes,2 * BAYER_GROUP);
+		return p + Width;
+	}
+
+	/*
+	Codes 2i and 2i+1 side by side in 32 bits, then 4 codes in each 64 bits
+	*/
+	codes = _mm_loadu_si128((const __m128i*)pCodes);
+	pairs = _mm_madd_epi16(codes,_mm_set1_epi32((1 << (16 + Width)) | 1));
+	pairs = _mm_or_si128(_mm_and_si128(pairs,_mm_set_epi32(0,-1,0,-1)),
+		_mm_mul_epu32(_mm_srli_epi64(pairs,32),_mm_set1_epi32(1 << (2 * Width))));
+	low = BayerLow64(pairs);
+	high = BayerLow64(_mm_unpackhi_epi64(pairs,pairs));
+#else
+	unsigned int i;
+
+	for(i=0;i<BAYER_GROUP / 2;i++)
+	{
+		low |= (unsigned long long)pCodes[i] << (i * Width);
+		high |= (unsigned long long)pCodes[i + BAYER_GROUP / 2] << (i * Width);
+	}
+#endif
+	// little endian hosts: the first code is in the low bits of the first byte
+
+	if(Width <= 8)
+	{
+		low |= high << (BAYER_GROUP / 2 * Width);
+		memcpy(p,&low,sizeof(low));
+		return p + Width;
+	}
+
+	memcpy(p,&low,sizeof(low));
+	memcpy(p + Width / 2,&high,sizeof(high));
+	return p + Width;
+}
+
+static unsigned long long BayerLoad(const unsigned char *p,const unsigned char *pEnd)
+{
+	unsigned long long word = 0;
+
+	if(pEnd - p >= (long)sizeof(word))
+		memcpy(&word,p,sizeof(word));
+	else
+		memcpy(&word,p,pEnd - p);
+	return word;
+}
+
+static void BayerUnpackGroup(const unsigned char *p,const unsigned char *pEnd,unsigned short *pCodes,unsigned int Width)
+{
+	unsigned long long low,high,mask = (1 << Width) - 1;
+	unsigned int i;
+
+	low = BayerLoad(p,pEnd);
+	if(Width <= 8)
+		high = low >> (BAYER_GROUP / 2 * Width);
+	else
+		high = BayerLoad(p + Width / 2,pEnd);
+
+	for(i=0;i<BAYER_GROUP / 2;i++)
+	{
+		pCodes[i] = (unsigned short)((low >> (i * Width)) & mask);
+		pCodes[i + BAYER_GROUP / 2] = (unsigned short)((high >> (i * Width)) & mask);
+	}
+}
+
+/*
+	Green sites: (x + y) odd for RGGB/BGGR, even for GBRG/GRBG.
+	Returns the parity of x of the green sites of row y
+*/
+static unsigned int BayerGreenPhase(tPvBayerPattern Pattern,unsigned long Row)
+{
+	unsigned int first = (Pattern == ePvBayerRGGB || Pattern == ePvBayerBGGR) ? 1 : 0;
+
+	return (unsigned int)((Row + first) & 1);
+}
+
+/*
+	Red and blue: median of left, up and left + up - up left (LOCO-I), written
+	as a clamp so it compiles without branches
+*/
+static int BayerMedian(int Left,int Up,int UpLeft)
+{
+	int low = Left < Up ? Left : Up;
+	int high = Left ^ Up ^ low;
+	int gradient = Left + Up - UpLeft;
+
+	gradient = gradient < low ? low : gradient;
+	return gradient > high ? high : gradient;
+}
+
+/*
+	Green: the two diagonal neighbours above are green too (the other green of
+	the pattern). Their average, moved by the difference between the green on
+	the left and its own diagonal neighbours, which also takes the offset
+	between the two greens away. x >= 3
+*/
+static int BayerGreen(const unsigned short *pUp1,unsigned long x,int Left)
+{
+	int green = ((pUp1[x - 1] + pUp1[x + 1] + 1) >> 1) + Left - ((pUp1[x - 3] + pUp1[x - 1] + 1) >> 1);
+
+	return green < 0 ? 0 : green;
+}
+
+/*!
+ * @brief
+ *		Prediction of one pixel, from pixels of the same color only. Shared by
+ *		the encoder (borders, wide pixels) and by the decoder
+ * @param
+ *		current row, decoded up to x - 1
+ * @param
+ *		row above
+ * @param
+ *		two rows above
+ * @param
+ *		column
+ * @param
+ *		row in the strip
+ * @param
+ *		width
+ * @param
+ *		parity of the green columns of this row
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		predicted value
+ */
+static unsigned int BayerPredict(const unsigned short *pRow,const unsigned short *pUp1,const unsigned short *pUp2,
+								 unsigned long x,unsigned long y,unsigned long Width,unsigned int GreenPhase)
+{
+	if(y < 2)
+		return x < 2 ? 0 : pRow[x - 2];
+	if(x < 2)
+		return pUp2[x];
+
+	if(!((x ^ GreenPhase) & 1) && x + 1 < Width)
+	{
+		if(x < 3)
+			return (pUp1[x - 1] + pUp1[x + 1] + 1) >> 1;
+		return BayerGreen(pUp1,x,pRow[x - 2]);
+	}
+
+	return BayerMedian(pRow[x - 2],pUp2[x],pUp2[x - 2]);
+}
+
+static unsigned int BayerZigzag(unsigned int Value,unsigned int Prediction)
+{
+	unsigned int residual = (Value - Prediction) & 0xFFFF;
+
+	return ((residual << 1) ^ ((residual & 0x8000) ? 0xFFFF : 0)) & 0xFFFF;
+}
+
+static unsigned int BayerUnzigzag(unsigned int Code,unsigned int Prediction)
+{
+	unsigned int residual = (Code >> 1) ^ ((Code & 1) ? 0xFFFF : 0);
+
+	return (Prediction + residual) & 0xFFFF;
+}
+
+#ifdef BAYER_SSE2
+/*
+	Residuals of x = 4 .. Width - 2 of a row, 8 pixels at a time. Same result
+	as BayerPredict() as long as the three rows are below BAYER_SIMD_LIMIT.
+	Returns the first column left to the caller
+*/
+static unsigned long BayerResidualsSse2(const unsigned short *pRow,const unsigned short *pUp1,const unsigned short *pUp2,
+										unsigned long Width,unsigned int GreenPhase,unsigned short *pCodes)
+{
+	__m128i green = GreenPhase ? _mm_set_epi16(-1,0,-1,0,-1,0,-1,0) : _mm_set_epi16(0,-1,0,-1,0,-1,0,-1);
+	__m128i left,up,upLeft,low,high,gradient,median,aboveLeft,diagonal,prediction,residual;
+	unsigned long x;
+
+	for(x=4;x + 9 <= Width;x+=8)
+	{
+		left = _mm_loadu_si128((const __m128i*)(pRow + x - 2));
+		up = _mm_loadu_si128((const __m128i*)(pUp2 + x));
+		upLeft = _mm_loadu_si128((const __m128i*)(pUp2 + x - 2));
+		low = _mm_min_epi16(left,up);
+		high = _mm_max_epi16(left,up);
+		gradient = _mm_sub_epi16(_mm_add_epi16(left,up),upLeft);
+		median = _mm_min_epi16(_mm_max_epi16(gradient,low),high);
+
+		aboveLeft = _mm_loadu_si128((const __m128i*)(pUp1 + x - 1));
+		diagonal = _mm_avg_epu16(aboveLeft,_mm_loadu_si128((const __m128i*)(pUp1 + x + 1)));
+		diagonal = _mm_sub_epi16(_mm_add_epi16(diagonal,left),
+			_mm_avg_epu16(_mm_loadu_si128((const __m128i*)(pUp1 + x - 3)),aboveLeft));
+		diagonal = _mm_max_epi16(diagonal,_mm_setzero_si128());
+
+		prediction = _mm_or_si128(_mm_and_si128(green,diagonal),_mm_andnot_si128(green,median));
+		residual = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(pRow + x)),prediction);
+		_mm_storeu_si128((__m128i*)(pCodes + x),_mm_xor_si128(_mm_add_epi16(residual,residual),_mm_srai_epi16(residual,15)));
+	}
+
+	return x;
+}
+#endif
+
+/*
+	Rows of the frame widened to 16 bits
+*/
+static void BayerLoadRow(const unsigned char *pSource,unsigned long Width,tPvImageFormat Format,unsigned short *pRow)
+{
+	unsigned long x = 0;
+#ifdef BAYER_SSE2
+	__m128i bytes;
+#endif
+
+	switch(Format)
+	{
+	case ePvFmtBayer8:
+#ifdef BAYER_SSE2
+		for(;x + 16 <= Width;x+=16)
+		{
+			bytes = _mm_loadu_si128((const __m128i*)(pSource + x));
+			_mm_storeu_si128((__m128i*)(pRow + x),_mm_unpacklo_epi8(bytes,_mm_setzero_si128()));
+			_mm_storeu_si128((__m128i*)(pRow + x + 8),_mm_unpackhi_epi8(bytes,_mm_setzero_si128()));
+		}
+#endif
+		for(;x<Width;x++)
+			pRow[x] = pSource[x];
+		break;
+	case ePvFmtBayer16:
+		for(;x<Width;x++)
+			pRow[x] = (unsigned short)(pSource[2 * x] | (pSource[2 * x + 1] << 8));
+		break;
+	default:
+		// Bayer12Packed: 2 pixels in 3 bytes, high bits of each pixel then the two low nibbles
+		for(;x<Width;x+=2,pSource+=3)
+		{
+			pRow[x] = (unsigned short)((pSource[0] << 4) | (pSource[1] & 0x0F));
+			pRow[x + 1] = (unsigned short)((pSource[2] << 4) | (pSource[1] >> 4));
+		}
+		break;
+	}
+}
+
+static bool BayerStoreRow(const unsigned short *pRow,unsigned long Width,tPvImageFormat Format,unsigned char *pTarget)
+{
+	unsigned long x;
+	unsigned int wide = 0;
+
+	switch(Format)
+	{
+	case ePvFmtBayer8:
+		for(x=0;x<Width;x++)
+		{
+			wide |= pRow[x];
+			pTarget[x] = (unsigned char)pRow[x];
+		}
+		return wide < 0x100;
+	case ePvFmtBayer16:
+		for(x=0;x<Width;x++)
+		{
+			pTarget[2 * x] = (unsigned char)pRow[x];
+			pTarget[2 * x + 1] = (unsigned char)(pRow[x] >> 8);
+		}
+		return true;
+	default:
+		for(x=0;x<Width;x+=2,pTarget+=3)
+		{
+			wide |= pRow[x] | pRow[x + 1];
+			pTarget[0] = (unsigned char)(pRow[x] >> 4);
+			pTarget[1] = (unsigned char)((pRow[x] & 0x0F) | ((pRow[x + 1] & 0x0F) << 4));
+			pTarget[2] = (unsigned char)(pRow[x + 1] >> 4);
+		}
+		return wide < 0x1000;
+	}
+}
+
+static unsigned int BayerRowMax(const unsigned short *pRow,unsigned long Width)
+{
+	unsigned long x;
+	unsigned int bits = 0;
+
+	for(x=0;x<Width;x++)
+		bits |= pRow[x];
+	return bits;
+}
+
+bool BayerCodecSupports(tPvImageFormat Format,unsigned long Width)
+{
+	if(!Width || Width > BAYER_MAX_WIDTH)
+		return false;
+
+	return Format == ePvFmtBayer8 || Format == ePvFmtBayer16 ||
+		(Format == ePvFmtBayer12Packed && !(Width & 1));
+}
+
+unsigned long BayerRowBytes(tPvImageFormat Format,unsigned long Width)
+{
+	switch(Format)
+	{
+	case ePvFmtBayer8:
+		return Width;
+	case ePvFmtBayer16:
+		return 2 * Width;
+	case ePvFmtBayer12Packed:
+		return Width / 2 * 3;
+	default:
+		return 0;
+	}
+}
+
+/*!
+ * @brief
+ *		Encode rows of a Bayer frame. The first row must be an even row of the
+ *		frame so the CFA phase of the pattern holds
+ * @param
+ *		pixels, as the camera sent them
+ * @param
+ *		width
+ * @param
+ *		number of rows
+ * @param
+ *		ePvFmtBayer8, ePvFmtBayer16 or ePvFmtBayer12Packed
+ * @param
+ *		Bayer pattern of the frame
+ * @param
+ *		output buffer
+ * @param
+ *		size of the output buffer, encoding gives up when it does not fit
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		BayerCodecSupports()
+ * @return
+ *		encoded size, 0 if it does not fit in the output buffer
+ */
+unsigned long BayerEncode(const void *pSource,unsigned long Width,unsigned long Rows,tPvImageFormat Format,
+						  tPvBayerPattern Pattern,void *pTarget,unsigned long TargetCapacity)
+{
+	unsigned short lines[3][BAYER_MAX_WIDTH];
+	unsigned short codes[BAYER_MAX_WIDTH + 2 * BAYER_GROUP];
+	unsigned int lineMax[3];
+	const unsigned char *pIn = (const unsigned char*)pSource;
+	const unsigned short *pRow,*pUp1,*pUp2;
+	unsigned char *pOut = (unsigned char*)pTarget;
+	unsigned char *pEnd = pOut + TargetCapacity;
+	unsigned long rowBytes = BayerRowBytes(Format,Width);
+	unsigned long x,y,i;
+	unsigned int phase,low,high;
+#ifdef BAYER_SSE2
+	__m128i group;
+#else
+	unsigned int j;
+#endif
+
+	if(!BayerCodecSupports(Format,Width))
+		return 0;
+
+	for(y=0;y<Rows;y++,pIn+=rowBytes)
+	{
+		BayerLoadRow(pIn,Width,Format,lines[y % 3]);
+		lineMax[y % 3] = Format == ePvFmtBayer16 ? BayerRowMax(lines[y % 3],Width) : 0;
+		pRow = lines[y % 3];
+		pUp1 = lines[(y + 2) % 3];
+		pUp2 = lines[(y + 1) % 3];
+		phase = BayerGreenPhase(Pattern,y);
+
+		x = 0;
+#ifdef BAYER_SSE2
+		if(y >= 2 && (lineMax[0] | lineMax[1] | lineMax[2]) < BAYER_SIMD_LIMIT)
+		{
+			for(;x<4 && x<Width;x++)
+				codes[x] = (unsigned short)BayerZigzag(pRow[x],BayerPredict(pRow,pUp1,pUp2,x,y,Width,phase));
+			if(x == 4)
+				x = BayerResidualsSse2(pRow,pUp1,pUp2,Width,phase,codes);
+		}
+#endif
+		for(;x<Width;x++)
+			codes[x] = (unsigned short)BayerZigzag(pRow[x],BayerPredict(pRow,pUp1,pUp2,x,y,Width,phase));
+		for(;x % (2 * BAYER_GROUP);x++)
+			codes[x] = 0;
+
+		/*
+		Two groups behind one header byte, each at the width of its largest code
+		*/
+		for(i=0;i<x;i+=2 * BAYER_GROUP)
+		{
+			if(pEnd - pOut < BAYER_GROUP_MAX + 8)
+				return 0;
+
+#ifdef BAYER_SSE2
+			group = _mm_loadu_si128((const __m128i*)(codes + i));
+			group = _mm_or_si128(group,_mm_srli_si128(group,8));
+			group = _mm_or_si128(group,_mm_srli_si128(group,4));
+			group = _mm_or_si128(group,_mm_srli_si128(group,2));
+			low = _mm_cvtsi128_si32(group) & 0xFFFF;
+			group = _mm_loadu_si128((const __m128i*)(codes + i + BAYER_GROUP));
+			group = _mm_or_si128(group,_mm_srli_si128(group,8));
+			group = _mm_or_si128(group,_mm_srli_si128(group,4));
+			group = _mm_or_si128(group,_mm_srli_si128(group,2));
+			high = _mm_cvtsi128_si32(group) & 0xFFFF;
+#else
+			for(low=0,high=0,j=0;j<BAYER_GROUP;j++)
+			{
+				low |= codes[i + j];
+				high |= codes[i + BAYER_GROUP + j];
+			}
+#endif
+			low = BayerWidthCodes[BayerBitLength(low)];
+			high = BayerWidthCodes[BayerBitLength(high)];
+
+			*pOut++ = (unsigned char)(low | (high << 4));
+			pOut = BayerPackGroup(pOut,codes + i,BayerWidths[low]);
+			pOut = BayerPackGroup(pOut,codes + i + BAYER_GROUP,BayerWidths[high]);
+		}
+	}
+
+	return (unsigned long)(pOut - (unsigned char*)pTarget);
+}
+
+/*!
+ * @brief
+ *		Decode rows encoded by BayerEncode(), the stream is checked
+ * @param
+ *		encoded rows
+ * @param
+ *		size of the encoded rows
+ * @param
+ *		output buffer, Rows * BayerRowBytes() bytes
+ * @param
+ *		width
+ * @param
+ *		number of rows
+ * @param
+ *		ePvFmtBayer8, ePvFmtBayer16 or ePvFmtBayer12Packed
+ * @param
+ *		Bayer pattern of the frame
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if the data are corrupted
+ */
+bool BayerDecode(const void *pSource,unsigned long SourceSize,void *pTarget,unsigned long Width,unsigned long Rows,
+				 tPvImageFormat Format,tPvBayerPattern Pattern)
+{
+	unsigned short lines[3][BAYER_MAX_WIDTH];
+	unsigned short codes[BAYER_MAX_WIDTH + 2 * BAYER_GROUP];
+	const unsigned char *pIn = (const unsigned char*)pSource;
+	const unsigned char *pEnd = pIn + SourceSize;
+	unsigned char *pOut = (unsigned char*)pTarget;
+	unsigned short *pRow;
+	const unsigned short *pUp1,*pUp2;
+	unsigned long rowBytes = BayerRowBytes(Format,Width);
+	unsigned long x,y,i;
+	unsigned int phase,low,high;
+	int left;
+
+	if(!BayerCodecSupports(Format,Width))
+		return false;
+
+	for(y=0;y<Rows;y++,pOut+=rowBytes)
+	{
+		for(i=0;i<Width;i+=2 * BAYER_GROUP)
+		{
+			if(pIn == pEnd)
+				return false;
+			low = *pIn & 0x0F;
+			high = *pIn++ >> 4;
+			if(low >= BAYER_WIDTH_CODES || high >= BAYER_WIDTH_CODES ||
+				(unsigned long)(pEnd - pIn) < (unsigned long)BayerWidths[low] + BayerWidths[high])
+				return false;
+
+			BayerUnpackGroup(pIn,pEnd,codes + i,BayerWidths[low]);
+			pIn += BayerWidths[low];
+			BayerUnpackGroup(pIn,pEnd,codes + i + BAYER_GROUP,BayerWidths[high]);
+			pIn += BayerWidths[high];
+		}
+
+		pRow = lines[y % 3];
+		pUp1 = lines[(y + 2) % 3];
+		pUp2 = lines[(y + 1) % 3];
+		phase = BayerGreenPhase(Pattern,y);
+		for(x=0;x<Width && (x < 4 || y < 2);x++)
+			pRow[x] = (unsigned short)BayerUnzigzag(codes[x],BayerPredict(pRow,pUp1,pUp2,x,y,Width,phase));
+
+		// inner columns, without the border cases of BayerPredict()
+		for(;x + 1 < Width;x++)
+		{
+			left = pRow[x - 2];
+			pRow[x] = (unsigned short)BayerUnzigzag(codes[x],((x ^ phase) & 1) ?
+				BayerMedian(left,pUp2[x],pUp2[x - 2]) : BayerGreen(pUp1,x,left));
+		}
+		for(;x<Width;x++)
+			pRow[x] = (unsigned short)BayerUnzigzag(codes[x],BayerPredict(pRow,pUp1,pUp2,x,y,Width,phase));
+
+		if(!BayerStoreRow(pRow,Width,Format,pOut))
+			return false;
+	}
+
+	return pIn == pEnd;
+}
+
+
+/*
+	Benchmark: round trip of random frames over every format, pattern and a
+	few widths, then synthetic frames (smooth scene, channel levels, sensor
+	noise) and the Bayer records of a segment when one is given
+*/
+#define BENCH_BAYER_COUNT	20
+
+static bool BayerBenchRoundTrip(const unsigned char *pImage,unsigned long Width,unsigned long Rows,
+								tPvImageFormat Format,tPvBayerPattern Pattern,unsigned char *pPacked,unsigned char *pCheck)
+{
+	unsigned long size = Rows * BayerRowBytes(Format,Width);
+	unsigned long packed = BayerEncode(pImage,Width,Rows,Format,Pattern,pPacked,3 * size + 256);
+
+	// room for the worst case: random 8 bit pixels take 16 bit codes
+	if(!packed || !BayerDecode(pPacked,packed,pCheck,Width,Rows,Format,Pattern))
+		return false;
+	return !memcmp(pCheck,pImage,size);
+}
+
+static void BayerBenchFrame(const char *Name,const unsigned char *pImage,unsigned long Width,unsigned long Height,
+							tPvImageFormat Format,tPvBayerPattern Pattern,unsigned char *pPacked,unsigned char *pCheck)
+{
+	unsigned long size = Height * BayerRowBytes(Format,Width);
+	unsigned long packed = 0,lzPacked,i;
+	unsigned long long start,encodeTime,decodeTime;
+	bool correct;
+
+	start = GetMicroseconds();
+	for(i=0;i<BENCH_BAYER_COUNT;i++)
+		packed = BayerEncode(pImage,Width,Height,Format,Pattern,pPacked,size);
+	encodeTime = GetMicroseconds() - start;
+
+	start = GetMicroseconds();
+	for(i=0;i<BENCH_BAYER_COUNT && packed;i++)
+		BayerDecode(pPacked,packed,pCheck,Width,Height,Format,Pattern);
+	decodeTime = GetMicroseconds() - start;
+	correct = !packed || (BayerDecode(pPacked,packed,pCheck,Width,Height,Format,Pattern) && !memcmp(pCheck,pImage,size));
+
+	lzPacked = LzCompress(pImage,size,pPacked,size);
+
+	printf("%-24s %5lux%-5lu ratio %5.2f (lz %5.2f) encode %7.1f MB/s decode %7.1f MB/s %s\n",Name,Width,Height,
+		packed ? (double)size / (double)packed : 1.0,lzPacked ? (double)size / (double)lzPacked : 1.0,
+		encodeTime ? (double)size * BENCH_BAYER_COUNT / (double)encodeTime : 0.0,
+		decodeTime ? (double)size * BENCH_BAYER_COUNT / (double)decodeTime : 0.0,
+		correct ? "round trip ok" : "ROUND TRIP FAILED");
+}
+
+/*
+	Synthetic scene: gradients, a different level per channel and sensor noise, 12 bits
+*/
+static void BayerBenchScene(unsigned short *pPixels,unsigned long Width,unsigned long Height,unsigned long Noise)
+{
+	static const unsigned int levels[4] = {1300,2100,2000,900};
+	unsigned long x,y,seed = 12345;
+
+	for(y=0;y<Height;y++)
+	{
+		for(x=0;x<Width;x++)
+		{
+			seed = seed * 1103515245 + 12345;
+			pPixels[y * Width + x] = (unsigned short)((levels[(y & 1) * 2 + (x & 1)] * (Width + x) / Width / 2 +
+				(x / 64 + y / 64) % 2 * 400 + (Noise ? (seed >> 16) % Noise : 0)) & 0xFFF);
+		}
+	}
+}
+
+static void BayerBenchEncodeScene(const unsigned short *pPixels,unsigned long Width,unsigned long Height,
+								  tPvImageFormat Format,unsigned char *pImage)
+{
+	unsigned long x,i,count = Width * Height;
+
+	for(i=0;i<count;i++)
+	{
+		if(Format == ePvFmtBayer8)
+			pImage[i] = (unsigned char)(pPixels[i] >> 4);
+		else if(Format == ePvFmtBayer16)
+		{
+			pImage[2 * i] = (unsigned char)pPixels[i];
+			pImage[2 * i + 1] = (unsigned char)(pPixels[i] >> 8);
+		}
+	}
+	if(Format == ePvFmtBayer12Packed)
+	{
+		for(x=0;x<count;x+=2,pImage+=3)
+		{
+			pImage[0] = (unsigned char)(pPixels[x] >> 4);
+			pImage[1] = (unsigned char)((pPixels[x] & 0x0F) | ((pPixels[x + 1] & 0x0F) << 4));
+			pImage[2] = (unsigned char)(pPixels[x + 1] >> 4);
+		}
+	}
+}
+
+/*
+	Bayer records of a segment, decompressed when they were recorded compressed
+*/
+static void BayerBenchSegment(const char *Segment,unsigned char *pPacked,unsigned char *pCheck,unsigned long Capacity)
+{
+	FILE *pFile = fopen(Segment,"rb");
+	tRawSegmentHeader segment;
+	tRawRecordHeader header;
+	unsigned char *pRecord = NULL;
+	unsigned char *pImage = NULL;
+	unsigned long long offset;
+	unsigned long frames = 0;
+	char name[64];
+
+	if(!pFile)
+	{
+		printf("Error in %s:%d at BayerBenchSegment() ----> could not open %s\n", __FILE__, __LINE__,Segment);
+		return;
+	}
+
+	if(fread(&segment,sizeof(segment),1,pFile) != 1 || memcmp(segment.Magic,RAW_SEGMENT_MAGIC,sizeof(segment.Magic)))
+	{
+		printf("Error in %s:%d at BayerBenchSegment() ----> %s is not a raw segment\n", __FILE__, __LINE__,Segment);
+		fclose(pFile);
+		return;
+	}
+
+	pRecord = (unsigned char*)malloc(Capacity);
+	pImage = (unsigned char*)malloc(Capacity);
+	for(offset=segment.HeaderSize;pRecord && pImage && frames < 4;offset+=header.RecordSize)
+	{
+		if(fseek(pFile,(long)offset,SEEK_SET) || fread(&header,sizeof(header),1,pFile) != 1 ||
+			header.Magic != RAW_RECORD_MAGIC || header.RecordSize < header.HeaderSize)
+			break;
+		if(header.ImageSize > Capacity || header.StoredSize > Capacity ||
+			!BayerCodecSupports((tPvImageFormat)header.Format,header.Width) ||
+			header.Height * BayerRowBytes((tPvImageFormat)header.Format,header.Width) != header.ImageSize)
+			continue;
+
+		if(fseek(pFile,(long)(offset + header.HeaderSize),SEEK_SET) || fread(pRecord,header.StoredSize,1,pFile) != 1)
+			break;
+		if(header.Compression == eRawCompressionNone)
+			memcpy(pImage,pRecord,header.ImageSize);
+		else if(!CompressDecode(&header,pRecord,pImage))
+			continue;
+
+		sprintf(name,"record %u",header.FrameCount);
+		BayerBenchFrame(name,pImage,header.Width,header.Height,(tPvImageFormat)header.Format,
+			(tPvBayerPattern)header.BayerPattern,pPacked,pCheck);
+		frames++;
+	}
+	if(!frames)
+		printf("No Bayer record in %s\n",Segment);
+
+	free(pRecord);
+	free(pImage);
+	fclose(pFile);
+}
+
+/*!
+ * @brief
+ *		Round trip checks, then ratio and single thread speed of the Bayer codec
+ *		against the LZ codec
+ * @param
+ *		segment to take recorded frames from, NULL for synthetic frames only
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void BayerCodecBenchmark(const char *Segment)
+{
+	static const tPvImageFormat formats[3] = {ePvFmtBayer8,ePvFmtBayer16,ePvFmtBayer12Packed};
+	static const char *formatNames[3] = {"Bayer8","Bayer16","Bayer12Packed"};
+	static const unsigned long widths[5] = {2,6,34,250,1360};
+	static const unsigned long noises[3] = {0,16,64};
+	const unsigned long width = 2448,height = 2050;
+	unsigned long capacity = width * height * 2;
+	unsigned short *pPixels = (unsigned short*)malloc(width * height * sizeof(unsigned short));
+	unsigned char *pImage = (unsigned char*)malloc(capacity);
+	unsigned char *pPacked = (unsigned char*)malloc(capacity);
+	unsigned char *pCheck = (unsigned char*)malloc(capacity);
+	unsigned long f,p,w,n,i,rows,seed = 987654,cases = 0,failures = 0;
+	char name[64];
+
+	if(!pPixels || !pImage || !pPacked || !pCheck)
+	{
+		free(pPixels);
+		free(pImage);
+		free(pPacked);
+		free(pCheck);
+		return;
+	}
+
+	/*
+	Random content, from flat to full range, odd strip heights included
+	*/
+	for(f=0;f<3;f++)
+	{
+		for(p=0;p<4;p++)
+		{
+			for(w=0;w<sizeof(widths)/sizeof(widths[0]);w++)
+			{
+				for(n=0;n<4;n++)
+				{
+					rows = 1 + n * 3;
+					for(i=0;i<rows * BayerRowBytes(formats[f],widths[w]);i++)
+					{
+						seed = seed * 1103515245 + 12345;
+						pImage[i] = (unsigned char)(n == 0 ? 0x5A : n == 1 ? (i & 0x3F) : (seed >> 16) >> (n == 2 ? 4 : 0));
+					}
+					cases++;
+					if(!BayerBenchRoundTrip(pImage,widths[w],rows,formats[f],(tPvBayerPattern)p,pPacked,pCheck))
+					{
+						failures++;
+						printf("ROUND TRIP FAILED: %s pattern %lu width %lu rows %lu\n",formatNames[f],p,widths[w],rows);
+					}
+				}
+			}
+		}
+	}
+	printf("Bayer codec round trip: %lu cases, %lu failed\n",cases,failures);
+
+	printf("Bayer codec benchmark, one thread, %d frames per run\n",BENCH_BAYER_COUNT);
+	for(n=0;n<sizeof(noises)/sizeof(noises[0]);n++)
+	{
+		BayerBenchScene(pPixels,width,height,noises[n]);
+		for(f=0;f<3;f++)
+		{
+			BayerBenchEncodeScene(pPixels,width,height,formats[f],pImage);
+			sprintf(name,"%s noise %lu",formatNames[f],formats[f] == ePvFmtBayer8 ? noises[n] / 16 : noises[n]);
+			BayerBenchFrame(name,pImage,width,height,formats[f],ePvBayerRGGB,pPacked,pCheck);
+		}
+	}
+
+	if(Segment)
+		BayerBenchSegment(Segment,pPacked,pCheck,capacity);
+
+	free(pPixels);
+	free(pImage);
+	free(pPacked);
+	free(pCheck);
+}
@@ -0,0 +1,281 @@
+/*!
+ *  @file
+ *     CameraBringup.cpp
+ *  @brief
+ *     OTC project: Bring-up of a plugged camera on a thread of its own. The
+ *	   thread and the first frame meet on Handoff: whichever comes second
+ *	   makes the camera Streaming
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "mainHeader.h"
+
+static const char *gBringupStateNames[] = { "idle", "prepare", "open", "start", "wait frame", "streaming", "failed" };
+
+/*
+	Milliseconds between two times of the bring-up, 0 if the second one has not come
+*/
+static double BringupSpan(unsigned long long From,unsigned long long To)
+{
+	return To && To >= From ? (double)(To - From) / 1000.0 : 0.0;
+}
+
+/*
+	Last state of the thread, then tell
+*/
+static void BringupOver(tCamera *tCamInstance,tBringupState State)
+{
+	tCameraBringup *pBringup = &(tCamInstance->Bringup);
+
+	pBringup->State = State;
+	// the first frame came while the frames were queued
+	if(State == eBringupWaitFrame && AtomicIncrement(&(pBringup->Handoff)) == 2)
+		pBringup->State = eBringupStreaming;
+
+	if(pBringup->Done)
+		pBringup->Done(tCamInstance);
+}
+
+/*!
+ * @brief
+ *		Bring-up thread: prepare, open and start the camera, looking at Cancel
+ *		between two states
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraSetup(), CameraStart()
+ * @return
+ *		0
+ */
+static THREADPROC CameraBringupThread(void *pContext)
+{
+	tCamera *tCamInstance = (tCamera*)pContext;
+	tCameraBringup *pBringup = &(tCamInstance->Bringup);
+	tPvErr errorCode;
+
+	/*
+	Directory, segment files and log of the camera. If the directory already exists, nothing happens.
+	A camera that comes back goes on with its segments, as it keeps its buffers
+	*/
+	if(!MakeDirectory(pBringup->Directory))
+		printf("Error in %s:%d at CameraBringupThread() ----> could not create %s\n", __FILE__, __LINE__, pBringup->Directory);
+	if(!RawContainerReuse(&(tCamInstance->Container),pBringup->Directory,tCamInstance->UID,segmentSizeMB,segmentSeconds,ioMode,ARENA_BLOCK_SIZE))
+		RawContainerInit(&(tCamInstance->Container),pBringup->Directory,tCamInstance->UID,segmentSizeMB,segmentSeconds,ioMode,ARENA_BLOCK_SIZE);
+	MetadataLogOpen(&(tCamInstance->Log),pBringup->Directory,tCamInstance->UID);
+	pBringup->PreparedAt = GetMicroseconds();
+	if(pBringup->Cancel)
+	{
+		BringupOver(tCamInstance,eBringupFailed);
+		return 0;
+	}
+
+	pBringup->State = eBringupOpen;
+	errorCode = CameraSetup(tCamInstance);
+	if(errorCode)
+	{
+		printf("Error in %s:%d at CameraBringupThread() ----> camera %lu did not open: ", __FILE__, __LINE__, tCamInstance->UID);
+		convertandPrintErrorCode(errorCode);
+		BringupOver(tCamInstance,eBringupFailed);
+		return 0;
+	}
+	pBringup->OpenedAt = GetMicroseconds();
+	if(pBringup->Cancel)
+	{
+		BringupOver(tCamInstance,eBringupFailed);
+		return 0;
+	}
+
+	pBringup->State = eBringupStart;
+	if(!CameraStart(tCamInstance))
+	{
+		printf("Error in %s:%d at CameraBringupThread() ----> camera %lu did not start\n", __FILE__, __LINE__, tCamInstance->UID);
+		BringupOver(tCamInstance,eBringupFailed);
+		return 0;
+	}
+	pBringup->StartedAt = GetMicroseconds();
+	BringupOver(tCamInstance,eBringupWaitFrame);
+
+	return 0;
+}
+
+/*!
+ * @brief
+ *		Start the bring-up of a camera that was just plugged, returns right away
+ * @param
+ *		Camera Instance, its previous bring-up joined
+ * @param
+ *		directory of the camera
+ * @param
+ *		called when the thread is over and with the first frame, NULL for none
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		ControlHandler()
+ * @return
+ *		false if the thread could not start, the camera is Failed
+ */
+bool CameraBringupStart(tCamera *tCamInstance,const char *Directory,tBringupDone Done)
+{
+	tCameraBringup *pBringup = &(tCamInstance->Bringup);
+
+	memset(pBringup,0,sizeof(tCameraBringup));
+	strncpy(pBringup->Directory,Directory,BRINGUP_DIR_SIZE - 1);
+	pBringup->Done = Done;
+	pBringup->PluggedAt = GetMicroseconds();
+	pBringup->State = eBringupPrepare;
+
+	if(!ThreadSpawn(&(pBringup->Thread),CameraBringupThread,tCamInstance))
+	{
+		printf("Error in %s:%d at CameraBringupStart() ----> could not start the bring-up of camera %lu\n", __FILE__, __LINE__,
+			tCamInstance->UID);
+		pBringup->State = eBringupFailed;
+		return false;
+	}
+	pBringup->Running = true;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Wait for the bring-up thread of a camera to be over
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void CameraBringupJoin(tCamera *tCamInstance)
+{
+	tCameraBringup *pBringup = &(tCamInstance->Bringup);
+
+	if(!pBringup->Running)
+		return;
+
+	ThreadJoin(&(pBringup->Thread));
+	pBringup->Running = false;
+}
+
+/*!
+ * @brief
+ *		Stop the bring-up of a camera after the state it is in, the camera is
+ *		unplugged or the application stops
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraUnsetup()
+ * @return
+ *		void
+ */
+void CameraBringupCancel(tCamera *tCamInstance)
+{
+	tCamInstance->Bringup.Cancel = true;
+	CameraBringupJoin(tCamInstance);
+}
+
+/*!
+ * @brief
+ *		A frame of the camera is done, from the frame callback. Only the first
+ *		one of a bring-up counts
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameDoneCB()
+ * @return
+ *		void
+ */
+void CameraBringupFirstFrame(tCamera *tCamInstance)
+{
+	tCameraBringup *pBringup = &(tCamInstance->Bringup);
+
+	if(AtomicIncrement(&(pBringup->FirstFrames)) != 1)
+		return;
+
+	pBringup->FirstFrameAt = GetMicroseconds();
+	// the thread is over with the camera started
+	if(AtomicIncrement(&(pBringup->Handoff)) == 2)
+	{
+		pBringup->State = eBringupStreaming;
+		if(pBringup->Done)
+			pBringup->Done(tCamInstance);
+	}
+}
+
+/*!
+ * @brief
+ *		Time to first frame of a camera, from its link event
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		milliseconds, 0 if no frame came yet
+ */
+double CameraBringupTimeToFirstFrame(const tCamera *tCamInstance)
+{
+	return BringupSpan(tCamInstance->Bringup.PluggedAt,tCamInstance->Bringup.FirstFrameAt);
+}
+
+/*!
+ * @brief
+ *		Count the reconnect of a camera once its first frame after the plug came
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		ControlHandler()
+ * @return
+ *		false if the camera was not coming back from an unplug, or has no frame yet
+ */
+bool CameraReconnectAccount(tCamera *tCamInstance)
+{
+	tCameraReconnect *pReconnect = &(tCamInstance->Reconnect);
+
+	if(!pReconnect->UnpluggedAt || !tCamInstance->Bringup.FirstFrameAt)
+		return false;
+
+	pReconnect->LastGap = BringupSpan(pReconnect->UnpluggedAt,tCamInstance->Bringup.FirstFrameAt);
+	pReconnect->TotalGap += pReconnect->LastGap;
+	if(pReconnect->LastGap > pReconnect->MaxGap)
+		pReconnect->MaxGap = pReconnect->LastGap;
+	pReconnect->Count++;
+	pReconnect->UnpluggedAt = 0;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Print the time to first frame of a camera and the time of each state
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void CameraBringupReport(const tCamera *tCamInstance)
+{
+	const tCameraBringup *pBringup = &(tCamInstance->Bringup);
+
+	printf("camera %lu %s, first frame after %.1f ms (prepare %.1f open %.1f start %.1f wait %.1f ms)\n",tCamInstance->UID,
+		CameraBringupStateName(pBringup->State),CameraBringupTimeToFirstFrame(tCamInstance),
+		BringupSpan(pBringup->PluggedAt,pBringup->PreparedAt),BringupSpan(pBringup->PreparedAt,pBringup->OpenedAt),
+		BringupSpan(pBringup->OpenedAt,pBringup->StartedAt),BringupSpan(pBringup->StartedAt,pBringup->FirstFrameAt));
+}
+
+const char *CameraBringupStateName(tBringupState State)
+{
+	return State <= eBringupFailed ? gBringupStateNames[State] : "unknown";
+}
@@ -0,0 +1,583 @@
+/*!
+ *  @file
+ *     CameraConfig.cpp
+ *  @brief
+ *     OTC project: Configuration of a camera, loaded from a profile file and
+ *	   written in full or only where the camera differs from it
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "CameraConfig.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+
+/*
+	Dependency order of the attributes: an attribute is written after the ones
+	that bound it. The ones not listed are modes (enum) or values
+*/
+#define CONFIG_RANK_ACQUISITION	0
+#define CONFIG_RANK_FORMAT		1
+#define CONFIG_RANK_MODE		2
+#define CONFIG_RANK_VALUE		3
+#define CONFIG_RANK_RATE		4
+#define CONFIG_RANK_NONE		5
+
+typedef struct
+{
+	const char			*Name;
+	unsigned long		Rank;
+
+} tConfigRank;
+
+static const tConfigRank gConfigRanks[] =
+{
+	{ "AcquisitionMode",		CONFIG_RANK_ACQUISITION },
+	{ "FrameStartTriggerMode",	CONFIG_RANK_ACQUISITION },
+	{ "FrameStartTriggerEvent",	CONFIG_RANK_ACQUISITION },
+	{ "PixelFormat",			CONFIG_RANK_FORMAT },
+	{ "BinningX",				CONFIG_RANK_FORMAT },
+	{ "BinningY",				CONFIG_RANK_FORMAT },
+	{ "Width",					CONFIG_RANK_FORMAT },
+	{ "Height",					CONFIG_RANK_FORMAT },
+	{ "RegionX",				CONFIG_RANK_FORMAT },
+	{ "RegionY",				CONFIG_RANK_FORMAT },
+	{ "PacketSize",				CONFIG_RANK_RATE },
+	{ "StreamBytesPerSecond",	CONFIG_RANK_RATE },
+	{ "FrameRate",				CONFIG_RANK_RATE }
+};
+
+static const char *gConfigTypes[] = { "enum", "uint32", "float32", "boolean" };
+static const tPvDatatype gConfigDatatypes[] = { ePvDatatypeEnum, ePvDatatypeUint32, ePvDatatypeFloat32, ePvDatatypeBoolean };
+
+static unsigned long ConfigRank(const tConfigValue *pValue)
+{
+	unsigned long i;
+
+	for(i=0;i<sizeof(gConfigRanks) / sizeof(gConfigRanks[0]);i++)
+		if(!strcmp(gConfigRanks[i].Name,pValue->Name))
+			return gConfigRanks[i].Rank;
+
+	return pValue->Type == ePvDatatypeEnum ? CONFIG_RANK_MODE : CONFIG_RANK_VALUE;
+}
+
+/*
+	Indices of the values in dependency order, the order of the file within a rank
+*/
+static void ConfigOrder(const tCameraConfig *pConfig,unsigned long *pOrder)
+{
+	unsigned long rank[CONFIG_MAX_VALUES];
+	unsigned long i,j,index;
+
+	for(i=0;i<pConfig->Count;i++)
+	{
+		rank[i] = ConfigRank(&(pConfig->Values[i]));
+		index = i;
+		for(j=i;j > 0 && rank[pOrder[j-1]] > rank[i];j--)
+			pOrder[j] = pOrder[j-1];
+		pOrder[j] = index;
+	}
+}
+
+/*
+	Next line of a profile file, without its comment and its blanks. false at the end
+*/
+static bool ConfigLine(FILE *pFile,char *Line,unsigned long *pNumber)
+{
+	char *p;
+
+	while(fgets(Line,CONFIG_LINE_SIZE,pFile))
+	{
+		(*pNumber)++;
+		p = strchr(Line,'#');
+		if(p)
+			*p = 0;
+		p = Line + strlen(Line);
+		while(p > Line && isspace((unsigned char)p[-1]))
+			*--p = 0;
+		for(p=Line;isspace((unsigned char)*p);p++)
+			;
+		if(!*p)
+			continue;
+		memmove(Line,p,strlen(p) + 1);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+	Name of the profile a line starts, false if it does not start one
+*/
+static bool ConfigSection(const char *Line,char *Name)
+{
+	size_t length = strlen(Line);
+
+	if(length < 3 || Line[0] != '[' || Line[length-1] != ']' || length - 2 >= CONFIG_NAME_SIZE)
+		return false;
+
+	memcpy(Name,Line + 1,length - 2);
+	Name[length-2] = 0;
+	return true;
+}
+
+
+/*
+	Value of an attribute on the camera, into Current (same name and type as Value)
+*/
+static tPvErr ConfigRead(tPvHandle Camera,const tConfigValue *pValue,tConfigValue *pCurrent)
+{
+	tPvBoolean boolean;
+	tPvErr err;
+
+	*pCurrent = *pValue;
+	switch(pValue->Type)
+	{
+	case ePvDatatypeEnum:
+		return PvAttrEnumGet(Camera,pValue->Name,pCurrent->Enum,CONFIG_ENUM_SIZE,NULL);
+	case ePvDatatypeUint32:
+		return PvAttrUint32Get(Camera,pValue->Name,&(pCurrent->Uint32));
+	case ePvDatatypeFloat32:
+		return PvAttrFloat32Get(Camera,pValue->Name,&(pCurrent->Float32));
+	default:
+		err = PvAttrBooleanGet(Camera,pValue->Name,&boolean);
+		pCurrent->Uint32 = boolean ? 1 : 0;
+		return err;
+	}
+}
+
+static tPvErr ConfigWrite(tPvHandle Camera,const tConfigValue *pValue)
+{
+	switch(pValue->Type)
+	{
+	case ePvDatatypeEnum:
+		return PvAttrEnumSet(Camera,pValue->Name,pValue->Enum);
+	case ePvDatatypeUint32:
+		return PvAttrUint32Set(Camera,pValue->Name,pValue->Uint32);
+	case ePvDatatypeFloat32:
+		return PvAttrFloat32Set(Camera,pValue->Name,pValue->Float32);
+	default:
+		return PvAttrBooleanSet(Camera,pValue->Name,pValue->Uint32 ? 1 : 0);
+	}
+}
+
+static bool ConfigSame(const tConfigValue *pValue,const tConfigValue *pCurrent)
+{
+	switch(pValue->Type)
+	{
+	case ePvDatatypeEnum:
+		return !strcmp(pValue->Enum,pCurrent->Enum);
+	case ePvDatatypeFloat32:
+		return fabs(pValue->Float32 - pCurrent->Float32) <= CONFIG_FLOAT_TOLERANCE * (fabs(pValue->Float32) > 1.0f ? fabs(pValue->Float32) : 1.0f);
+	default:
+		return pValue->Uint32 == pCurrent->Uint32;
+	}
+}
+
+/*!
+ * @brief
+ *		Empty configuration, nothing applied yet
+ * @param
+ *		configuration
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void CameraConfigInit(tCameraConfig *pConfig)
+{
+	memset(pConfig,0,sizeof(tCameraConfig));
+	strcpy(pConfig->Profile,"built-in");
+}
+
+/*!
+ * @brief
+ *		Add an attribute to the configuration, or change its value
+ * @param
+ *		configuration
+ * @param
+ *		name of the attribute
+ * @param
+ *		ePvDatatypeEnum, Uint32, Float32 or Boolean
+ * @param
+ *		value as text: the enum, a number, 0 or 1
+ * @param
+ *		the camera does not start if it cannot be written
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart()
+ * @return
+ *		false if the configuration is full or the value does not fit
+ */
+bool CameraConfigSet(tCameraConfig *pConfig,const char *Name,tPvDatatype Type,const char *Value,bool Required)
+{
+	tConfigValue *pValue = NULL;
+	unsigned long i;
+
+	if(strlen(Name) >= CONFIG_NAME_SIZE || strlen(Value) >= CONFIG_ENUM_SIZE)
+	{
+		printf("Error in %s:%d at CameraConfigSet() ----> %s=%s is too long\n", __FILE__, __LINE__, Name, Value);
+		return false;
+	}
+
+	for(i=0;i<pConfig->Count && !pValue;i++)
+		if(!strcmp(pConfig->Values[i].Name,Name))
+			pValue = &(pConfig->Values[i]);
+	if(!pValue)
+	{
+		if(pConfig->Count == CONFIG_MAX_VALUES)
+		{
+			printf("Error in %s:%d at CameraConfigSet() ----> more than %d attributes\n", __FILE__, __LINE__, CONFIG_MAX_VALUES);
+			return false;
+		}
+		pValue = &(pConfig->Values[pConfig->Count++]);
+	}
+
+	memset(pValue,0,sizeof(tConfigValue));
+	strcpy(pValue->Name,Name);
+	pValue->Type = Type;
+	pValue->Required = Required;
+	if(Type == ePvDatatypeEnum)
+		strcpy(pValue->Enum,Value);
+	else if(Type == ePvDatatypeFloat32)
+		pValue->Float32 = (tPvFloat32)atof(Value);
+	else if(Type == ePvDatatypeBoolean)
+		pValue->Uint32 = !strcmp(Value,"true") || strtoul(Value,NULL,10) ? 1 : 0;
+	else
+		pValue->Uint32 = strtoul(Value,NULL,10);
+
+	// a new value has never been on the camera
+	pConfig->Applied = false;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Load one profile of a profile file, in place of the configuration
+ * @param
+ *		configuration
+ * @param
+ *		profile file (CameraConfig.h)
+ * @param
+ *		name of the profile, NULL for the first one of the file
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		main()
+ * @return
+ *		false if the file cannot be read, has no such profile or a line is wrong
+ */
+bool CameraConfigLoad(tCameraConfig *pConfig,const char *File,const char *Profile)
+{
+	char line[CONFIG_LINE_SIZE];
+	char section[CONFIG_NAME_SIZE];
+	char name[CONFIG_LINE_SIZE],type[CONFIG_LINE_SIZE],value[CONFIG_LINE_SIZE],flag[CONFIG_LINE_SIZE];
+	unsigned long number = 0;
+	unsigned long t;
+	bool found = false;
+	bool ok = true;
+	int fields;
+	FILE *pFile = fopen(File,"r");
+
+	if(!pFile)
+	{
+		printf("Error in %s:%d at CameraConfigLoad() ----> could not open %s\n", __FILE__, __LINE__, File);
+		return false;
+	}
+
+	CameraConfigInit(pConfig);
+	while(ok && ConfigLine(pFile,line,&number))
+	{
+		if(ConfigSection(line,section))
+		{
+			// the profile ends where the next one starts
+			if(found)
+				break;
+			found = !Profile || !strcmp(section,Profile);
+			if(found)
+				strcpy(pConfig->Profile,section);
+			continue;
+		}
+		if(!found)
+			continue;
+
+		fields = sscanf(line,"%255s %255s %255s %255s",name,type,value,flag);
+		for(t=0;fields >= 3 && t<sizeof(gConfigTypes) / sizeof(gConfigTypes[0]) && strcmp(type,gConfigTypes[t]);t++)
+			;
+		if(fields < 3 || t == sizeof(gConfigTypes) / sizeof(gConfigTypes[0]) || (fields == 4 && strcmp(flag,"required")))
+		{
+			printf("Error in %s:%d at CameraConfigLoad() ----> %s:%lu : expected Attribute enum|uint32|float32|boolean Value [required]\n",
+				__FILE__, __LINE__, File, number);
+			ok = false;
+		}
+		else
+			ok = CameraConfigSet(pConfig,name,gConfigDatatypes[t],value,fields == 4);
+	}
+	fclose(pFile);
+
+	if(ok && !found)
+	{
+		printf("Error in %s:%d at CameraConfigLoad() ----> no profile %s in %s\n", __FILE__, __LINE__, Profile ? Profile : "at all", File);
+		ok = false;
+	}
+
+	return ok;
+}
+
+/*!
+ * @brief
+ *		Names of the profiles of a profile file, in their order
+ * @param
+ *		profile file
+ * @param
+ *		names
+ * @param
+ *		room in Names
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraConfigBenchmark()
+ * @return
+ *		number of profiles, 0 if the file cannot be read
+ */
+unsigned long CameraConfigProfiles(const char *File,char Names[][CONFIG_NAME_SIZE],unsigned long Max)
+{
+	char line[CONFIG_LINE_SIZE];
+	unsigned long number = 0;
+	unsigned long count = 0;
+	FILE *pFile = fopen(File,"r");
+
+	if(!pFile)
+	{
+		printf("Error in %s:%d at CameraConfigProfiles() ----> could not open %s\n", __FILE__, __LINE__, File);
+		return 0;
+	}
+
+	while(count < Max && ConfigLine(pFile,line,&number))
+		if(ConfigSection(line,Names[count]))
+			count++;
+	fclose(pFile);
+
+	return count;
+}
+
+/*!
+ * @brief
+ *		Write the configuration to the camera, in dependency order
+ * @param
+ *		camera handle
+ * @param
+ *		configuration, its counters are those of this call
+ * @param
+ *		read every attribute back first and only write the ones that differ
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart()
+ * @return
+ *		false if a required attribute could not be written
+ */
+bool CameraConfigApply(tPvHandle Camera,tCameraConfig *pConfig,bool Diff)
+{
+	unsigned long long start = GetMicroseconds();
+	tConfigValue current[CONFIG_MAX_VALUES];
+	bool known[CONFIG_MAX_VALUES];
+	unsigned long order[CONFIG_MAX_VALUES];
+	unsigned long written = CONFIG_RANK_NONE;	// lowest rank written
+	tConfigValue *pValue;
+	bool required = true;
+	unsigned long i,k,rank;
+	tPvErr err;
+
+	pConfig->Reads = 0;
+	pConfig->Rereads = 0;
+	pConfig->Writes = 0;
+	pConfig->Skipped = 0;
+	pConfig->Failed = 0;
+	pConfig->AppliedAt = start;
+
+	/*
+	Read back in one pass, before anything changes on the camera
+	*/
+	for(i=0;Diff && i<pConfig->Count;i++)
+	{
+		known[i] = !ConfigRead(Camera,&(pConfig->Values[i]),&(current[i]));
+		pConfig->Reads++;
+	}
+	pConfig->ReadTime = GetMicroseconds() - start;
+
+	ConfigOrder(pConfig,order);
+	for(k=0;k<pConfig->Count;k++)
+	{
+		i = order[k];
+		pValue = &(pConfig->Values[i]);
+		rank = ConfigRank(pValue);
+		if(Diff)
+		{
+			// the camera clamps the rates to what the values written before them allow
+			if(rank == CONFIG_RANK_RATE && written < rank)
+			{
+				known[i] = !ConfigRead(Camera,pValue,&(current[i]));
+				pConfig->Reads++;
+				pConfig->Rereads++;
+			}
+			// an attribute that cannot be read is written
+			if(known[i] && ConfigSame(pValue,&(current[i])))
+			{
+				pConfig->Skipped++;
+				continue;
+			}
+		}
+
+		pConfig->Writes++;
+		err = ConfigWrite(Camera,pValue);
+		if(err)
+		{
+			printf("Error in %s:%d at CameraConfigApply() ----> %s : ", __FILE__, __LINE__, pValue->Name);
+			convertandPrintErrorCode(err);
+			pConfig->Failed++;
+			if(pValue->Required)
+				required = false;
+		}
+		else if(rank < written)
+			written = rank;
+	}
+
+	pConfig->Applied = required;
+	pConfig->ApplyTime = GetMicroseconds() - start;
+
+	return required;
+}
+
+/*!
+ * @brief
+ *		Time to stream of the last apply: from its start to the first frame
+ * @param
+ *		configuration
+ * @param
+ *		GetMicroseconds() of the first frame after the apply
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		milliseconds, 0 if the frame is not after the apply
+ */
+double CameraConfigTimeToStream(const tCameraConfig *pConfig,unsigned long long FirstFrameAt)
+{
+	return pConfig->AppliedAt && FirstFrameAt >= pConfig->AppliedAt ? (double)(FirstFrameAt - pConfig->AppliedAt) / 1000.0 : 0.0;
+}
+
+/*!
+ * @brief
+ *		Time to stream of each profile of a file applied over the previous one,
+ *		written in full then only where the camera differs. Every profile is
+ *		applied in turn, then the first one twice
+ * @param
+ *		profile file, NULL for CONFIG_PROFILE_FILE
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraConfigApply()
+ * @return
+ *		void
+ */
+void CameraConfigBenchmark(const char *File)
+{
+	static char environment[] = "PVSIM=cameras=1,width=640,height=480,fps=30,discovery=0,control=5";
+	static tCameraConfig config;
+	char names[CONFIG_MAX_PROFILES][CONFIG_NAME_SIZE];
+	unsigned long sequence[CONFIG_MAX_PROFILES + 2];
+	const char *previous;
+	tPvCameraInfo info;
+	tPvHandle handle;
+	tPvFrame frame;
+	tPvUint32 frameSize;
+	double stream,total;
+	unsigned long count,steps,d,s,waited = 0;
+	tPvErr err;
+
+	if(!File)
+		File = CONFIG_PROFILE_FILE;
+	count = CameraConfigProfiles(File,names,CONFIG_MAX_PROFILES);
+	if(!count)
+	{
+		printf("Error in %s:%d at CameraConfigBenchmark() ----> no profile in %s\n", __FILE__, __LINE__, File);
+		return;
+	}
+	for(steps=0;steps<count;steps++)
+		sequence[steps] = steps;
+	sequence[steps++] = 0;
+	sequence[steps++] = 0;
+
+	// control transactions that take the time of a GigE round trip, unless they are set already
+	if(!getenv("PVSIM"))
+		putenv(environment);
+
+	printf("Profile benchmark, %lu profile(s) of %s\n",count,File);
+	if(PvInitialize())
+	{
+		printf("Error in %s:%d at CameraConfigBenchmark() ----> PvInitialize failed\n", __FILE__, __LINE__);
+		return;
+	}
+	while(!PvCameraCount() && waited < 5000)
+	{
+		Sleep(250);
+		waited += 250;
+	}
+	if(!PvCameraList(&info,1,NULL) || PvCameraOpen(info.UniqueId,ePvAccessMaster,&handle))
+	{
+		printf("Error in %s:%d at CameraConfigBenchmark() ----> no camera to open\n", __FILE__, __LINE__);
+		PvUnInitialize();
+		return;
+	}
+
+	memset(&frame,0,sizeof(tPvFrame));
+	PvCaptureStart(handle);
+	for(d=0;d<2;d++)
+	{
+		total = 0.0;
+		previous = "camera";
+		for(s=0;s<steps;s++)
+		{
+			PvCommandRun(handle,"AcquisitionStop");
+			PvCaptureQueueClear(handle);
+			if(!CameraConfigLoad(&config,File,names[sequence[s]]))
+				break;
+
+			CameraConfigApply(handle,&config,d != 0);
+			// a profile may change the size of the frames
+			PvAttrUint32Get(handle,"TotalBytesPerFrame",&frameSize);
+			if(frameSize > frame.ImageBufferSize)
+			{
+				free(frame.ImageBuffer);
+				frame.ImageBuffer = malloc(frameSize);
+				frame.ImageBufferSize = frame.ImageBuffer ? frameSize : 0;
+			}
+			err = PvCaptureQueueFrame(handle,&frame,NULL);
+			if(!err)
+				err = PvCommandRun(handle,"AcquisitionStart");
+			if(!err)
+				err = PvCaptureWaitForFrameDone(handle,&frame,CONFIG_BENCH_WAIT);
+			stream = !err && !frame.Status ? CameraConfigTimeToStream(&config,GetMicroseconds()) : 0.0;
+			total += stream;
+
+			printf("  %-4s %-10s -> %-10s : apply %7.2f ms (read back %6.2f ms), %2lu read (%lu again), %2lu written, %2lu unchanged, streaming after %7.2f ms%s\n",
+				d ? "diff" : "full",previous,config.Profile,(double)config.ApplyTime / 1000.0,(double)config.ReadTime / 1000.0,
+				config.Reads,config.Rereads,config.Writes,config.Skipped,stream,stream ? "" : " (no frame)");
+			previous = names[sequence[s]];
+		}
+		printf("  %-4s time to stream %7.2f ms on average\n",d ? "diff" : "full",total / (double)steps);
+	}
+
+	PvCommandRun(handle,"AcquisitionStop");
+	PvCaptureQueueClear(handle);
+	PvCaptureEnd(handle);
+	PvCameraClose(handle);
+	PvUnInitialize();
+	free(frame.ImageBuffer);
+}
@@ -0,0 +1,152 @@
+/*!
+ *  @file
+ *     CameraRegistry.cpp
+ *  @brief
+ *     OTC project: Camera registry. The slots are only appended, so readers
+ *	   walk them without the lock; adding a camera takes it
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "mainHeader.h"
+#include "CameraRegistry.h"
+
+/*
+	UIDs next to each other, the lookup of a link event reads one or two lines
+*/
+static unsigned long gRegistryUID[REGISTRY_MAX_CAMERAS];
+static tCamera *gRegistryCameras[REGISTRY_MAX_CAMERAS];
+static volatile long gRegistryCount = 0;
+static tLock gRegistryLock;
+
+
+/*!
+ * @brief
+ *		Initialize the registry, before the link callbacks are registered
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void CameraRegistryInit()
+{
+	LockInit(&gRegistryLock);
+	gRegistryCount = 0;
+}
+
+/*!
+ * @brief
+ *		Release every camera instance. The cameras must be closed and the link
+ *		callbacks unregistered
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraUnsetup()
+ * @return
+ *		void
+ */
+void CameraRegistryDestroy()
+{
+	for(long i=0;i<gRegistryCount;i++)
+	{
+		AlignedFree(gRegistryCameras[i]);
+		gRegistryCameras[i] = NULL;
+	}
+	gRegistryCount = 0;
+	LockDestroy(&gRegistryLock);
+}
+
+/*!
+ * @brief
+ *		Instance of a camera, created the first time the camera is plugged
+ * @param
+ *		UID of the camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraEventCB()
+ * @return
+ *		the instance, NULL when REGISTRY_MAX_CAMERAS cameras are registered already
+ */
+tCamera *CameraRegistryAdd(unsigned long UID)
+{
+	tCamera *tCamInstance;
+	unsigned long size;
+
+	LockAcquire(&gRegistryLock);
+
+	tCamInstance = CameraRegistryFind(UID);
+	if(tCamInstance || gRegistryCount == REGISTRY_MAX_CAMERAS)
+	{
+		LockRelease(&gRegistryLock);
+		if(!tCamInstance)
+			printf("Error in %s:%d at CameraRegistryAdd() ----> no slot for camera %lu, %d cameras at most\n", __FILE__, __LINE__,
+				UID, REGISTRY_MAX_CAMERAS);
+		return tCamInstance;
+	}
+
+	// whole lines, the allocation that follows cannot share the last one
+	size = (sizeof(tCamera) + REGISTRY_CACHE_LINE - 1) & ~(REGISTRY_CACHE_LINE - 1);
+	tCamInstance = (tCamera*)AlignedAlloc(size,REGISTRY_CACHE_LINE);
+	if(tCamInstance)
+	{
+		memset(tCamInstance,0,size);
+		tCamInstance->UID = UID;
+		tCamInstance->Index = gRegistryCount;
+		gRegistryUID[gRegistryCount] = UID;
+		gRegistryCameras[gRegistryCount] = tCamInstance;
+		// the slot is filled before it is counted
+		AtomicIncrement(&gRegistryCount);
+	}
+	else
+		printf("Error in %s:%d at CameraRegistryAdd() ----> could not allocate camera %lu\n", __FILE__, __LINE__, UID);
+
+	LockRelease(&gRegistryLock);
+
+	return tCamInstance;
+}
+
+/*!
+ * @brief
+ *		Instance of a registered camera
+ * @param
+ *		UID of the camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		the instance, NULL if the camera was never plugged
+ */
+tCamera *CameraRegistryFind(unsigned long UID)
+{
+	long count = gRegistryCount;
+
+	for(long i=0;i<count;i++)
+	{
+		if(gRegistryUID[i] == UID)
+			return gRegistryCameras[i];
+	}
+
+	return NULL;
+}
+
+/*!
+ * @brief
+ *		Instance in a slot, in the order the cameras were first plugged
+ * @param
+ *		slot, below CameraRegistryCount()
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		the instance, NULL past the last slot
+ */
+tCamera *CameraRegistryGet(unsigned long Index)
+{
+	return Index < (unsigned long)gRegistryCount ? gRegistryCameras[Index] : NULL;
+}
+
+unsigned long CameraRegistryCount()
+{
+	return gRegistryCount;
+}
@@ -0,0 +1,671 @@
+/*!
+ *  @file
+ *     CaptureBenchmark.cpp
+ *  @brief
+ *     OTC project: End to end capture benchmark. Each run brings the cameras
+ *	   up the way ControlHandler() does, measures between two snapshots of the
+ *	   counters and takes everything down again
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "mainHeader.h"
+#include "CaptureBenchmark.h"
+
+#ifdef _WINDOWS
+#define BENCH_U64	"%I64u"
+#else
+#define BENCH_U64	"%llu"
+#endif
+
+#define BENCH_CAPTURE_DIR		"capture_bench"
+#define BENCH_CAPTURE_VALUES	8			// values of one swept parameter
+#define BENCH_CAPTURE_WAIT		5000		// milliseconds for the cameras to show up, then to stream
+#define BENCH_REPLUG_SECONDS	1			// a camera unplugged by the simulator comes back after that
+
+typedef enum
+{
+	eBenchTiff,
+	eBenchRaw,
+	eBenchPool,
+	eBenchUring,
+	eBenchCompress,
+	eBenchStorageCount
+
+} tBenchStorage;
+
+typedef enum
+{
+	eBenchReconnectNone,
+	eBenchReconnectFull,
+	eBenchReconnectFast,
+	eBenchReconnectCount
+
+} tBenchReconnect;
+
+static const char *gBenchStorageNames[eBenchStorageCount] = { "tiff", "raw", "pool", "uring", "compress" };
+static const char *gBenchAcquireNames[2] = { "callback", "poll" };
+static const char *gBenchProcessNames[2] = { "writer", "pool" };
+static const char *gBenchBringupNames[2] = { "serial", "parallel" };
+static const char *gBenchReconnectNames[eBenchReconnectCount] = { "none", "full", "fast" };
+
+/*!
+ * @brief
+ *		Parameters swept by the benchmark, every combination is one run
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned long		Cameras[BENCH_CAPTURE_VALUES];
+	unsigned long		CameraCount;
+	unsigned long		Width[BENCH_CAPTURE_VALUES];
+	unsigned long		Height[BENCH_CAPTURE_VALUES];
+	unsigned long		SizeCount;
+	char				Format[BENCH_CAPTURE_VALUES][16];	// tPvImageFormat name, handed to the simulator
+	unsigned long		FormatCount;
+	tBenchStorage		Storage[BENCH_CAPTURE_VALUES];
+	unsigned long		StorageCount;
+	tAcquireMode		Acquire[BENCH_CAPTURE_VALUES];
+	unsigned long		AcquireCount;
+	tProcessMode		Process[BENCH_CAPTURE_VALUES];
+	unsigned long		ProcessCount;
+	bool				Parallel[BENCH_CAPTURE_VALUES];	// bring-up of the cameras
+	unsigned long		BringupCount;
+	tBenchReconnect		Reconnect[BENCH_CAPTURE_VALUES];
+	unsigned long		ReconnectCount;
+	unsigned long		Control;			// milliseconds per control transaction of the simulator
+	unsigned long		Workers;			// threads of the work pool, 0 one per processor but one
+	unsigned long		Seconds;
+	unsigned long		Warmup;
+	float				FrameRate;
+
+} tCaptureSweep;
+
+/*
+	Counters of all the cameras of a run at one time
+*/
+typedef struct
+{
+	unsigned long long	Completed;
+	unsigned long long	Dropped;
+	unsigned long long	Written;
+	unsigned long long	Rejected;			// frames the writer could not queue
+	unsigned long long	Bytes;
+	unsigned long long	Cpu;
+	unsigned long long	Time;
+	tLatencyHistogram	Latency;
+	unsigned long		FramesHeld;			// -process pool, done before an older frame
+	tWorkStats			Pool[WORKPOOL_MAX_THREADS + 1];
+	unsigned long		Workers;
+
+} tBenchSnapshot;
+
+/*
+	Link events of a camera of the run, from the link callback
+*/
+typedef struct
+{
+	unsigned long		UID;
+	volatile unsigned long long	RemovedAt;	// first unplug
+	volatile unsigned long long	AddedAt;	// first plug after it
+
+} tBenchLink;
+
+static tBenchLink gBenchLinks[REGISTRY_MAX_CAMERAS];
+static unsigned long gBenchLinkCount = 0;
+
+
+/*
+	Split the values of one key, separated by ':'
+*/
+static unsigned long BenchSplit(char *pValue,char **ppValues)
+{
+	unsigned long count = 0;
+	char *pNext;
+
+	while(pValue && count < BENCH_CAPTURE_VALUES)
+	{
+		pNext = strchr(pValue,':');
+		if(pNext)
+			*pNext++ = 0;
+		ppValues[count++] = pValue;
+		pValue = pNext;
+	}
+
+	return count;
+}
+
+static bool BenchParse(const char *Spec,tCaptureSweep *pSweep)
+{
+	char buffer[512];
+	char *pKey,*pValue,*pNext;
+	char *values[BENCH_CAPTURE_VALUES];
+	unsigned long i,j,count;
+
+	if(strlen(Spec) >= sizeof(buffer))
+		return false;
+	strcpy(buffer,Spec);
+
+	for(pKey=buffer;pKey && *pKey;pKey=pNext)
+	{
+		pNext = strchr(pKey,',');
+		if(pNext)
+			*pNext++ = 0;
+		pValue = strchr(pKey,'=');
+		if(!pValue)
+			return false;
+		*pValue++ = 0;
+		count = BenchSplit(pValue,values);
+
+		if(!strcmp(pKey,"cameras"))
+		{
+			for(i=0;i<count;i++)
+				pSweep->Cameras[i] = strtoul(values[i],NULL,10);
+			pSweep->CameraCount = count;
+		}
+		else if(!strcmp(pKey,"size"))
+		{
+			for(i=0;i<count;i++)
+				if(sscanf(values[i],"%lux%lu",&(pSweep->Width[i]),&(pSweep->Height[i])) != 2)
+					return false;
+			pSweep->SizeCount = count;
+		}
+		else if(!strcmp(pKey,"format"))
+		{
+			for(i=0;i<count;i++)
+			{
+				if(strlen(values[i]) >= sizeof(pSweep->Format[i]))
+					return false;
+				strcpy(pSweep->Format[i],values[i]);
+			}
+			pSweep->FormatCount = count;
+		}
+		else if(!strcmp(pKey,"storage"))
+		{
+			for(i=0;i<count;i++)
+			{
+				for(j=0;j<eBenchStorageCount && strcmp(values[i],gBenchStorageNames[j]);j++);
+				if(j == eBenchStorageCount)
+					return false;
+				pSweep->Storage[i] = (tBenchStorage)j;
+			}
+			pSweep->StorageCount = count;
+		}
+		else if(!strcmp(pKey,"acquire"))
+		{
+			for(i=0;i<count;i++)
+			{
+				for(j=0;j<2 && strcmp(values[i],gBenchAcquireNames[j]);j++);
+				if(j == 2)
+					return false;
+				pSweep->Acquire[i] = (tAcquireMode)j;
+			}
+			pSweep->AcquireCount = count;
+		}
+		else if(!strcmp(pKey,"process"))
+		{
+			for(i=0;i<count;i++)
+			{
+				for(j=0;j<2 && strcmp(values[i],gBenchProcessNames[j]);j++);
+				if(j == 2)
+					return false;
+				pSweep->Process[i] = (tProcessMode)j;
+			}
+			pSweep->ProcessCount = count;
+		}
+		else if(!strcmp(pKey,"bringup"))
+		{
+			for(i=0;i<count;i++)
+			{
+				for(j=0;j<2 && strcmp(values[i],gBenchBringupNames[j]);j++);
+				if(j == 2)
+					return false;
+				pSweep->Parallel[i] = j != 0;
+			}
+			pSweep->BringupCount = count;
+		}
+		else if(!strcmp(pKey,"reconnect"))
+		{
+			for(i=0;i<count;i++)
+			{
+				for(j=0;j<eBenchReconnectCount && strcmp(values[i],gBenchReconnectNames[j]);j++);
+				if(j == eBenchReconnectCount)
+					return false;
+				pSweep->Reconnect[i] = (tBenchReconnect)j;
+			}
+			pSweep->ReconnectCount = count;
+		}
+		else if(!strcmp(pKey,"control"))
+			pSweep->Control = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"workers"))
+			pSweep->Workers = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"seconds"))
+			pSweep->Seconds = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"warmup"))
+			pSweep->Warmup = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"fps"))
+			pSweep->FrameRate = (float)atof(pValue);
+		else
+			return false;
+	}
+
+	return pSweep->CameraCount && pSweep->SizeCount && pSweep->FormatCount && pSweep->StorageCount && pSweep->AcquireCount && pSweep->ProcessCount &&
+		pSweep->BringupCount && pSweep->ReconnectCount && pSweep->Seconds;
+}
+
+static void BenchRemoveDir(const char *Directory)
+{
+	char command[200];
+
+#ifdef _WINDOWS
+	sprintf(command,"rmdir /s /q %s",Directory);
+#else
+	sprintf(command,"rm -rf %s",Directory);
+#endif
+	system(command);
+}
+
+static void BenchSnapshotTake(tBenchSnapshot *pSnapshot)
+{
+	tCamera *tCamInstance;
+	tStreamStats stats;
+	unsigned long i,b;
+
+	memset(pSnapshot,0,sizeof(tBenchSnapshot));
+	pSnapshot->Cpu = ProcessCpuMicroseconds();
+	pSnapshot->Time = GetMicroseconds();
+	pSnapshot->Workers = WorkPoolSnapshot(pSnapshot->Pool);
+
+	for(i=0;i<CameraRegistryCount();i++)
+	{
+		tCamInstance = CameraRegistryGet(i);
+		StatsSamplerRead(&(tCamInstance->Stats),&stats);
+		pSnapshot->Completed += stats.FramesCompleted;
+		pSnapshot->Dropped += stats.FramesDropped;
+		pSnapshot->Written += tCamInstance->Writer.FramesWritten;
+		pSnapshot->Rejected += tCamInstance->Writer.FramesFailed;
+		pSnapshot->Bytes += tCamInstance->Container.BytesWritten + tCamInstance->Tiff.BytesWritten;
+		pSnapshot->FramesHeld += tCamInstance->Writer.FramesHeld;
+		for(b=0;b<LATENCY_BUCKETS;b++)
+			pSnapshot->Latency.Count[b] += tCamInstance->Writer.DiskLatency.Count[b];
+	}
+}
+
+/*
+	Percent of the time worker Index spent running jobs between two snapshots
+*/
+static double BenchWorkerBusy(const tBenchSnapshot *pBegin,const tBenchSnapshot *pEnd,unsigned long Index)
+{
+	unsigned long long elapsed = pEnd->Pool[Index].Elapsed - pBegin->Pool[Index].Elapsed;
+
+	if(!elapsed)
+		return 0.0;
+
+	return (double)(pEnd->Pool[Index].BusyTime - pBegin->Pool[Index].BusyTime) * 100.0 / (double)elapsed;
+}
+
+/*
+	The cameras brought up have all had their first frame
+*/
+static bool BenchStreaming(unsigned long Count)
+{
+	tCamera *tCamInstance;
+	unsigned long i;
+
+	for(i=0;i<Count;i++)
+	{
+		tCamInstance = CameraRegistryGet(i);
+		if(tCamInstance->Bringup.State != eBringupFailed && !tCamInstance->Bringup.FirstFrameAt)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+	Link callback of the run: the first unplug of each camera, then its plug
+*/
+static void _STDCALL BenchLinkCB(void* /*Context*/,tPvInterface /*Interface*/,tPvLinkEvent Event,unsigned long UniqueId)
+{
+	unsigned long i;
+
+	for(i=0;i<gBenchLinkCount;i++)
+	{
+		if(gBenchLinks[i].UID != UniqueId)
+			continue;
+		if(Event == ePvLinkRemove && !gBenchLinks[i].RemovedAt)
+			gBenchLinks[i].RemovedAt = GetMicroseconds();
+		else if(Event == ePvLinkAdd && gBenchLinks[i].RemovedAt && !gBenchLinks[i].AddedAt)
+			gBenchLinks[i].AddedAt = GetMicroseconds();
+	}
+}
+
+/*
+	Handle the unplug and the plug of every camera the way ControlHandler() does,
+	until each one streams again: its gap, its first frame after the plug and the
+	attributes written
+*/
+static void BenchReconnect(unsigned long Count,unsigned long Timeout,double *pGap,double *pPlugged,unsigned long *pWrites)
+{
+	tCamera *tCamInstance;
+	char cameraDir[100];
+	unsigned long phase[REGISTRY_MAX_CAMERAS];
+	unsigned long i,done = 0,waited;
+
+	memset(phase,0,sizeof(phase));
+	for(waited=0;done < Count && waited < Timeout;waited+=10)
+	{
+		for(i=0;i<Count;i++)
+		{
+			tCamInstance = CameraRegistryGet(i);
+			if(phase[i] == 0 && gBenchLinks[i].RemovedAt)
+			{
+				CameraUnplugged(tCamInstance);
+				tCamInstance->Reconnect.UnpluggedAt = gBenchLinks[i].RemovedAt;
+				phase[i]++;
+			}
+			else if(phase[i] == 1 && gBenchLinks[i].AddedAt)
+			{
+				tCamInstance->isUnplugged = false;
+				sprintf(cameraDir,"%s/%lu",surveyDir,tCamInstance->UID);
+				CameraBringupStart(tCamInstance,cameraDir,NULL);
+				phase[i]++;
+			}
+			else if(phase[i] == 2 && (tCamInstance->Bringup.State == eBringupFailed || CameraReconnectAccount(tCamInstance)))
+			{
+				CameraBringupJoin(tCamInstance);
+				pGap[i] = tCamInstance->Reconnect.LastGap;
+				pPlugged[i] = CameraBringupTimeToFirstFrame(tCamInstance);
+				pWrites[i] = tCamInstance->Config.Writes;
+				phase[i]++;
+				done++;
+			}
+		}
+		Sleep(10);
+	}
+}
+
+/*
+	One run: Cameras cameras of the same size and format, brought up, acquired
+	and processed one way, recorded with one storage backend
+*/
+static void CaptureBenchRun(const tCaptureSweep *pSweep,unsigned long Cameras,unsigned long Width,unsigned long Height,
+							const char *Format,tBenchStorage Storage,tAcquireMode Acquire,tProcessMode Process,
+							bool Parallel,tBenchReconnect Reconnect,FILE *pJson,bool First)
+{
+	static char environment[200];
+	tPvCameraInfo info[REGISTRY_MAX_CAMERAS];
+	double ttff[REGISTRY_MAX_CAMERAS];
+	double gap[REGISTRY_MAX_CAMERAS],plugged[REGISTRY_MAX_CAMERAS];
+	unsigned long writes[REGISTRY_MAX_CAMERAS];
+	unsigned long unplug = 0;
+	tCamera *tCamInstance;
+	tBenchSnapshot begin,end;
+	char cameraDir[100];
+	unsigned long i,b,count,waited = 0;
+	unsigned long long completed,dropped,written,rejected,bytes,bringupAt;
+	double elapsed,dropRate,cpu,streaming = 0.0;
+
+	// the simulator reads PVSIM in PvInitialize(), the real PvAPI does not
+	// the first unplug (0.5 to 1.5 times unplug) comes after the measurement
+	if(Reconnect != eBenchReconnectNone)
+		unplug = 2 * (pSweep->Warmup + pSweep->Seconds + 2);
+	sprintf(environment,"PVSIM=cameras=%lu,width=%lu,height=%lu,format=%s,fps=%.1f,discovery=0,control=%lu,unplug=%lu,replug=%d",
+		Cameras,Width,Height,Format,pSweep->FrameRate,pSweep->Control,unplug,BENCH_REPLUG_SECONDS);
+	putenv(environment);
+	memset(gap,0,sizeof(gap));
+	memset(plugged,0,sizeof(plugged));
+	memset(writes,0,sizeof(writes));
+
+	rawContainer = Storage != eBenchTiff;
+	storageKind = Storage == eBenchPool ? eStoragePool : (Storage == eBenchUring ? eStorageUring : eStorageSync);
+	compressFrames = Storage == eBenchCompress;
+	acquireMode = Acquire;
+	processMode = Process;
+	fastReconnect = Reconnect == eBenchReconnectFast;
+	if(compressFrames || processMode == eProcessPool)
+		WorkPoolStart(pSweep->Workers ? pSweep->Workers : ProcessorCount() - 1);
+
+	if(PvInitialize())
+	{
+		printf("Error in %s:%d at CaptureBenchRun() ----> PvInitialize failed\n", __FILE__, __LINE__);
+		WorkPoolStop();
+		return;
+	}
+	while(PvCameraCount() < Cameras && waited < BENCH_CAPTURE_WAIT)
+	{
+		Sleep(100);
+		waited += 100;
+	}
+	if(Cameras > sizeof(info) / sizeof(info[0]))
+		Cameras = sizeof(info) / sizeof(info[0]);
+	count = PvCameraList(info,Cameras,NULL);
+	if(!count)
+	{
+		printf("Error in %s:%d at CaptureBenchRun() ----> no camera\n", __FILE__, __LINE__);
+		PvUnInitialize();
+		WorkPoolStop();
+		return;
+	}
+	for(i=0;i<count;i++)
+	{
+		gBenchLinks[i].UID = info[i].UniqueId;
+		gBenchLinks[i].RemovedAt = 0;
+		gBenchLinks[i].AddedAt = 0;
+	}
+	gBenchLinkCount = count;
+	PvLinkCallbackRegister(BenchLinkCB,ePvLinkAdd,NULL);
+	PvLinkCallbackRegister(BenchLinkCB,ePvLinkRemove,NULL);
+
+	// same directories as a survey
+	strcpy(surveyDir,BENCH_CAPTURE_DIR);
+	MakeDirectory(surveyDir);
+	sprintf(cameraDir,"%s/Previewer",surveyDir);
+	MakeDirectory(cameraDir);
+	CameraRegistryInit();
+	bringupAt = GetMicroseconds();
+	for(i=0;i<count;i++)
+	{
+		sprintf(cameraDir,"%s/%lu",surveyDir,info[i].UniqueId);
+		tCamInstance = CameraRegistryAdd(info[i].UniqueId);
+		CameraBringupStart(tCamInstance,cameraDir,NULL);
+		// serial: the next camera waits, as it did on the link callback thread
+		if(!Parallel)
+			CameraBringupJoin(tCamInstance);
+	}
+	for(i=0;i<count;i++)
+	{
+		tCamInstance = CameraRegistryGet(i);
+		CameraBringupJoin(tCamInstance);
+		if(tCamInstance->Bringup.State == eBringupFailed)
+			printf("Error in %s:%d at CaptureBenchRun() ----> camera %lu did not start\n", __FILE__, __LINE__, info[i].UniqueId);
+		else
+			tCamInstance->readyToCapture = true;
+	}
+
+	// time to first frame from the start of the bring-ups, the one of the last camera is the startup time
+	for(waited=0;!BenchStreaming(count) && waited < BENCH_CAPTURE_WAIT;waited+=10)
+		Sleep(10);
+	for(i=0;i<count;i++)
+	{
+		tCamInstance = CameraRegistryGet(i);
+		ttff[i] = tCamInstance->Bringup.FirstFrameAt ? (double)(tCamInstance->Bringup.FirstFrameAt - bringupAt) / 1000.0 : 0.0;
+		if(ttff[i] > streaming)
+			streaming = ttff[i];
+	}
+
+	Sleep(pSweep->Warmup * 1000);
+	BenchSnapshotTake(&begin);
+	Sleep(pSweep->Seconds * 1000);
+	BenchSnapshotTake(&end);
+
+	if(Reconnect != eBenchReconnectNone)
+		BenchReconnect(count,(unplug * 3 / 2 + BENCH_REPLUG_SECONDS) * 1000 + BENCH_CAPTURE_WAIT,gap,plugged,writes);
+
+	PvLinkCallbackUnRegister(BenchLinkCB,ePvLinkAdd);
+	PvLinkCallbackUnRegister(BenchLinkCB,ePvLinkRemove);
+	for(i=0;i<count;i++)
+	{
+		tCamInstance = CameraRegistryGet(i);
+		CameraBringupCancel(tCamInstance);
+		// a camera that did not come back was closed already
+		if(tCamInstance->isUnplugged)
+		{
+			FrameArenaDestroy(&(tCamInstance->Arena),tCamInstance->Frames);
+			continue;
+		}
+		PvCommandRun(tCamInstance->Handle,"AcquisitionStop");
+		PvCaptureEnd(tCamInstance->Handle);
+		CameraUnsetup(tCamInstance);
+	}
+	CameraRegistryDestroy();
+	PvUnInitialize();
+	WorkPoolStop();
+	BenchRemoveDir(BENCH_CAPTURE_DIR);
+
+	elapsed = (double)(end.Time - begin.Time) / 1000000.0;
+	completed = end.Completed - begin.Completed;
+	dropped = end.Dropped - begin.Dropped;
+	written = end.Written - begin.Written;
+	rejected = end.Rejected - begin.Rejected;
+	bytes = end.Bytes - begin.Bytes;
+	for(b=0;b<LATENCY_BUCKETS;b++)
+		end.Latency.Count[b] -= begin.Latency.Count[b];
+	// frames the camera could not send and frames the writer could not take
+	dropRate = completed + dropped ? (double)(dropped + rejected) / (double)(completed + dropped) : 0.0;
+	// percent of one processor, the frame source included
+	cpu = (double)(end.Cpu - begin.Cpu) / (double)(end.Time - begin.Time) * 100.0 / count;
+
+	printf("%2lu x %4lux%-4lu %-13s %-8s %-8s %-6s %-8s : %6.1f fps/camera, drop %6.3f%%, latency p50 %7.2f p99 %7.2f p99.9 %7.2f ms, cpu %5.1f%%/camera, %7.1f MB/s\n",
+		count,Width,Height,Format,gBenchStorageNames[Storage],gBenchAcquireNames[Acquire],gBenchProcessNames[Process],
+		gBenchBringupNames[Parallel],(double)written / elapsed / count,dropRate * 100.0,
+		(double)LatencyPercentile(&(end.Latency),0.5) / 1000.0,(double)LatencyPercentile(&(end.Latency),0.99) / 1000.0,
+		(double)LatencyPercentile(&(end.Latency),0.999) / 1000.0,cpu,(double)bytes / elapsed / 1048576.0);
+
+	printf("    bring-up, all cameras streaming after %7.1f ms, first frame of each :",streaming);
+	for(i=0;i<count;i++)
+		printf(" %7.1f",ttff[i]);
+	printf(" ms\n");
+	if(Reconnect != eBenchReconnectNone)
+	{
+		printf("    reconnect %s, gap of each :",gBenchReconnectNames[Reconnect]);
+		for(i=0;i<count;i++)
+			printf(" %7.1f",gap[i]);
+		printf(" ms, first frame after the plug :");
+		for(i=0;i<count;i++)
+			printf(" %6.1f",plugged[i]);
+		printf(" ms, attributes written :");
+		for(i=0;i<count;i++)
+			printf(" %lu",writes[i]);
+		printf("\n");
+	}
+
+	// utilization and steals of every worker
+	if(end.Workers)
+	{
+		printf("    work pool, %lu frames held for an older one :",end.FramesHeld - begin.FramesHeld);
+		for(i=0;i<end.Workers;i++)
+			printf(" %5.1f%% (" BENCH_U64 " steals)",BenchWorkerBusy(&begin,&end,i),end.Pool[i].Steals - begin.Pool[i].Steals);
+		printf("\n");
+	}
+
+	if(!pJson)
+		return;
+	fprintf(pJson,"%s\n    {\"cameras\": %lu, \"width\": %lu, \"height\": %lu, \"format\": \"%s\", \"storage\": \"%s\", \"acquire\": \"%s\", \"process\": \"%s\",\n",
+		First ? "" : ",",count,Width,Height,Format,gBenchStorageNames[Storage],gBenchAcquireNames[Acquire],gBenchProcessNames[Process]);
+	fprintf(pJson,"     \"bringup\": \"%s\", \"control_ms\": %lu, \"streaming_ms\": %.2f, \"ttff_ms\": [",
+		gBenchBringupNames[Parallel],pSweep->Control,streaming);
+	for(i=0;i<count;i++)
+		fprintf(pJson,"%s%.2f",i ? ", " : "",ttff[i]);
+	fprintf(pJson,"],\n");
+	fprintf(pJson,"     \"reconnect\": \"%s\", \"reconnect_gap_ms\": [",gBenchReconnectNames[Reconnect]);
+	for(i=0;Reconnect != eBenchReconnectNone && i<count;i++)
+		fprintf(pJson,"%s%.2f",i ? ", " : "",gap[i]);
+	fprintf(pJson,"], \"reconnect_ttff_ms\": [");
+	for(i=0;Reconnect != eBenchReconnectNone && i<count;i++)
+		fprintf(pJson,"%s%.2f",i ? ", " : "",plugged[i]);
+	fprintf(pJson,"], \"reconnect_writes\": [");
+	for(i=0;Reconnect != eBenchReconnectNone && i<count;i++)
+		fprintf(pJson,"%s%lu",i ? ", " : "",writes[i]);
+	fprintf(pJson,"],\n");
+	fprintf(pJson,"     \"seconds\": %.3f, \"fps_per_camera\": %.2f, \"fps_total\": %.2f,\n",
+		elapsed,(double)written / elapsed / count,(double)written / elapsed);
+	fprintf(pJson,"     \"frames_completed\": " BENCH_U64 ", \"frames_written\": " BENCH_U64 ", \"frames_dropped\": " BENCH_U64 ", \"frames_rejected\": " BENCH_U64 ", \"drop_rate\": %.6f,\n",
+		completed,written,dropped,rejected,dropRate);
+	fprintf(pJson,"     \"latency_p50_us\": " BENCH_U64 ", \"latency_p99_us\": " BENCH_U64 ", \"latency_p999_us\": " BENCH_U64 ",\n",
+		LatencyPercentile(&(end.Latency),0.5),LatencyPercentile(&(end.Latency),0.99),LatencyPercentile(&(end.Latency),0.999));
+	fprintf(pJson,"     \"cpu_per_camera_pct\": %.2f, \"bytes_written\": " BENCH_U64 ", \"write_mb_per_s\": %.2f,\n",
+		cpu,bytes,(double)bytes / elapsed / 1048576.0);
+	fprintf(pJson,"     \"frames_held\": %lu, \"helper_jobs\": " BENCH_U64 ", \"workers\": [",end.FramesHeld - begin.FramesHeld,
+		end.Pool[WORKPOOL_MAX_THREADS].JobsRun - begin.Pool[WORKPOOL_MAX_THREADS].JobsRun);
+	for(i=0;i<end.Workers;i++)
+		fprintf(pJson,"%s{\"busy_pct\": %.2f, \"jobs\": " BENCH_U64 ", \"steals\": " BENCH_U64 "}",i ? ", " : "",
+			BenchWorkerBusy(&begin,&end,i),end.Pool[i].JobsRun - begin.Pool[i].JobsRun,end.Pool[i].Steals - begin.Pool[i].Steals);
+	fprintf(pJson,"]}");
+	fflush(pJson);
+}
+
+/*!
+ * @brief
+ *		Run every combination of the sweep and write the results
+ * @param
+ *		JSON file to create, NULL for BENCH_CAPTURE_JSON
+ * @param
+ *		sweep (see CaptureBenchmark.h), NULL for BENCH_CAPTURE_SWEEP
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void CaptureBenchmark(const char *JsonFile,const char *Sweep)
+{
+	tCaptureSweep sweep;
+	FILE *pJson;
+	unsigned long c,s,f,k,a,p,u,r;
+	bool first = true;
+
+	memset(&sweep,0,sizeof(sweep));
+	sweep.Warmup = 1;
+	sweep.FrameRate = 30.0f;
+	if(!BenchParse(BENCH_CAPTURE_SWEEP,&sweep) || (Sweep && !BenchParse(Sweep,&sweep)))
+	{
+		printf("Error in %s:%d at CaptureBenchmark() ----> invalid sweep %s\n", __FILE__, __LINE__, Sweep ? Sweep : BENCH_CAPTURE_SWEEP);
+		return;
+	}
+	if(!JsonFile)
+		JsonFile = BENCH_CAPTURE_JSON;
+
+	pJson = fopen(JsonFile,"w");
+	if(!pJson)
+		printf("Error in %s:%d at CaptureBenchmark() ----> could not create %s\n", __FILE__, __LINE__, JsonFile);
+	else
+		fprintf(pJson,"{\n  \"benchmark\": \"capture\", \"processors\": %lu, \"seconds\": %lu, \"warmup\": %lu, \"fps\": %.1f,\n  \"runs\": [",
+			ProcessorCount(),sweep.Seconds,sweep.Warmup,sweep.FrameRate);
+
+	printf("Capture benchmark, %lu s per run after %lu s of warmup, %.1f fps, control transactions %lu ms\n",sweep.Seconds,sweep.Warmup,
+		sweep.FrameRate,sweep.Control);
+	for(c=0;c<sweep.CameraCount;c++)
+		for(s=0;s<sweep.SizeCount;s++)
+			for(f=0;f<sweep.FormatCount;f++)
+				for(k=0;k<sweep.StorageCount;k++)
+					for(a=0;a<sweep.AcquireCount;a++)
+						for(p=0;p<sweep.ProcessCount;p++)
+							for(u=0;u<sweep.BringupCount;u++)
+								for(r=0;r<sweep.ReconnectCount;r++)
+								{
+									CaptureBenchRun(&sweep,sweep.Cameras[c],sweep.Width[s],sweep.Height[s],sweep.Format[f],sweep.Storage[k],
+										sweep.Acquire[a],sweep.Process[p],sweep.Parallel[u],sweep.Reconnect[r],pJson,first);
+									first = false;
+								}
+
+	if(pJson)
+	{
+		fprintf(pJson,"\n  ]\n}\n");
+		fclose(pJson);
+		printf("results written to %s\n",JsonFile);
+	}
+}
@@ -0,0 +1,190 @@
+/*!
+ *  @file
+ *     CapturePoller.cpp
+ *  @brief
+ *     OTC project: Polling acquisition mode. The frames complete in the order
+ *	   they were queued, the thread always waits for the oldest one
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "mainHeader.h"
+
+
+/*!
+ * @brief
+ *		Polling thread: waits for the oldest queued frame and hands it over
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameDoneCB()
+ * @return
+ *		0
+ */
+static THREADPROC CapturePollerThread(void *pContext)
+{
+	tCamera *tCamInstance = (tCamera*)pContext;
+	tCapturePoller *pPoller = &(tCamInstance->Poller);
+	tPvFrame *pFrame;
+	tPvErr errorCode;
+
+	if(pPoller->Processor >= 0)
+		ThreadSetAffinity((unsigned long)pPoller->Processor);
+	if(pPoller->Priority)
+		ThreadSetRealtime(pPoller->Priority);
+
+	while(!pPoller->Stop)
+	{
+		LockAcquire(&(pPoller->Lock));
+		pFrame = pPoller->Count ? pPoller->Queued[pPoller->Head] : NULL;
+		LockRelease(&(pPoller->Lock));
+
+		// every frame is with the writer
+		if(!pFrame)
+		{
+			EventWait(&(pPoller->Wake),POLL_WAIT_SLICE);
+			continue;
+		}
+
+		errorCode = PvCaptureWaitForFrameDone(tCamInstance->Handle,pFrame,POLL_WAIT_SLICE);
+		if(errorCode == ePvErrTimeout)
+		{
+			pPoller->Timeouts++;
+			continue;
+		}
+		if(errorCode)
+		{
+			// the camera is gone, CameraUnsetup() stops us
+			EventWait(&(pPoller->Wake),POLL_WAIT_SLICE);
+			continue;
+		}
+
+		LockAcquire(&(pPoller->Lock));
+		pPoller->Head = (pPoller->Head + 1) % POLL_MAX_FRAMES;
+		pPoller->Count--;
+		LockRelease(&(pPoller->Lock));
+
+		pPoller->FramesPolled++;
+		FrameDoneCB(pFrame);
+	}
+
+	return 0;
+}
+
+/*!
+ * @brief
+ *		Switch a camera to the polling mode and start its thread, before any
+ *		frame is queued
+ * @param
+ *		Camera Instance
+ * @param
+ *		processor the thread is pinned on, -1 for none
+ * @param
+ *		real-time priority of the thread, 0 for the normal one
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart()
+ * @return
+ *		bool
+ */
+bool CapturePollerStart(tCamera *tCamInstance,long Processor,int Priority)
+{
+	tCapturePoller *pPoller = &(tCamInstance->Poller);
+
+	LockInit(&(pPoller->Lock));
+	EventInit(&(pPoller->Wake));
+	pPoller->Head = 0;
+	pPoller->Count = 0;
+	pPoller->Stop = false;
+	pPoller->Processor = Processor;
+	pPoller->Priority = Priority;
+	pPoller->FramesPolled = 0;
+	pPoller->Timeouts = 0;
+	pPoller->Enabled = true;
+
+	if(!ThreadSpawn(&(pPoller->Thread),CapturePollerThread,tCamInstance))
+	{
+		printf("Error in %s:%d at CapturePollerStart() ----> could not start the polling thread of camera %lu\n", __FILE__, __LINE__,
+			tCamInstance->UID);
+		pPoller->Enabled = false;
+		EventDestroy(&(pPoller->Wake));
+		LockDestroy(&(pPoller->Lock));
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Stop the polling thread. The writer must be stopped: nothing gives
+ *		frames back to the camera any more
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraUnsetup()
+ * @return
+ *		void
+ */
+void CapturePollerStop(tCamera *tCamInstance)
+{
+	tCapturePoller *pPoller = &(tCamInstance->Poller);
+
+	if(!pPoller->Enabled)
+		return;
+
+	pPoller->Stop = true;
+	EventSignal(&(pPoller->Wake));
+	ThreadJoin(&(pPoller->Thread));
+	pPoller->Enabled = false;
+	EventDestroy(&(pPoller->Wake));
+	LockDestroy(&(pPoller->Lock));
+}
+
+/*!
+ * @brief
+ *		Give a frame to the camera: with FrameDoneCB() in callback mode, for the
+ *		polling thread in polling mode
+ * @param
+ *		Camera Instance
+ * @param
+ *		frame
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart(), FrameDoneCB(), FrameWriterRequeue()
+ * @return
+ *		tPvErr of PvCaptureQueueFrame()
+ */
+tPvErr CaptureQueueFrame(tCamera *tCamInstance,tPvFrame *pFrame)
+{
+	tCapturePoller *pPoller = &(tCamInstance->Poller);
+	tPvErr errorCode;
+	bool wake;
+
+	if(!pPoller->Enabled)
+		return PvCaptureQueueFrame(tCamInstance->Handle,pFrame,FrameDoneCB);
+
+	// under the lock, the frames are in the same order here and in the camera queue
+	LockAcquire(&(pPoller->Lock));
+	if(pPoller->Count == POLL_MAX_FRAMES)
+		errorCode = ePvErrQueueFull;
+	else
+		errorCode = PvCaptureQueueFrame(tCamInstance->Handle,pFrame,NULL);
+	wake = !errorCode && !pPoller->Count;
+	if(!errorCode)
+		pPoller->Queued[(pPoller->Head + pPoller->Count++) % POLL_MAX_FRAMES] = pFrame;
+	LockRelease(&(pPoller->Lock));
+
+	if(wake)
+		EventSignal(&(pPoller->Wake));
+
+	return errorCode;
+}
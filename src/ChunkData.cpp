@@ -0,0 +1,104 @@
+/*!
+ *  @file
+ *     ChunkData.cpp
+ *  @brief
+ *     OTC project: Chunk data of the frames, turned on when the camera is
+ *	   started and read from the ancillary buffer of every frame
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "ChunkData.h"
+
+
+/*
+	The camera is big endian on the wire, the chunk ID tells whether the driver swapped the values
+*/
+static unsigned int ChunkRead32(const unsigned char *p,bool Swapped)
+{
+	if(Swapped)
+		return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) | ((unsigned int)p[2] << 8) | p[3];
+
+	return p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned short ChunkRead16(const unsigned char *p,bool Swapped)
+{
+	if(Swapped)
+		return (unsigned short)((p[0] << 8) | p[1]);
+
+	return (unsigned short)(p[0] | (p[1] << 8));
+}
+
+/*!
+ * @brief
+ *		Turn the chunk data of a camera on, before its frame buffers are allocated
+ * @param
+ *		handle of the open camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart()
+ * @return
+ *		bytes of ancillary data per frame (NonImagePayloadSize), 0 when the camera has no chunk mode
+ */
+unsigned long ChunkEnable(tPvHandle Camera)
+{
+	tPvUint32 size = 0;
+
+	if(PvAttrBooleanSet(Camera,"ChunkModeActive",1) || PvAttrUint32Get(Camera,"NonImagePayloadSize",&size))
+	{
+		printf("chunk data not available, the frame attributes come from the camera\n");
+		return 0;
+	}
+
+	if(size < CHUNK_SIZE)
+	{
+		printf("Error in %s:%d at ChunkEnable() ----> %lu bytes of chunk data, %d expected\n", __FILE__, __LINE__, (unsigned long)size, CHUNK_SIZE);
+		PvAttrBooleanSet(Camera,"ChunkModeActive",0);
+		return 0;
+	}
+
+	return size;
+}
+
+/*!
+ * @brief
+ *		Read the chunk of a frame
+ * @param
+ *		completed frame
+ * @param
+ *		values of the chunk
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameReadMetadata(), FrameSave()
+ * @return
+ *		false if the frame has no chunk (no ancillary buffer, short or unknown chunk)
+ */
+bool ChunkParse(const tPvFrame *pFrame,tChunkData *pChunk)
+{
+	const unsigned char *p = (const unsigned char*)pFrame->AncillaryBuffer;
+	bool swapped;
+
+	if(!p || pFrame->AncillarySize < CHUNK_SIZE || pFrame->AncillaryBufferSize < CHUNK_SIZE)
+		return false;
+
+	if(ChunkRead32(p + 40,false) == CHUNK_ID)
+		swapped = false;
+	else if(ChunkRead32(p + 40,true) == CHUNK_ID)
+		swapped = true;
+	else
+		return false;
+
+	pChunk->AcquisitionCount = ChunkRead32(p,swapped);
+	pChunk->UserValue = ChunkRead32(p + 4,swapped);
+	pChunk->Exposure = ChunkRead32(p + 8,swapped);
+	pChunk->Gain = ChunkRead32(p + 12,swapped);
+	pChunk->SyncInLevels = ChunkRead16(p + 16,swapped);
+	pChunk->SyncOutLevels = ChunkRead16(p + 18,swapped);
+
+	return true;
+}
@@ -0,0 +1,497 @@
+/*!
+ *  @file
+ *     CompressStage.cpp
+ *  @brief
+ *     OTC project: Parallel lossless compression of the recorded frames. The
+ *	   frames are cut in strips that are compressed independently on the work
+ *	   pool of all the cameras, with the CFA codec for the Bayer frames
+ *	   and with the LZ codec otherwise
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "CompressStage.h"
+#include "LzCodec.h"
+#include "BayerCodec.h"
+#include <stdlib.h>
+#include <string.h>
+
+static void CompressStripRun(tWorkJob *pJob)
+{
+	tCompressStrip *pStrip = (tCompressStrip*)pJob->pContext;
+	tCompressor *pOwner = pStrip->pOwner;
+
+	if(pStrip->Codec == eRawCompressionBayer)
+		pStrip->PackedSize = BayerEncode(pStrip->pSource,pStrip->Width,pStrip->Rows,pStrip->Format,pStrip->Pattern,
+			pStrip->pTarget,pStrip->SourceSize);
+	else
+		pStrip->PackedSize = LzCompress(pStrip->pSource,pStrip->SourceSize,pStrip->pTarget,pStrip->SourceSize);
+
+	if(!AtomicDecrement(&(pOwner->Remaining)))
+		EventSignal(&(pOwner->Done));
+}
+
+/*!
+ * @brief
+ *		Initialize the compressor of a camera
+ * @param
+ *		compressor
+ * @param
+ *		work pool home of the camera, COMPRESS_INLINE to keep the strips on
+ *		the calling thread (it is a job of the pool already)
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void CompressorInit(tCompressor *pCompressor,unsigned long Home)
+{
+	unsigned long i;
+
+	memset(pCompressor,0,sizeof(tCompressor));
+	EventInit(&(pCompressor->Done));
+	pCompressor->Home = Home;
+	for(i=0;i<COMPRESS_STRIPS;i++)
+	{
+		pCompressor->Strips[i].pOwner = pCompressor;
+		pCompressor->Strips[i].Job.Run = CompressStripRun;
+		pCompressor->Strips[i].Job.pContext = &(pCompressor->Strips[i]);
+	}
+}
+
+void CompressorDestroy(tCompressor *pCompressor)
+{
+	EventDestroy(&(pCompressor->Done));
+}
+
+/*!
+ * @brief
+ *		Add the counters of the compressor of one frame to the ones of its
+ *		camera, and clear them
+ * @param
+ *		compressor of the camera
+ * @param
+ *		compressor the frame was compressed with
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameWriterCollect()
+ * @return
+ *		void
+ */
+void CompressorAccount(tCompressor *pCompressor,tCompressor *pFrameCompressor)
+{
+	pCompressor->FramesCompressed += pFrameCompressor->FramesCompressed;
+	pCompressor->FramesStored += pFrameCompressor->FramesStored;
+	pCompressor->FramesBypassed += pFrameCompressor->FramesBypassed;
+	pCompressor->RawBytes += pFrameCompressor->RawBytes;
+	pCompressor->PackedBytes += pFrameCompressor->PackedBytes;
+	pCompressor->CompressTime += pFrameCompressor->CompressTime;
+
+	pFrameCompressor->FramesCompressed = 0;
+	pFrameCompressor->FramesStored = 0;
+	pFrameCompressor->FramesBypassed = 0;
+	pFrameCompressor->RawBytes = 0;
+	pFrameCompressor->PackedBytes = 0;
+	pFrameCompressor->CompressTime = 0;
+}
+
+/*!
+ * @brief
+ *		Whether the next frame is stored as it is: no CPU to spare while the
+ *		writer queue backs up, the stage steps aside until it is empty
+ * @param
+ *		compressor of the camera
+ * @param
+ *		frames waiting for the writer of the camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CompressFrame(), FrameWriterThread()
+ * @return
+ *		true if the frame is bypassed (and counted)
+ */
+bool CompressBypass(tCompressor *pCompressor,unsigned long Backlog)
+{
+	if(Backlog >= COMPRESS_BACKLOG_HIGH)
+		pCompressor->Bypassing = true;
+	else if(!Backlog)
+		pCompressor->Bypassing = false;
+
+	if(pCompressor->Bypassing)
+		pCompressor->FramesBypassed++;
+
+	return pCompressor->Bypassing;
+}
+
+/*
+	Strips are cut on row boundaries when the rows have a whole number of bytes
+*/
+static unsigned long CompressRowBytes(unsigned long ImageSize,unsigned long Height)
+{
+	if(Height && !(ImageSize % Height))
+		return ImageSize / Height;
+	return ImageSize;
+}
+
+/*!
+ * @brief
+ *		Compress a frame in its packed area. Runs on the writer thread of the
+ *		camera, which compresses strips as well until the frame is done, or
+ *		on a worker with -process pool
+ * @param
+ *		compressor of the camera, or of the frame
+ * @param
+ *		frame to compress
+ * @param
+ *		packed area of the frame, COMPRESS_PACKED_SIZE(ImageSize) bytes
+ * @param
+ *		frames waiting in the writer queue of the camera
+ * @param
+ *		filled with the compressed image
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameArenaPacked()
+ * @return
+ *		false if the frame must be stored as it is (bypass, or it did not get smaller)
+ */
+bool CompressFrame(tCompressor *pCompressor,const tPvFrame *pFrame,void *pPacked,unsigned long Backlog,tRawPayload *pPayload)
+{
+	tRawStripTable *pTable = (tRawStripTable*)pPacked;
+	unsigned int *pSizes = (unsigned int*)(pTable + 1);
+	unsigned char *pBase,*pOut;
+	tCompressStrip *pStrip;
+	unsigned long rowBytes,rows,stripRows,count,offset,i;
+	unsigned long long start = GetMicroseconds();
+	tRawCompression codec = eRawCompressionLz;
+
+	if(CompressBypass(pCompressor,Backlog))
+		return false;
+	if(!pPacked || !pFrame->ImageSize)
+	{
+		pCompressor->FramesBypassed++;
+		return false;
+	}
+
+	rowBytes = CompressRowBytes(pFrame->ImageSize,pFrame->Height);
+	rows = pFrame->ImageSize / rowBytes;
+	stripRows = (rows + COMPRESS_STRIPS - 1) / COMPRESS_STRIPS;
+
+	/*
+	Bayer strips start on even rows, so they all see the pattern of the frame
+	*/
+	if(BayerCodecSupports(pFrame->Format,pFrame->Width) && rows == pFrame->Height &&
+		rowBytes == BayerRowBytes(pFrame->Format,pFrame->Width))
+	{
+		codec = eRawCompressionBayer;
+		stripRows += stripRows & 1;
+	}
+	count = (rows + stripRows - 1) / stripRows;
+
+	pTable->StripCount = count;
+	pTable->StripRows = stripRows;
+	pBase = (unsigned char*)(pSizes + count);
+
+	/*
+	Each strip is compressed where its pixels would be stored uncompressed,
+	the strips never overlap
+	*/
+	for(offset=0,i=0;i<count;i++)
+	{
+		pStrip = &(pCompressor->Strips[i]);
+		pStrip->pSource = (const unsigned char*)pFrame->ImageBuffer + offset;
+		pStrip->SourceSize = stripRows * rowBytes;
+		if(pStrip->SourceSize > pFrame->ImageSize - offset)
+			pStrip->SourceSize = pFrame->ImageSize - offset;
+		pStrip->pTarget = pBase + offset;
+		pStrip->Codec = codec;
+		pStrip->Rows = pStrip->SourceSize / rowBytes;
+		pStrip->Width = pFrame->Width;
+		pStrip->Format = pFrame->Format;
+		pStrip->Pattern = pFrame->BayerPattern;
+		offset += pStrip->SourceSize;
+	}
+	pCompressor->Remaining = count;
+
+	if(WorkPoolRunning() && pCompressor->Home != COMPRESS_INLINE && count > 1)
+	{
+		for(i=1;i<count;i++)
+			WorkPoolSubmit(&(pCompressor->Strips[i].Job),pCompressor->Home);
+
+		CompressStripRun(&(pCompressor->Strips[0].Job));
+
+		/*
+		Help the pool (with any camera's jobs) until our frame is done
+		*/
+		while(pCompressor->Remaining)
+		{
+			if(!WorkPoolHelp(pCompressor->Home))
+				EventWait(&(pCompressor->Done),EVENT_INFINITE);
+		}
+	}
+	else
+	{
+		for(i=0;i<count;i++)
+			CompressStripRun(&(pCompressor->Strips[i].Job));
+	}
+
+	/*
+	Pack the strips one after the other, the ones that did not get smaller
+	are copied as they are
+	*/
+	pOut = pBase;
+	for(i=0;i<count;i++)
+	{
+		pStrip = &(pCompressor->Strips[i]);
+		if(pStrip->PackedSize)
+		{
+			memmove(pOut,pStrip->pTarget,pStrip->PackedSize);
+			pSizes[i] = pStrip->PackedSize;
+			pOut += pStrip->PackedSize;
+		}
+		else
+		{
+			memcpy(pOut,pStrip->pSource,pStrip->SourceSize);
+			pSizes[i] = pStrip->SourceSize | RAW_STRIP_STORED;
+			pOut += pStrip->SourceSize;
+		}
+	}
+
+	pCompressor->CompressTime += GetMicroseconds() - start;
+
+	pPayload->pData = pPacked;
+	pPayload->Size = (unsigned long)(pOut - (unsigned char*)pPacked);
+	pPayload->Compression = codec;
+
+	if(pPayload->Size >= pFrame->ImageSize)
+	{
+		pCompressor->FramesStored++;
+		return false;
+	}
+
+	pCompressor->FramesCompressed++;
+	pCompressor->RawBytes += pFrame->ImageSize;
+	pCompressor->PackedBytes += pPayload->Size;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Decompress an eRawCompressionLz or eRawCompressionBayer image, for the
+ *		tools reading the segments back
+ * @param
+ *		header of the record
+ * @param
+ *		compressed image (data of the record)
+ * @param
+ *		image buffer, tRawRecordHeader::ImageSize bytes
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if the image is corrupted
+ */
+bool CompressDecode(const tRawRecordHeader *pHeader,const void *pPacked,void *pImage)
+{
+	const tRawStripTable *pTable = (const tRawStripTable*)pPacked;
+	const unsigned int *pSizes = (const unsigned int*)(pTable + 1);
+	const unsigned char *pIn;
+	unsigned char *pOut = (unsigned char*)pImage;
+	unsigned long PackedSize = pHeader->StoredSize;
+	unsigned long ImageSize = pHeader->ImageSize;
+	unsigned long rowBytes = CompressRowBytes(ImageSize,pHeader->Height);
+	unsigned long available,stripSize,storedSize,offset = 0,i;
+	bool bayer = pHeader->Compression == eRawCompressionBayer;
+
+	if(bayer && (rowBytes != BayerRowBytes((tPvImageFormat)pHeader->Format,pHeader->Width) ||
+		!BayerCodecSupports((tPvImageFormat)pHeader->Format,pHeader->Width)))
+		return false;
+
+	if(PackedSize < sizeof(tRawStripTable) ||
+		!pTable->StripCount || pTable->StripCount > COMPRESS_STRIPS ||
+		PackedSize < sizeof(tRawStripTable) + pTable->StripCount * sizeof(unsigned int))
+		return false;
+
+	pIn = (const unsigned char*)(pSizes + pTable->StripCount);
+	available = PackedSize - (unsigned long)(pIn - (const unsigned char*)pPacked);
+
+	for(i=0;i<pTable->StripCount;i++)
+	{
+		stripSize = pTable->StripRows * rowBytes;
+		if(stripSize > ImageSize - offset)
+			stripSize = ImageSize - offset;
+		storedSize = pSizes[i] & ~RAW_STRIP_STORED;
+		if(storedSize > available)
+			return false;
+
+		if(pSizes[i] & RAW_STRIP_STORED)
+		{
+			if(storedSize != stripSize)
+				return false;
+			memcpy(pOut + offset,pIn,stripSize);
+		}
+		else if(bayer)
+		{
+			if(!BayerDecode(pIn,storedSize,pOut + offset,pHeader->Width,stripSize / rowBytes,
+				(tPvImageFormat)pHeader->Format,(tPvBayerPattern)pHeader->BayerPattern))
+				return false;
+		}
+		else if(!LzDecompress(pIn,storedSize,pOut + offset,stripSize))
+			return false;
+
+		pIn += storedSize;
+		available -= storedSize;
+		offset += stripSize;
+	}
+
+	return offset == ImageSize;
+}
+
+/*!
+ * @brief
+ *		Compression ratio of a camera
+ * @param
+ *		compressor of the camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		raw size / compressed size, 1.0 before the first compressed frame
+ */
+double CompressRatio(const tCompressor *pCompressor)
+{
+	if(!pCompressor->PackedBytes)
+		return 1.0;
+
+	return (double)pCompressor->RawBytes / (double)pCompressor->PackedBytes;
+}
+
+/*!
+ * @brief
+ *		Raw bytes compressed per second of compression
+ * @param
+ *		compressor of the camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		MB/s
+ */
+double CompressThroughput(const tCompressor *pCompressor)
+{
+	if(!pCompressor->CompressTime)
+		return 0.0;
+
+	return (double)pCompressor->RawBytes / (double)pCompressor->CompressTime;
+}
+
+
+/*
+	Benchmark: synthetic Bayer8 frames (smooth scene, two channel levels and
+	some noise), every frame is checked back
+*/
+#define BENCH_COMPRESS_COUNT	50
+
+static void CompressBenchRun(unsigned long Threads,unsigned long Noise,unsigned long Width,unsigned long Height)
+{
+	tCompressor compressor;
+	tRawPayload payload;
+	tRawRecordHeader header;
+	tPvFrame frame;
+	unsigned char *pImage,*pPacked,*pCheck;
+	unsigned long x,y,i,seed = 12345;
+	unsigned long long start,elapsed;
+	bool correct = true;
+
+	memset(&frame,0,sizeof(tPvFrame));
+	frame.Format = ePvFmtBayer8;
+	frame.Width = Width;
+	frame.Height = Height;
+	frame.BitDepth = 8;
+	frame.ImageSize = Width * Height;
+	pImage = (unsigned char*)malloc(frame.ImageSize);
+	pPacked = (unsigned char*)malloc(COMPRESS_PACKED_SIZE(frame.ImageSize));
+	pCheck = (unsigned char*)malloc(frame.ImageSize);
+	if(!pImage || !pPacked || !pCheck)
+	{
+		free(pImage);
+		free(pPacked);
+		free(pCheck);
+		return;
+	}
+	frame.ImageBuffer = pImage;
+
+	for(y=0;y<Height;y++)
+	{
+		for(x=0;x<Width;x++)
+		{
+			seed = seed * 1103515245 + 12345;
+			pImage[y * Width + x] = (unsigned char)(40 + x * 100 / Width + y * 60 / Height +
+				(((x ^ y) & 1) ? 30 : 0) + (Noise ? (seed >> 16) % Noise : 0));
+		}
+	}
+
+	WorkPoolStart(Threads);
+	CompressorInit(&compressor,0);
+
+	start = GetMicroseconds();
+	for(i=0;i<BENCH_COMPRESS_COUNT;i++)
+		CompressFrame(&compressor,&frame,pPacked,0,&payload);
+	elapsed = GetMicroseconds() - start;
+
+	memset(&header,0,sizeof(tRawRecordHeader));
+	header.Width = frame.Width;
+	header.Height = frame.Height;
+	header.Format = frame.Format;
+	header.BayerPattern = frame.BayerPattern;
+	header.ImageSize = frame.ImageSize;
+	header.Compression = payload.Compression;
+	header.StoredSize = payload.Size;
+	if(!CompressDecode(&header,payload.pData,pCheck) || memcmp(pCheck,pImage,frame.ImageSize))
+		correct = false;
+
+	printf("%2lu threads noise %2lu %5lux%-5lu ratio %5.2f %8.1f MB/s %s\n",Threads,Noise,Width,Height,
+		(double)frame.ImageSize / (double)payload.Size,
+		(double)frame.ImageSize * BENCH_COMPRESS_COUNT / (double)elapsed,
+		correct ? "round trip ok" : "ROUND TRIP FAILED");
+
+	CompressorDestroy(&compressor);
+	WorkPoolStop();
+	free(pImage);
+	free(pPacked);
+	free(pCheck);
+}
+
+/*!
+ * @brief
+ *		Ratio and throughput of the compression stage for a growing number of
+ *		pool threads
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void CompressBenchmark()
+{
+	static const unsigned long noises[] = {0,4,16};
+	unsigned long maxThreads = ProcessorCount() - 1;
+	unsigned long threads;
+	unsigned int n;
+
+	if(maxThreads > WORKPOOL_MAX_THREADS)
+		maxThreads = WORKPOOL_MAX_THREADS;
+
+	printf("Compression benchmark, Bayer8, %d frames per run\n",BENCH_COMPRESS_COUNT);
+	for(n=0;n<sizeof(noises)/sizeof(noises[0]);n++)
+	{
+		for(threads=0;;threads = threads ? threads * 2 : 1)
+		{
+			if(threads > maxThreads)
+				threads = maxThreads;
+			CompressBenchRun(threads,noises[n],1360,1024);
+			if(threads == maxThreads)
+				break;
+		}
+	}
+}
@@ -0,0 +1,348 @@
+/*!
+ *  @file
+ *     ControlLoop.cpp
+ *  @brief
+ *     OTC project: Control loop of main(). A queue of events and a list of
+ *	   timers behind one lock, the loop waits on an event for the next one
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "ControlLoop.h"
+#include <string.h>
+#ifndef _WINDOWS
+#include <signal.h>
+#endif
+
+static tLock gControlLock;
+static tEvent gControlWake;
+static tControlEvent gControlQueue[CONTROL_QUEUE_SIZE];
+static unsigned long gControlHead = 0;
+static unsigned long gControlCount = 0;
+static tControlEvent gControlTimers[CONTROL_MAX_TIMERS];
+static unsigned long gControlTimerCount = 0;
+static unsigned long gControlWakeups = 0;		// times the loop woke up, for the benchmark
+
+#ifndef _WINDOWS
+static tThread gControlSignalThread;
+static sigset_t gControlSignals;
+static bool gControlCatching = false;
+static volatile bool gControlExit = false;
+#endif
+
+
+/*!
+ * @brief
+ *		Initialize the queue, before the link callbacks are registered
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void ControlLoopInit()
+{
+	LockInit(&gControlLock);
+	EventInit(&gControlWake);
+	gControlHead = 0;
+	gControlCount = 0;
+	gControlTimerCount = 0;
+	gControlWakeups = 0;
+}
+
+#ifdef _WINDOWS
+/*
+	Runs on a thread of its own, it can post
+*/
+static BOOL WINAPI ControlCtrlHandler(DWORD CtrlType)
+{
+	ControlLoopPost(eControlShutdown,0);
+	return TRUE;
+}
+#else
+/*
+	SIGINT and SIGTERM are blocked everywhere else, they only come here
+*/
+static THREADPROC ControlSignalThread(void * /*pContext*/)
+{
+	int signo;
+
+	while(!gControlExit)
+	{
+		if(sigwait(&gControlSignals,&signo) || gControlExit)
+			continue;
+		ControlLoopPost(eControlShutdown,0);
+	}
+
+	return 0;
+}
+#endif
+
+/*!
+ * @brief
+ *		Turn CTRL-C (and SIGTERM) into an eControlShutdown event. On POSIX it has
+ *		to be called before any other thread is started
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		ControlLoopInit()
+ * @return
+ *		bool
+ */
+bool ControlLoopCatchInterrupt()
+{
+#ifdef _WINDOWS
+	if(!SetConsoleCtrlHandler(ControlCtrlHandler,TRUE))
+	{
+		printf("Error in %s:%d at ControlLoopCatchInterrupt() ----> could not set the console handler\n", __FILE__, __LINE__);
+		return false;
+	}
+#else
+	sigemptyset(&gControlSignals);
+	sigaddset(&gControlSignals,SIGINT);
+	sigaddset(&gControlSignals,SIGTERM);
+	// the threads started from now on inherit the mask
+	pthread_sigmask(SIG_BLOCK,&gControlSignals,NULL);
+
+	gControlExit = false;
+	if(!ThreadSpawn(&gControlSignalThread,ControlSignalThread,NULL))
+	{
+		printf("Error in %s:%d at ControlLoopCatchInterrupt() ----> could not start the signal thread\n", __FILE__, __LINE__);
+		pthread_sigmask(SIG_UNBLOCK,&gControlSignals,NULL);
+		return false;
+	}
+	gControlCatching = true;
+#endif
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Stop catching CTRL-C and release the queue
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void ControlLoopDestroy()
+{
+#ifdef _WINDOWS
+	SetConsoleCtrlHandler(ControlCtrlHandler,FALSE);
+#else
+	if(gControlCatching)
+	{
+		gControlExit = true;
+		pthread_kill(gControlSignalThread,SIGTERM);
+		ThreadJoin(&gControlSignalThread);
+		gControlCatching = false;
+	}
+#endif
+
+	EventDestroy(&gControlWake);
+	LockDestroy(&gControlLock);
+}
+
+/*!
+ * @brief
+ *		Post an event, from any thread
+ * @param
+ *		kind of event
+ * @param
+ *		UID of the camera, or timer number
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraEventCB()
+ * @return
+ *		false if the queue is full, the event is lost
+ */
+bool ControlLoopPost(tControlKind Kind,unsigned long UID)
+{
+	tControlEvent *pEvent;
+
+	LockAcquire(&gControlLock);
+	if(gControlCount == CONTROL_QUEUE_SIZE)
+	{
+		LockRelease(&gControlLock);
+		printf("Error in %s:%d at ControlLoopPost() ----> queue full, event %d of %lu lost\n", __FILE__, __LINE__, Kind, UID);
+		return false;
+	}
+	pEvent = &(gControlQueue[(gControlHead + gControlCount) % CONTROL_QUEUE_SIZE]);
+	pEvent->Kind = Kind;
+	pEvent->UID = UID;
+	pEvent->Due = 0;
+	gControlCount++;
+	LockRelease(&gControlLock);
+
+	EventSignal(&gControlWake);
+	return true;
+}
+
+/*!
+ * @brief
+ *		Post an event for later, a timer. A periodic timer posts itself again
+ *		from the handler
+ * @param
+ *		kind of event
+ * @param
+ *		UID of the camera, or timer number
+ * @param
+ *		milliseconds
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if CONTROL_MAX_TIMERS events are waiting already
+ */
+bool ControlLoopPostAfter(tControlKind Kind,unsigned long UID,unsigned long Delay)
+{
+	tControlEvent *pEvent;
+
+	if(!Delay)
+		return ControlLoopPost(Kind,UID);
+
+	LockAcquire(&gControlLock);
+	if(gControlTimerCount == CONTROL_MAX_TIMERS)
+	{
+		LockRelease(&gControlLock);
+		printf("Error in %s:%d at ControlLoopPostAfter() ----> too many timers, event %d of %lu lost\n", __FILE__, __LINE__, Kind, UID);
+		return false;
+	}
+	pEvent = &(gControlTimers[gControlTimerCount++]);
+	pEvent->Kind = Kind;
+	pEvent->UID = UID;
+	pEvent->Due = GetMicroseconds() + Delay * 1000ULL;
+	LockRelease(&gControlLock);
+
+	// the loop may be sleeping until a later timer
+	EventSignal(&gControlWake);
+	return true;
+}
+
+/*!
+ * @brief
+ *		Handle the events until the shutdown. Sleeps while there is none, up to
+ *		the next timer
+ * @param
+ *		called for each event, on the calling thread
+ * @param
+ *		context of the handler
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		main()
+ * @return
+ *		void
+ */
+void ControlLoopRun(tControlHandler Handler,void *pContext)
+{
+	tControlEvent batch[CONTROL_QUEUE_SIZE + CONTROL_MAX_TIMERS];
+	unsigned long i,count;
+	unsigned long long now,next;
+	bool shutdown = false;
+
+	while(!shutdown)
+	{
+		// take everything that is due, the handlers run without the lock
+		LockAcquire(&gControlLock);
+		for(count=0;gControlCount;count++)
+		{
+			batch[count] = gControlQueue[gControlHead];
+			gControlHead = (gControlHead + 1) % CONTROL_QUEUE_SIZE;
+			gControlCount--;
+		}
+		now = GetMicroseconds();
+		next = 0;
+		for(i=0;i<gControlTimerCount;)
+		{
+			if(gControlTimers[i].Due <= now)
+			{
+				batch[count++] = gControlTimers[i];
+				gControlTimers[i] = gControlTimers[--gControlTimerCount];
+			}
+			else
+			{
+				if(!next || gControlTimers[i].Due < next)
+					next = gControlTimers[i].Due;
+				i++;
+			}
+		}
+		LockRelease(&gControlLock);
+
+		for(i=0;i<count;i++)
+		{
+			if(batch[i].Kind == eControlShutdown)
+				shutdown = true;
+			Handler(&(batch[i]),pContext);
+		}
+
+		if(!count)
+		{
+			EventWait(&gControlWake,next ? (unsigned long)((next - now + 999) / 1000) : EVENT_INFINITE);
+			gControlWakeups++;
+		}
+	}
+}
+
+
+/*
+	Benchmark: CPU used by main() while it waits for cameras, with the loops
+	it had before (spinning on a flag, polling it every 250 ms) and with the
+	control loop
+*/
+static volatile bool gBenchDone;
+
+static THREADPROC ControlBenchSpin(void * /*pContext*/)
+{
+	while(!gBenchDone);
+	return 0;
+}
+
+static THREADPROC ControlBenchPoll(void * /*pContext*/)
+{
+	while(!gBenchDone)
+		Sleep(250);
+	return 0;
+}
+
+static void ControlBenchHandler(const tControlEvent * /*pEvent*/,void * /*pContext*/)
+{
+}
+
+static void ControlBenchReport(const char *Name,unsigned long long Cpu,unsigned long long Elapsed,unsigned long Wakeups)
+{
+	printf("  %-24s : cpu %6.2f%% of one processor, %lu wake-ups\n",Name,(double)Cpu * 100.0 / (double)Elapsed,Wakeups);
+}
+
+void ControlLoopBenchmark()
+{
+	tThread thread;
+	unsigned long long cpu,start;
+	tThreadProc procs[2] = { ControlBenchSpin, ControlBenchPoll };
+	const char *names[2] = { "spin on a flag", "poll every 250 ms" };
+
+	printf("Idle CPU benchmark, %d s each, no camera\n",CONTROL_BENCH_SECONDS);
+
+	for(int i=0;i<2;i++)
+	{
+		gBenchDone = false;
+		start = GetMicroseconds();
+		cpu = ProcessCpuMicroseconds();
+		if(!ThreadSpawn(&thread,procs[i],NULL))
+			return;
+		Sleep(CONTROL_BENCH_SECONDS * 1000);
+		gBenchDone = true;
+		ThreadJoin(&thread);
+		ControlBenchReport(names[i],ProcessCpuMicroseconds() - cpu,GetMicroseconds() - start,
+			i ? CONTROL_BENCH_SECONDS * 1000 / 250 : 0);
+	}
+
+	ControlLoopInit();
+	start = GetMicroseconds();
+	cpu = ProcessCpuMicroseconds();
+	ControlLoopPostAfter(eControlShutdown,0,CONTROL_BENCH_SECONDS * 1000);
+	ControlLoopRun(ControlBenchHandler,NULL);
+	ControlBenchReport("control loop",ProcessCpuMicroseconds() - cpu,GetMicroseconds() - start,gControlWakeups);
+	ControlLoopDestroy();
+}
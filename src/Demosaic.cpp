@@ -0,0 +1,1091 @@
+/*!
+ *  @file
+ *     Demosaic.cpp
+ *  @brief
+ *     OTC project: Demosaic of the Bayer frames, bilinear or edge directed,
+ *	   SSE2 kernels over row tiles of the work pool and the scalar reference
+ *	   they are checked against
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "Demosaic.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define DEMOSAIC_SSE2
+#include <emmintrin.h>
+#endif
+
+#define DEMOSAIC_PAD			8			// samples before the first pixel of a line, 16 bytes
+#define DEMOSAIC_SOURCE_LINES	8			// rows y - 3 to y + 3 of the edge method, a power of 2
+#define DEMOSAIC_GREEN_LINES	4			// green of the rows y - 1 to y + 1, a power of 2
+#define DEMOSAIC_LINES			(DEMOSAIC_SOURCE_LINES + DEMOSAIC_GREEN_LINES + 3)
+#define DEMOSAIC_NO_ROW			0xFFFFFFFF
+#define DEMOSAIC_QUOTE(x)		#x
+#define DEMOSAIC_STRING(x)		DEMOSAIC_QUOTE(x)
+
+// the first frame without a SIMD kernel is reported, once
+static volatile long gScalarNoticed = 0;
+
+/*
+	Frame being read, the pixels out of it are mirrored
+*/
+typedef struct
+{
+	const void			*pImage;
+	long				Width;
+	long				Height;
+	bool				Wide;				// 16 bits samples
+	int					Maximum;
+	tPvBayerPattern		Pattern;
+
+} tDemosaicImage;
+
+/*
+	Line buffers of a tile: the source rows widened to 16 bits and the green
+	of the edge method, both with DEMOSAIC_PAD mirrored samples on each side,
+	tagged with the row they hold
+*/
+typedef struct
+{
+	const tDemosaicImage	*pImage;
+	unsigned short			*pBase;
+	unsigned long			Stride;
+	unsigned long			SourceRow[DEMOSAIC_SOURCE_LINES];
+	unsigned long			GreenRow[DEMOSAIC_GREEN_LINES];
+
+} tDemosaicLines;
+
+
+static long DemosaicMirror(long i,long n)
+{
+	if(i < 0)
+		return -i;
+	if(i >= n)
+		return 2 * (n - 1) - i;
+	return i;
+}
+
+/*
+	1 when the pixels of even columns of the row are red or blue (see
+	BayerCodec.cpp), the parity of the column of a pixel is kept by the mirror
+*/
+static unsigned int DemosaicGreenPhase(tPvBayerPattern Pattern,unsigned long Row)
+{
+	unsigned int first = (Pattern == ePvBayerRGGB || Pattern == ePvBayerBGGR) ? 1 : 0;
+
+	return (unsigned int)((Row + first) & 1);
+}
+
+// the row has red pixels, the others have blue ones
+static bool DemosaicRedRow(tPvBayerPattern Pattern,unsigned long Row)
+{
+	unsigned int first = (Pattern == ePvBayerGBRG || Pattern == ePvBayerBGGR) ? 1 : 0;
+
+	return ((Row + first) & 1) == 0;
+}
+
+static int DemosaicClamp(int Value,int Maximum)
+{
+	return Value < 0 ? 0 : Value > Maximum ? Maximum : Value;
+}
+
+static unsigned long DemosaicMaximum(const tPvFrame *pFrame)
+{
+	if(pFrame->Format == ePvFmtBayer8)
+		return 255;
+	if(pFrame->BitDepth && pFrame->BitDepth < 16)
+		return (1UL << pFrame->BitDepth) - 1;
+	return 65535;
+}
+
+static void DemosaicImage(const tPvFrame *pFrame,tDemosaicImage *pImage)
+{
+	pImage->pImage = pFrame->ImageBuffer;
+	pImage->Width = (long)pFrame->Width;
+	pImage->Height = (long)pFrame->Height;
+	pImage->Wide = pFrame->Format == ePvFmtBayer16;
+	pImage->Maximum = (int)DemosaicMaximum(pFrame);
+	pImage->Pattern = pFrame->BayerPattern;
+}
+
+/*!
+ * @brief
+ *		Store the channels of a row in the target
+ * @param
+ *		frame geometry and depth
+ * @param
+ *		row
+ * @param
+ *		red, green and blue samples of the row
+ * @param
+ *		layout
+ * @param
+ *		target, DemosaicTargetSize() bytes
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+static void DemosaicStoreRow(const tDemosaicImage *pImage,unsigned long Row,const unsigned short *pRed,
+							 const unsigned short *pGreen,const unsigned short *pBlue,tDemosaicLayout Layout,void *pTarget)
+{
+	unsigned long x,width = (unsigned long)pImage->Width,plane = width * (unsigned long)pImage->Height;
+	const unsigned short *pFirst = Layout == eDemosaicBgr ? pBlue : pRed;
+	const unsigned short *pLast = Layout == eDemosaicBgr ? pRed : pBlue;
+	unsigned short *pOut16;
+	unsigned char *pOut8;
+
+	if(Layout == eDemosaicPlanar)
+	{
+		if(pImage->Wide)
+		{
+			pOut16 = (unsigned short*)pTarget + Row * width;
+			memcpy(pOut16,pRed,width * sizeof(unsigned short));
+			memcpy(pOut16 + plane,pGreen,width * sizeof(unsigned short));
+			memcpy(pOut16 + 2 * plane,pBlue,width * sizeof(unsigned short));
+			return;
+		}
+		pOut8 = (unsigned char*)pTarget + Row * width;
+		for(x=0;x<width;x++)
+		{
+			pOut8[x] = (unsigned char)pRed[x];
+			pOut8[x + plane] = (unsigned char)pGreen[x];
+			pOut8[x + 2 * plane] = (unsigned char)pBlue[x];
+		}
+		return;
+	}
+
+	if(pImage->Wide)
+	{
+		pOut16 = (unsigned short*)pTarget + Row * width * 3;
+		for(x=0;x<width;x++,pOut16+=3)
+		{
+			pOut16[0] = pFirst[x];
+			pOut16[1] = pGreen[x];
+			pOut16[2] = pLast[x];
+		}
+		return;
+	}
+	pOut8 = (unsigned char*)pTarget + Row * width * 3;
+	for(x=0;x<width;x++,pOut8+=3)
+	{
+		pOut8[0] = (unsigned char)pFirst[x];
+		pOut8[1] = (unsigned char)pGreen[x];
+		pOut8[2] = (unsigned char)pLast[x];
+	}
+}
+
+
+/*
+	Scalar reference, pixel by pixel on the frame. Every division rounds the
+	way the SSE2 kernels do: (sum + half) >> shift, arithmetic shift
+*/
+static int RefSample(const tDemosaicImage *pImage,long x,long y)
+{
+	x = DemosaicMirror(x,pImage->Width);
+	y = DemosaicMirror(y,pImage->Height);
+	if(pImage->Wide)
+		return ((const unsigned short*)pImage->pImage)[y * pImage->Width + x];
+	return ((const unsigned char*)pImage->pImage)[y * pImage->Width + x];
+}
+
+static bool RefIsGreen(const tDemosaicImage *pImage,long x,long y)
+{
+	return !(((unsigned long)x ^ DemosaicGreenPhase(pImage->Pattern,(unsigned long)y)) & 1);
+}
+
+/*
+	Green of the edge method: along the direction of the smaller gradient, the
+	average of both without one
+*/
+static int RefGreen(const tDemosaicImage *pImage,long x,long y)
+{
+	int c,w,e,n,s,lh,lv,gh,gv,h,v,g;
+
+	x = DemosaicMirror(x,pImage->Width);
+	y = DemosaicMirror(y,pImage->Height);
+	c = RefSample(pImage,x,y);
+	if(RefIsGreen(pImage,x,y))
+		return c;
+
+	w = RefSample(pImage,x - 1,y);
+	e = RefSample(pImage,x + 1,y);
+	n = RefSample(pImage,x,y - 1);
+	s = RefSample(pImage,x,y + 1);
+	lh = 2 * c - RefSample(pImage,x - 2,y) - RefSample(pImage,x + 2,y);
+	lv = 2 * c - RefSample(pImage,x,y - 2) - RefSample(pImage,x,y + 2);
+	gh = abs(w - e) + abs(lh);
+	gv = abs(n - s) + abs(lv);
+	h = (2 * (w + e) + lh + 2) >> 2;
+	v = (2 * (n + s) + lv + 2) >> 2;
+	g = gh < gv ? h : gv < gh ? v : (h + v + 1) >> 1;
+
+	return DemosaicClamp(g,pImage->Maximum);
+}
+
+// sample minus its green
+static int RefDifference(const tDemosaicImage *pImage,long x,long y)
+{
+	return RefSample(pImage,x,y) - RefGreen(pImage,x,y);
+}
+
+/*
+	One row: the color of the row (red or blue), green and the other color
+*/
+static void RefRow(const tDemosaicImage *pImage,tDemosaicMethod Method,long y,int *pOwn,int *pGreen,int *pOther)
+{
+	int c,max = pImage->Maximum;
+	long x;
+
+	for(x=0;x<pImage->Width;x++)
+	{
+		c = RefSample(pImage,x,y);
+		if(Method == eDemosaicBilinear)
+		{
+			if(RefIsGreen(pImage,x,y))
+			{
+				pGreen[x] = c;
+				pOwn[x] = (RefSample(pImage,x - 1,y) + RefSample(pImage,x + 1,y) + 1) >> 1;
+				pOther[x] = (RefSample(pImage,x,y - 1) + RefSample(pImage,x,y + 1) + 1) >> 1;
+			}
+			else
+			{
+				pOwn[x] = c;
+				pGreen[x] = (RefSample(pImage,x - 1,y) + RefSample(pImage,x + 1,y) +
+					RefSample(pImage,x,y - 1) + RefSample(pImage,x,y + 1) + 2) >> 2;
+				pOther[x] = (RefSample(pImage,x - 1,y - 1) + RefSample(pImage,x + 1,y - 1) +
+					RefSample(pImage,x - 1,y + 1) + RefSample(pImage,x + 1,y + 1) + 2) >> 2;
+			}
+		}
+		else if(RefIsGreen(pImage,x,y))
+		{
+			pGreen[x] = c;
+			pOwn[x] = DemosaicClamp(c + ((RefDifference(pImage,x - 1,y) + RefDifference(pImage,x + 1,y) + 1) >> 1),max);
+			pOther[x] = DemosaicClamp(c + ((RefDifference(pImage,x,y - 1) + RefDifference(pImage,x,y + 1) + 1) >> 1),max);
+		}
+		else
+		{
+			pOwn[x] = c;
+			pGreen[x] = RefGreen(pImage,x,y);
+			pOther[x] = DemosaicClamp(pGreen[x] + ((RefDifference(pImage,x - 1,y - 1) + RefDifference(pImage,x + 1,y - 1) +
+				RefDifference(pImage,x - 1,y + 1) + RefDifference(pImage,x + 1,y + 1) + 2) >> 2),max);
+		}
+	}
+}
+
+/*
+	Rows of the reference, channel lines of Width samples each
+*/
+static void RefRows(const tDemosaicImage *pImage,tDemosaicMethod Method,tDemosaicLayout Layout,unsigned long FirstRow,
+					unsigned long Rows,int *pSamples,unsigned short *pLines,void *pTarget)
+{
+	unsigned long x,y,width = (unsigned long)pImage->Width;
+	unsigned short *pRed = pLines,*pGreen = pLines + width,*pBlue = pLines + 2 * width;
+	int *pOwn = pSamples,*pMiddle = pSamples + width,*pOther = pSamples + 2 * width;
+	bool red;
+
+	for(y=FirstRow;y<FirstRow + Rows;y++)
+	{
+		RefRow(pImage,Method,(long)y,pOwn,pMiddle,pOther);
+		red = DemosaicRedRow(pImage->Pattern,y);
+		for(x=0;x<width;x++)
+		{
+			pRed[x] = (unsigned short)(red ? pOwn[x] : pOther[x]);
+			pGreen[x] = (unsigned short)pMiddle[x];
+			pBlue[x] = (unsigned short)(red ? pOther[x] : pOwn[x]);
+		}
+		DemosaicStoreRow(pImage,y,pRed,pGreen,pBlue,Layout,pTarget);
+	}
+}
+
+
+#ifdef DEMOSAIC_SSE2
+static __m128i DemosaicLoad(const unsigned short *p)
+{
+	return _mm_loadu_si128((const __m128i*)p);
+}
+
+static __m128i DemosaicSelect(__m128i Mask,__m128i A,__m128i B)
+{
+	return _mm_or_si128(_mm_and_si128(Mask,A),_mm_andnot_si128(Mask,B));
+}
+
+static __m128i DemosaicClampSse2(__m128i Value,__m128i Maximum)
+{
+	return _mm_min_epi16(_mm_max_epi16(Value,_mm_setzero_si128()),Maximum);
+}
+
+static __m128i DemosaicAbs(__m128i Value)
+{
+	return _mm_max_epi16(Value,_mm_sub_epi16(_mm_setzero_si128(),Value));
+}
+
+/*
+	Lanes of the red and blue pixels of 8 pixels from an even column
+*/
+static __m128i DemosaicColorMask(unsigned int Phase)
+{
+	return Phase ? _mm_set_epi16(0,-1,0,-1,0,-1,0,-1) : _mm_set_epi16(-1,0,-1,0,-1,0,-1,0);
+}
+
+/*!
+ * @brief
+ *		Bilinear, one row 8 pixels at a time. The lines are padded, the
+ *		columns past Width are computed on the padding and not stored
+ * @param
+ *		source rows above, of, and below the row
+ * @param
+ *		width
+ * @param
+ *		green phase of the row
+ * @param
+ *		color of the row (red or blue), green and the other color
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+static void DemosaicBilinearSse2(const unsigned short *pUp,const unsigned short *pRow,const unsigned short *pDown,
+								 unsigned long Width,unsigned int Phase,unsigned short *pOwn,unsigned short *pGreen,unsigned short *pOther)
+{
+	__m128i mask = DemosaicColorMask(Phase),two = _mm_set1_epi16(2);
+	__m128i c,w,e,n,s,cross,diagonal;
+	unsigned long x;
+
+	for(x=0;x<Width;x+=8)
+	{
+		c = DemosaicLoad(pRow + x);
+		w = DemosaicLoad(pRow + x - 1);
+		e = DemosaicLoad(pRow + x + 1);
+		n = DemosaicLoad(pUp + x);
+		s = DemosaicLoad(pDown + x);
+		cross = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(_mm_add_epi16(w,e),_mm_add_epi16(n,s)),two),2);
+		diagonal = _mm_add_epi16(_mm_add_epi16(DemosaicLoad(pUp + x - 1),DemosaicLoad(pUp + x + 1)),
+			_mm_add_epi16(DemosaicLoad(pDown + x - 1),DemosaicLoad(pDown + x + 1)));
+		diagonal = _mm_srli_epi16(_mm_add_epi16(diagonal,two),2);
+
+		_mm_store_si128((__m128i*)(pOwn + x),DemosaicSelect(mask,c,_mm_avg_epu16(w,e)));
+		_mm_store_si128((__m128i*)(pGreen + x),DemosaicSelect(mask,cross,c));
+		_mm_store_si128((__m128i*)(pOther + x),DemosaicSelect(mask,diagonal,_mm_avg_epu16(n,s)));
+	}
+}
+
+/*
+	Edge method, green of one row from the source rows y - 2 to y + 2
+*/
+static void DemosaicGreenSse2(const unsigned short *pUp2,const unsigned short *pUp,const unsigned short *pRow,
+							  const unsigned short *pDown,const unsigned short *pDown2,unsigned long Width,unsigned int Phase,
+							  unsigned long Maximum,unsigned short *pGreen)
+{
+	__m128i mask = DemosaicColorMask(Phase),one = _mm_set1_epi16(1),two = _mm_set1_epi16(2);
+	__m128i maximum = _mm_set1_epi16((short)Maximum);
+	__m128i c,c2,w,e,n,s,lh,lv,gh,gv,h,v,g;
+	unsigned long x;
+
+	for(x=0;x<Width;x+=8)
+	{
+		c = DemosaicLoad(pRow + x);
+		w = DemosaicLoad(pRow + x - 1);
+		e = DemosaicLoad(pRow + x + 1);
+		n = DemosaicLoad(pUp + x);
+		s = DemosaicLoad(pDown + x);
+		c2 = _mm_add_epi16(c,c);
+		lh = _mm_sub_epi16(_mm_sub_epi16(c2,DemosaicLoad(pRow + x - 2)),DemosaicLoad(pRow + x + 2));
+		lv = _mm_sub_epi16(_mm_sub_epi16(c2,DemosaicLoad(pUp2 + x)),DemosaicLoad(pDown2 + x));
+		gh = _mm_add_epi16(DemosaicAbs(_mm_sub_epi16(w,e)),DemosaicAbs(lh));
+		gv = _mm_add_epi16(DemosaicAbs(_mm_sub_epi16(n,s)),DemosaicAbs(lv));
+		h = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(_mm_add_epi16(w,e),1),lh),two),2);
+		v = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_slli_epi16(_mm_add_epi16(n,s),1),lv),two),2);
+		g = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(h,v),one),1);
+		g = DemosaicSelect(_mm_cmplt_epi16(gv,gh),v,g);
+		g = DemosaicSelect(_mm_cmplt_epi16(gh,gv),h,g);
+		_mm_store_si128((__m128i*)(pGreen + x),DemosaicSelect(mask,DemosaicClampSse2(g,maximum),c));
+	}
+}
+
+/*
+	Edge method, red and blue of one row as color differences to the green of
+	the rows y - 1 to y + 1
+*/
+static void DemosaicColorSse2(const unsigned short *pUp,const unsigned short *pRow,const unsigned short *pDown,
+							  const unsigned short *pGreenUp,const unsigned short *pGreen,const unsigned short *pGreenDown,
+							  unsigned long Width,unsigned int Phase,unsigned long Maximum,unsigned short *pOwn,unsigned short *pOther)
+{
+	__m128i mask = DemosaicColorMask(Phase),one = _mm_set1_epi16(1),two = _mm_set1_epi16(2);
+	__m128i maximum = _mm_set1_epi16((short)Maximum);
+	__m128i c,g,diagonal,sides,vertical,other;
+	unsigned long x;
+
+	for(x=0;x<Width;x+=8)
+	{
+		c = DemosaicLoad(pRow + x);
+		g = DemosaicLoad(pGreen + x);
+
+		// red and blue pixels: the other color from the 4 diagonals
+		diagonal = _mm_add_epi16(
+			_mm_add_epi16(_mm_sub_epi16(DemosaicLoad(pUp + x - 1),DemosaicLoad(pGreenUp + x - 1)),
+				_mm_sub_epi16(DemosaicLoad(pUp + x + 1),DemosaicLoad(pGreenUp + x + 1))),
+			_mm_add_epi16(_mm_sub_epi16(DemosaicLoad(pDown + x - 1),DemosaicLoad(pGreenDown + x - 1)),
+				_mm_sub_epi16(DemosaicLoad(pDown + x + 1),DemosaicLoad(pGreenDown + x + 1))));
+		other = _mm_add_epi16(g,_mm_srai_epi16(_mm_add_epi16(diagonal,two),2));
+
+		// green pixels: the color of the row from the sides, the other one from above and below
+		sides = _mm_add_epi16(_mm_sub_epi16(DemosaicLoad(pRow + x - 1),DemosaicLoad(pGreen + x - 1)),
+			_mm_sub_epi16(DemosaicLoad(pRow + x + 1),DemosaicLoad(pGreen + x + 1)));
+		sides = _mm_add_epi16(c,_mm_srai_epi16(_mm_add_epi16(sides,one),1));
+		vertical = _mm_add_epi16(_mm_sub_epi16(DemosaicLoad(pUp + x),DemosaicLoad(pGreenUp + x)),
+			_mm_sub_epi16(DemosaicLoad(pDown + x),DemosaicLoad(pGreenDown + x)));
+		vertical = _mm_add_epi16(c,_mm_srai_epi16(_mm_add_epi16(vertical,one),1));
+
+		_mm_store_si128((__m128i*)(pOwn + x),DemosaicSelect(mask,c,DemosaicClampSse2(sides,maximum)));
+		_mm_store_si128((__m128i*)(pOther + x),DemosaicClampSse2(DemosaicSelect(mask,other,vertical),maximum));
+	}
+}
+
+/*
+	Source row in its line, widened and mirrored on both sides
+*/
+static unsigned short *DemosaicSourceLine(tDemosaicLines *pLines,unsigned long Row)
+{
+	const tDemosaicImage *pImage = pLines->pImage;
+	unsigned long slot = Row & (DEMOSAIC_SOURCE_LINES - 1),x,width = (unsigned long)pImage->Width;
+	unsigned short *pLine = pLines->pBase + slot * pLines->Stride + DEMOSAIC_PAD;
+	const unsigned char *pSource;
+
+	if(pLines->SourceRow[slot] == Row)
+		return pLine;
+
+	if(pImage->Wide)
+		memcpy(pLine,(const unsigned short*)pImage->pImage + Row * width,width * sizeof(unsigned short));
+	else
+	{
+		pSource = (const unsigned char*)pImage->pImage + Row * width;
+		for(x=0;x<width;x++)
+			pLine[x] = pSource[x];
+	}
+	pLine[-1] = pLine[1];
+	pLine[-2] = pLine[2];
+	pLine[width] = pLine[width - 2];
+	pLine[width + 1] = pLine[width - 3];
+	pLines->SourceRow[slot] = Row;
+
+	return pLine;
+}
+
+static unsigned short *DemosaicGreenLine(tDemosaicLines *pLines,unsigned long Row)
+{
+	const tDemosaicImage *pImage = pLines->pImage;
+	unsigned long slot = Row & (DEMOSAIC_GREEN_LINES - 1),width = (unsigned long)pImage->Width;
+	unsigned short *pLine = pLines->pBase + (DEMOSAIC_SOURCE_LINES + slot) * pLines->Stride + DEMOSAIC_PAD;
+	long height = pImage->Height,y = (long)Row;
+
+	if(pLines->GreenRow[slot] == Row)
+		return pLine;
+
+	DemosaicGreenSse2(DemosaicSourceLine(pLines,DemosaicMirror(y - 2,height)),DemosaicSourceLine(pLines,DemosaicMirror(y - 1,height)),
+		DemosaicSourceLine(pLines,Row),DemosaicSourceLine(pLines,DemosaicMirror(y + 1,height)),
+		DemosaicSourceLine(pLines,DemosaicMirror(y + 2,height)),width,DemosaicGreenPhase(pImage->Pattern,Row),
+		(unsigned long)pImage->Maximum,pLine);
+	pLine[-1] = pLine[1];
+	pLine[width] = pLine[width - 2];
+	pLines->GreenRow[slot] = Row;
+
+	return pLine;
+}
+
+/*
+	Rows of a tile with the SSE2 kernels. The rows used for one output row are
+	at most 3 rows away from it: they all fit in the lines, none is evicted
+	before the row is done
+*/
+static void DemosaicRowsSse2(const tDemosaicImage *pImage,tDemosaicMethod Method,tDemosaicLayout Layout,unsigned long FirstRow,
+							 unsigned long Rows,unsigned short *pBase,unsigned long Stride,void *pTarget)
+{
+	tDemosaicLines lines;
+	unsigned short *pOwn = pBase + (DEMOSAIC_SOURCE_LINES + DEMOSAIC_GREEN_LINES) * Stride + DEMOSAIC_PAD;
+	unsigned short *pMiddle = pOwn + Stride;
+	unsigned short *pOther = pMiddle + Stride;
+	unsigned short *pGreen,*pUp,*pRow,*pDown;
+	unsigned long i,y,up,down,width = (unsigned long)pImage->Width;
+	unsigned int phase;
+
+	lines.pImage = pImage;
+	lines.pBase = pBase;
+	lines.Stride = Stride;
+	for(i=0;i<DEMOSAIC_SOURCE_LINES;i++)
+		lines.SourceRow[i] = DEMOSAIC_NO_ROW;
+	for(i=0;i<DEMOSAIC_GREEN_LINES;i++)
+		lines.GreenRow[i] = DEMOSAIC_NO_ROW;
+
+	for(y=FirstRow;y<FirstRow + Rows;y++)
+	{
+		up = DemosaicMirror((long)y - 1,pImage->Height);
+		down = DemosaicMirror((long)y + 1,pImage->Height);
+		phase = DemosaicGreenPhase(pImage->Pattern,y);
+		if(Method == eDemosaicEdge)
+		{
+			// the green lines first, they read source rows up to 3 away
+			const unsigned short *pGreenUp = DemosaicGreenLine(&lines,up);
+			const unsigned short *pGreenDown = DemosaicGreenLine(&lines,down);
+			pGreen = DemosaicGreenLine(&lines,y);
+			pUp = DemosaicSourceLine(&lines,up);
+			pRow = DemosaicSourceLine(&lines,y);
+			pDown = DemosaicSourceLine(&lines,down);
+			DemosaicColorSse2(pUp,pRow,pDown,pGreenUp,pGreen,pGreenDown,width,phase,(unsigned long)pImage->Maximum,pOwn,pOther);
+		}
+		else
+		{
+			pUp = DemosaicSourceLine(&lines,up);
+			pRow = DemosaicSourceLine(&lines,y);
+			pDown = DemosaicSourceLine(&lines,down);
+			DemosaicBilinearSse2(pUp,pRow,pDown,width,phase,pOwn,pMiddle,pOther);
+			pGreen = pMiddle;
+		}
+
+		if(DemosaicRedRow(pImage->Pattern,y))
+			DemosaicStoreRow(pImage,y,pOwn,pGreen,pOther,Layout,pTarget);
+		else
+			DemosaicStoreRow(pImage,y,pOther,pGreen,pOwn,Layout,pTarget);
+	}
+}
+#endif
+
+/*
+	Job of the work pool: the rows of one tile
+*/
+static void DemosaicTileRun(tWorkJob *pJob)
+{
+	tDemosaicTile *pTile = (tDemosaicTile*)pJob->pContext;
+	tDemosaic *pOwner = pTile->pOwner;
+	tDemosaicImage image;
+
+	DemosaicImage(pOwner->pFrame,&image);
+#ifdef DEMOSAIC_SSE2
+	if(pOwner->Simd)
+		DemosaicRowsSse2(&image,pOwner->Method,pOwner->Layout,pTile->FirstRow,pTile->Rows,pTile->pLines,pTile->Stride,pOwner->pTarget);
+	else
+#endif
+	// 3 lines of int samples, then 3 lines of unsigned short: they fit in the lines of the tile
+	RefRows(&image,pOwner->Method,pOwner->Layout,pTile->FirstRow,pTile->Rows,(int*)pTile->pLines,
+		pTile->pLines + 6 * image.Width,pOwner->pTarget);
+
+	if(!AtomicDecrement(&(pOwner->Remaining)))
+		EventSignal(&(pOwner->Done));
+}
+
+/*!
+ * @brief
+ *		Initialize the demosaic state of a camera, the line buffers are
+ *		allocated with the first frame
+ * @param
+ *		demosaic state
+ * @param
+ *		work pool home of the camera, DEMOSAIC_INLINE to keep the tiles on
+ *		the calling thread
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void DemosaicInit(tDemosaic *pDemosaic,unsigned long Home)
+{
+	unsigned long i;
+
+	memset(pDemosaic,0,sizeof(tDemosaic));
+	EventInit(&(pDemosaic->Done));
+	pDemosaic->Home = Home;
+	for(i=0;i<DEMOSAIC_TILES;i++)
+	{
+		pDemosaic->Tiles[i].pOwner = pDemosaic;
+		pDemosaic->Tiles[i].Job.Run = DemosaicTileRun;
+		pDemosaic->Tiles[i].Job.pContext = &(pDemosaic->Tiles[i]);
+	}
+}
+
+void DemosaicDestroy(tDemosaic *pDemosaic)
+{
+	unsigned long i;
+
+	for(i=0;i<DEMOSAIC_TILES;i++)
+	{
+		AlignedFree(pDemosaic->Tiles[i].pLines);
+		pDemosaic->Tiles[i].pLines = NULL;
+		pDemosaic->Tiles[i].Stride = 0;
+	}
+	EventDestroy(&(pDemosaic->Done));
+}
+
+/*!
+ * @brief
+ *		The frame is Bayer8 or Bayer16, at least DEMOSAIC_MIN_SIZE pixels wide
+ *		and high
+ * @param
+ *		frame
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		bool
+ */
+bool DemosaicSupports(const tPvFrame *pFrame)
+{
+	unsigned long bytes = pFrame->Format == ePvFmtBayer16 ? 2 : 1;
+
+	if(pFrame->Format != ePvFmtBayer8 && pFrame->Format != ePvFmtBayer16)
+		return false;
+	if(pFrame->Width < DEMOSAIC_MIN_SIZE || pFrame->Height < DEMOSAIC_MIN_SIZE || pFrame->Width > 0x10000)
+		return false;
+	return pFrame->ImageBuffer && pFrame->ImageSize >= pFrame->Width * pFrame->Height * bytes;
+}
+
+/*
+	Bytes of the converted frame, 3 samples per pixel at the depth of the frame
+*/
+unsigned long DemosaicTargetSize(const tPvFrame *pFrame)
+{
+	return pFrame->Width * pFrame->Height * 3 * (pFrame->Format == ePvFmtBayer16 ? 2 : 1);
+}
+
+/*
+	The SSE2 kernels take the frames of DEMOSAIC_SIMD_BITS at most
+*/
+static bool DemosaicSimd(const tPvFrame *pFrame)
+{
+#ifdef DEMOSAIC_SSE2
+	return DemosaicMaximum(pFrame) < (1UL << DEMOSAIC_SIMD_BITS);
+#else
+	return false;
+#endif
+}
+
+/*!
+ * @brief
+ *		Name of the kernel DemosaicFrame() runs a frame with
+ * @param
+ *		Bayer8 or Bayer16 frame
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		"sse2" or "scalar"
+ */
+const char *DemosaicKernel(const tPvFrame *pFrame)
+{
+	return DemosaicSimd(pFrame) ? "sse2" : "scalar";
+}
+
+/*!
+ * @brief
+ *		Demosaic a frame, its row tiles on the work pool when it runs
+ * @param
+ *		demosaic state of the caller
+ * @param
+ *		Bayer8 or Bayer16 frame, see DemosaicSupports()
+ * @param
+ *		target, DemosaicTargetSize() bytes
+ * @param
+ *		method
+ * @param
+ *		layout of the target
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		DemosaicReference()
+ * @return
+ *		false if the frame is not supported or the lines could not be allocated
+ */
+bool DemosaicFrame(tDemosaic *pDemosaic,const tPvFrame *pFrame,void *pTarget,tDemosaicMethod Method,tDemosaicLayout Layout)
+{
+	unsigned long long start = GetMicroseconds();
+	unsigned long i,count,rows,stride;
+	tDemosaicTile *pTile;
+
+	if(!DemosaicSupports(pFrame))
+		return false;
+
+	pDemosaic->pFrame = pFrame;
+	pDemosaic->pTarget = pTarget;
+	pDemosaic->Method = Method;
+	pDemosaic->Layout = Layout;
+	pDemosaic->Maximum = DemosaicMaximum(pFrame);
+	pDemosaic->Simd = DemosaicSimd(pFrame);
+	if(!pDemosaic->Simd && !AtomicExchange(&gScalarNoticed,1))
+		printf("demosaic: %lu bits frames run the scalar kernel, %s\n",pFrame->BitDepth,
+#ifdef DEMOSAIC_SSE2
+			"the SSE2 ones take " DEMOSAIC_STRING(DEMOSAIC_SIMD_BITS) " bits at most"
+#else
+			"no SSE2 in this build"
+#endif
+			);
+
+	/*
+	One tile on the calling thread, or up to DEMOSAIC_TILES of at least
+	DEMOSAIC_TILE_MIN_ROWS rows for the pool
+	*/
+	count = 1;
+	if(WorkPoolRunning() && pDemosaic->Home != DEMOSAIC_INLINE)
+	{
+		count = pFrame->Height / DEMOSAIC_TILE_MIN_ROWS;
+		if(count > DEMOSAIC_TILES)
+			count = DEMOSAIC_TILES;
+		if(!count)
+			count = 1;
+	}
+	rows = (pFrame->Height + count - 1) / count;
+	count = (pFrame->Height + rows - 1) / rows;
+
+	// 8 samples of slack after the padding, the kernels run past Width
+	stride = DEMOSAIC_PAD + ((pFrame->Width + 7) & ~7UL) + DEMOSAIC_PAD + 8;
+	for(i=0;i<count;i++)
+	{
+		pTile = &(pDemosaic->Tiles[i]);
+		pTile->FirstRow = i * rows;
+		pTile->Rows = pTile->FirstRow + rows > pFrame->Height ? pFrame->Height - pTile->FirstRow : rows;
+		if(pTile->Stride >= stride)
+			continue;
+		AlignedFree(pTile->pLines);
+		pTile->pLines = (unsigned short*)AlignedAlloc(DEMOSAIC_LINES * stride * sizeof(unsigned short),16);
+		if(!pTile->pLines)
+		{
+			printf("Error in %s:%d at DemosaicFrame() ----> no memory for the lines of %lu pixels\n", __FILE__, __LINE__, pFrame->Width);
+			pTile->Stride = 0;
+			return false;
+		}
+		// what the kernels read past the padding is defined
+		memset(pTile->pLines,0,DEMOSAIC_LINES * stride * sizeof(unsigned short));
+		pTile->Stride = stride;
+	}
+	pDemosaic->Remaining = count;
+
+	if(count > 1)
+	{
+		for(i=1;i<count;i++)
+			WorkPoolSubmit(&(pDemosaic->Tiles[i].Job),pDemosaic->Home);
+
+		DemosaicTileRun(&(pDemosaic->Tiles[0].Job));
+
+		/*
+		Help the pool (with any camera's jobs) until our frame is done
+		*/
+		while(pDemosaic->Remaining)
+		{
+			if(!WorkPoolHelp(pDemosaic->Home))
+				EventWait(&(pDemosaic->Done),EVENT_INFINITE);
+		}
+	}
+	else
+		DemosaicTileRun(&(pDemosaic->Tiles[0].Job));
+
+	pDemosaic->Frames++;
+	if(!pDemosaic->Simd)
+		pDemosaic->FramesScalar++;
+	pDemosaic->Time += GetMicroseconds() - start;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Scalar reference of the demosaic, pixel by pixel on the calling thread
+ * @param
+ *		Bayer8 or Bayer16 frame, see DemosaicSupports()
+ * @param
+ *		target, DemosaicTargetSize() bytes
+ * @param
+ *		method
+ * @param
+ *		layout of the target
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		DemosaicFrame()
+ * @return
+ *		false if the frame is not supported
+ */
+bool DemosaicReference(const tPvFrame *pFrame,void *pTarget,tDemosaicMethod Method,tDemosaicLayout Layout)
+{
+	tDemosaicImage image;
+	int *pSamples;
+	unsigned short *pLines;
+
+	if(!DemosaicSupports(pFrame))
+		return false;
+
+	DemosaicImage(pFrame,&image);
+	pSamples = (int*)malloc(3 * pFrame->Width * sizeof(int));
+	pLines = (unsigned short*)malloc(3 * pFrame->Width * sizeof(unsigned short));
+	if(pSamples && pLines)
+		RefRows(&image,Method,Layout,0,pFrame->Height,pSamples,pLines,pTarget);
+	free(pSamples);
+	free(pLines);
+
+	return pSamples && pLines;
+}
+
+
+/*
+	Benchmark: the kernels against the reference over every pattern, method,
+	layout and depth, odd sizes included; then the quality of both methods on
+	a synthetic scene mosaiced from its RGB truth; then the speed
+*/
+#define BENCH_DEMOSAIC_COUNT	10
+
+/*
+	Scene: a luminance of gradients, hard diagonal edges and fine stripes, in
+	a tint that changes slowly but at the edge of a disc, 3 samples per pixel
+	up to Maximum. The channels follow each other, as in the frames of a camera
+*/
+static void DemosaicBenchScene(unsigned short *pTruth,unsigned long Width,unsigned long Height,unsigned long Maximum)
+{
+	unsigned long x,y,luminance,r,g,b;
+	long dx,dy,radius = (long)Height / 4;
+
+	for(y=0;y<Height;y++)
+	{
+		for(x=0;x<Width;x++,pTruth+=3)
+		{
+			luminance = 400 + 800 * (x + y) / (Width + Height);
+			if(((x * 3 + y * 2) / 53) & 1)
+				luminance += 1600;
+			// fine stripes in the lower quarter
+			if(y > Height * 3 / 4 && (x / 3) % 2)
+				luminance += 800;
+			r = 60 + 40 * x / Width;
+			g = 100;
+			b = 90 - 40 * y / Height;
+			dx = (long)x - (long)Width / 2;
+			dy = (long)y - (long)Height / 2;
+			if(dx * dx + dy * dy < radius * radius)
+			{
+				r = 120;
+				b = 40;
+			}
+			pTruth[0] = (unsigned short)((luminance * r / 128) * Maximum / 4095);
+			pTruth[1] = (unsigned short)((luminance * g / 128) * Maximum / 4095);
+			pTruth[2] = (unsigned short)((luminance * b / 128) * Maximum / 4095);
+		}
+	}
+}
+
+// each pixel keeps the channel of its color in the pattern
+static void DemosaicBenchMosaic(const unsigned short *pTruth,const tPvFrame *pFrame)
+{
+	unsigned long x,y,channel,i;
+
+	for(y=0;y<pFrame->Height;y++)
+	{
+		for(x=0;x<pFrame->Width;x++)
+		{
+			i = y * pFrame->Width + x;
+			if(!((x ^ DemosaicGreenPhase(pFrame->BayerPattern,y)) & 1))
+				channel = 1;
+			else
+				channel = DemosaicRedRow(pFrame->BayerPattern,y) ? 0 : 2;
+			if(pFrame->Format == ePvFmtBayer16)
+				((unsigned short*)pFrame->ImageBuffer)[i] = pTruth[3 * i + channel];
+			else
+				((unsigned char*)pFrame->ImageBuffer)[i] = (unsigned char)pTruth[3 * i + channel];
+		}
+	}
+}
+
+static double DemosaicBenchPsnr(const unsigned short *pTruth,const void *pImage,const tPvFrame *pFrame)
+{
+	unsigned long i,count = pFrame->Width * pFrame->Height * 3;
+	double error = 0.0,difference,maximum = (double)DemosaicMaximum(pFrame);
+
+	for(i=0;i<count;i++)
+	{
+		if(pFrame->Format == ePvFmtBayer16)
+			difference = (double)pTruth[i] - (double)((const unsigned short*)pImage)[i];
+		else
+			difference = (double)pTruth[i] - (double)((const unsigned char*)pImage)[i];
+		error += difference * difference;
+	}
+	if(error == 0.0)
+		return 99.0;
+	return 10.0 * log10(maximum * maximum * (double)count / error);
+}
+
+static void DemosaicBenchFrame(tPvFrame *pFrame,tPvImageFormat Format,unsigned long BitDepth,unsigned long Width,
+							   unsigned long Height,tPvBayerPattern Pattern,void *pImage)
+{
+	memset(pFrame,0,sizeof(tPvFrame));
+	pFrame->Format = Format;
+	pFrame->BitDepth = BitDepth;
+	pFrame->Width = Width;
+	pFrame->Height = Height;
+	pFrame->BayerPattern = Pattern;
+	pFrame->ImageBuffer = pImage;
+	pFrame->ImageSize = Width * Height * (Format == ePvFmtBayer16 ? 2 : 1);
+}
+
+static void DemosaicBenchSpeed(unsigned long Threads,tPvFrame *pFrame,const char *Name,void *pTarget)
+{
+	static const char *methods[2] = {"bilinear","edge"};
+	tDemosaic demosaic;
+	unsigned long long start,elapsed;
+	unsigned long m,i;
+	double pixels = (double)pFrame->Width * (double)pFrame->Height;
+
+	WorkPoolStart(Threads);
+	DemosaicInit(&demosaic,0);
+	for(m=0;m<2;m++)
+	{
+		start = GetMicroseconds();
+		for(i=0;i<BENCH_DEMOSAIC_COUNT;i++)
+			DemosaicFrame(&demosaic,pFrame,pTarget,(tDemosaicMethod)m,eDemosaicRgb);
+		elapsed = GetMicroseconds() - start;
+		printf("  %-16s %-8s %2lu thread(s) %-6s : %7.2f ms per frame %8.1f Mpixel/s\n",Name,methods[m],Threads + 1,
+			DemosaicKernel(pFrame),(double)elapsed / 1000.0 / BENCH_DEMOSAIC_COUNT,
+			pixels * BENCH_DEMOSAIC_COUNT / (double)elapsed);
+	}
+	DemosaicDestroy(&demosaic);
+	WorkPoolStop();
+}
+
+/*!
+ * @brief
+ *		Checks, quality and speed of the demosaic, see above
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void DemosaicBenchmark()
+{
+	static const tPvImageFormat formats[3] = {ePvFmtBayer8,ePvFmtBayer16,ePvFmtBayer16};
+	static const unsigned long depths[3] = {8,12,16};
+	static const char *formatNames[3] = {"Bayer8","Bayer16 12 bits","Bayer16 16 bits"};
+	static const char *methods[2] = {"bilinear","edge"};
+	static const unsigned long widths[5] = {4,7,34,250,1362};
+	static const unsigned long heights[5] = {4,5,9,37,560};
+	const unsigned long width = 2448,height = 2050;
+	unsigned long capacity = width * height * 3 * 2;
+	unsigned short *pTruth = (unsigned short*)malloc(capacity);
+	unsigned char *pImage = (unsigned char*)malloc(width * height * 2);
+	unsigned char *pTarget = (unsigned char*)malloc(capacity);
+	unsigned char *pCheck = (unsigned char*)malloc(capacity);
+	unsigned long f,p,m,l,s,i,seed = 24680,cases = 0,failures = 0;
+	unsigned long maxThreads = ProcessorCount() - 1,threads;
+	unsigned long long start,elapsed;
+	double psnr[2];
+	tDemosaic demosaic;
+	tPvFrame frame;
+	char name[64];
+
+	if(!pTruth || !pImage || !pTarget || !pCheck)
+	{
+		free(pTruth);
+		free(pImage);
+		free(pTarget);
+		free(pCheck);
+		return;
+	}
+	if(maxThreads > WORKPOOL_MAX_THREADS)
+		maxThreads = WORKPOOL_MAX_THREADS;
+
+	/*
+	Random content at the full depth, over tiles of the pool
+	*/
+	WorkPoolStart(2);
+	DemosaicInit(&demosaic,0);
+	for(f=0;f<3;f++)
+	{
+		for(s=0;s<sizeof(widths)/sizeof(widths[0]);s++)
+		{
+			for(i=0;i<widths[s] * heights[s] * 2;i++)
+			{
+				seed = seed * 1103515245 + 12345;
+				pImage[i] = (unsigned char)(seed >> 16);
+			}
+			for(i=0;f && i<widths[s] * heights[s];i++)
+				((unsigned short*)pImage)[i] &= (unsigned short)((1UL << depths[f]) - 1);
+			for(p=0;p<4;p++)
+			{
+				DemosaicBenchFrame(&frame,formats[f],depths[f],widths[s],heights[s],(tPvBayerPattern)p,pImage);
+				for(m=0;m<2;m++)
+				{
+					for(l=0;l<3;l++)
+					{
+						cases++;
+						if(!DemosaicFrame(&demosaic,&frame,pTarget,(tDemosaicMethod)m,(tDemosaicLayout)l) ||
+							!DemosaicReference(&frame,pCheck,(tDemosaicMethod)m,(tDemosaicLayout)l) ||
+							memcmp(pTarget,pCheck,DemosaicTargetSize(&frame)))
+						{
+							failures++;
+							printf("MISMATCH: %s pattern %lu %s layout %lu %lux%lu\n",formatNames[f],p,methods[m],l,frame.Width,frame.Height);
+						}
+					}
+				}
+			}
+		}
+	}
+	DemosaicDestroy(&demosaic);
+	WorkPoolStop();
+	printf("Demosaic kernels against the reference: %lu cases, %lu mismatches\n",cases,failures);
+	for(f=0;f<3;f++)
+	{
+		DemosaicBenchFrame(&frame,formats[f],depths[f],width,height,ePvBayerRGGB,pImage);
+		printf("  %-16s : %s kernel\n",formatNames[f],DemosaicKernel(&frame));
+	}
+
+	/*
+	Quality, against the RGB truth of the scene
+	*/
+	printf("Demosaic quality, PSNR against the scene before the mosaic (%lux%lu)\n",width,height);
+	DemosaicInit(&demosaic,DEMOSAIC_INLINE);
+	for(f=0;f<3;f++)
+	{
+		DemosaicBenchScene(pTruth,width,height,(1UL << depths[f]) - 1);
+		for(p=0;p<4;p++)
+		{
+			DemosaicBenchFrame(&frame,formats[f],depths[f],width,height,(tPvBayerPattern)p,pImage);
+			DemosaicBenchMosaic(pTruth,&frame);
+			for(m=0;m<2;m++)
+			{
+				DemosaicFrame(&demosaic,&frame,pTarget,(tDemosaicMethod)m,eDemosaicRgb);
+				psnr[m] = DemosaicBenchPsnr(pTruth,pTarget,&frame);
+			}
+			printf("  %-16s pattern %lu %-6s : bilinear %5.2f dB, edge %5.2f dB\n",formatNames[f],p,DemosaicKernel(&frame),psnr[0],psnr[1]);
+		}
+	}
+
+	/*
+	Speed: the reference on one thread, then the kernels on a growing pool
+	*/
+	printf("Demosaic speed, %lux%lu, %d frames per run, RGB\n",width,height,BENCH_DEMOSAIC_COUNT);
+	for(f=0;f<3;f++)
+	{
+		DemosaicBenchScene(pTruth,width,height,(1UL << depths[f]) - 1);
+		DemosaicBenchFrame(&frame,formats[f],depths[f],width,height,ePvBayerRGGB,pImage);
+		DemosaicBenchMosaic(pTruth,&frame);
+		for(m=0;m<2;m++)
+		{
+			start = GetMicroseconds();
+			DemosaicReference(&frame,pCheck,(tDemosaicMethod)m,eDemosaicRgb);
+			elapsed = GetMicroseconds() - start;
+			printf("  %-16s %-8s reference           : %7.2f ms per frame %8.1f Mpixel/s\n",formatNames[f],methods[m],
+				(double)elapsed / 1000.0,(double)width * (double)height / (double)elapsed);
+		}
+		sprintf(name,"%s",formatNames[f]);
+		for(threads=0;;threads = threads ? threads * 2 : 1)
+		{
+			if(threads > maxThreads)
+				threads = maxThreads;
+			DemosaicBenchSpeed(threads,&frame,name,pTarget);
+			if(threads == maxThreads)
+				break;
+		}
+	}
+	DemosaicDestroy(&demosaic);
+
+	free(pTruth);
+	free(pImage);
+	free(pTarget);
+	free(pCheck);
+}
@@ -0,0 +1,202 @@
+/*!
+ *  @file
+ *     FrameArena.cpp
+ *  @brief
+ *     OTC project: Frame buffer arena, one aligned allocation for all the frame
+ *	   buffers of a camera, each buffer preceded by the block its raw record
+ *	   header goes in
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "FrameArena.h"
+#include <string.h>
+
+
+/*
+	Bytes of one slot, every part rounded up to the block size
+*/
+unsigned long FrameArenaSlotSize(unsigned long FrameSize,unsigned long PackedSize,unsigned long AncillarySize,
+								unsigned long BlockSize)
+{
+	unsigned long size = BlockSize + ARENA_ROUND_UP(FrameSize,BlockSize);
+
+	if(PackedSize)
+		size += BlockSize + ARENA_ROUND_UP(PackedSize,BlockSize);
+	if(AncillarySize)
+		size += ARENA_ROUND_UP(AncillarySize,BlockSize);
+
+	return size;
+}
+
+/*!
+ * @brief
+ *		Allocate the frame buffers of a camera and attach them to its frames
+ * @param
+ *		arena
+ * @param
+ *		frames of the camera
+ * @param
+ *		number of frames
+ * @param
+ *		TotalBytesPerFrame of the camera
+ * @param
+ *		size of the packed area of each frame, 0 when the frames are not compressed
+ * @param
+ *		NonImagePayloadSize of the camera, 0 without chunk data
+ * @param
+ *		alignment of the buffers, a power of two (ARENA_BLOCK_SIZE)
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart()
+ * @return
+ *		bool
+ */
+bool FrameArenaInit(tFrameArena *pArena,tPvFrame *Frames,unsigned long Count,unsigned long FrameSize,
+					unsigned long PackedSize,unsigned long AncillarySize,unsigned long BlockSize)
+{
+	unsigned long i;
+	char *pSlot;
+
+	memset(pArena,0,sizeof(tFrameArena));
+	pArena->BlockSize = BlockSize;
+	pArena->BufferSize = ARENA_ROUND_UP(FrameSize,BlockSize);
+	pArena->PackedSize = PackedSize ? ARENA_ROUND_UP(PackedSize,BlockSize) : 0;
+	pArena->AncillarySize = AncillarySize ? ARENA_ROUND_UP(AncillarySize,BlockSize) : 0;
+	pArena->SlotSize = FrameArenaSlotSize(FrameSize,PackedSize,AncillarySize,BlockSize);
+	pArena->Count = Count;
+
+	pArena->Base = (char*)AlignedAlloc(pArena->SlotSize * Count,BlockSize);
+	if(!pArena->Base)
+	{
+		printf("Error in %s:%d at FrameArenaInit() ----> could not allocate %lu frame buffers\n", __FILE__, __LINE__, Count);
+		return false;
+	}
+
+	/*
+	The tail of a buffer past the image and the unused part of a record block
+	are written to the disk with the record, they must not carry old data
+	*/
+	memset(pArena->Base,0,pArena->SlotSize * Count);
+
+	for(i=0;i<Count;i++)
+	{
+		pSlot = pArena->Base + i * pArena->SlotSize;
+		Frames[i].ImageBuffer = pSlot + BlockSize;
+		Frames[i].ImageBufferSize = pArena->BufferSize;
+		if(pArena->AncillarySize)
+		{
+			Frames[i].AncillaryBuffer = pSlot + pArena->SlotSize - pArena->AncillarySize;
+			Frames[i].AncillaryBufferSize = AncillarySize;
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Keep the frame buffers of a camera that comes back, when they have the
+ *		layout FrameArenaInit() would give them. They only ever held records of
+ *		that layout, they are not cleared again
+ * @param
+ *		arena, allocated or not
+ * @param
+ *		frames of the camera
+ * @param
+ *		number of frames
+ * @param
+ *		TotalBytesPerFrame of the camera
+ * @param
+ *		size of the packed area of each frame, 0 when the frames are not compressed
+ * @param
+ *		NonImagePayloadSize of the camera, 0 without chunk data
+ * @param
+ *		alignment of the buffers
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart()
+ * @return
+ *		false if the arena has to be allocated again
+ */
+bool FrameArenaReuse(tFrameArena *pArena,tPvFrame *Frames,unsigned long Count,unsigned long FrameSize,
+					 unsigned long PackedSize,unsigned long AncillarySize,unsigned long BlockSize)
+{
+	unsigned long i;
+
+	if(!pArena->Base || pArena->Count != Count || pArena->BlockSize != BlockSize ||
+		pArena->SlotSize != FrameArenaSlotSize(FrameSize,PackedSize,AncillarySize,BlockSize) ||
+		pArena->BufferSize != ARENA_ROUND_UP(FrameSize,BlockSize) ||
+		pArena->PackedSize != (PackedSize ? ARENA_ROUND_UP(PackedSize,BlockSize) : 0) ||
+		pArena->AncillarySize != (AncillarySize ? ARENA_ROUND_UP(AncillarySize,BlockSize) : 0))
+		return false;
+
+	for(i=0;i<Count;i++)
+		if(Frames[i].AncillaryBuffer)
+			Frames[i].AncillaryBufferSize = AncillarySize;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Free the frame buffers, the camera and the storage must be done with them
+ * @param
+ *		arena
+ * @param
+ *		frames of the camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraUnsetup()
+ * @return
+ *		void
+ */
+void FrameArenaDestroy(tFrameArena *pArena,tPvFrame *Frames)
+{
+	unsigned long i;
+
+	for(i=0;i<pArena->Count;i++)
+	{
+		Frames[i].ImageBuffer = NULL;
+		Frames[i].ImageBufferSize = 0;
+		Frames[i].AncillaryBuffer = NULL;
+		Frames[i].AncillaryBufferSize = 0;
+	}
+
+	AlignedFree(pArena->Base);
+	pArena->Base = NULL;
+	pArena->Count = 0;
+}
+
+/*
+	Whole slot of a frame, record block first (registered buffers of io_uring)
+*/
+void *FrameArenaSlot(const tFrameArena *pArena,unsigned long Index)
+{
+	return pArena->Base + Index * pArena->SlotSize;
+}
+
+/*!
+ * @brief
+ *		Packed area of a frame, where the compression stage puts its output
+ * @param
+ *		arena
+ * @param
+ *		frame allocated from the arena
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		PackedSize bytes, block aligned, or NULL when the arena has no packed area
+ */
+void *FrameArenaPacked(const tFrameArena *pArena,const tPvFrame *pFrame)
+{
+	if(!pArena->PackedSize)
+		return NULL;
+
+	return (char*)pFrame->ImageBuffer + pArena->BufferSize + pArena->BlockSize;
+}
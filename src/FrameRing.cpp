@@ -0,0 +1,320 @@
+/*!
+ *  @file
+ *     FrameRing.cpp
+ *  @brief
+ *     OTC project: Lock-free single producer / single consumer ring of frames.
+ *	   Pushing never blocks, so the PvAPI callback thread never waits on a
+ *	   mutex or on the disk
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "FrameRing.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+	Frame buffers the benchmark cycles, FRAMESCOUNT of a camera (mainHeader.h)
+*/
+#define RING_BENCH_BUFFERS	10
+#define RING_BENCH_SECONDS	2
+
+
+/*!
+ * @brief
+ *		Allocate the slots of a ring
+ * @param
+ *		ring to initialise
+ * @param
+ *		number of frames the ring must hold, rounded up to a power of two
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		bool
+ */
+bool FrameRingInit(tFrameRing *pRing,unsigned long Capacity)
+{
+	unsigned long size = 1;
+
+	while(size < Capacity)
+		size <<= 1;
+
+	memset(pRing,0,sizeof(tFrameRing));
+	pRing->Slots = (tPvFrame**)malloc(size * sizeof(tPvFrame*));
+	if(!pRing->Slots)
+		return false;
+	pRing->Capacity = size;
+	pRing->Mask = size - 1;
+	EventInit(&(pRing->Ready));
+
+	return true;
+}
+
+void FrameRingDestroy(tFrameRing *pRing)
+{
+	if(pRing->Slots)
+	{
+		EventDestroy(&(pRing->Ready));
+		free(pRing->Slots);
+	}
+	pRing->Slots = NULL;
+}
+
+/*!
+ * @brief
+ *		Producer side: append a frame. Wait-free, only the producer may call it.
+ *		The consumer is signaled once per sleep: the push that clears its flag
+ *		signals it, the pushes while it is awake do not touch the event
+ * @param
+ *		ring
+ * @param
+ *		frame to append
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if the ring is full
+ */
+bool FrameRingPush(tFrameRing *pRing,tPvFrame *pFrame)
+{
+	unsigned long tail = pRing->Tail;
+
+	if(tail - pRing->Head >= pRing->Capacity)
+		return false;
+
+	pRing->Slots[tail & pRing->Mask] = pFrame;
+	RING_BARRIER();		// the slot must be visible before the new tail
+	pRing->Tail = tail + 1;
+	RING_BARRIER();		// the new tail must be visible before we look at the consumer
+
+	if(pRing->ConsumerWaiting && AtomicExchange(&(pRing->ConsumerWaiting),0))
+		EventSignal(&(pRing->Ready));
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Consumer side: take the oldest frame. Only the consumer may call it
+ * @param
+ *		ring
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		the frame or NULL if the ring is empty
+ */
+tPvFrame *FrameRingPop(tFrameRing *pRing)
+{
+	unsigned long head = pRing->Head;
+	tPvFrame *pFrame;
+
+	if(head == pRing->Tail)
+		return NULL;
+
+	RING_BARRIER();		// read the slot only after having seen the tail
+	pFrame = pRing->Slots[head & pRing->Mask];
+	RING_BARRIER();		// done with the slot before handing it back
+	pRing->Head = head + 1;
+
+	return pFrame;
+}
+
+/*!
+ * @brief
+ *		Consumer side: take the oldest frame, sleeping while the ring is empty.
+ *		The consumer raises its flag before it looks at the ring a last time
+ *		and the producer publishes the tail before it looks at the flag: either
+ *		the last look sees the frame or the push signals the event, which keeps
+ *		the signal until the wait
+ * @param
+ *		ring
+ * @param
+ *		timeout in milliseconds, EVENT_INFINITE to wait for ever
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameRingWake()
+ * @return
+ *		the frame or NULL on timeout / wake up (a signal left by a push the
+ *		last look already saw wakes the next wait up early, once)
+ */
+tPvFrame *FrameRingWaitPop(tFrameRing *pRing,unsigned long Timeout)
+{
+	tPvFrame *pFrame = FrameRingPop(pRing);
+
+	if(pFrame || !Timeout)
+		return pFrame;
+
+	AtomicExchange(&(pRing->ConsumerWaiting),1);
+	pFrame = FrameRingPop(pRing);
+	if(!pFrame)
+	{
+		EventWait(&(pRing->Ready),Timeout);
+		pFrame = FrameRingPop(pRing);
+	}
+	AtomicExchange(&(pRing->ConsumerWaiting),0);
+
+	return pFrame;
+}
+
+/*!
+ * @brief
+ *		Wake the consumer up, used when shutting the ring down
+ * @param
+ *		ring
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void FrameRingWake(tFrameRing *pRing)
+{
+	EventSignal(&(pRing->Ready));
+}
+
+unsigned long FrameRingDepth(const tFrameRing *pRing)
+{
+	return pRing->Tail - pRing->Head;
+}
+
+
+/*
+	Benchmark: a producer thread pushes frames at the camera rate, the consumer
+	touches every pixel (like a writer would) and hands the frame back. The
+	frames cycle through RING_BENCH_BUFFERS buffers like the ones of a camera,
+	a frame without a buffer handed back is dropped
+*/
+typedef struct
+{
+	tFrameRing			Ring;
+	tPvFrame			Frames[RING_BENCH_BUFFERS];
+	unsigned long long	PushedAt[RING_BENCH_BUFFERS];
+	unsigned long		FrameCount;
+	unsigned long		FramesPerSecond;
+	unsigned long long	PushTotal;
+	unsigned long long	PushMax;
+	unsigned long long	HandoffTotal;
+	unsigned long long	HandoffMax;
+	volatile long		Popped;				// buffers handed back
+	unsigned long		Pushed;
+	unsigned long		Full;
+	unsigned long		Dropped;
+	volatile long		Done;
+
+} tRingBench;
+
+static THREADPROC FrameRingBenchConsumer(void *pContext)
+{
+	tRingBench *pBench = (tRingBench*)pContext;
+	tPvFrame *pFrame;
+	unsigned long long handoff;
+	unsigned long i,sum;
+
+	while(!pBench->Done || FrameRingDepth(&(pBench->Ring)))
+	{
+		pFrame = FrameRingWaitPop(&(pBench->Ring),100);
+		if(!pFrame)
+			continue;
+
+		handoff = GetMicroseconds() - pBench->PushedAt[pFrame - pBench->Frames];
+		pBench->HandoffTotal += handoff;
+		if(handoff > pBench->HandoffMax)
+			pBench->HandoffMax = handoff;
+
+		sum = 0;
+		for(i=0;i<pFrame->ImageBufferSize;i+=RING_CACHE_LINE)
+			sum += ((unsigned char*)pFrame->ImageBuffer)[i];
+		pFrame->FrameCount = sum;
+		AtomicIncrement(&(pBench->Popped));
+	}
+
+	return 0;
+}
+
+static void FrameRingBenchRun(unsigned long FramesPerSecond,unsigned long Width,unsigned long Height)
+{
+	tRingBench bench;
+	tThread consumer;
+	unsigned long frameSize = Width * Height;
+	unsigned long long period = 1000000 / FramesPerSecond;
+	unsigned long long next,start,elapsed;
+	unsigned long i,frame;
+
+	memset(&bench,0,sizeof(tRingBench));
+	bench.FrameCount = FramesPerSecond * RING_BENCH_SECONDS;
+	if(!FrameRingInit(&(bench.Ring),16))
+	{
+		printf("Error in %s:%d at FrameRingBenchRun() ----> out of memory\n", __FILE__, __LINE__);
+		return;
+	}
+	for(i=0;i<RING_BENCH_BUFFERS;i++)
+	{
+		bench.Frames[i].ImageBuffer = malloc(frameSize);
+		bench.Frames[i].ImageBufferSize = bench.Frames[i].ImageBuffer ? frameSize : 0;
+	}
+
+	ThreadSpawn(&consumer,FrameRingBenchConsumer,&bench);
+
+	next = GetMicroseconds();
+	for(i=0;i<bench.FrameCount;i++)
+	{
+		while(GetMicroseconds() < next)
+			Sleep(1);
+		next += period;
+
+		// the buffers come back in the order they were pushed
+		if(bench.Pushed - (unsigned long)bench.Popped >= RING_BENCH_BUFFERS)
+		{
+			bench.Dropped++;
+			continue;
+		}
+		frame = bench.Pushed % RING_BENCH_BUFFERS;
+
+		start = GetMicroseconds();
+		bench.PushedAt[frame] = start;
+		if(FrameRingPush(&(bench.Ring),&(bench.Frames[frame])))
+			bench.Pushed++;
+		else
+			bench.Full++;
+		elapsed = GetMicroseconds() - start;
+
+		bench.PushTotal += elapsed;
+		if(elapsed > bench.PushMax)
+			bench.PushMax = elapsed;
+	}
+	bench.Done = 1;
+	FrameRingWake(&(bench.Ring));
+	ThreadJoin(&consumer);
+
+	printf("%4lu fps %5lux%-5lu push avg %6.2f us max %6.0f us | handoff avg %8.2f us max %8.0f us | full %lu dropped %lu\n",
+		FramesPerSecond,Width,Height,
+		bench.Pushed + bench.Full ? (double)bench.PushTotal / (bench.Pushed + bench.Full) : 0.0,(double)bench.PushMax,
+		bench.Popped ? (double)bench.HandoffTotal / bench.Popped : 0.0,(double)bench.HandoffMax,
+		bench.Full,bench.Dropped);
+
+	for(i=0;i<RING_BENCH_BUFFERS;i++)
+		free(bench.Frames[i].ImageBuffer);
+	FrameRingDestroy(&(bench.Ring));
+}
+
+/*!
+ * @brief
+ *		Measure the push latency (callback side) and the push to pop latency
+ *		(callback to writer) of the ring from 15 to 120 fps for a few frame sizes
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void FrameRingBenchmark()
+{
+	static const unsigned long rates[] = {15,30,60,120};
+	static const unsigned long sizes[][2] = {{640,480},{1360,1024},{2448,2050}};
+	unsigned int r,s;
+
+	printf("Frame ring benchmark\n");
+	for(s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+		for(r=0;r<sizeof(rates)/sizeof(rates[0]);r++)
+			FrameRingBenchRun(rates[r],sizes[s][0],sizes[s][1]);
+}
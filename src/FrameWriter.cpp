@@ -0,0 +1,495 @@
+/*!
+ *  @file
+ *     FrameWriter.cpp
+ *  @brief
+ *     OTC project: Asynchronous frame writer. FrameDoneCB() pushes the frame in
+ *	   the camera queue and returns straight away, one writer thread per camera
+ *	   saves the frame and its stats (or keeps it in the ring recorder) and
+ *	   re-queues the buffer to the camera. With -process pool the frames are
+ *	   processed on the work pool and the writer thread only stores them
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "mainHeader.h"
+
+/*
+	PushedAt, QueueLatency and Jobs of tFrameWriter are indexed like
+	tCamera::Frames, they are sized by WRITER_QUEUE_SIZE
+*/
+typedef char tWriterQueueHoldsFrames[WRITER_QUEUE_SIZE >= FRAMESCOUNT ? 1 : -1];
+
+/*!
+ * @brief
+ *		Give a saved frame back to the camera
+ * @param
+ *		Camera Instance
+ * @param
+ *		saved frame
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+static void FrameWriterRequeue(tCamera *tCamInstance,tPvFrame *pFrame)
+{
+	if(!tCamInstance->Writer.Stop && !tCamInstance->isUnplugged &&
+		(pFrame->Status == ePvErrSuccess  ||
+		pFrame->Status == ePvErrDataLost ||
+		pFrame->Status == ePvErrDataMissing))
+		CaptureQueueFrame(tCamInstance,pFrame);
+}
+
+static void FrameWriterAccount(tFrameWriter *pWriter,unsigned long long Latency)
+{
+	pWriter->FramesWritten++;
+	pWriter->WriteLatencyLast = Latency;
+	pWriter->WriteLatencyTotal += Latency;
+	if(Latency > pWriter->WriteLatencyMax)
+		pWriter->WriteLatencyMax = Latency;
+}
+
+/*!
+ * @brief
+ *		Job of the work pool: the compression FrameSave() does before the frame
+ *		is stored. Runs on any worker, several frames of a camera at once
+ * @param
+ *		job of the frame
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameWriterSubmit()
+ * @return
+ *		void
+ */
+static void FrameWriterProcess(tWorkJob *pWorkJob)
+{
+	tFrameJob *pJob = (tFrameJob*)pWorkJob->pContext;
+	tCamera *tCamInstance = pJob->pCamera;
+	tPvFrame *pFrame = pJob->pFrame;
+
+	pJob->Packed = pJob->Compress &&
+		CompressFrame(&(pJob->Compressor),pFrame,FrameArenaPacked(&(tCamInstance->Arena),pFrame),0,&(pJob->Payload));
+	pJob->DoneAt = GetMicroseconds();
+
+	// publishes the results, the writer may store the frame from now on
+	AtomicIncrement(&(pJob->Done));
+	FrameRingWake(&(tCamInstance->Writer.Ring));
+	AtomicDecrement(&(tCamInstance->Writer.Processing));
+}
+
+/*!
+ * @brief
+ *		Hand a frame to the work pool, on the worker of the camera first. Its
+ *		metadata are read here, in capture order: the attribute cache has one
+ *		reader, the writer thread
+ * @param
+ *		Camera Instance
+ * @param
+ *		camera frame
+ * @param
+ *		index of the frame in tCamera::Frames
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameWriterCollect()
+ * @return
+ *		void
+ */
+static void FrameWriterSubmit(tCamera *tCamInstance,tPvFrame *pFrame,unsigned long Index)
+{
+	tFrameWriter *pWriter = &(tCamInstance->Writer);
+	tFrameJob *pJob = &(pWriter->Jobs[Index]);
+
+	/*
+	The frames on the pool are the backlog of the camera
+	*/
+	pJob->pFrame = pFrame;
+	FrameReadMetadata(tCamInstance,pFrame,&(pJob->Metadata));
+	pJob->Compress = rawContainer && compressFrames &&
+		!CompressBypass(&(tCamInstance->Compressor),FrameRingDepth(&(pWriter->Ring)) + pWriter->OrderCount);
+	pJob->Packed = false;
+	pJob->Done = 0;
+	pJob->SubmittedAt = GetMicroseconds();
+
+	pWriter->Order[(pWriter->OrderHead + pWriter->OrderCount++) % WRITER_QUEUE_SIZE] = Index;
+	if(pWriter->OrderCount > pWriter->OrderMax)
+		pWriter->OrderMax = pWriter->OrderCount;
+
+	AtomicIncrement(&(pWriter->Processing));
+	WorkPoolSubmit(&(pJob->Job),tCamInstance->Index);
+}
+
+/*!
+ * @brief
+ *		Store the frames processed on the pool, oldest first, and give them
+ *		back to the camera. Stops at the first frame still being processed
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameStore()
+ * @return
+ *		void
+ */
+static void FrameWriterCollect(tCamera *tCamInstance)
+{
+	tFrameWriter *pWriter = &(tCamInstance->Writer);
+	tFrameJob *pJob;
+	unsigned long index;
+	bool requeue,stored = false;
+
+	while(pWriter->OrderCount)
+	{
+		index = pWriter->Order[pWriter->OrderHead];
+		pJob = &(pWriter->Jobs[index]);
+		if(!pJob->Done)
+			break;
+		RING_BARRIER();
+
+		requeue = FrameStore(tCamInstance,pJob->pFrame,&(pJob->Metadata),pJob->Packed ? &(pJob->Payload) : NULL);
+		// written now, unless the asynchronous storage holds it
+		if(requeue)
+			LatencyRecord(&(pWriter->DiskLatency),GetMicroseconds() - pWriter->PushedAt[index]);
+		CompressorAccount(&(tCamInstance->Compressor),&(pJob->Compressor));
+		if(pJob->DoneAt < pWriter->LastDoneAt)
+			pWriter->FramesHeld++;
+		else
+			pWriter->LastDoneAt = pJob->DoneAt;
+		FrameWriterAccount(pWriter,GetMicroseconds() - pJob->SubmittedAt);
+
+		pWriter->OrderHead = (pWriter->OrderHead + 1) % WRITER_QUEUE_SIZE;
+		pWriter->OrderCount--;
+		stored = true;
+
+		if(requeue)
+			FrameWriterRequeue(tCamInstance,pJob->pFrame);
+	}
+
+	if(stored && !FrameRingDepth(&(pWriter->Ring)))
+		AsyncStorageFlush(&(tCamInstance->Storage));
+}
+
+/*!
+ * @brief
+ *		Writer thread: waits for frames, saves them and gives them back to the camera
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameWriterPush()
+ * @return
+ *		0
+ */
+static THREADPROC FrameWriterThread(void *pContext)
+{
+	tCamera *tCamInstance = (tCamera*)pContext;
+	tFrameWriter *pWriter = &(tCamInstance->Writer);
+	tPvFrame *pFrame;
+	unsigned long long start,latency;
+	unsigned long index,timeout;
+	bool requeue,flushing = false;
+
+	while(true)
+	{
+		if(pWriter->Jobs)
+			FrameWriterCollect(tCamInstance);
+
+		/*
+		While the ring recorder flushes its pre-roll, one pre-roll frame is
+		written between two live frames and the writer does not wait. Once
+		stopped the writer looks again shortly instead of sleeping: a job of
+		the pool wakes it up just before it leaves Processing, and a push that
+		began before the stop may land after the wake-up of FrameWriterStop()
+		was used
+		*/
+		if(flushing)
+			timeout = 0;
+		else if(pWriter->Stop)
+			timeout = WRITER_DRAIN_WAIT;
+		else
+			timeout = EVENT_INFINITE;
+		pFrame = FrameRingWaitPop(&(pWriter->Ring),timeout);
+		flushing = RingRecorderService(tCamInstance);
+		if(!pFrame)
+		{
+			if(pWriter->Stop && !flushing && !FrameRingDepth(&(pWriter->Ring)) &&
+				!pWriter->OrderCount && !pWriter->Processing)
+				break;
+			continue;
+		}
+
+		if(pFrame->Status == ePvErrDataLost || pFrame->Status == ePvErrDataMissing)
+			RingRecorderTrigger(tCamInstance,eRingTriggerFrameError);
+
+		start = GetMicroseconds();
+		index = (unsigned long)(pFrame - tCamInstance->Frames);
+		if(index < FRAMESCOUNT)
+			pWriter->QueueLatency[index] = (unsigned long)(start - pWriter->PushedAt[index]);
+		if(RingRecorderKeep(tCamInstance,pFrame))
+			requeue = true;
+		else if(pWriter->Jobs && index < FRAMESCOUNT)
+		{
+			// stored by FrameWriterCollect() once processed
+			FrameWriterSubmit(tCamInstance,pFrame,index);
+			continue;
+		}
+		else
+		{
+			requeue = FrameSave(tCamInstance,pFrame,NULL);
+			// written now, unless the asynchronous storage holds it
+			if(requeue && index < FRAMESCOUNT)
+				LatencyRecord(&(pWriter->DiskLatency),GetMicroseconds() - pWriter->PushedAt[index]);
+		}
+		latency = GetMicroseconds() - start;
+		FrameWriterAccount(pWriter,latency);
+
+		/*
+		If the frame was completed (or if data were missing/lost) we re-enqueue it,
+		unless the asynchronous storage still writes it
+		*/
+		if(requeue)
+			FrameWriterRequeue(tCamInstance,pFrame);
+
+		/*
+		Nothing else to do for now, let the storage start the writes it batched
+		*/
+		if(!FrameRingDepth(&(pWriter->Ring)))
+			AsyncStorageFlush(&(tCamInstance->Storage));
+	}
+
+	return 0;
+}
+
+static void FrameWriterFreeJobs(tFrameWriter *pWriter)
+{
+	unsigned long i;
+
+	if(!pWriter->Jobs)
+		return;
+
+	for(i=0;i<WRITER_QUEUE_SIZE;i++)
+		CompressorDestroy(&(pWriter->Jobs[i].Compressor));
+	free(pWriter->Jobs);
+	pWriter->Jobs = NULL;
+}
+
+/*!
+ * @brief
+ *		Reset the counters and start the writer thread of a camera, with the
+ *		jobs of its frames with -process pool
+ * @param
+ *		Camera Instance
+ * @param
+ *		frames the ring holds
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart()
+ * @return
+ *		bool
+ */
+bool FrameWriterStart(tCamera *tCamInstance,unsigned long QueueSize)
+{
+	tFrameWriter *pWriter = &(tCamInstance->Writer);
+	unsigned long i;
+
+	if(pWriter->Running)
+		return true;
+
+	memset(pWriter,0,sizeof(tFrameWriter));
+	if(!FrameRingInit(&(pWriter->Ring),QueueSize))
+	{
+		printf("Error in %s:%d at FrameWriterStart() ----> could not allocate the frame ring\n", __FILE__, __LINE__);
+		return false;
+	}
+
+	if(processMode == eProcessPool)
+	{
+		pWriter->Jobs = (tFrameJob*)malloc(WRITER_QUEUE_SIZE * sizeof(tFrameJob));
+		if(!pWriter->Jobs)
+		{
+			printf("Error in %s:%d at FrameWriterStart() ----> could not allocate the frame jobs\n", __FILE__, __LINE__);
+			FrameRingDestroy(&(pWriter->Ring));
+			return false;
+		}
+		for(i=0;i<WRITER_QUEUE_SIZE;i++)
+		{
+			memset(&(pWriter->Jobs[i]),0,sizeof(tFrameJob));
+			pWriter->Jobs[i].Job.Run = FrameWriterProcess;
+			pWriter->Jobs[i].Job.pContext = &(pWriter->Jobs[i]);
+			pWriter->Jobs[i].pCamera = tCamInstance;
+			// the frame is a job of the pool already, its strips stay on the worker
+			CompressorInit(&(pWriter->Jobs[i].Compressor),COMPRESS_INLINE);
+		}
+	}
+
+	if(!ThreadSpawn(&(pWriter->Thread),FrameWriterThread,tCamInstance))
+	{
+		printf("Error in %s:%d at FrameWriterStart() ----> could not start the writer thread\n", __FILE__, __LINE__);
+		FrameWriterFreeJobs(pWriter);
+		FrameRingDestroy(&(pWriter->Ring));
+		return false;
+	}
+	pWriter->Running = true;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Let the writer drain its queue and wait for the thread to be over.
+ *		Must be called before the frame buffers are deleted
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraUnsetup()
+ * @return
+ *		void
+ */
+void FrameWriterStop(tCamera *tCamInstance)
+{
+	tFrameWriter *pWriter = &(tCamInstance->Writer);
+
+	if(!pWriter->Running)
+		return;
+
+	pWriter->Stop = true;
+	RING_BARRIER();
+	FrameRingWake(&(pWriter->Ring));
+
+	ThreadJoin(&(pWriter->Thread));
+	FrameWriterFreeJobs(pWriter);
+	FrameRingDestroy(&(pWriter->Ring));
+	pWriter->Running = false;
+}
+
+/*!
+ * @brief
+ *		Hand a completed frame to the writer. Called from FrameDoneCB(), it never
+ *		blocks: no lock, no disk, no camera access
+ * @param
+ *		Camera Instance
+ * @param
+ *		completed frame
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameDoneCB()
+ * @return
+ *		false if the writer is not running or its queue is full
+ */
+bool FrameWriterPush(tCamera *tCamInstance,tPvFrame *pFrame)
+{
+	tFrameWriter *pWriter = &(tCamInstance->Writer);
+	unsigned long depth;
+	unsigned long index = (unsigned long)(pFrame - tCamInstance->Frames);
+
+	if(!pWriter->Running || pWriter->Stop)
+		return false;
+
+	// published to the writer by the push
+	if(index < FRAMESCOUNT)
+		pWriter->PushedAt[index] = GetMicroseconds();
+
+	if(!FrameRingPush(&(pWriter->Ring),pFrame))
+	{
+		pWriter->FramesFailed++;
+		return false;
+	}
+
+	depth = FrameRingDepth(&(pWriter->Ring));
+	if(depth > pWriter->QueueDepthMax)
+		pWriter->QueueDepthMax = depth;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Done callback of the asynchronous storage: the record of the frame is
+ *		written, the buffer can go back to the camera. Runs on a storage thread
+ * @param
+ *		Camera Instance
+ * @param
+ *		written frame
+ * @param
+ *		false if the record could not be written
+ * @param
+ *		microseconds between the submission and the completion
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		AsyncStorageStart()
+ * @return
+ *		void
+ */
+void FrameWriterStored(void *Context,tPvFrame *pFrame,bool Success,unsigned long long /*Latency*/)
+{
+	tCamera *tCamInstance = (tCamera*)Context;
+	unsigned long index = (unsigned long)(pFrame - tCamInstance->Frames);
+
+	if(!Success)
+		printf("Failed to save the grabbed frame! \n ");
+	else if(index < FRAMESCOUNT)
+		LatencyRecord(&(tCamInstance->Writer.DiskLatency),GetMicroseconds() - tCamInstance->Writer.PushedAt[index]);
+
+	FrameWriterRequeue(tCamInstance,pFrame);
+}
+
+unsigned long FrameWriterQueueDepth(const tFrameWriter *pWriter)
+{
+	if(!pWriter->Running)
+		return 0;
+
+	return FrameRingDepth(&(pWriter->Ring));
+}
+
+/*!
+ * @brief
+ *		Average time spent writing one frame
+ * @param
+ *		writer of a camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		milliseconds
+ */
+double FrameWriterAverageLatency(const tFrameWriter *pWriter)
+{
+	if(!pWriter->FramesWritten)
+		return 0.0;
+
+	return (double)pWriter->WriteLatencyTotal / (double)pWriter->FramesWritten / 1000.0;
+}
+
+/*!
+ * @brief
+ *		Time a frame waited for the writer, from the frame done callback. Copies
+ *		of the ring recorder report the one of the frame they were copied from
+ * @param
+ *		Camera Instance
+ * @param
+ *		frame being saved, a camera frame or a copy of the ring recorder
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		microseconds
+ */
+unsigned long FrameQueueLatency(const tCamera *tCamInstance,const tPvFrame *pFrame)
+{
+	unsigned long index = (unsigned long)(pFrame - tCamInstance->Frames);
+
+	if(pFrame >= tCamInstance->Frames && index < FRAMESCOUNT)
+		return tCamInstance->Writer.QueueLatency[index];
+	if(RingRecorderOwns(&(tCamInstance->Recorder),pFrame))
+		return tCamInstance->Recorder.QueueLatency[pFrame - tCamInstance->Recorder.Frames];
+
+	return 0;
+}
@@ -0,0 +1,270 @@
+/*!
+ *  @file
+ *     LzCodec.cpp
+ *  @brief
+ *     OTC project: LZ codec of the compression stage, greedy single-probe
+ *	   matcher writing LZ4 blocks. Fast rather than tight: raw frames are
+ *	   large and the stage has to keep up with the cameras
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "LzCodec.h"
+#include <string.h>
+
+#define LZ_HASH_LOG			12
+#define LZ_HASH_SIZE		(1 << LZ_HASH_LOG)
+#define LZ_MIN_MATCH		4
+#define LZ_MAX_OFFSET		65535
+#define LZ_LAST_LITERALS	5				// the block ends with at least 5 literals
+#define LZ_MF_LIMIT			12				// no match starts in the last 12 bytes
+#define LZ_SKIP_TRIGGER		6				// step up after 2^6 misses in a row
+
+
+static unsigned int LzRead32(const unsigned char *p)
+{
+	unsigned int value;
+
+	memcpy(&value,p,sizeof(value));
+	return value;
+}
+
+static unsigned int LzHash(unsigned int Sequence)
+{
+	return (Sequence * 2654435761U) >> (32 - LZ_HASH_LOG);
+}
+
+/*
+	Length continuation bytes of the LZ4 format: 255 while more is coming
+*/
+static unsigned char *LzPutLength(unsigned char *p,unsigned long Length)
+{
+	while(Length >= 255)
+	{
+		*p++ = 255;
+		Length -= 255;
+	}
+	*p++ = (unsigned char)Length;
+	return p;
+}
+
+/*!
+ * @brief
+ *		Emit one sequence: literals then a match, or only literals for the last one
+ * @param
+ *		output position
+ * @param
+ *		end of the output buffer
+ * @param
+ *		literals
+ * @param
+ *		number of literals
+ * @param
+ *		distance of the match
+ * @param
+ *		length of the match, 0 for the last sequence
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		next output position, NULL when the output buffer is too small
+ */
+static unsigned char *LzSequence(unsigned char *p,const unsigned char *pEnd,const unsigned char *pLiterals,
+								 unsigned long Literals,unsigned long Offset,unsigned long MatchLength)
+{
+	unsigned char *pToken;
+
+	if((unsigned long)(pEnd - p) < 1 + Literals / 255 + 1 + Literals + 2 + MatchLength / 255 + 1)
+		return NULL;
+
+	pToken = p++;
+	if(Literals >= 15)
+	{
+		*pToken = 15 << 4;
+		p = LzPutLength(p,Literals - 15);
+	}
+	else
+		*pToken = (unsigned char)(Literals << 4);
+
+	memcpy(p,pLiterals,Literals);
+	p += Literals;
+
+	if(MatchLength)
+	{
+		*p++ = (unsigned char)(Offset & 0xFF);
+		*p++ = (unsigned char)(Offset >> 8);
+		MatchLength -= LZ_MIN_MATCH;
+		if(MatchLength >= 15)
+		{
+			*pToken |= 15;
+			p = LzPutLength(p,MatchLength - 15);
+		}
+		else
+			*pToken |= (unsigned char)MatchLength;
+	}
+
+	return p;
+}
+
+/*!
+ * @brief
+ *		Compress a block
+ * @param
+ *		data to compress
+ * @param
+ *		size of the data
+ * @param
+ *		output buffer
+ * @param
+ *		size of the output buffer. Compression gives up when the block does not
+ *		fit, pass the source size to only keep blocks that got smaller
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		compressed size, 0 if it does not fit in the output buffer
+ */
+unsigned long LzCompress(const void *pSource,unsigned long SourceSize,void *pTarget,unsigned long TargetCapacity)
+{
+	const unsigned char *pSrc = (const unsigned char*)pSource;
+	unsigned char *pOut = (unsigned char*)pTarget;
+	const unsigned char *pEnd = pOut + TargetCapacity;
+	unsigned int table[LZ_HASH_SIZE];
+	unsigned long ip,anchor = 0,ref,length,limit,matchLimit,misses = 0;
+	unsigned int sequence,h;
+
+	if(SourceSize > LZ_MF_LIMIT + 1)
+	{
+		memset(table,0,sizeof(table));
+		limit = SourceSize - LZ_MF_LIMIT;
+		matchLimit = SourceSize - LZ_LAST_LITERALS;
+
+		ip = 1;
+		while(ip < limit)
+		{
+			sequence = LzRead32(pSrc + ip);
+			h = LzHash(sequence);
+			ref = table[h];
+			table[h] = (unsigned int)ip;
+
+			if(ip - ref > LZ_MAX_OFFSET || LzRead32(pSrc + ref) != sequence)
+			{
+				ip += (misses++ >> LZ_SKIP_TRIGGER) + 1;
+				continue;
+			}
+			misses = 0;
+
+			/*
+			Extend the match backward over the pending literals, then forward
+			*/
+			while(ip > anchor && ref > 0 && pSrc[ip - 1] == pSrc[ref - 1])
+			{
+				ip--;
+				ref--;
+			}
+			length = LZ_MIN_MATCH;
+			while(ip + length < matchLimit && pSrc[ip + length] == pSrc[ref + length])
+				length++;
+
+			pOut = LzSequence(pOut,pEnd,pSrc + anchor,ip - anchor,ip - ref,length);
+			if(!pOut)
+				return 0;
+
+			ip += length;
+			anchor = ip;
+			if(ip < limit)
+				table[LzHash(LzRead32(pSrc + ip - 2))] = (unsigned int)(ip - 2);
+		}
+	}
+
+	pOut = LzSequence(pOut,pEnd,pSrc + anchor,SourceSize - anchor,0,0);
+	if(!pOut)
+		return 0;
+
+	return (unsigned long)(pOut - (unsigned char*)pTarget);
+}
+
+/*!
+ * @brief
+ *		Decompress a block, every length and distance is checked
+ * @param
+ *		compressed block
+ * @param
+ *		size of the block
+ * @param
+ *		output buffer
+ * @param
+ *		exact size of the decompressed data
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if the block is corrupted
+ */
+bool LzDecompress(const void *pSource,unsigned long SourceSize,void *pTarget,unsigned long TargetSize)
+{
+	const unsigned char *ip = (const unsigned char*)pSource;
+	const unsigned char *pInEnd = ip + SourceSize;
+	unsigned char *pOut = (unsigned char*)pTarget;
+	unsigned long op = 0,literals,length,offset,i;
+	unsigned char token,b;
+
+	while(ip < pInEnd)
+	{
+		token = *ip++;
+
+		literals = token >> 4;
+		if(literals == 15)
+		{
+			do
+			{
+				if(ip >= pInEnd)
+					return false;
+				b = *ip++;
+				literals += b;
+			} while(b == 255);
+		}
+		if((unsigned long)(pInEnd - ip) < literals || TargetSize - op < literals)
+			return false;
+		memcpy(pOut + op,ip,literals);
+		ip += literals;
+		op += literals;
+
+		// the last sequence has no match
+		if(ip == pInEnd)
+			break;
+
+		if(pInEnd - ip < 2)
+			return false;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(!offset || offset > op)
+			return false;
+
+		length = token & 15;
+		if(length == 15)
+		{
+			do
+			{
+				if(ip >= pInEnd)
+					return false;
+				b = *ip++;
+				length += b;
+			} while(b == 255);
+		}
+		length += LZ_MIN_MATCH;
+		if(TargetSize - op < length)
+			return false;
+
+		if(offset >= length)
+			memcpy(pOut + op,pOut + op - offset,length);
+		else
+		{
+			// overlapping copy repeats the last offset bytes
+			for(i=0;i<length;i++)
+				pOut[op + i] = pOut[op + i - offset];
+		}
+		op += length;
+	}
+
+	return op == TargetSize;
+}
@@ -31,18 +31,64 @@
 */
 
 #include "mainHeader.h"
+#ifdef _WINDOWS
 #include "direct.h"
+#else
+#include <sys/times.h>
+#endif
 #include "time.h"
 
+#ifdef _WINDOWS
+#define MAIN_U64	"%020I64u"
+#define PATH_SEP	"\\"
+#else
+#define MAIN_U64	"%020llu"
+#define PATH_SEP	"/"
+#endif
+
 
-// global camera data
-tCamera         GCamera1;	//Camera Instance for the camera with UniqueId 112322
-tCamera			GCamera2;	//Camera Instance for the camera with UniqueId 112321
-clock_t Begin, End; 
+// global camera data, the camera instances are in the registry (CameraRegistry.h)
 int numCameras = 0;
-char surveyDir[30];
+tAcquireMode acquireMode = eAcquireCallback;	//-acquire poll : a thread per camera waits for the frames
+unsigned long pollProcessors[REGISTRY_MAX_CAMERAS];	//-affinity CPU[,CPU...] : processor of the polling thread of each camera
+unsigned long pollProcessorCount = 0;
+int pollPriority = 0;					//-rt-priority N : real-time priority of the polling threads
+unsigned long cpuReportSeconds = 0;		//-cpu-report SECONDS : print the CPU used by the process every SECONDS
+unsigned long long cpuReportAt = 0;
+unsigned long long cpuReportUsed = 0;
+tWorkStats cpuReportPool[WORKPOOL_MAX_THREADS + 1];
+char surveyDir[64];
+bool rawContainer = false;			//-raw : append the frames to segment files instead of one TIFF per frame
+unsigned long segmentSizeMB = RAW_DEFAULT_SEGMENT_MB;
+unsigned long segmentSeconds = RAW_DEFAULT_SEGMENT_SECONDS;
+tStorageKind storageKind = eStorageSync;	//-storage pool|uring : write the segments asynchronously
+tRawIoMode ioMode = eRawIoBuffered;		//-io direct|writebehind : keep the segments out of the system cache
+bool nativeTiff = true;					//-tiff imagelib : save the TIFF files with ImageWriteTiff()
+bool compressFrames = false;			//-compress : compress the raw records (with -raw)
+tProcessMode processMode = eProcessWriter;	//-process pool : process the frames on the work pool, the writers store them
+unsigned long poolWorkers = 0;			//-workers N : threads of the work pool, one per processor but one by default
+bool fastReconnect = true;				//-reconnect full : free the buffers and write every attribute again when a camera comes back
+tCameraConfig cameraProfile;			//-profiles FILE -profile NAME : attributes of the cameras, built in without them
+bool statsRegisters = true;				//-stats attributes : read the stream statistics as attributes, not in one register read
+unsigned long preRollSeconds = 0;		//-preroll SECONDS : keep the frames in RAM, save them on a trigger only
+unsigned long postRollSeconds = RING_DEFAULT_POSTROLL;
+unsigned long ringBudgetMB = RING_DEFAULT_MB;
+unsigned long ringBudgetUID[REGISTRY_MAX_CAMERAS];	//-ringmb UID:MB : budget of one camera
+unsigned long ringBudgetCameraMB[REGISTRY_MAX_CAMERAS];
+int ringBudgets = 0;
+unsigned short triggerPort = 0;			//-trigger-port PORT : triggers sent to 127.0.0.1:PORT
+unsigned long attrRefreshMs = ATTR_DEFAULT_REFRESH;	//-attr-refresh MS : attribute cache refresh period, 0 reads them for every frame
+unsigned long wheelTickMs = WHEEL_TICK_MS;		//-wheel-tick MS : resolution of the timers of the cameras
+unsigned long statsPeriodMs = STATS_PERIOD;		//-stats-ms MS : statistics and status line of each camera, 0 for none
+unsigned long previewPeriodMs = WHEEL_PREVIEW_MS;	//-preview-ms MS : frame of each camera saved for the previewer, 0 for none
+unsigned long alertPeriodMs = WHEEL_ALERT_MS;	//-alert-ms MS : one alert at most per camera in this time, 0 for none
+unsigned long diskPeriodMs = WHEEL_DISK_MS;		//-disk-ms MS : free space check of each camera, 0 for none
+unsigned long long diskMinMB = MONITOR_DISK_MIN_MB;	//-disk-min MB : free space under which the disk check alerts
+bool previewColor = false;				//-preview-color bilinear|edge : frames of the previewer demosaiced to RGB
+tDemosaicMethod previewMethod = eDemosaicEdge;
 unsigned long lastBeepTimeStamp = 0;
 
+#ifdef _WINDOWS
 BOOL WINAPI Beep(
   __in  DWORD dwFreq,
   __in  DWORD dwDuration
@@ -51,6 +97,7 @@ BOOL WINAPI Beep(
 VOID WINAPI Sleep(
   __in  DWORD dwMilliseconds
 );
+#endif
 
 
 
@@ -80,164 +127,176 @@ unsigned long GetTickCount()
 	return (unsigned long)((float)(lNow - gT00) * 10000000.0 / (float)CLOCKS_PER_SEC);
 }
 
-void SetConsoleCtrlHandler(void (*func)(int), int junk)
+// no speaker to drive, the terminal bell rings instead
+void Beep(unsigned long /*Frequency*/,unsigned long /*Duration*/)
 {
-	signal(SIGINT, func);
+	printf("\a");
+	fflush(stdout);
 }
 #endif
 
-#ifdef _WINDOWS
-unsigned long __stdcall CameraCaptureThread(void *pContext)
-#else
-void *CameraCaptureThread(void *pContext)
-#endif
+/*!
+* @brief 
+*		Statistics of a camera and its status line, on the timer wheel every
+*		-stats-ms. It used to be the statistics thread of the camera
+* @param 
+*		Camera Instance
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		CameraMonitorStart()
+* @return 
+*		void
+*/
+static void CameraStatsTask(void *pContext)
 {
+	tCamera *tCamInstance = (tCamera*)pContext;
+	tCameraMonitor *pMonitor = &(tCamInstance->Monitor);
 	/*
-	Statistics of completed,done, lost and dropped frames
-	*/
-	unsigned long Completed,Dropped,Done;
-	unsigned long Missed,Errs;
-	
-	/*
-	Used for calculating the frame rate
+	Statistics of completed, dropped, lost and erroneous frames
 	*/
-	unsigned long Before,Now,Total,Elapsed; 
-	double Fps;
+	unsigned long Completed,Dropped,Missed,Errs,Now;
 	float Rate;
-	
-	/*
-	Error returned by the camera snapping process
-	*/
+	tStreamStats stats;
 	tPvErr Err;
 
-	tCamera *tCamInstance = (tCamera*)pContext;
-	/*
-	Initializatio of the variables
-	*/
-	Fps = 0;
-	Elapsed = 0;
-	Total = 0;
-	Done = 0;
-
-	/*
-	Get the tick count before the start of camera snap process
-	*/
-	Before = GetTickCount();
-
-	/*
-	Start the capture process if the camera is not unplugged
-	*/
-	while(!tCamInstance->isUnplugged)
+	// one batched register read where the camera allows it (StatsSampler.h)
+	Err = StatsSamplerRead(&(tCamInstance->Stats),&stats);
+	if(Err)
 	{
-		while(!tCamInstance->Abort) //TODO remove the abort
-		{
-			Err = PvAttrUint32Get(tCamInstance->Handle,"StatFramesCompleted",&Completed); 
-			if(Err)
-			{
-				printf("Error in %s:%d at CameraCaptureThread() ----> ", __FILE__, __LINE__); 
-				convertandPrintErrorCode(Err);
-				break;
-			}
-
-			Err = PvAttrUint32Get(tCamInstance->Handle,"StatFramesCompleted",&Completed);
-			if(Err)
-			{
-				printf("Error in %s:%d at CameraCaptureThread() ----> ", __FILE__, __LINE__); 
-				convertandPrintErrorCode(Err);
-				break;
-			}
-
-			Err = PvAttrUint32Get(tCamInstance->Handle,"StatFramesDropped",&Dropped);
-			if(Err)
-			{
-				printf("Error in %s:%d at CameraCaptureThread() ----> ", __FILE__, __LINE__); 
-				convertandPrintErrorCode(Err);
-				break;
-			}
+		printf("Error in %s:%d at CameraStatsTask() ----> ", __FILE__, __LINE__); 
+		convertandPrintErrorCode(Err);
+		return;
+	}
+	Completed = stats.FramesCompleted;
+	Dropped = stats.FramesDropped;
+	Missed = stats.PacketsMissed;
+	Errs = stats.PacketsErroneous;
+	Rate = stats.FrameRate;
+	Now = GetTickCount();
+	pMonitor->Total += Completed - pMonitor->Done;
+	pMonitor->Elapsed += Now - pMonitor->Before;
+
+	if(pMonitor->Elapsed >= 500)
+	{
+		pMonitor->Fps = (double)pMonitor->Total * 1000.0 / (double)pMonitor->Elapsed;
+		pMonitor->Elapsed = 0;
+		pMonitor->Total = 0;
+	}
 
-			Err = PvAttrUint32Get(tCamInstance->Handle,"StatPacketsMissed",&Missed);
-			if(Err)
-			{
-				printf("Error in %s:%d at CameraCaptureThread() ----> ", __FILE__, __LINE__); 
-				convertandPrintErrorCode(Err);
-				break;
-			}
+	printf("%lu completed : %9lu dropped : %9lu missed : %9lu err. : %9lu rate : %5.2f (%5.2f) queue : %2lu (max %2lu) write : %6.2f ms",
+		tCamInstance->UID,Completed,Dropped,Missed,Errs,Rate,pMonitor->Fps,FrameWriterQueueDepth(&(tCamInstance->Writer)),tCamInstance->Writer.QueueDepthMax,
+		FrameWriterAverageLatency(&(tCamInstance->Writer)));
+	if(compressFrames)
+		printf(" lz : x%4.2f %6.1f MB/s (%lu bypassed)",CompressRatio(&(tCamInstance->Compressor)),
+			CompressThroughput(&(tCamInstance->Compressor)),tCamInstance->Compressor.FramesBypassed);
+	if(tCamInstance->Writer.Jobs)
+		printf(" pool : max %2lu held %lu",tCamInstance->Writer.OrderMax,tCamInstance->Writer.FramesHeld);
+	if(tCamInstance->Attributes.Running)
+		printf(" attr : %5.1f ms",AttributeCacheStaleness(&(tCamInstance->Attributes)));
+	if(tCamInstance->Recorder.Enabled)
+		printf(" ring : %s %4lu/%4lu (%lu flushed)",RingRecorderState(&(tCamInstance->Recorder)),
+			tCamInstance->Recorder.Used,tCamInstance->Recorder.Count,tCamInstance->Recorder.FramesFlushed);
+	printf("\r");
+	pMonitor->Before = Now;
+	pMonitor->Done = Completed;
+}
 
-			Err = PvAttrUint32Get(tCamInstance->Handle,"StatPacketsErroneous",&Errs);
-			if(Err)
-			{
-				printf("Error in %s:%d at CameraCaptureThread() ----> ", __FILE__, __LINE__); 
-				convertandPrintErrorCode(Err);
-				break;
-			}
+/*
+	Previewer: the writer saves the next frame of the camera to the Previewer
+	directory, the frame buffer is only valid on its thread
+*/
+static void CameraPreviewTask(void *pContext)
+{
+	((tCamera*)pContext)->Monitor.PreviewDue = 1;
+}
 
-			Err = PvAttrFloat32Get(tCamInstance->Handle,"StatFrameRate",&Rate);
-			if(Err)
-			{
-				printf("Error in %s:%d at CameraCaptureThread() ----> ", __FILE__, __LINE__); 
-				convertandPrintErrorCode(Err);
-				break;
-			}
-			Now = GetTickCount();
-			Total += Completed - Done;
-			Elapsed += Now-Before;
+/*
+	Alerts: one at most per -alert-ms, whatever the number of frames that failed
+	since the last one. The beep blocks, the control loop does it
+*/
+static void CameraAlertTask(void *pContext)
+{
+	tCamera *tCamInstance = (tCamera*)pContext;
+	long failed = tCamInstance->Monitor.Failed;
 
-			if(Elapsed >= 500)
-			{
-				Fps = (double)Total * 1000.0 / (double)Elapsed;
-				Elapsed = 0;
-				Total = 0;
-			}
+	if(failed == tCamInstance->Monitor.Alerted)
+		return;
+	printf("\ncamera %lu : %ld frame(s) failed since the last alert\n",tCamInstance->UID,failed - tCamInstance->Monitor.Alerted);
+	tCamInstance->Monitor.Alerted = failed;
+	ControlLoopPost(eControlAlert,tCamInstance->UID);
+}
 
-			printf("Completed : %9lu dropped : %9lu missed : %9lu err. : %9lu rate : %5.2f (%5.2f)\r",
-				Completed,Dropped,Missed,Errs,Rate,Fps);
-			Before = GetTickCount();
-			Done = Completed;
+/*
+	Disk check: free space of the directory of the camera, an alert when it goes
+	under -disk-min. A disk that cannot be queried counts as full
+*/
+static void CameraDiskTask(void *pContext)
+{
+	tCamera *tCamInstance = (tCamera*)pContext;
+	unsigned long long available = DiskFreeMegabytes(tCamInstance->Bringup.Directory);
 
-			Sleep(20);
+	if(available < diskMinMB)
+	{
+		if(!tCamInstance->Monitor.DiskLow)
+		{
+			printf("\ncamera %lu : %llu MB left on the disk of %s\n",tCamInstance->UID,available,tCamInstance->Bringup.Directory);
+			ControlLoopPost(eControlAlert,tCamInstance->UID);
 		}
+		tCamInstance->Monitor.DiskLow = true;
 	}
-	printf("Came out of the thread \n");
-	printf("\n");
-
-	return 0;
+	else
+		tCamInstance->Monitor.DiskLow = false;
 }
 
-// spawn a thread
-void SpawnThread(tCamera *tCamInstance)
+/*!
+* @brief 
+*		Arm the periodic tasks of a camera once it is brought up, a period of 0
+*		leaves a task off
+* @param 
+*		Camera Instance
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		ControlHandler(), CameraMonitorStop()
+* @return 
+*		void
+*/
+static void CameraMonitorStart(tCamera *tCamInstance)
 {
-	/*
-	Check if the readytoCapture flag is set
-	If it is set go forward and complete start camera thread
-	*/
-	if(tCamInstance->readyToCapture)		
-	{
-		printf("Inside spawn Thread \n");
-#ifdef _WINDOWS	
-		tCamInstance->ThHandle = CreateThread(NULL,NULL,CameraCaptureThread,tCamInstance,NULL,&(tCamInstance->ThId));
-#else
-		pthread_create(tCamInstance->ThHandle,NULL,CameraCaptureThread,(void *)&GCamera1);
-#endif    
-		// We wait until there is no more camera
-		WaitForEver(tCamInstance);
-
-		// Then wait for the thread to finish
-		if(tCamInstance->ThHandle)
-			WaitThread(tCamInstance);     
-
-		// stop the camera
-		CameraStop(tCamInstance);   
-	}
+	tCameraMonitor *pMonitor = &(tCamInstance->Monitor);
+
+	if(pMonitor->Armed)
+		return;
+
+	// the statistics of the camera start again from 0 when it comes back
+	pMonitor->Before = GetTickCount();
+	pMonitor->Elapsed = 0;
+	pMonitor->Total = 0;
+	pMonitor->Done = 0;
+	pMonitor->Fps = 0;
+	pMonitor->PreviewDue = 0;
+	pMonitor->DiskLow = false;
+
+	pMonitor->Stats = statsPeriodMs ? TimerWheelAdd("stats",CameraStatsTask,tCamInstance,statsPeriodMs) : WHEEL_NO_TIMER;
+	pMonitor->Preview = previewPeriodMs ? TimerWheelAdd("preview",CameraPreviewTask,tCamInstance,previewPeriodMs) : WHEEL_NO_TIMER;
+	pMonitor->Alert = alertPeriodMs ? TimerWheelAdd("alert",CameraAlertTask,tCamInstance,alertPeriodMs) : WHEEL_NO_TIMER;
+	pMonitor->Disk = diskPeriodMs ? TimerWheelAdd("disk",CameraDiskTask,tCamInstance,diskPeriodMs) : WHEEL_NO_TIMER;
+	pMonitor->Armed = true;
 }
 
-// wait for the thread to be over
-void WaitThread(tCamera *tCamInstance)
+// the tasks are not running any more once it returns
+static void CameraMonitorStop(tCamera *tCamInstance)
 {
-#ifdef _WINDOWS		
-	WaitForSingleObject(tCamInstance->ThHandle,INFINITE);
-#else
-	pthread_join(tCamInstance->ThHandle,NULL);
-#endif
+	tCameraMonitor *pMonitor = &(tCamInstance->Monitor);
+
+	if(!pMonitor->Armed)
+		return;
+	TimerWheelCancel(pMonitor->Stats);
+	TimerWheelCancel(pMonitor->Preview);
+	TimerWheelCancel(pMonitor->Alert);
+	TimerWheelCancel(pMonitor->Disk);
+	pMonitor->Armed = false;
 }
 
 // wait for a camera to be plugged
@@ -245,7 +304,8 @@ void WaitThread(tCamera *tCamInstance)
 
 /*!
 * @brief 
-*		 Callback called when a camera is plugged or unplugged
+*		 Callback called when a camera is plugged or unplugged, the event is
+*		 handled by the control loop
 * @param 
 *		context
 * @param 
@@ -259,59 +319,65 @@ void WaitThread(tCamera *tCamInstance)
 * @return 
 *		void
 */
-void _STDCALL CameraEventCB(void* Context,
-							tPvInterface Interface,
+void _STDCALL CameraEventCB(void* /*Context*/,
+							tPvInterface /*Interface*/,
 							tPvLinkEvent Event,
 							unsigned long UniqueId)
 {
-	tPvErr errorCode;
+	if(Event == ePvLinkAdd)
+		ControlLoopPost(eControlLinkAdd,UniqueId);
+	else if(Event == ePvLinkRemove)
+		ControlLoopPost(eControlLinkRemove,UniqueId);
+}
+
+/*
+	Bring-up of a camera over, or its first frame: from the bring-up thread or
+	the frame callback, handled by the control loop as well
+*/
+static void CameraBringupDone(tCamera *tCamInstance)
+{
+	ControlLoopPost(eControlBringup,tCamInstance->UID);
+}
+
+/*!
+* @brief 
+*		Handle an event of the control loop, on the main thread: start the
+*		bring-up of a camera that is plugged, stop one that is unplugged
+* @param 
+*		event
+* @param 
+*		context, not used
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		CameraEventCB(), ControlLoopRun()
+* @return 
+*		void
+*/
+static void ControlHandler(const tControlEvent *pEvent,void * /*pContext*/)
+{
+	unsigned long UniqueId = pEvent->UID;
+	unsigned long long now,used;
+	tWorkStats pool[WORKPOOL_MAX_THREADS + 1];
 	tCamera *tCamInstance = NULL;
 	char cameraDir[100];
-	char cameraDir1[100];
-	char cameraSettingsFilename[100];
-	char cmdMkdir[200];
-	char cmdMkdir1[200];
-	FILE *fp;
-	switch(Event)
+	switch(pEvent->Kind)
 	{
-	case ePvLinkAdd:
+	case eControlLinkAdd:
 		{
 			printf("camera %lu plugged\n",UniqueId);
 
 			/*
-			Increment the number of cameras count
+			Same instance as the last time the camera was plugged, or a new one
 			*/
-			numCameras++;
-			/*
-			Create directory to save frames for connected camera. If directory already exists, nothing happens
-			*/
-			sprintf(cameraDir,"%s\\%lu",surveyDir,UniqueId);   //when working with mkdir from direct.h use "\". Working with system() use "\\"
-			//sprintf(cameraDir1,"%s\\%lu%s",surveyDir,UniqueId,"-LeftCam");
-			sprintf(cameraDir1,"%s\\%s",surveyDir,"Previewer");
-			sprintf(cmdMkdir,"mkdir %s",cameraDir);
-			sprintf(cmdMkdir1,"mkdir %s",cameraDir1);
-
-			system(cmdMkdir);
-				system(cmdMkdir1);
-			//mkdir(cameraDir);
+			tCamInstance = CameraRegistryAdd(UniqueId);
+			if(!tCamInstance)
+				break;
+
 			/*
-			Create log file for camera status
+			Increment the number of cameras count
 			*/
-			try{
-			sprintf(cameraSettingsFilename,"%s/%lu/stats%s",surveyDir,UniqueId,".txt");
-			fopen_s(&fp,cameraSettingsFilename,"w");
-			fprintf_s(fp,"Stats for Camera %lu\nFrame,Exposure time,Gain Value,White Balance RED,White Balance BLUE",UniqueId);
-			fclose(fp);
-			}catch(char *e){}
-
-			if(UniqueId==112322)
-			{
-				tCamInstance = &GCamera1;
-			}
-			else
-			{
-				tCamInstance = &GCamera2;
-			}
+			numCameras++;
 			tCamInstance->isUnplugged = false;
 			if(!CameraGrab(tCamInstance,UniqueId))
 			{
@@ -321,33 +387,98 @@ void _STDCALL CameraEventCB(void* Context,
 
 			tCamInstance->readyToCapture = false;
 
-			errorCode = CameraSetup(tCamInstance);	//Open the camera 
-			convertandPrintErrorCode(errorCode);
-
-			tCamInstance->readyToCapture = CameraStart(tCamInstance);
+			/*
+			Directory, log, open and start on a thread of the camera: the other cameras
+			and the loop do not wait for it. eControlBringup comes back when it is over
+			*/
+			sprintf(cameraDir,"%s" PATH_SEP "%lu",surveyDir,UniqueId);
+			CameraBringupStart(tCamInstance,cameraDir,CameraBringupDone);
 			printf("Num of cameras %d \n", numCameras);
 
-
 			break;
 		}
-	case ePvLinkRemove:
+	case eControlBringup:
 		{
-			printf("camera %lu unplugged\n",UniqueId);															
-			if(UniqueId==112322)
+			tCamInstance = CameraRegistryFind(UniqueId);
+			// unplugged since, or a thread still on its way
+			if(!tCamInstance || tCamInstance->isUnplugged || tCamInstance->Bringup.State < eBringupWaitFrame)
+				break;
+
+			// the thread is over, or about to be
+			CameraBringupJoin(tCamInstance);
+			if(tCamInstance->Bringup.State == eBringupFailed)
 			{
-				tCamInstance = &GCamera1;
+				if(!tCamInstance->Bringup.Reported)
+					printf("camera %lu could not be brought up\n",UniqueId);
+				tCamInstance->Bringup.Reported = true;
+				break;
 			}
-			else
+
+			tCamInstance->readyToCapture = true;
+			// its statistics, previewer, alerts and disk checks on the timer wheel
+			CameraMonitorStart(tCamInstance);
+
+			if(tCamInstance->Bringup.State == eBringupStreaming && !tCamInstance->Bringup.Reported)
 			{
-				tCamInstance = &GCamera2;
+				tCamInstance->Bringup.Reported = true;
+				CameraBringupReport(tCamInstance);
+				printf("camera %lu profile %s, streaming %.1f ms after the apply (apply %.1f ms, read back %.1f ms, %lu read, %lu written, %lu unchanged)\n",
+					UniqueId,tCamInstance->Config.Profile,CameraConfigTimeToStream(&(tCamInstance->Config),tCamInstance->Bringup.FirstFrameAt),
+					(double)tCamInstance->Config.ApplyTime / 1000.0,(double)tCamInstance->Config.ReadTime / 1000.0,
+					tCamInstance->Config.Reads,tCamInstance->Config.Writes,tCamInstance->Config.Skipped);
+				if(CameraReconnectAccount(tCamInstance))
+					printf("camera %lu reconnected, gap %.1f ms (max %.1f), buffers %s, %lu attribute(s) written, %lu unchanged\n",UniqueId,
+						tCamInstance->Reconnect.LastGap,tCamInstance->Reconnect.MaxGap,tCamInstance->Reconnect.BuffersKept ? "kept" : "allocated",
+						tCamInstance->Config.Writes,tCamInstance->Config.Skipped);
 			}
+			break;
+		}
+	case eControlLinkRemove:
+		{
+			printf("camera %lu unplugged\n",UniqueId);															
+			tCamInstance = CameraRegistryFind(UniqueId);
+			if(!tCamInstance || tCamInstance->isUnplugged)
+				break;
 
-			tCamInstance->isUnplugged = true;
-			CameraUnsetup(tCamInstance);
+			CameraUnplugged(tCamInstance);
 			numCameras--;
 			printf("Num of cameras %d \n", numCameras);
 			break;
 		}
+	case eControlTimer:
+		{
+			// whole process since the last report, the frame path included
+			now = GetMicroseconds();
+			used = ProcessCpuMicroseconds();
+			printf("\ncpu %5.1f%% of one processor over %lu s\n",(double)(used - cpuReportUsed) * 100.0 / (double)(now - cpuReportAt),
+				cpuReportSeconds);
+			cpuReportAt = now;
+			cpuReportUsed = used;
+			if(WorkPoolRunning())
+			{
+				WorkPoolSnapshot(pool);
+				WorkPoolReport(cpuReportPool,pool);
+				memcpy(cpuReportPool,pool,sizeof(pool));
+			}
+			ControlLoopPostAfter(eControlTimer,UniqueId,cpuReportSeconds * 1000);
+			break;
+		}
+	case eControlAlert:
+		// the timer wheel rate-limits them, the beep blocks for its duration
+		Beep(750, 300);
+		break;
+	case eControlTrigger:
+		// flush one camera, or all of them for UID 0
+		for(unsigned long i=0;i<CameraRegistryCount();i++)
+		{
+			tCamInstance = CameraRegistryGet(i);
+			if(tCamInstance->readyToCapture && !tCamInstance->isUnplugged && (!UniqueId || UniqueId == tCamInstance->UID))
+				RingRecorderTrigger(tCamInstance,eRingTriggerPort);
+		}
+		break;
+	case eControlShutdown:
+		printf("\nstopping the cameras\n");
+		break;
 	default:
 		break;
 	}
@@ -355,96 +486,236 @@ void _STDCALL CameraEventCB(void* Context,
 
 /*!
 * @brief 
-*		This function registers call back events for camera plugging and unplugging and 
-*		waits for a camera to be plugged
+*		callback called when a frame is done. The frame is only handed to the
+*		camera writer, saving it and re-queuing it happens on the writer thread
 * @param 
-*		void
+*		instance of tPvFrame
 * @author 
 *		Waazim Reza, Sagar Aghera , Rafael Giusti
 * @see 
-*		CameraEventCB()
+*		CameraStart(), FrameWriterPush()
 * @return 
 *		void
 */
-unsigned long  __stdcall WaitForCamera(void *pContext)
-//void WaitForCamera()
+void _STDCALL FrameDoneCB(tPvFrame* pFrame)
 {
+	tCamera *tCamInstance = (tCamera*)(pFrame->Context[2]);
 
-	tPvErr errorCode = PvLinkCallbackRegister(CameraEventCB,ePvLinkAdd,NULL);//Separate thread
-	convertandPrintErrorCode(errorCode);
+	/*
+	Cancelled frames are being flushed by CameraUnsetup(), nothing to save
+	*/
+	if(pFrame->Status == ePvErrCancelled)
+		return;
 
-	errorCode = PvLinkCallbackRegister(CameraEventCB,ePvLinkRemove,NULL);//Separate thread
-	convertandPrintErrorCode(errorCode);
+	// time to first frame of the bring-up
+	if(!tCamInstance->Bringup.FirstFrameAt)
+		CameraBringupFirstFrame(tCamInstance);
 
-	printf("waiting for a camera ...\n");
+	/*
+	If the writer cannot take it, give the frame straight back to the camera
+	*/
+	if(FrameWriterPush(tCamInstance,pFrame))
+		return;
 
-	while(!PvCameraCount())		//Waiting for atleast one camera to be connected
-	{
-		//printf(".");
-		Sleep(250);
-	}
-	//printf("\n");
+	if(!tCamInstance->Writer.Stop)
+		RingRecorderTrigger(tCamInstance,eRingTriggerOverflow);
+	if(pFrame->Status == ePvErrSuccess  || 
+		pFrame->Status == ePvErrDataLost ||
+		pFrame->Status == ePvErrDataMissing)
+		CaptureQueueFrame(tCamInstance,pFrame);
+}
 
-	while(1)
-	{
-	}
+
+
+/*!
+* @brief 
+*		save a frame in a TIFF file, with the native writer of the camera when
+*		it handles the format of the frame
+* @param 
+*		Camera Instance
+* @param 
+*		name of the file
+* @param 
+*		instance of tPvFrame
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		TiffWriterWrite()
+* @return 
+*		bool
+*/
+static bool FrameWriteTiff(tCamera *tCamInstance,const char *filename,tPvFrame* pFrame)
+{
+	if(nativeTiff && TiffWriterSupports(pFrame))
+		return TiffWriterWrite(&(tCamInstance->Tiff),filename,pFrame);
+
+#ifdef _WINDOWS
+	return ImageWriteTiff(filename,pFrame);
+#else
+	// ImageLib is Windows only
+	if(TiffWriterSupports(pFrame))
+		return TiffWriterWrite(&(tCamInstance->Tiff),filename,pFrame);
+	printf("Error in %s:%d at FrameWriteTiff() ----> no TIFF writer for the format %d of %s\n", __FILE__, __LINE__, pFrame->Format, filename);
+	return false;
+#endif
 }
 
+/*!
+* @brief 
+*		save the frame of the previewer, demosaiced to RGB at the depth of the
+*		frame with -preview-color, as it is otherwise
+* @param 
+*		Camera Instance
+* @param 
+*		name of the file
+* @param 
+*		instance of tPvFrame
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		DemosaicFrame()
+* @return 
+*		bool
+*/
+static bool FrameWritePreview(tCamera *tCamInstance,const char *filename,tPvFrame* pFrame)
+{
+	tCameraMonitor *pMonitor = &(tCamInstance->Monitor);
+	unsigned long size;
+	tPvFrame color;
 
+	if(!previewColor || !DemosaicSupports(pFrame))
+		return FrameWriteTiff(tCamInstance,filename,pFrame);
+
+	// the buffer of the camera follows the size of its frames
+	size = DemosaicTargetSize(pFrame);
+	if(pMonitor->ColorSize < size)
+	{
+		free(pMonitor->pColor);
+		pMonitor->pColor = malloc(size);
+		pMonitor->ColorSize = pMonitor->pColor ? size : 0;
+	}
+	if(!pMonitor->pColor || !DemosaicFrame(&(pMonitor->Demosaic),pFrame,pMonitor->pColor,previewMethod,eDemosaicRgb))
+		return FrameWriteTiff(tCamInstance,filename,pFrame);
+
+	color = *pFrame;
+	color.Format = pFrame->Format == ePvFmtBayer16 ? ePvFmtRgb48 : ePvFmtRgb24;
+	color.ImageBuffer = pMonitor->pColor;
+	color.ImageBufferSize = size;
+	color.ImageSize = size;
+#ifdef _WINDOWS
+	if(!nativeTiff)
+		return ImageWriteTiff(filename,&color);
+#endif
+	return TiffWriterWrite(&(pMonitor->ColorTiff),filename,&color);
+}
 
 /*!
 * @brief 
-*		This function waits forever (at least until CTRL-C)
+*		read the attributes stored with a frame: exposure and gain the frame was
+*		taken with from its chunk data, the rest from the attribute cache of the
+*		camera unless it is turned off
 * @param 
-*		void
+*		Camera Instance
+* @param 
+*		completed frame
+* @param 
+*		exposure, gain and white balance, 0 when an attribute cannot be read
 * @author 
 *		Waazim Reza, Sagar Aghera , Rafael Giusti
 * @see 
-*		WaitForCamera()
+*		FrameSave(), RingRecorderKeep()
 * @return 
 *		void
 */
-void WaitForEver(tCamera *tCamInstance)
+void FrameReadMetadata(tCamera *tCamInstance,const tPvFrame *pFrame,tRawMetadata *pMetadata)
 {
-	while(!tCamInstance->Abort)
-		Sleep(500);
+	tChunkData chunk;
+
+	if(!AttributeCacheRead(&(tCamInstance->Attributes),pMetadata))
+		AttributeReadCamera(&(tCamInstance->AttrTable),pMetadata);
+
+	if(ChunkParse(pFrame,&chunk))
+	{
+		pMetadata->Exposure = chunk.Exposure;
+		pMetadata->Gain = chunk.Gain;
+	}
 }
 
+/*!
+* @brief 
+*		save a frame and its stats to the disk. Runs on the writer thread of the camera
+* @param 
+*		Camera Instance
+* @param 
+*		instance of tPvFrame
+* @param 
+*		attributes of the frame, NULL to read them now
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		FrameDoneCB(), FrameStore(), RingRecorderService()
+* @return 
+*		false if the asynchronous storage now holds the frame, true if the
+*		caller has to give it back to the camera
+*/
+bool FrameSave(tCamera *tCamInstance,tPvFrame* pFrame,const tRawMetadata *pMetadata)
+{
+	tRawMetadata metadata;
+	tRawPayload payload;
+	tRawPayload *pPayload = NULL;
 
+	/*
+	Frames kept by the ring recorder come with the attributes of their time
+	*/
+	if(pMetadata)
+		metadata = *pMetadata;
+	else
+		FrameReadMetadata(tCamInstance,pFrame,&metadata);
+
+	/*
+	Compressed in the packed area of the frame, unless the writer is late
+	*/
+	if(rawContainer && compressFrames &&
+		CompressFrame(&(tCamInstance->Compressor),pFrame,FrameArenaPacked(&(tCamInstance->Arena),pFrame),
+			FrameWriterQueueDepth(&(tCamInstance->Writer)),&payload))
+		pPayload = &payload;
+
+	return FrameStore(tCamInstance,pFrame,&metadata,pPayload);
+}
 
 /*!
 * @brief 
-*		callback called when a frame is done
+*		store a processed frame and its stats. Runs on the writer thread of the
+*		camera, in the order the frames were captured
+* @param 
+*		Camera Instance
 * @param 
 *		instance of tPvFrame
+* @param 
+*		attributes of the frame
+* @param 
+*		compressed image, NULL to store the frame as it is
 * @author 
 *		Waazim Reza, Sagar Aghera , Rafael Giusti
 * @see 
-*		CameraStart()
+*		FrameSave(), FrameWriterCollect(), AsyncStorageSubmit()
 * @return 
-*		void
+*		false if the asynchronous storage now holds the frame, true if the
+*		caller has to give it back to the camera
 */
-void _STDCALL FrameDoneCB(tPvFrame* pFrame)
+bool FrameStore(tCamera *tCamInstance,tPvFrame* pFrame,const tRawMetadata *pMetadata,const tRawPayload *pPayload)
 {
-	char filename[100];
-	char filename1[100];
+	char filename[160];
+	char filename1[160];
 	char timestamp[21];
 	char camview[40];
-	char statsFileName[100];
-	char statsFileNameGlobal[100];
-	tPvUint32 filevalue=0;
-	tPvUint32 filevalue1=0;
-	tPvUint32 filevalue2=0;
-	tPvUint32 filevalue3=0;
 	unsigned long exp = 0;
 	unsigned long gain = 0;
 	unsigned long whitebalRed =0;
 	unsigned long whitebalBlue =0;
-	unsigned long  * stringsize = 0;
-	tCamera *tCamInstance = NULL;
-		  
-		int elapTicks;
-     double elapSeconds;
+	tMetadataRecord record;
+	tChunkData chunk;
+	bool submitAsync = false;
 
 	/*
 	TimestampHi is the higher 32 bits of the TimeStamp
@@ -454,9 +725,6 @@ void _STDCALL FrameDoneCB(tPvFrame* pFrame)
 	Shift the TimestampHi 32 bits to the left and add the TimestampLo
 	*/
 	
-	unsigned long long timeStampMerged  = pFrame->TimestampLo + 
-		pFrame->TimestampHi*4294967296.;
-	
 	unsigned long long timeStampFormated = ((unsigned long long)pFrame->TimestampHi << 32) 
 		| pFrame->TimestampLo;
 	
@@ -464,44 +732,39 @@ void _STDCALL FrameDoneCB(tPvFrame* pFrame)
 	unsigned long  *pCamInstance = (unsigned long *)(pFrame->Context[0]);
 	
 	//fill timestamp till 20 numbers width with zeros. No more than 20 numbers are expected (max=2^64)
-	sprintf(timestamp,"%020I64u",timeStampFormated);
+	sprintf(timestamp,MAIN_U64,timeStampFormated);
 	//drop the right 13 numbers to reduce time precision. Drop less number to increase timestamp precision
-	sprintf(timestamp,"%.13s",timestamp);
+	timestamp[13] = '\0';
 
-	if(*pCamInstance == 112321)
-	{
-		sprintf(camview,"%s","cam1");
-	}
-	else
-	{ 
-		sprintf(camview,"%s","cam2");
-	}
+	// cam1, cam2, ... in the order the cameras were first plugged
+	sprintf(camview,"cam%lu",tCamInstance->Index + 1);
 
 	//add timestamp format to filename
 	sprintf(filename,"%s/%lu%s%s%s",surveyDir,*pCamInstance,"/frame",timestamp,".tiff");
 	sprintf(filename1,"%s/%s/%s%s",surveyDir,"Previewer",camview,".tiff");
 
+	exp = pMetadata->Exposure;
+	gain = pMetadata->Gain;
+	whitebalRed = pMetadata->WhitebalRed;
+	whitebalBlue = pMetadata->WhitebalBlue;
+
 	/*
 	Save the recieved frame to the disk. The directory have to be previously created.
 	*/
 	/*start = clock();*/
-	if(!ImageWriteTiff(filename,(pFrame)))
+	if(rawContainer)
 	{
-		printf("Failed to save the grabbed frame! \n ");
-		//TODO: create directory and try again...
-	}
-	else
-	{
-		//printf("frame saved\n");
+		/*
+		Frame and stats go in the same record of the camera segment. With the
+		asynchronous storage the record is submitted once we are done with the frame,
+		the copies of the ring recorder are not camera frames and are written here
+		*/
+		if(tCamInstance->Container.pStorage && !RingRecorderOwns(&(tCamInstance->Recorder),pFrame))
+			submitAsync = true;
+		else if(!RawContainerWrite(&(tCamInstance->Container),pFrame,pMetadata,pPayload))
+			printf("Failed to save the grabbed frame! \n ");
 	}
-	 End = clock() * CLK_TCK;      //Timer for Camview app
-	   elapTicks = End - Begin; 
-	 elapSeconds = elapTicks/1000000;
-
-	 if(int(elapSeconds)%3 == 0)
-	 {
-
-	if(!ImageWriteTiff(filename1,(pFrame)))
+	else if(!FrameWriteTiff(tCamInstance,filename,pFrame))
 	{
 		printf("Failed to save the grabbed frame! \n ");
 		//TODO: create directory and try again...
@@ -510,88 +773,30 @@ void _STDCALL FrameDoneCB(tPvFrame* pFrame)
 	{
 		//printf("frame saved\n");
 	}
-	 }
-	 else
-	 {
-	 }
+	// frame for the Camview app, when the timer wheel asks for one (CameraPreviewTask())
+	if(tCamInstance->Monitor.PreviewDue)
+	{
+		tCamInstance->Monitor.PreviewDue = 0;
+		if(!FrameWritePreview(tCamInstance,filename1,pFrame))
+			printf("Failed to save the grabbed frame! \n ");
+	}
 	//finish = clock();
 	//		duration = (double)(finish - start) / CLOCKS_PER_SEC;
  //  printf( "%2.1f seconds\n", duration );
 	//*****Frame Saved*****
 
 	//*****Start Saving Stats***
-	sprintf(statsFileName,"%s/%lu%s%s%s",surveyDir,*pCamInstance,"/stat",timestamp,".txt");
-	if(*pCamInstance == 112322) //TODO
-	{
-		tCamInstance = &GCamera1;
-		
-		if(!PvAttrUint32Get(tCamInstance->Handle,"ExposureValue",&filevalue))
-		{
-		exp = unsigned long(filevalue);
-		
-		}
-		if(!PvAttrUint32Get(tCamInstance->Handle,"GainValue",&filevalue1))
-		{
-		gain = unsigned long(filevalue1);
-		}
-		if(!PvAttrUint32Get(tCamInstance->Handle,"WhitebalValueRed",&filevalue2))
-		{
-		whitebalRed = unsigned long(filevalue2);
-		}
-		if(!PvAttrUint32Get(tCamInstance->Handle,"WhitebalValueBlue",&filevalue3))
-		{
-		whitebalBlue = unsigned long(filevalue3);
-		}
-	}
-	else
-	{
-		tCamInstance = &GCamera2;
-		if(!PvAttrUint32Get(tCamInstance->Handle,"ExposureValue",&filevalue))
-		{
-		exp = unsigned long(filevalue);
-		}
-		if(!PvAttrUint32Get(tCamInstance->Handle,"GainValue",&filevalue1))
-		{
-		gain = unsigned long(filevalue1);
-		}
-		if(!PvAttrUint32Get(tCamInstance->Handle,"WhitebalValueRed",&filevalue2))
-		{
-		whitebalRed = unsigned long(filevalue2);
-		}
-		if(!PvAttrUint32Get(tCamInstance->Handle,"WhitebalValueBlue",&filevalue3))
-		{
-		whitebalBlue = unsigned long(filevalue3);
-		}
-	}
-
-	try{
-		/*Save stats in a single txt file*/
-		FILE *fp;
-		fopen_s(&fp,statsFileName,"w");
-		fprintf_s(fp,"Exposure time : %I32u\n",exp);
-		fprintf_s(fp,"Gain Value : %I32u\n",gain);
-		fprintf_s(fp,"White Balance Red : %I32u\n",whitebalRed);
-		fprintf_s(fp,"White Balance Blue : %I32u\n",whitebalBlue);
-		fclose(fp);
-		}catch(char *e){
-		printf("could not save stats in single file\n");
-		}
-	
-	
-	try{
-	/*Save stats in a global file*/
-	FILE *globalStatFp;
-	sprintf(statsFileNameGlobal,"%s/%lu%s",surveyDir,*pCamInstance,"/stats.txt");
-	fopen_s(&globalStatFp,statsFileNameGlobal,"a");
-	fprintf_s(globalStatFp,"\n%s,%I32u,%I32u,%I32u,%I32u",timestamp,exp,gain,whitebalRed,whitebalBlue);
-	/*fprintf_s(globalStatFp,"Frame:%s Gain Value : %I32u\n",timestamp,gain);
-	fprintf_s(globalStatFp,"Frame:%s White Balance Red : %I32u\n",timestamp,whitebalRed);
-	fprintf_s(globalStatFp,"Frame:%s White Balance Blue : %I32u\n",timestamp,whitebalBlue);
-	*/
-	fclose(globalStatFp);
-	}catch(char *e){
-		printf("could not save stats in global file\n");
-	}
+	record.Timestamp = timeStampFormated;
+	record.UID = *pCamInstance;
+	record.FrameCount = pFrame->FrameCount;
+	record.Status = pFrame->Status;
+	record.Exposure = exp;
+	record.Gain = gain;
+	record.WhitebalRed = whitebalRed;
+	record.WhitebalBlue = whitebalBlue;
+	record.QueueLatency = FrameQueueLatency(tCamInstance,pFrame);
+	record.AcquisitionCount = ChunkParse(pFrame,&chunk) ? chunk.AcquisitionCount : 0;
+	MetadataLogAppend(&(tCamInstance->Log),&record);
 
 	/*Increase AutoExposureMax by 100 every 30 segs and keep it between 200 & 600
 	
@@ -600,31 +805,21 @@ void _STDCALL FrameDoneCB(tPvFrame* pFrame)
 	//errorCode = PvAttrUint32Set(tCamInstance->Handle,"ExposureAutoMax",400);
 	//if(errorCode!=0)
 	//	convertandPrintErrorCode(errorCode);
+	/*Beep if frame is not success: counted here, the alert task of the timer wheel beeps*/
+	if(pFrame->Status != ePvErrSuccess)
+		AtomicIncrement(&(tCamInstance->Monitor.Failed));
+
 	/*
-		If the frame was completed (or if data were missing/lost) we re-enqueue it
+	Submit last: the frame goes back to the camera as soon as its record is written
 	*/
-	if(pFrame->Status == ePvErrSuccess  || 
-		pFrame->Status == ePvErrDataLost ||
-		pFrame->Status == ePvErrDataMissing)
-		PvCaptureQueueFrame(tCamInstance->Handle,pFrame,FrameDoneCB);
-
-	/*Beep if frame is not success*/
-	if(pFrame->Status != ePvErrSuccess ){
-		//beepSafe(strtoul(timestamp,'\0',10));
-		unsigned long FormatedTimestamp = strtoul(timestamp,'\0',10);
-		unsigned long lastBeepCameraTimeStamp = *(unsigned long*)(pFrame->Context[1]);
-		//TODO: carefull with the "> 20" because unsigned long doesnt have negative values - chechk later the correct implementation
-		if(lastBeepCameraTimeStamp == 0 || (FormatedTimestamp-lastBeepCameraTimeStamp > 200)){
-		Beep(750, 300);
-		//lastBeepTimeStamp = FormatedTimestamp;
-		for(int i=0;i<FRAMESCOUNT;i++){
-		*(unsigned long*)(tCamInstance->Frames[i].Context[1]) = FormatedTimestamp;
-		}
-		
-		}
+	if(submitAsync)
+	{
+		if(AsyncStorageSubmit(&(tCamInstance->Storage),&(tCamInstance->Container),pFrame,pMetadata,pPayload))
+			return false;
+		printf("Failed to save the grabbed frame! \n ");
 	}
 
-
+	return true;
 }
 
 
@@ -669,10 +864,89 @@ bool CameraGrab(tCamera *tCamInstance,unsigned long UID)
 */
 tPvErr CameraSetup(tCamera *tCamInstance)
 {
+	tPvErr errorCode;
+
 	tCamInstance->isUnplugged = false;
-	return PvCameraOpen(tCamInstance->UID,ePvAccessMaster,&(tCamInstance->Handle));   
+	errorCode = PvCameraOpen(tCamInstance->UID,ePvAccessMaster,&(tCamInstance->Handle));
+	if(!errorCode)
+	{
+		AttributeTableOpen(&(tCamInstance->AttrTable),tCamInstance->Handle);
+		StatsSamplerOpen(&(tCamInstance->Stats),&(tCamInstance->AttrTable),tCamInstance->UID,statsRegisters);
+	}
+
+	return errorCode;
+}
+
+
+/*!
+* @brief 
+*		memory budget of the ring recorder of a camera
+* @param 
+*		UID of the camera
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @return 
+*		MB, the -ringmb UID:MB of the camera or else the default one
+*/
+static unsigned long RingBudget(unsigned long UID)
+{
+	for(int i=0;i<ringBudgets;i++)
+	{
+		if(ringBudgetUID[i] == UID)
+			return ringBudgetCameraMB[i];
+	}
+
+	return ringBudgetMB;
+}
+
+/*!
+* @brief 
+*		attributes set on every camera without a profile file
+* @param 
+*		configuration of the camera
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		CameraStart()
+* @return 
+*		void
+*/
+static void CameraConfigDefaults(tCameraConfig *pConfig)
+{
+	CameraConfigInit(pConfig);
+	CameraConfigSet(pConfig,"ExposureMode",ePvDatatypeEnum,"Auto",false);
+	CameraConfigSet(pConfig,"ExposureValue",ePvDatatypeUint32,"10000",false);
+	CameraConfigSet(pConfig,"ExposureAutoMax",ePvDatatypeUint32,"30000",false);
+	CameraConfigSet(pConfig,"GainMode",ePvDatatypeEnum,"Auto",false);
+	CameraConfigSet(pConfig,"WhitebalMode",ePvDatatypeEnum,"Auto",false);
+	// without them the camera is not started
+	CameraConfigSet(pConfig,"FrameRate",ePvDatatypeFloat32,"15.0",true);
+	CameraConfigSet(pConfig,"FrameStartTriggerMode",ePvDatatypeEnum,"FixedRate",true);
 }
 
+/*!
+* @brief 
+*		stop what CameraStart() started before it failed, in the reverse order,
+*		as CameraDetach() does. The camera stays open and keeps its buffers, no
+*		frame has been queued yet
+* @param 
+*		Camera Instance
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		CameraStart(), CameraDetach()
+* @return 
+*		void
+*/
+static void CameraStartUnwind(tCamera *tCamInstance)
+{
+	AttributeCacheStop(&(tCamInstance->Attributes));
+	AsyncStorageStop(&(tCamInstance->Storage));
+	tCamInstance->Container.pStorage = NULL;
+	CapturePollerStop(tCamInstance);
+	FrameWriterStop(tCamInstance);
+	RingRecorderStop(tCamInstance);
+}
 
 /*!
 * @brief 
@@ -682,13 +956,16 @@ tPvErr CameraSetup(tCamera *tCamInstance)
 * @author 
 *		Waazim Reza, Sagar Aghera , Rafael Giusti
 * @see 
-*		
+*		CameraStartUnwind()
 * @return 
 *		bool
 */
 bool CameraStart(tCamera *tCamInstance)
 {
 	unsigned long FrameSize = 0;
+	unsigned long PackedSize;
+	unsigned long AncillarySize;
+	bool reconnect;
 	//unsigned long zero = 10;
 	//unsigned long *p = (unsigned long*)malloc(sizeof(unsigned long));
 	//*p = 10;
@@ -699,7 +976,7 @@ bool CameraStart(tCamera *tCamInstance)
 	//PvCaptureAdjustPacketSize(tCamInstance->Handle,8228);
 
 	// how big should the frame buffers be?
-	tPvErr errorCode = PvAttrUint32Get(tCamInstance->Handle,"TotalBytesPerFrame",&FrameSize);
+	tPvErr errorCode = AttributeUint32Get(&(tCamInstance->AttrTable),tCamInstance->AttrTable.TotalBytesPerFrame,&FrameSize);
 	if(errorCode)
 	{
 		printf("Error in %s:%d at CameraStart() ----> ", __FILE__, __LINE__); 
@@ -708,58 +985,97 @@ bool CameraStart(tCamera *tCamInstance)
 	}
 
 
-	bool failed = false;
-
-	// allocate the buffer for each frames
-	for(int i=0;i<FRAMESCOUNT && !failed;i++)
+	// allocate the buffer for each frames, aligned so they can be written with direct I/O,
+	// with room for the compressed image when the records are compressed
+	// with the chunk data of the camera, the arena holds the ancillary buffers as well
+	AncillarySize = ChunkEnable(tCamInstance->Handle);
+	PackedSize = rawContainer && compressFrames ? COMPRESS_PACKED_SIZE(FrameSize) : 0;
+	// a camera that comes back keeps the buffers it had, when they still fit
+	tCamInstance->Reconnect.BuffersKept = FrameArenaReuse(&(tCamInstance->Arena),tCamInstance->Frames,FRAMESCOUNT,FrameSize,PackedSize,
+		AncillarySize,ARENA_BLOCK_SIZE);
+	if(!tCamInstance->Reconnect.BuffersKept)
 	{
-		tCamInstance->Frames[i].ImageBuffer = new char[FrameSize];
-		if(tCamInstance->Frames[i].ImageBuffer)
-			tCamInstance->Frames[i].ImageBufferSize = FrameSize;
-		else
+		FrameArenaDestroy(&(tCamInstance->Arena),tCamInstance->Frames);
+		if(!FrameArenaInit(&(tCamInstance->Arena),tCamInstance->Frames,FRAMESCOUNT,FrameSize,PackedSize,AncillarySize,ARENA_BLOCK_SIZE))
 			return false;
 	}
 
+	// with a pre-roll the frames stay in RAM until a trigger, in slots laid out like the arena
+	if(preRollSeconds &&
+		!RingRecorderStart(tCamInstance,RingBudget(tCamInstance->UID),preRollSeconds,postRollSeconds,FrameSize,PackedSize,AncillarySize))
+		printf("camera %lu records without pre-roll\n",tCamInstance->UID);
+
+	// the TIFF header is built again on the first frame
+	TiffWriterInit(&(tCamInstance->Tiff));
+	CompressorInit(&(tCamInstance->Compressor),tCamInstance->Index);
+	TiffWriterInit(&(tCamInstance->Monitor.ColorTiff));
+	DemosaicInit(&(tCamInstance->Monitor.Demosaic),tCamInstance->Index);
+
+	// start the writer before any frame can complete
+	if(!FrameWriterStart(tCamInstance,WRITER_QUEUE_SIZE))
+	{
+		CameraStartUnwind(tCamInstance);
+		return false;
+	}
+
+	// in polling mode the frames are queued without a callback, for a thread of the camera
+	if(acquireMode == eAcquirePoll &&
+		!CapturePollerStart(tCamInstance,pollProcessorCount ? (long)pollProcessors[tCamInstance->Index % pollProcessorCount] : -1,
+		pollPriority))
+	{
+		CameraStartUnwind(tCamInstance);
+		return false;
+	}
+
+	// the asynchronous storage registers the frame buffers, they must be allocated
+	if(rawContainer && storageKind != eStorageSync &&
+		AsyncStorageStart(&(tCamInstance->Storage),storageKind,tCamInstance->Frames,FRAMESCOUNT,
+		&(tCamInstance->Arena),FrameWriterStored,tCamInstance))
+		tCamInstance->Container.pStorage = &(tCamInstance->Storage);
+
 	// set the camera is acquisition mode
 	errorCode =  PvCaptureStart(tCamInstance->Handle);
 	if(errorCode)
 	{
 		printf("Error in %s:%d at CameraStart() ----> ", __FILE__, __LINE__); 
 		convertandPrintErrorCode(errorCode);
+		CameraStartUnwind(tCamInstance);
 		return false;
 	}
 
-	//Set camera parameters
-	errorCode = PvAttrEnumSet(tCamInstance->Handle,"ExposureMode","Auto");
-	if(errorCode!=0)
-		convertandPrintErrorCode(errorCode);
-	errorCode = PvAttrUint32Set(tCamInstance->Handle,"ExposureValue",10000);
-	if(errorCode!=0)
-		convertandPrintErrorCode(errorCode);
-	errorCode = PvAttrUint32Set(tCamInstance->Handle,"ExposureAutoMax",30000);
-	if(errorCode!=0)
-		convertandPrintErrorCode(errorCode);
-	errorCode = PvAttrEnumSet(tCamInstance->Handle,"GainMode","Auto");
-	if(errorCode!=0)
-		convertandPrintErrorCode(errorCode);
-	errorCode = PvAttrEnumSet(tCamInstance->Handle,"WhitebalMode","Auto");
-	if(errorCode!=0)
-		convertandPrintErrorCode(errorCode);
+	//Set camera parameters: all of them the first time, only the ones the camera lost when it comes back
+	reconnect = fastReconnect && tCamInstance->Config.Applied;
+	if(!reconnect)
+		tCamInstance->Config = cameraProfile;
+	if(!CameraConfigApply(tCamInstance->Handle,&(tCamInstance->Config),reconnect))
+	{
+		PvCaptureEnd(tCamInstance->Handle);
+		CameraStartUnwind(tCamInstance);
+		return false;
+	}
 	errorCode = PvCommandRun(tCamInstance->Handle,"TimeStampReset");
 	if(errorCode!=0)
 		convertandPrintErrorCode(errorCode);
 	
-	unsigned long timeStampFrequency;
-	PvAttrUint32Get(tCamInstance->Handle,"TimeStampFrequency",&timeStampFrequency);
-	printf("TimeStampFrequency: %32u",&timeStampFrequency);
+	// it does not change, the camera is asked the first time only
+	if(!reconnect)
+	{
+		tPvUint32 timeStampFrequency;
+		if(!AttributeUint32Get(&(tCamInstance->AttrTable),tCamInstance->AttrTable.TimeStampFrequency,&timeStampFrequency))
+			printf("TimeStampFrequency: %lu\n",(unsigned long)timeStampFrequency);
+	}
+
+	// the attributes are set, the writer reads them from the cache from now on
+	if(attrRefreshMs)
+		AttributeCacheStart(&(tCamInstance->Attributes),&(tCamInstance->AttrTable),attrRefreshMs);
 
 	
 
-	if(PvCommandRun(tCamInstance->Handle,"AcquisitionStart") || PvAttrFloat32Set(tCamInstance->Handle,"FrameRate",15.0) ||
-		PvAttrEnumSet(tCamInstance->Handle,"FrameStartTriggerMode","FixedRate"))
+	if(PvCommandRun(tCamInstance->Handle,"AcquisitionStart"))
 	{
 		// if that fail, we reset the camera to non capture mode
 		PvCaptureEnd(tCamInstance->Handle) ;
+		CameraStartUnwind(tCamInstance);
 		return false;
 	}
 	else                
@@ -774,10 +1090,9 @@ bool CameraStart(tCamera *tCamInstance)
 
 
 			(tCamInstance->Frames[i].Context[0]) = (unsigned long *)&(tCamInstance->UID);
+			(tCamInstance->Frames[i].Context[2]) = tCamInstance;	//used by FrameDoneCB to find the writer
 			//unsigned long *pZero = (unsigned long*)malloc(sizeof(unsigned long));
 			//*pZero = 10;
-			(tCamInstance->Frames[i].Context[1]) = (unsigned long*)malloc(sizeof(unsigned long)); //lastTimeErrorBeep
-			*(unsigned long*)(tCamInstance->Frames[i].Context[1]) = 0;
 			//unsigned long lastBeepCameraTimeStamp = *(unsigned long *)(tCamInstance->Frames[i].Context[1]);
 			//unsigned long * pCamInstance = (unsigned long  *)(tCamInstance->Frames->Context[0]);
 			/*Sagui code
@@ -787,11 +1102,9 @@ bool CameraStart(tCamera *tCamInstance)
 	unsigned long long timeStampFormated = ((unsigned long long)pFrame->TimestampHi << 32) 
 		| pFrame->TimestampLo;
 	*/
-	//if(pFrame->Context[0])
-	unsigned long  *pCamInstance = (unsigned long *)(tCamInstance->Frames->Context[0]);
 
 	/*Sagui code
-	sprintf(timestamp,"%020I64u",timeStampFormated);
+	sprintf(timestamp,MAIN_U64,timeStampFormated);
 	//drop the right 13 numbers to reduce time precision. Drop less number to increase timestamp precision
 	sprintf(timestamp,"%.13s",timestamp);
 	//add timestamp format to filename
@@ -800,9 +1113,7 @@ bool CameraStart(tCamera *tCamInstance)
 
 
 
-			Begin = clock() * CLK_TCK;
-
-			PvCaptureQueueFrame(tCamInstance->Handle,&(tCamInstance->Frames[i]),FrameDoneCB);
+			CaptureQueueFrame(tCamInstance,&(tCamInstance->Frames[i]));
 		}
 		printf("frames queued ...\n");
 
@@ -835,6 +1146,43 @@ void CameraStop(tCamera *tCamInstance)
 }
 
 
+/*!
+* @brief 
+*		Close the camera and stop what works for it, the frame buffers stay
+*		attached to the frames for when it comes back
+* @param 
+*		Camera Instance
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		CameraUnplugged(), CameraUnsetup()
+* @return 
+*		void
+*/
+void CameraDetach(tCamera *tCamInstance)
+{
+	// dequeue all the frame still queued (this will block until they all have been dequeued)
+	PvCaptureQueueClear(tCamInstance->Handle);
+	// let the writer save what it already has, it must be done with the buffers before we delete them
+	FrameWriterStop(tCamInstance);
+	// nothing gives frames back to the camera any more
+	CapturePollerStop(tCamInstance);
+	RingRecorderStop(tCamInstance);
+	MetadataLogClose(&(tCamInstance->Log));
+	AttributeCacheStop(&(tCamInstance->Attributes));
+	CompressorDestroy(&(tCamInstance->Compressor));
+	DemosaicDestroy(&(tCamInstance->Monitor.Demosaic));
+	free(tCamInstance->Monitor.pColor);
+	tCamInstance->Monitor.pColor = NULL;
+	tCamInstance->Monitor.ColorSize = 0;
+	// wait for the records still in flight
+	AsyncStorageStop(&(tCamInstance->Storage));
+	// the writer is over, write the index of the current segment
+	RawContainerClose(&(tCamInstance->Container));
+	// then close the camera
+	PvCameraClose(tCamInstance->Handle);
+}
+
 /*!
 * @brief 
 *		Unsetup the camera
@@ -851,14 +1199,43 @@ void CameraStop(tCamera *tCamInstance)
 */
 void CameraUnsetup(tCamera *tCamInstance)
 {
-	// dequeue all the frame still queued (this will block until they all have been dequeued)
-	PvCaptureQueueClear(tCamInstance->Handle);
-	// then close the camera
-	PvCameraClose(tCamInstance->Handle);
+	CameraDetach(tCamInstance);
 
 	// delete all the allocated buffers
-	for(int i=0;i<FRAMESCOUNT;i++)
-		delete [] (char*)tCamInstance->Frames[i].ImageBuffer;
+	FrameArenaDestroy(&(tCamInstance->Arena),tCamInstance->Frames);
+}
+
+/*!
+* @brief 
+*		A camera is gone: its bring-up ends, the writer flushes the pre-roll and
+*		the camera is closed. With -reconnect fast (the default) its buffers and
+*		its configuration stay for when it comes back
+* @param 
+*		Camera Instance
+* @author 
+*		Waazim Reza, Sagar Aghera , Rafael Giusti
+* @see 
+*		ControlHandler()
+* @return 
+*		void
+*/
+void CameraUnplugged(tCamera *tCamInstance)
+{
+	// the state the bring-up is in goes to its end first
+	CameraBringupCancel(tCamInstance);
+	// and the tasks of the timer wheel, before the camera is closed
+	CameraMonitorStop(tCamInstance);
+	tCamInstance->isUnplugged = true;
+	// the reconnect gap starts at the first unplug, the camera may come and go before it streams again
+	if(!tCamInstance->Reconnect.UnpluggedAt)
+		tCamInstance->Reconnect.UnpluggedAt = GetMicroseconds();
+	// the writer flushes the pre-roll before it is over
+	RingRecorderTrigger(tCamInstance,eRingTriggerUnplug);
+	if(fastReconnect)
+		CameraDetach(tCamInstance);
+	else
+		CameraUnsetup(tCamInstance);
+	tCamInstance->Bringup.State = eBringupIdle;
 }
 
 void beep_s(unsigned long FormatedTimestamp){
@@ -869,7 +1246,7 @@ void beep_s(unsigned long FormatedTimestamp){
 	}
 }
 
-void __stdcall beepSafe(unsigned long FormatedTimestamp){
+void _STDCALL beepSafe(unsigned long FormatedTimestamp){
 
 	if(lastBeepTimeStamp == 0 || (FormatedTimestamp-lastBeepTimeStamp > 20)){
 		Beep(750, 300);
@@ -878,53 +1255,246 @@ void __stdcall beepSafe(unsigned long FormatedTimestamp){
 }
 
 
-// CTRL-C handler
-//TODO Remove the control C handler
-#ifdef _WINDOWS
-BOOL WINAPI CtrlCHandler(DWORD dwCtrlType)
-#else
-void CtrlCHandler(int Signo)
-#endif	
-{  
-	GCamera1.Abort = true;    
-
-#ifndef _WINDOWS
-	signal(SIGINT, CtrlCHandler);
-#else
-	return true;
-#endif
+/*
+	Trigger listener callback: the cameras are only touched by the control loop,
+	the trigger is handled there
+*/
+static void RingTriggerCameras(unsigned long UID)
+{
+	ControlLoopPost(eControlTrigger,UID);
 }
 
-
-
 int main(int argc, char* argv[])
 {
 	//Delete the Images captured for the previous run
 	//system("deleteIMGs.bat");		
 
-	tCamera *tCamInstance1 = NULL;		//Camera Instances for camera 1 //TODO
-	tCamera *tCamInstance2 = NULL;		//Camera Instances for camera 2 //TODO
+	tCamera *tCamInstance;
 
 	/*
-	Three threads are part of the this implementation
-	Main Thread  - Wait for cameras which would register CameraPlugged and CameraUnPluggedEvents				  	
-	CameraThread1 - Camera Setup, camera open, camera capture start,capture image save for a camera 1
-	CameraThread2 - Camera Setup, camera open, camera capture start,capture image save for a camera 2
+	Threads of this implementation
+	Main Thread   - control loop (ControlLoop.h): sets up, starts and stops the cameras as their link events come, until CTRL-C
+	Shared        - one timer wheel scheduler thread (TimerWheel.h): statistics, previewer, alerts and disk checks of every camera
+	              - work pool (WorkPool.h) with -compress or -process pool
+	Per camera    - bring-up thread (CameraBringup.h) while it comes up, writer thread (FrameWriter.h) and the ones of its storage,
+	                polling thread with -acquire poll, attribute cache thread with -attr-refresh
 	*/
 
-	DWORD           cameraThreadID1;
-	DWORD           cameraThreadID2;
-	DWORD           waitForCameraID;
+	/*
+	Storage options
+		-raw			record in segment files instead of one TIFF per frame
+		-segsize MB		space reserved for each segment
+		-rotate SECONDS	age of a segment before a new one is started
+		-storage KIND	sync (default), pool or uring: how the segments are written
+		-io MODE		buffered (default), direct or writebehind: how the segments use the system cache
+		-tiff WRITER	native (default) or imagelib: how the TIFF files are written
+		-compress		compress the records in parallel strips (with -raw), CFA codec for the Bayer formats
+		-preroll SECONDS	keep the frames in a RAM ring, a trigger saves the last SECONDS of them
+		-postroll SECONDS	live frames saved after a trigger (5 by default)
+		-ringmb [UID:]MB	memory of the ring of every camera, or of camera UID (512 by default)
+		-trigger-port PORT	"trigger" or "trigger UID" datagrams on 127.0.0.1:PORT flush the rings
+		-attr-refresh MS	refresh period of the attribute cache (250 by default), 0 reads the attributes for every frame
+		-cpu-report SECONDS	print the CPU used by the process every SECONDS
+		-acquire MODE		callback (default) or poll: frames handled on the PvAPI thread, or on a thread of each camera
+		-affinity CPU[,CPU...]	processors of the polling threads, camera n gets the n-th one (round robin)
+		-rt-priority N		real-time priority of the polling threads (SCHED_FIFO 1 to 99 on Linux, time critical on Windows)
+		-process MODE		writer (default) or pool: frames processed by the writer of their camera, or by the work pool of all of them
+		-workers N		threads of the work pool (-compress, -process pool), one per processor but one by default
+		-reconnect MODE		fast (default) or full: keep the buffers and write only the attributes the camera lost, or start over
+		-profiles FILE		profile file of the cameras (CameraConfig.h), cameraProfiles.txt with -profile alone
+		-profile NAME		profile of the file, the first one by default
+		-stats MODE		registers (default) or attributes: stream statistics in one register read where the camera is known, or one attribute at a time
+	*/
+	const char *profileFile = NULL;
+	const char *profileName = NULL;
+	for(int i=1;i<argc;i++)
+	{
+		if(!strcmp(argv[i],"-raw"))
+			rawContainer = true;
+		else if(!strcmp(argv[i],"-segsize") && i+1<argc)
+			segmentSizeMB = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-rotate") && i+1<argc)
+			segmentSeconds = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-storage") && i+1<argc)
+		{
+			i++;
+			if(!strcmp(argv[i],"pool"))
+				storageKind = eStoragePool;
+			else if(!strcmp(argv[i],"uring"))
+				storageKind = eStorageUring;
+			else
+				storageKind = eStorageSync;
+		}
+		else if(!strcmp(argv[i],"-io") && i+1<argc)
+		{
+			i++;
+			if(!strcmp(argv[i],"direct"))
+				ioMode = eRawIoDirect;
+			else if(!strcmp(argv[i],"writebehind"))
+				ioMode = eRawIoWriteBehind;
+			else
+				ioMode = eRawIoBuffered;
+		}
+		else if(!strcmp(argv[i],"-compress"))
+			compressFrames = true;
+		else if(!strcmp(argv[i],"-tiff") && i+1<argc)
+			nativeTiff = strcmp(argv[++i],"imagelib") != 0;
+		else if(!strcmp(argv[i],"-preroll") && i+1<argc)
+			preRollSeconds = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-postroll") && i+1<argc)
+			postRollSeconds = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-ringmb") && i+1<argc)
+		{
+			char *separator = strchr(argv[++i],':');
+			if(!separator)
+				ringBudgetMB = strtoul(argv[i],NULL,10);
+			else if(ringBudgets < REGISTRY_MAX_CAMERAS)
+			{
+				ringBudgetUID[ringBudgets] = strtoul(argv[i],NULL,10);
+				ringBudgetCameraMB[ringBudgets++] = strtoul(separator + 1,NULL,10);
+			}
+			else
+			{
+				printf("Error in %s:%d at main() ----> -ringmb %s : %d cameras at most have their own budget\n", __FILE__, __LINE__, argv[i], REGISTRY_MAX_CAMERAS);
+				return 1;
+			}
+		}
+		else if(!strcmp(argv[i],"-trigger-port") && i+1<argc)
+			triggerPort = (unsigned short)strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-attr-refresh") && i+1<argc)
+			attrRefreshMs = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-cpu-report") && i+1<argc)
+			cpuReportSeconds = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-acquire") && i+1<argc)
+			acquireMode = strcmp(argv[++i],"poll") ? eAcquireCallback : eAcquirePoll;
+		else if(!strcmp(argv[i],"-affinity") && i+1<argc)
+		{
+			char *processor = argv[++i];
+			for(pollProcessorCount=0;*processor && pollProcessorCount<REGISTRY_MAX_CAMERAS;pollProcessorCount++)
+			{
+				pollProcessors[pollProcessorCount] = strtoul(processor,&processor,10);
+				if(*processor == ',')
+					processor++;
+			}
+		}
+		else if(!strcmp(argv[i],"-rt-priority") && i+1<argc)
+			pollPriority = atoi(argv[++i]);
+		else if(!strcmp(argv[i],"-process") && i+1<argc)
+			processMode = strcmp(argv[++i],"pool") ? eProcessWriter : eProcessPool;
+		else if(!strcmp(argv[i],"-workers") && i+1<argc)
+			poolWorkers = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-reconnect") && i+1<argc)
+			fastReconnect = strcmp(argv[++i],"full") != 0;
+		else if(!strcmp(argv[i],"-profiles") && i+1<argc)
+			profileFile = argv[++i];
+		else if(!strcmp(argv[i],"-profile") && i+1<argc)
+			profileName = argv[++i];
+		else if(!strcmp(argv[i],"-stats") && i+1<argc)
+			statsRegisters = strcmp(argv[++i],"attributes") != 0;
+		else if(!strcmp(argv[i],"-wheel-tick") && i+1<argc)
+			wheelTickMs = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-stats-ms") && i+1<argc)
+			statsPeriodMs = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-preview-ms") && i+1<argc)
+			previewPeriodMs = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-alert-ms") && i+1<argc)
+			alertPeriodMs = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-disk-ms") && i+1<argc)
+			diskPeriodMs = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-disk-min") && i+1<argc)
+			diskMinMB = strtoul(argv[++i],NULL,10);
+		else if(!strcmp(argv[i],"-preview-color") && i+1<argc)
+		{
+			previewColor = true;
+			previewMethod = strcmp(argv[++i],"bilinear") ? eDemosaicEdge : eDemosaicBilinear;
+		}
+	}
 
-	HANDLE          ThWaitForCamera;
-	HANDLE          ThHandle1;
-	HANDLE          ThHandle2;
+	/*
+	Profile of the cameras, the first one of the file without a name
+	*/
+	if(profileFile || profileName)
+	{
+		if(!CameraConfigLoad(&cameraProfile,profileFile ? profileFile : CONFIG_PROFILE_FILE,profileName))
+			return 1;
+		printf("profile %s, %lu attribute(s)\n",cameraProfile.Profile,cameraProfile.Count);
+	}
+	else
+		CameraConfigDefaults(&cameraProfile);
+
+	/*
+	Metadata log to CSV: AVCameraThreaded -export-metadata metadata.avm [file.csv]
+	*/
+	if(argc > 2 && !strcmp(argv[1],"-export-metadata"))
+		return MetadataLogExport(argv[2],argc > 3 ? argv[3] : NULL) ? 0 : 1;
+
+	/*
+	Benchmarks, they do not need any camera but the attribute one: AVCameraThreaded -bench ring|storage|tiff|compress|bayer [segment]|attributes|idle|wheel|demosaic
+	Over the cameras of the simulator, simulator builds only (PV_SIMULATOR, the Linux Makefile without PVAPI_LIB):
+	End to end: AVCameraThreaded -bench capture [results.json [sweep]]
+	Time to stream of the profiles of a file: AVCameraThreaded -bench profile [profiles.txt]
+	Statistics as attributes and as register reads: AVCameraThreaded -bench stats
+	*/
+	if(argc > 2 && !strcmp(argv[1],"-bench"))
+	{
+#ifndef PV_SIMULATOR
+		// they set their cameras up through PVSIM, the real PvAPI would run them over whatever is plugged
+		if(!strcmp(argv[2],"capture") || !strcmp(argv[2],"profile") || !strcmp(argv[2],"stats"))
+		{
+			printf("The %s benchmark runs over the simulated cameras (PvSimulator.h): build with make, without PVAPI_LIB\n",argv[2]);
+			return 1;
+		}
+#endif
+		if(!strcmp(argv[2],"ring"))
+			FrameRingBenchmark();
+		else if(!strcmp(argv[2],"storage"))
+			AsyncStorageBenchmark();
+		else if(!strcmp(argv[2],"tiff"))
+			TiffWriterBenchmark();
+		else if(!strcmp(argv[2],"compress"))
+			CompressBenchmark();
+		else if(!strcmp(argv[2],"bayer"))
+			BayerCodecBenchmark(argc > 3 ? argv[3] : NULL);
+		else if(!strcmp(argv[2],"attributes"))
+			AttributeCacheBenchmark();
+		else if(!strcmp(argv[2],"idle"))
+			ControlLoopBenchmark();
+		else if(!strcmp(argv[2],"capture"))
+			CaptureBenchmark(argc > 3 ? argv[3] : NULL,argc > 4 ? argv[4] : NULL);
+		else if(!strcmp(argv[2],"profile"))
+			CameraConfigBenchmark(argc > 3 ? argv[3] : NULL);
+		else if(!strcmp(argv[2],"stats"))
+			StatsSamplerBenchmark();
+		else if(!strcmp(argv[2],"wheel"))
+			TimerWheelBenchmark();
+		else if(!strcmp(argv[2],"demosaic"))
+			DemosaicBenchmark();
+		else
+			printf("Unknown benchmark %s\n",argv[2]);
+		return 0;
+	}
 
 	/*
-	Initialize the two global camera instances here
+	The camera instances are created as the cameras are plugged
 	*/
-	memset(&GCamera1,0,sizeof(tCamera));
-	memset(&GCamera2,0,sizeof(tCamera));
+	CameraRegistryInit();
+
+	// before any thread is started, they must not take CTRL-C
+	ControlLoopInit();
+	ControlLoopCatchInterrupt();
+
+	// one work pool for all the cameras, the writer threads take part as well
+	if((rawContainer && compressFrames) || processMode == eProcessPool)
+	{
+		WorkPoolStart(poolWorkers ? poolWorkers : ProcessorCount() - 1);
+		WorkPoolSnapshot(cpuReportPool);
+	}
+
+	if(preRollSeconds && triggerPort)
+		RingTriggerListenerStart(triggerPort,RingTriggerCameras);
+
+	// one scheduler thread for the periodic tasks of all the cameras
+	TimerWheelStart(wheelTickMs);
 
 	// initialise the Prosilica API
 	if(!PvInitialize())
@@ -940,7 +1510,7 @@ int main(int argc, char* argv[])
 		//Sleep(10000); //for testing initialization from startup
 		printf("Starting Frame Collector at %s", ctime( &ltime ) );
 		today = localtime(&ltime);
-		sprintf(surveyDir,"..\\Survey_%d_%d_%d_%d_%d_%d",today->tm_year+1900,today->tm_mon+1,today->tm_mday,
+		sprintf(surveyDir,".." PATH_SEP "Survey_%d_%d_%d_%d_%d_%d",today->tm_year+1900,today->tm_mon+1,today->tm_mday,
 			today->tm_hour,today->tm_min,today->tm_sec);
 		char cmdMkdir[200];
 		sprintf(cmdMkdir,"mkdir %s",surveyDir);
@@ -951,44 +1521,80 @@ int main(int argc, char* argv[])
 		}
 		catch(char *e){
 			sprintf(surveyDir,"Survey");
-			if( mkdir(surveyDir) != 0){
+			if(!MakeDirectory(surveyDir)){
 				printf("TRY2: Survey Directory Not created");}
 		}
-		
-		/*
-		TODO Remove control C Handler not required for our scenario
-		*/
-		SetConsoleCtrlHandler(&CtrlCHandler, TRUE);
+		// shared by the cameras, the bring-up only creates the directory of its camera
+		char previewerDir[100];
+		sprintf(previewerDir,"%s" PATH_SEP "Previewer",surveyDir);
+		MakeDirectory(previewerDir);
 
 		/*
-		WaitForCamera Thread - Wait for a camera to be plugged using event registering
+		The link events of the cameras are handled by the control loop, until CTRL-C
 		*/
-		ThWaitForCamera = CreateThread(NULL,NULL,WaitForCamera,tCamInstance1,NULL,&waitForCameraID);
-		//WaitForSingleObject(ThWaitForCamera,INFINITE);
-
-		/*
-		Wait Untill either of the cameras are setup
-		*/
-		while(!GCamera1.readyToCapture && !GCamera2.readyToCapture);		
+		tPvErr errorCode = PvLinkCallbackRegister(CameraEventCB,ePvLinkAdd,NULL);
+		convertandPrintErrorCode(errorCode);
+		errorCode = PvLinkCallbackRegister(CameraEventCB,ePvLinkRemove,NULL);
+		convertandPrintErrorCode(errorCode);
+		printf("waiting for a camera ...\n");
 
-		if(GCamera1.UID) //TODO
-		{
-			SpawnThread(&GCamera1); //TODO
-		}
-		if(GCamera2.UID) //TODO
+		if(cpuReportSeconds)
 		{
-			SpawnThread(&GCamera2); //TODO
+			cpuReportAt = GetMicroseconds();
+			cpuReportUsed = ProcessCpuMicroseconds();
+			ControlLoopPostAfter(eControlTimer,0,cpuReportSeconds * 1000);
 		}
+		ControlLoopRun(ControlHandler,NULL);
+		// no trigger may reach a camera being stopped
+		RingTriggerListenerStop();
+
+		PvLinkCallbackUnRegister(CameraEventCB,ePvLinkAdd);
+		PvLinkCallbackUnRegister(CameraEventCB,ePvLinkRemove);
 
-		if(ThWaitForCamera)
+		/*
+		Then stop the tasks and the cameras still plugged, brought up or not
+		*/
+		for(unsigned long i=0;i<CameraRegistryCount();i++)
 		{
-			WaitForSingleObject(ThWaitForCamera,INFINITE);
-			//WaitForSingleObject(ThHandle1,INFINITE);
+			tCamInstance = CameraRegistryGet(i);
+			CameraBringupCancel(tCamInstance);
+			CameraMonitorStop(tCamInstance);
+			if(tCamInstance->Bringup.State != eBringupIdle && !tCamInstance->isUnplugged)
+			{
+				CameraStop(tCamInstance);
+				CameraUnsetup(tCamInstance);
+			}
+			else
+				FrameArenaDestroy(&(tCamInstance->Arena),tCamInstance->Frames);	// kept for a reconnect
+			if(tCamInstance->Reconnect.Count)
+				printf("camera %lu : %lu reconnect(s), gap %.1f ms on average, %.1f ms at most\n",tCamInstance->UID,
+					tCamInstance->Reconnect.Count,tCamInstance->Reconnect.TotalGap / tCamInstance->Reconnect.Count,
+					tCamInstance->Reconnect.MaxGap);
 		}
 
 		PvUnInitialize();
 	}
+	if(TimerWheelRunning())
+	{
+		tWheelStats wheel;
+		TimerWheelSnapshot(&wheel);
+		printf("timer wheel : %lu wake-ups, %lu task(s) run, %.1f per tick with a timer due\n",wheel.Wakeups,wheel.Runs,
+			wheel.Ticks ? (double)wheel.Runs / (double)wheel.Ticks : 0.0);
+	}
+	TimerWheelStop();
+	// already stopped unless PvInitialize() failed, it posts to the control loop
+	RingTriggerListenerStop();
+	ControlLoopDestroy();
+	CameraRegistryDestroy();
 
+	if(WorkPoolRunning())
+	{
+		tWorkStats pool[WORKPOOL_MAX_THREADS + 1];
+		WorkPoolSnapshot(pool);
+		printf("work pool since the start\n");
+		WorkPoolReport(NULL,pool);
+	}
+	WorkPoolStop();
 
 	return 0;
 }
@@ -0,0 +1,286 @@
+/*!
+ *  @file
+ *     MetadataLog.cpp
+ *  @brief
+ *     OTC project: Per-frame metadata log. Appending a record only fills the
+ *	   columns of the block in memory, the disk sees one write per block
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "MetadataLog.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WINDOWS
+#define METADATA_U64	"%I64u"
+#else
+#define METADATA_U64	"%llu"
+#endif
+
+
+/*!
+ * @brief
+ *		Open the log of a camera, the records go after the ones of a previous run
+ * @param
+ *		log
+ * @param
+ *		directory of the camera
+ * @param
+ *		UID of the camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraEventCB()
+ * @return
+ *		bool
+ */
+bool MetadataLogOpen(tMetadataLog *pLog,const char *Directory,unsigned long UID)
+{
+	char filename[160];
+	tMetadataFileHeader header;
+	FILE *pExisting;
+
+	memset(pLog,0,sizeof(tMetadataLog));
+	sprintf(filename,"%s/metadata.avm",Directory);
+
+	// the blocks of an older log do not have the same columns
+	pExisting = fopen(filename,"rb");
+	if(pExisting)
+	{
+		if(fread(&header,sizeof(header),1,pExisting) == 1 && header.Columns != METADATA_COLUMNS)
+		{
+			printf("Error in %s:%d at MetadataLogOpen() ----> %s has %u columns, %d expected\n", __FILE__, __LINE__,
+				filename, header.Columns, METADATA_COLUMNS);
+			fclose(pExisting);
+			return false;
+		}
+		fclose(pExisting);
+	}
+
+	pLog->pFile = fopen(filename,"ab");
+	if(!pLog->pFile)
+	{
+		printf("Error in %s:%d at MetadataLogOpen() ----> could not open %s\n", __FILE__, __LINE__, filename);
+		return false;
+	}
+
+	fseek(pLog->pFile,0,SEEK_END);
+	if(!ftell(pLog->pFile))
+	{
+		memset(&header,0,sizeof(header));
+		memcpy(header.Magic,METADATA_MAGIC,sizeof(header.Magic));
+		header.Version = METADATA_VERSION;
+		header.HeaderSize = sizeof(tMetadataFileHeader);
+		header.CameraUID = UID;
+		header.Columns = METADATA_COLUMNS;
+		header.BlockRecords = METADATA_BLOCK_RECORDS;
+		if(fwrite(&header,sizeof(header),1,pLog->pFile) != 1)
+			printf("Error in %s:%d at MetadataLogOpen() ----> could not write the header of %s\n", __FILE__, __LINE__, filename);
+	}
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Add the record of a frame. Only touches memory, unless the block is full
+ *		or its first record is older than METADATA_FLUSH_SECONDS
+ * @param
+ *		log
+ * @param
+ *		record
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameSave()
+ * @return
+ *		void
+ */
+void MetadataLogAppend(tMetadataLog *pLog,const tMetadataRecord *pRecord)
+{
+	unsigned long i = pLog->Count;
+	unsigned long long now = GetMicroseconds();
+
+	if(!pLog->pFile)
+		return;
+
+	if(!i)
+		pLog->FirstAt = now;
+
+	pLog->Timestamp[i] = pRecord->Timestamp;
+	pLog->UID[i] = pRecord->UID;
+	pLog->FrameCount[i] = pRecord->FrameCount;
+	pLog->Status[i] = pRecord->Status;
+	pLog->Exposure[i] = pRecord->Exposure;
+	pLog->Gain[i] = pRecord->Gain;
+	pLog->WhitebalRed[i] = pRecord->WhitebalRed;
+	pLog->WhitebalBlue[i] = pRecord->WhitebalBlue;
+	pLog->QueueLatency[i] = pRecord->QueueLatency;
+	pLog->AcquisitionCount[i] = pRecord->AcquisitionCount;
+	pLog->Count++;
+	pLog->Records++;
+
+	if(pLog->Count == METADATA_BLOCK_RECORDS || now - pLog->FirstAt >= METADATA_FLUSH_SECONDS * 1000000ULL)
+		MetadataLogFlush(pLog);
+}
+
+/*!
+ * @brief
+ *		Write the block being filled, column by column
+ * @param
+ *		log
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if the block could not be written, its records are lost
+ */
+bool MetadataLogFlush(tMetadataLog *pLog)
+{
+	tMetadataBlockHeader header;
+	unsigned long count = pLog->Count;
+	bool success;
+
+	if(!pLog->pFile || !count)
+		return true;
+
+	header.Magic = METADATA_BLOCK_MAGIC;
+	header.Count = count;
+	success = fwrite(&header,sizeof(header),1,pLog->pFile) == 1 &&
+		fwrite(pLog->Timestamp,sizeof(pLog->Timestamp[0]),count,pLog->pFile) == count &&
+		fwrite(pLog->UID,sizeof(pLog->UID[0]),count,pLog->pFile) == count &&
+		fwrite(pLog->FrameCount,sizeof(pLog->FrameCount[0]),count,pLog->pFile) == count &&
+		fwrite(pLog->Status,sizeof(pLog->Status[0]),count,pLog->pFile) == count &&
+		fwrite(pLog->Exposure,sizeof(pLog->Exposure[0]),count,pLog->pFile) == count &&
+		fwrite(pLog->Gain,sizeof(pLog->Gain[0]),count,pLog->pFile) == count &&
+		fwrite(pLog->WhitebalRed,sizeof(pLog->WhitebalRed[0]),count,pLog->pFile) == count &&
+		fwrite(pLog->WhitebalBlue,sizeof(pLog->WhitebalBlue[0]),count,pLog->pFile) == count &&
+		fwrite(pLog->QueueLatency,sizeof(pLog->QueueLatency[0]),count,pLog->pFile) == count &&
+		fwrite(pLog->AcquisitionCount,sizeof(pLog->AcquisitionCount[0]),count,pLog->pFile) == count &&
+		!fflush(pLog->pFile);
+
+	pLog->Count = 0;
+	if(!success)
+	{
+		printf("Error in %s:%d at MetadataLogFlush() ----> could not write %lu records\n", __FILE__, __LINE__, count);
+		return false;
+	}
+	pLog->Blocks++;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Write what is left and close the log. The writer of the camera must be stopped
+ * @param
+ *		log
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraUnsetup()
+ * @return
+ *		void
+ */
+void MetadataLogClose(tMetadataLog *pLog)
+{
+	if(!pLog->pFile)
+		return;
+
+	MetadataLogFlush(pLog);
+	fclose(pLog->pFile);
+	pLog->pFile = NULL;
+}
+
+/*!
+ * @brief
+ *		Convert a metadata log to CSV, one line per frame
+ * @param
+ *		metadata.avm file
+ * @param
+ *		CSV file to create, NULL for the standard output
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if the log could not be read or is damaged
+ */
+bool MetadataLogExport(const char *LogFile,const char *CsvFile)
+{
+	tMetadataFileHeader header;
+	tMetadataBlockHeader block;
+	tMetadataLog *pColumns;
+	FILE *pIn,*pOut;
+	unsigned long i,count,records = 0;
+	bool success = true;
+
+	pIn = fopen(LogFile,"rb");
+	if(!pIn)
+	{
+		printf("Error in %s:%d at MetadataLogExport() ----> could not open %s\n", __FILE__, __LINE__, LogFile);
+		return false;
+	}
+
+	if(fread(&header,sizeof(header),1,pIn) != 1 || memcmp(header.Magic,METADATA_MAGIC,sizeof(header.Magic)) ||
+		(header.Columns != METADATA_COLUMNS && header.Columns != METADATA_COLUMNS_V1) ||
+		header.BlockRecords > METADATA_BLOCK_RECORDS ||
+		fseek(pIn,header.HeaderSize,SEEK_SET))
+	{
+		printf("Error in %s:%d at MetadataLogExport() ----> %s is not a metadata log\n", __FILE__, __LINE__, LogFile);
+		fclose(pIn);
+		return false;
+	}
+
+	pOut = CsvFile ? fopen(CsvFile,"w") : stdout;
+	pColumns = (tMetadataLog*)malloc(sizeof(tMetadataLog));
+	if(!pOut || !pColumns)
+	{
+		printf("Error in %s:%d at MetadataLogExport() ----> could not create %s\n", __FILE__, __LINE__, CsvFile);
+		if(pOut && pOut != stdout)
+			fclose(pOut);
+		free(pColumns);
+		fclose(pIn);
+		return false;
+	}
+
+	memset(pColumns->AcquisitionCount,0,sizeof(pColumns->AcquisitionCount));
+	fprintf(pOut,"UID,Frame,Timestamp,Status,Exposure,Gain,WhitebalRed,WhitebalBlue,QueueLatencyUs,AcquisitionCount\n");
+	while(fread(&block,sizeof(block),1,pIn) == 1)
+	{
+		count = block.Count;
+		if(block.Magic != METADATA_BLOCK_MAGIC || !count || count > header.BlockRecords ||
+			fread(pColumns->Timestamp,sizeof(pColumns->Timestamp[0]),count,pIn) != count ||
+			fread(pColumns->UID,sizeof(pColumns->UID[0]),count,pIn) != count ||
+			fread(pColumns->FrameCount,sizeof(pColumns->FrameCount[0]),count,pIn) != count ||
+			fread(pColumns->Status,sizeof(pColumns->Status[0]),count,pIn) != count ||
+			fread(pColumns->Exposure,sizeof(pColumns->Exposure[0]),count,pIn) != count ||
+			fread(pColumns->Gain,sizeof(pColumns->Gain[0]),count,pIn) != count ||
+			fread(pColumns->WhitebalRed,sizeof(pColumns->WhitebalRed[0]),count,pIn) != count ||
+			fread(pColumns->WhitebalBlue,sizeof(pColumns->WhitebalBlue[0]),count,pIn) != count ||
+			fread(pColumns->QueueLatency,sizeof(pColumns->QueueLatency[0]),count,pIn) != count ||
+			(header.Columns == METADATA_COLUMNS &&
+			fread(pColumns->AcquisitionCount,sizeof(pColumns->AcquisitionCount[0]),count,pIn) != count))
+		{
+			printf("Error in %s:%d at MetadataLogExport() ----> damaged block after %lu records\n", __FILE__, __LINE__, records);
+			success = false;
+			break;
+		}
+
+		for(i=0;i<count;i++)
+			fprintf(pOut,"%u,%u," METADATA_U64 ",%u,%u,%u,%u,%u,%u,%u\n",pColumns->UID[i],pColumns->FrameCount[i],
+				pColumns->Timestamp[i],pColumns->Status[i],pColumns->Exposure[i],pColumns->Gain[i],
+				pColumns->WhitebalRed[i],pColumns->WhitebalBlue[i],pColumns->QueueLatency[i],pColumns->AcquisitionCount[i]);
+		records += count;
+	}
+
+	if(pOut != stdout)
+	{
+		fclose(pOut);
+		printf("%lu records exported to %s\n",records,CsvFile);
+	}
+	free(pColumns);
+	fclose(pIn);
+
+	return success;
+}
@@ -0,0 +1,1770 @@
+/*!
+ *  @file
+ *     PvSimulator.cpp
+ *  @brief
+ *     OTC project: Simulated PvAPI backend. Every virtual camera has a streamer
+ *	   thread that completes the queued frames at the frame rate, a world thread
+ *	   plugs and unplugs the cameras and calls the link callbacks, the way the
+ *	   PvAPI threads do
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "PvSimulator.h"
+#include "PvRegIo.h"
+#include "ChunkData.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_WORLD_PERIOD		50			// milliseconds between two checks of the plug states
+#define SIM_WAIT_SLICE			10			// milliseconds, PvCaptureWaitForFrameDone() looks at the queue this often
+#define SIM_AUTO_PERIOD			1000000		// microseconds between two steps of the auto modes
+#define SIM_EXPOSURE_MIN		100
+#define SIM_GAIN_MAX			22
+#define SIM_WHITEBAL_MIN		80
+#define SIM_WHITEBAL_MAX		300
+#define SIM_PACKET_OVERHEAD		36			// bytes of the GVSP headers in a packet
+
+#define SIM_EVENT_ACQ_START		40000
+#define SIM_EVENT_ACQ_END		40001
+#define SIM_EVENT_EXPOSURE_END	40003
+
+typedef enum
+{
+	eSimTriggerFreerun,
+	eSimTriggerSyncIn1,
+	eSimTriggerSyncIn2,
+	eSimTriggerFixedRate,
+	eSimTriggerSoftware,
+	eSimTriggerCount
+
+} tSimTriggerMode;
+
+static const char *gSimTriggerModes[eSimTriggerCount] = { "Freerun", "SyncIn1", "SyncIn2", "FixedRate", "Software" };
+
+static const char *gSimFormats[] =
+{
+	"Mono8", "Mono16", "Bayer8", "Bayer16", "Rgb24", "Rgb48", "Yuv411", "Yuv422",
+	"Yuv444", "Bgr24", "Rgba32", "Bgra32", "Mono12Packed", "Bayer12Packed"
+};
+#define SIM_FORMAT_COUNT		(sizeof(gSimFormats) / sizeof(gSimFormats[0]))
+
+/*
+	Attributes of a virtual camera, anything else is ePvErrNotFound
+*/
+typedef struct
+{
+	const char			*Name;
+	tPvDatatype			Type;
+	bool				Writable;
+
+} tSimAttribute;
+
+static const tSimAttribute gSimAttributes[] =
+{
+	{ "AcquisitionMode",		ePvDatatypeEnum,	true },
+	{ "ChunkModeActive",		ePvDatatypeBoolean,	true },
+	{ "EventNotification",		ePvDatatypeEnum,	true },
+	{ "EventsEnable1",			ePvDatatypeUint32,	true },
+	{ "ExposureAutoMax",		ePvDatatypeUint32,	true },
+	{ "ExposureMode",			ePvDatatypeEnum,	true },
+	{ "ExposureValue",			ePvDatatypeUint32,	true },
+	{ "FrameRate",				ePvDatatypeFloat32,	true },
+	{ "FrameStartTriggerMode",	ePvDatatypeEnum,	true },
+	{ "GainMode",				ePvDatatypeEnum,	true },
+	{ "GainValue",				ePvDatatypeUint32,	true },
+	{ "Height",					ePvDatatypeUint32,	true },
+	{ "NonImagePayloadSize",	ePvDatatypeUint32,	false },
+	{ "PacketSize",				ePvDatatypeUint32,	true },
+	{ "PixelFormat",			ePvDatatypeEnum,	true },
+	{ "StatFrameRate",			ePvDatatypeFloat32,	false },
+	{ "StatFramesCompleted",	ePvDatatypeUint32,	false },
+	{ "StatFramesDropped",		ePvDatatypeUint32,	false },
+	{ "StatPacketsErroneous",	ePvDatatypeUint32,	false },
+	{ "StatPacketsMissed",		ePvDatatypeUint32,	false },
+	{ "StatPacketsReceived",	ePvDatatypeUint32,	false },
+	{ "StreamBytesPerSecond",	ePvDatatypeUint32,	true },
+	{ "TimeStampFrequency",		ePvDatatypeUint32,	false },
+	{ "TotalBytesPerFrame",		ePvDatatypeUint32,	false },
+	{ "UniqueId",				ePvDatatypeUint32,	false },
+	{ "WhitebalMode",			ePvDatatypeEnum,	true },
+	{ "WhitebalValueBlue",		ePvDatatypeUint32,	true },
+	{ "WhitebalValueRed",		ePvDatatypeUint32,	true },
+	{ "Width",					ePvDatatypeUint32,	true },
+	{ "AcquisitionAbort",		ePvDatatypeCommand,	true },
+	{ "AcquisitionStart",		ePvDatatypeCommand,	true },
+	{ "AcquisitionStop",		ePvDatatypeCommand,	true },
+	{ "FrameStartTriggerSoftware",ePvDatatypeCommand,true },
+	{ "TimeStampReset",			ePvDatatypeCommand,	true }
+};
+#define SIM_ATTRIBUTE_COUNT		(sizeof(gSimAttributes) / sizeof(gSimAttributes[0]))
+
+typedef struct
+{
+	tPvFrame			*pFrame;
+	tPvFrameCallback	Callback;
+
+} tSimQueued;
+
+/*!
+ * @brief
+ *		One virtual camera: plug state, frame queue, streamer and attributes
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned long		UID;
+
+	/*
+	Plug state, changed by the world thread only
+	*/
+	volatile bool		Discovered;
+	volatile bool		Plugged;
+	volatile bool		UnplugRequest;
+	volatile bool		PlugRequest;
+	unsigned long long	UnplugAt;			// 0 never
+	unsigned long long	UnpluggedAt;
+	volatile bool		Open;
+
+	/*
+	Capture: Lock protects the queue and InFlight
+	*/
+	tLock				Lock;
+	tEvent				Wake;				// streamer
+	tEvent				Done;				// a frame was completed
+	tThread				Thread;
+	bool				Capturing;
+	volatile bool		Stop;
+	volatile bool		Acquiring;
+	volatile bool		Delivering;			// the streamer is between the pop and the end of the callback
+	volatile long		SoftTriggers;
+	tSimQueued			Queue[SIM_QUEUE_SIZE];
+	unsigned long		QueueHead;
+	unsigned long		QueueCount;
+	tPvFrame			*InFlight;
+	unsigned char		*Pattern;			// two frames of synthetic image, the frames are windows on it
+	unsigned long		PatternSize;
+	unsigned long		Random;
+
+	/*
+	Attributes
+	*/
+	tPvImageFormat		Format;
+	unsigned long		Width;
+	unsigned long		Height;
+	volatile float		FrameRate;
+	volatile unsigned long	TriggerMode;
+	volatile unsigned long	Exposure;
+	volatile unsigned long	Gain;
+	volatile unsigned long	WhitebalRed;
+	volatile unsigned long	WhitebalBlue;
+	unsigned long		ExposureAutoMax;
+	unsigned long		EventsEnable1;
+	unsigned long		PacketSize;
+	unsigned long		StreamBytesPerSecond;
+	bool				ExposureAuto;
+	bool				GainAuto;
+	bool				WhitebalAuto;
+	bool				EventNotification;
+	bool				ChunkMode;
+	unsigned long long	TimeStampBase;
+	unsigned long long	AutoAt;
+	tPvCameraEventCallback	EventCallback;
+	void				*EventContext;
+
+	/*
+	Statistics
+	*/
+	unsigned long		AcquisitionCount;
+	unsigned long		FramesCompleted;
+	unsigned long		FramesDropped;
+	unsigned long		PacketsMissed;
+	unsigned long		PacketsErroneous;
+	unsigned long		PacketsReceived;
+	float				StatFrameRate;
+	unsigned long long	RateAt;
+	unsigned long		RateFrames;
+
+} tSimCamera;
+
+typedef struct
+{
+	tPvLinkCallback		Callback;
+	tPvLinkEvent		Event;
+	void				*Context;
+
+} tSimLink;
+
+/*!
+ * @brief
+ *		The simulated PvAPI: configuration, link callbacks, world thread and cameras
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	tPvSimConfig		Config;
+	bool				Configured;
+	bool				Initialized;
+	tLock				Lock;				// link callbacks
+	tSimLink			Links[SIM_MAX_CALLBACKS];
+	tEvent				Wake;
+	tThread				Thread;
+	volatile bool		Stop;
+	unsigned long long	StartedAt;
+	tSimCamera			Cameras[SIM_MAX_CAMERAS];
+
+} tSimulator;
+
+static tSimulator gSim;
+
+
+//===== HELPERS ===============================================================
+
+static unsigned long SimRandom(tSimCamera *pCam)
+{
+	unsigned long x = pCam->Random;
+
+	// xorshift32, the camera index in the seed keeps the cameras apart
+	x ^= (x << 13) & 0xFFFFFFFF;
+	x ^= x >> 17;
+	x ^= (x << 5) & 0xFFFFFFFF;
+	pCam->Random = x;
+
+	return x;
+}
+
+static bool SimChance(tSimCamera *pCam,double Rate)
+{
+	return Rate > 0.0 && (double)(SimRandom(pCam) % 1000000) < Rate * 1000000.0;
+}
+
+/*
+	Bytes of one frame, 0 for a format the simulator does not know
+*/
+static unsigned long SimFrameBytes(tPvImageFormat Format,unsigned long Width,unsigned long Height)
+{
+	unsigned long pixels = Width * Height;
+
+	switch(Format)
+	{
+	case ePvFmtMono8:
+	case ePvFmtBayer8:
+		return pixels;
+	case ePvFmtMono16:
+	case ePvFmtBayer16:
+	case ePvFmtYuv422:
+		return pixels * 2;
+	case ePvFmtRgb24:
+	case ePvFmtBgr24:
+	case ePvFmtYuv444:
+		return pixels * 3;
+	case ePvFmtRgb48:
+		return pixels * 6;
+	case ePvFmtRgba32:
+	case ePvFmtBgra32:
+		return pixels * 4;
+	case ePvFmtYuv411:
+	case ePvFmtMono12Packed:
+	case ePvFmtBayer12Packed:
+		return pixels * 3 / 2;
+	default:
+		return 0;
+	}
+}
+
+static bool SimSixteenBits(tPvImageFormat Format)
+{
+	return Format == ePvFmtMono16 || Format == ePvFmtBayer16 || Format == ePvFmtRgb48;
+}
+
+static bool SimFormatParse(const char *Name,tPvImageFormat *pFormat)
+{
+	unsigned long i;
+
+	for(i=0;i<SIM_FORMAT_COUNT;i++)
+		if(!strcmp(Name,gSimFormats[i]))
+		{
+			*pFormat = (tPvImageFormat)i;
+			return true;
+		}
+
+	return false;
+}
+
+static const tSimAttribute *SimAttribute(const char *Name)
+{
+	unsigned long i;
+
+	for(i=0;i<SIM_ATTRIBUTE_COUNT;i++)
+		if(!strcmp(Name,gSimAttributes[i].Name))
+			return &gSimAttributes[i];
+
+	return NULL;
+}
+
+/*
+	Round trip of a control transaction, the calling thread waits for the camera
+*/
+static void SimControl()
+{
+	if(gSim.Config.Control)
+		Sleep(gSim.Config.Control);
+}
+
+/*
+	Attribute lookup of the accessors: the camera must be open and plugged, the attribute of that type
+*/
+static tPvErr SimAttributeCheck(tPvHandle Camera,const char *Name,tPvDatatype Type,bool Write,tSimCamera **ppCam)
+{
+	tSimCamera *pCam = (tSimCamera*)Camera;
+	const tSimAttribute *pAttribute;
+
+	if(!gSim.Initialized || pCam < gSim.Cameras || pCam >= gSim.Cameras + gSim.Config.Cameras || !pCam->Open)
+		return ePvErrBadHandle;
+	if(!pCam->Plugged)
+		return ePvErrUnplugged;
+
+	SimControl();
+	pAttribute = SimAttribute(Name);
+	if(!pAttribute)
+		return ePvErrNotFound;
+	if(pAttribute->Type != Type)
+		return ePvErrWrongType;
+	if(Write && !pAttribute->Writable)
+		return ePvErrForbidden;
+
+	*ppCam = pCam;
+	return ePvErrSuccess;
+}
+
+/*
+	Open camera of a handle, plugged or not
+*/
+static tSimCamera *SimCamera(tPvHandle Camera)
+{
+	tSimCamera *pCam = (tSimCamera*)Camera;
+
+	if(!gSim.Initialized || pCam < gSim.Cameras || pCam >= gSim.Cameras + gSim.Config.Cameras || !pCam->Open)
+		return NULL;
+
+	return pCam;
+}
+
+static float SimFrameRate(const tSimCamera *pCam)
+{
+	return gSim.Config.FrameRate > 0.0f ? gSim.Config.FrameRate : pCam->FrameRate;
+}
+
+/*
+	Synthetic image: gradient plus a little noise, so that the codecs see
+	something close to a real scene. Twice the frame, every frame starts one
+	line further
+*/
+static bool SimPatternBuild(tSimCamera *pCam)
+{
+	unsigned long size = SimFrameBytes(pCam->Format,pCam->Width,pCam->Height);
+	unsigned long lineBytes = size / pCam->Height;
+	unsigned long x,y;
+	unsigned short *pLine16;
+	unsigned char *pLine;
+
+	free(pCam->Pattern);
+	pCam->Pattern = (unsigned char*)malloc(size * 2);
+	if(!pCam->Pattern)
+	{
+		pCam->PatternSize = 0;
+		return false;
+	}
+	pCam->PatternSize = size * 2;
+
+	for(y=0;y<pCam->Height*2;y++)
+	{
+		pLine = pCam->Pattern + y * lineBytes;
+		if(SimSixteenBits(pCam->Format))
+		{
+			pLine16 = (unsigned short*)pLine;
+			for(x=0;x<lineBytes/2;x++)
+				pLine16[x] = (unsigned short)(((x + y) * 2 + (SimRandom(pCam) & 15)) & 0x0FFF);
+		}
+		else
+		{
+			for(x=0;x<lineBytes;x++)
+				pLine[x] = (unsigned char)(((x + y * 2) / 4 + (SimRandom(pCam) & 3)) & 0xFF);
+		}
+	}
+
+	return true;
+}
+
+static void SimCameraEvent(tSimCamera *pCam,unsigned long EventId)
+{
+	tPvCameraEvent event;
+	unsigned long long stamp;
+	tPvCameraEventCallback callback = pCam->EventCallback;
+
+	if(!callback || !pCam->EventNotification || !(pCam->EventsEnable1 & (1 << (EventId - SIM_EVENT_ACQ_START))))
+		return;
+
+	stamp = GetMicroseconds() - pCam->TimeStampBase;
+	memset(&event,0,sizeof(event));
+	event.EventId = EventId;
+	event.TimestampLo = (unsigned long)(stamp & 0xFFFFFFFF);
+	event.TimestampHi = (unsigned long)(stamp >> 32);
+	callback(pCam->EventContext,(tPvHandle)pCam,&event,1);
+}
+
+static void SimLinkEvent(tPvLinkEvent Event,unsigned long UID)
+{
+	tSimLink links[SIM_MAX_CALLBACKS];
+	unsigned long i;
+
+	// called without the lock, a callback may register or unregister
+	LockAcquire(&(gSim.Lock));
+	memcpy(links,gSim.Links,sizeof(links));
+	LockRelease(&(gSim.Lock));
+
+	for(i=0;i<SIM_MAX_CALLBACKS;i++)
+		if(links[i].Callback && links[i].Event == Event)
+			links[i].Callback(links[i].Context,ePvInterfaceEthernet,Event,UID);
+}
+
+/*
+	One step up or down, within Min and Max
+*/
+static unsigned long SimWalk(tSimCamera *pCam,unsigned long Value,unsigned long Min,unsigned long Max)
+{
+	if(SimRandom(pCam) & 1)
+		return Value < Max ? Value + 1 : Max;
+
+	return Value > Min ? Value - 1 : Min;
+}
+
+/*
+	Auto exposure, gain and white balance take a small random step every SIM_AUTO_PERIOD
+*/
+static void SimAutoStep(tSimCamera *pCam,unsigned long long Now)
+{
+	unsigned long step;
+
+	if(Now < pCam->AutoAt)
+		return;
+	pCam->AutoAt = Now + SIM_AUTO_PERIOD;
+
+	if(pCam->ExposureAuto)
+	{
+		step = pCam->Exposure / 20 + 1;
+		if(SimRandom(pCam) & 1)
+			pCam->Exposure = pCam->Exposure + step > pCam->ExposureAutoMax ? pCam->ExposureAutoMax : pCam->Exposure + step;
+		else
+			pCam->Exposure = pCam->Exposure < SIM_EXPOSURE_MIN + step ? SIM_EXPOSURE_MIN : pCam->Exposure - step;
+	}
+	if(pCam->GainAuto)
+	{
+		pCam->Gain = SimWalk(pCam,pCam->Gain,0,SIM_GAIN_MAX);
+	}
+	if(pCam->WhitebalAuto)
+	{
+		pCam->WhitebalRed = SimWalk(pCam,pCam->WhitebalRed,SIM_WHITEBAL_MIN,SIM_WHITEBAL_MAX);
+		pCam->WhitebalBlue = SimWalk(pCam,pCam->WhitebalBlue,SIM_WHITEBAL_MIN,SIM_WHITEBAL_MAX);
+	}
+}
+
+static void SimPut32(unsigned char *p,unsigned long Value)
+{
+	p[0] = (unsigned char)(Value >> 24);
+	p[1] = (unsigned char)(Value >> 16);
+	p[2] = (unsigned char)(Value >> 8);
+	p[3] = (unsigned char)Value;
+}
+
+/*
+	Fill a frame the way the driver does: image, chunk trailer, counters, status
+*/
+static void SimFill(tSimCamera *pCam,tPvFrame *pFrame,unsigned long Count,unsigned long long Now)
+{
+	unsigned long size = SimFrameBytes(pCam->Format,pCam->Width,pCam->Height);
+	unsigned long lineBytes = size / pCam->Height;
+	unsigned long packets = size / (pCam->PacketSize - SIM_PACKET_OVERHEAD) + 1;
+	unsigned long long stamp = Now - pCam->TimeStampBase;
+	unsigned long first,lines;
+	unsigned char *pChunk;
+
+	pFrame->Width = pCam->Width;
+	pFrame->Height = pCam->Height;
+	pFrame->RegionX = 0;
+	pFrame->RegionY = 0;
+	pFrame->Format = pCam->Format;
+	pFrame->BitDepth = SimSixteenBits(pCam->Format) || pCam->Format == ePvFmtMono12Packed || pCam->Format == ePvFmtBayer12Packed ? 12 : 8;
+	pFrame->BayerPattern = ePvBayerRGGB;
+	pFrame->FrameCount = Count & 0xFFFF;
+	pFrame->TimestampLo = (unsigned long)(stamp & 0xFFFFFFFF);
+	pFrame->TimestampHi = (unsigned long)(stamp >> 32);
+	pFrame->ImageSize = 0;
+	pFrame->AncillarySize = 0;
+
+	if(pFrame->ImageBufferSize < size)
+	{
+		pFrame->Status = ePvErrBufferTooSmall;
+		return;
+	}
+	if(SimChance(pCam,gSim.Config.LossRate))
+	{
+		pFrame->Status = ePvErrDataLost;
+		pCam->PacketsMissed += packets;
+		return;
+	}
+
+	memcpy(pFrame->ImageBuffer,pCam->Pattern + (Count % pCam->Height) * lineBytes,size);
+	pFrame->ImageSize = size;
+	pFrame->Status = ePvErrSuccess;
+	pCam->PacketsReceived += packets;
+
+	// a burst of missing packets leaves a black band
+	if(SimChance(pCam,gSim.Config.MissingRate))
+	{
+		lines = pCam->Height / 16 + 1;
+		first = SimRandom(pCam) % (pCam->Height - lines + 1);
+		memset((unsigned char*)pFrame->ImageBuffer + first * lineBytes,0,lines * lineBytes);
+		pCam->PacketsMissed += lines * lineBytes / (pCam->PacketSize - SIM_PACKET_OVERHEAD) + 1;
+		pCam->PacketsReceived -= lines * lineBytes / (pCam->PacketSize - SIM_PACKET_OVERHEAD);
+		pFrame->Status = ePvErrDataMissing;
+	}
+
+	// big endian as sent by the camera, see ChunkData.h
+	if(pCam->ChunkMode && pFrame->AncillaryBuffer && pFrame->AncillaryBufferSize >= CHUNK_SIZE)
+	{
+		pChunk = (unsigned char*)pFrame->AncillaryBuffer;
+		memset(pChunk,0,CHUNK_SIZE);
+		SimPut32(pChunk,Count);
+		SimPut32(pChunk + 8,pCam->Exposure);
+		SimPut32(pChunk + 12,pCam->Gain);
+		SimPut32(pChunk + 40,CHUNK_ID);
+		SimPut32(pChunk + 44,CHUNK_SIZE - 8);
+		pFrame->AncillarySize = CHUNK_SIZE;
+	}
+
+	pCam->FramesCompleted++;
+}
+
+/*
+	One frame time: complete the frame at the head of the queue, or count a
+	dropped frame when the application did not queue any
+*/
+static void SimDeliver(tSimCamera *pCam)
+{
+	tSimQueued done;
+	unsigned long long now = GetMicroseconds();
+	unsigned long count = pCam->AcquisitionCount++;
+
+	pCam->RateFrames++;
+	if(now - pCam->RateAt >= 1000000)
+	{
+		pCam->StatFrameRate = (float)((double)pCam->RateFrames * 1000000.0 / (double)(now - pCam->RateAt));
+		pCam->RateFrames = 0;
+		pCam->RateAt = now;
+	}
+	SimAutoStep(pCam,now);
+
+	LockAcquire(&(pCam->Lock));
+	if(!pCam->QueueCount)
+	{
+		LockRelease(&(pCam->Lock));
+		pCam->FramesDropped++;
+		return;
+	}
+	done = pCam->Queue[pCam->QueueHead];
+	pCam->QueueHead = (pCam->QueueHead + 1) % SIM_QUEUE_SIZE;
+	pCam->QueueCount--;
+	pCam->InFlight = done.pFrame;
+	pCam->Delivering = true;
+	LockRelease(&(pCam->Lock));
+
+	SimFill(pCam,done.pFrame,count,now);
+
+	LockAcquire(&(pCam->Lock));
+	pCam->InFlight = NULL;
+	LockRelease(&(pCam->Lock));
+	EventSignal(&(pCam->Done));
+
+	SimCameraEvent(pCam,SIM_EVENT_EXPOSURE_END);
+	if(done.Callback)
+		done.Callback(done.pFrame);
+	pCam->Delivering = false;
+}
+
+/*
+	Random offset of the next frame, -Jitter to +Jitter milliseconds in microseconds
+*/
+static long long SimJitter(tSimCamera *pCam)
+{
+	unsigned long range = gSim.Config.Jitter * 1000;
+
+	if(!range)
+		return 0;
+
+	return (long long)(SimRandom(pCam) % (2 * range + 1)) - (long long)range;
+}
+
+static THREADPROC SimCameraThread(void *pContext)
+{
+	tSimCamera *pCam = (tSimCamera*)pContext;
+	unsigned long long now,due,next = 0;
+	long long jitter = 0;
+	unsigned long long period;
+
+	while(!pCam->Stop)
+	{
+		if(!pCam->Acquiring || !pCam->Plugged)
+		{
+			EventWait(&(pCam->Wake),EVENT_INFINITE);
+			next = 0;
+			continue;
+		}
+
+		if(pCam->TriggerMode == eSimTriggerSoftware)
+		{
+			if(pCam->SoftTriggers > 0)
+			{
+				AtomicDecrement(&(pCam->SoftTriggers));
+				SimDeliver(pCam);
+			}
+			else
+				EventWait(&(pCam->Wake),EVENT_INFINITE);
+			next = 0;
+			continue;
+		}
+
+		// the schedule does not drift, only each frame is early or late
+		period = (unsigned long long)(1000000.0 / SimFrameRate(pCam));
+		now = GetMicroseconds();
+		if(!next)
+		{
+			next = now + period;
+			jitter = SimJitter(pCam);
+		}
+		due = (unsigned long long)((long long)next + jitter);
+		if(due > now + 1000)
+		{
+			EventWait(&(pCam->Wake),(unsigned long)((due - now) / 1000));
+			continue;
+		}
+
+		SimDeliver(pCam);
+		next += period;
+		// late by more than a frame (slow callback): no burst to catch up
+		if(next + period < now)
+			next = now + period;
+		jitter = SimJitter(pCam);
+	}
+
+	return 0;
+}
+
+static void SimPlug(tSimCamera *pCam,unsigned long long Now)
+{
+	double fraction;
+
+	pCam->Plugged = true;
+	pCam->UnplugAt = 0;
+	if(gSim.Config.UnplugAfter)
+	{
+		fraction = 0.5 + (double)(SimRandom(pCam) % 1000) / 1000.0;
+		pCam->UnplugAt = Now + (unsigned long long)(gSim.Config.UnplugAfter * fraction * 1000000.0);
+	}
+	SimLinkEvent(ePvLinkAdd,pCam->UID);
+}
+
+static void SimUnplug(tSimCamera *pCam,unsigned long long Now)
+{
+	pCam->Plugged = false;
+	pCam->Acquiring = false;
+	pCam->UnpluggedAt = Now;
+	EventSignal(&(pCam->Wake));
+	SimLinkEvent(ePvLinkRemove,pCam->UID);
+}
+
+/*
+	World thread: discovery, unplug and replug. An unplugged camera comes back
+	only once the application has closed it
+*/
+static THREADPROC SimWorldThread(void * /*pContext*/)
+{
+	tSimCamera *pCam;
+	unsigned long long now;
+	unsigned long i;
+
+	while(!gSim.Stop)
+	{
+		now = GetMicroseconds();
+		for(i=0;i<gSim.Config.Cameras && !gSim.Stop;i++)
+		{
+			pCam = &(gSim.Cameras[i]);
+			if(!pCam->Discovered)
+			{
+				if(now - gSim.StartedAt >= gSim.Config.Discovery * 1000ULL)
+				{
+					pCam->Discovered = true;
+					SimPlug(pCam,now);
+				}
+			}
+			else if(pCam->Plugged)
+			{
+				pCam->PlugRequest = false;
+				if(pCam->UnplugRequest || (pCam->UnplugAt && now >= pCam->UnplugAt))
+				{
+					pCam->UnplugRequest = false;
+					SimUnplug(pCam,now);
+				}
+			}
+			else
+			{
+				pCam->UnplugRequest = false;
+				if(!pCam->Open && (pCam->PlugRequest ||
+					(gSim.Config.ReplugAfter && now - pCam->UnpluggedAt >= gSim.Config.ReplugAfter * 1000000ULL)))
+				{
+					pCam->PlugRequest = false;
+					SimPlug(pCam,now);
+				}
+			}
+		}
+
+		EventWait(&(gSim.Wake),SIM_WORLD_PERIOD);
+	}
+
+	return 0;
+}
+
+static void SimCaptureStop(tSimCamera *pCam)
+{
+	if(!pCam->Capturing)
+		return;
+
+	pCam->Stop = true;
+	EventSignal(&(pCam->Wake));
+	ThreadJoin(&(pCam->Thread));
+	pCam->Capturing = false;
+}
+
+/*
+	Give back every queued frame as ePvErrCancelled, then wait for the frame
+	the streamer may be completing
+*/
+static void SimQueueCancel(tSimCamera *pCam)
+{
+	tSimQueued cancelled[SIM_QUEUE_SIZE];
+	unsigned long i,count;
+
+	LockAcquire(&(pCam->Lock));
+	count = pCam->QueueCount;
+	for(i=0;i<count;i++)
+		cancelled[i] = pCam->Queue[(pCam->QueueHead + i) % SIM_QUEUE_SIZE];
+	pCam->QueueHead = 0;
+	pCam->QueueCount = 0;
+	LockRelease(&(pCam->Lock));
+	EventSignal(&(pCam->Done));
+
+	for(i=0;i<count;i++)
+	{
+		cancelled[i].pFrame->Status = ePvErrCancelled;
+		cancelled[i].pFrame->ImageSize = 0;
+		if(cancelled[i].Callback)
+			cancelled[i].Callback(cancelled[i].pFrame);
+	}
+
+	while(pCam->Delivering)
+		Sleep(1);
+}
+
+static void SimCameraReset(tSimCamera *pCam,unsigned long Index)
+{
+	pCam->UID = gSim.Config.FirstUID + Index;
+	pCam->Random = (gSim.Config.Seed * 2654435761UL + Index * 40503 + 1) & 0xFFFFFFFF;
+	if(!pCam->Random)
+		pCam->Random = 1;
+	pCam->Format = gSim.Config.Format;
+	pCam->Width = gSim.Config.Width;
+	pCam->Height = gSim.Config.Height;
+	pCam->FrameRate = SIM_DEFAULT_FPS;
+	pCam->TriggerMode = eSimTriggerFreerun;
+	pCam->Exposure = 15000;
+	pCam->Gain = 0;
+	pCam->WhitebalRed = 140;
+	pCam->WhitebalBlue = 180;
+	pCam->ExposureAutoMax = 500000;
+	pCam->PacketSize = 1500;
+	pCam->StreamBytesPerSecond = 115000000;
+	pCam->TimeStampBase = GetMicroseconds();
+}
+
+
+//===== CONFIGURATION =========================================================
+
+/*!
+ * @brief
+ *		Default simulation: one Bayer8 camera at 1360x1024, no fault
+ * @param
+ *		configuration to fill
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void PvSimDefaults(tPvSimConfig *pConfig)
+{
+	memset(pConfig,0,sizeof(tPvSimConfig));
+	pConfig->Cameras = 1;
+	pConfig->FirstUID = SIM_FIRST_UID;
+	pConfig->Format = ePvFmtBayer8;
+	pConfig->Width = 1360;
+	pConfig->Height = 1024;
+	pConfig->Discovery = 500;
+	pConfig->Seed = 1;
+}
+
+/*!
+ * @brief
+ *		Read a list of key=value separated by commas (see PvSimulator.h) over a configuration
+ * @param
+ *		list, such as the PVSIM environment variable
+ * @param
+ *		configuration, the keys not in the list keep their value
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false on an unknown key or a bad value
+ */
+bool PvSimParse(const char *Spec,tPvSimConfig *pConfig)
+{
+	char buffer[512];
+	char *pKey,*pValue,*pNext;
+
+	if(strlen(Spec) >= sizeof(buffer))
+	{
+		printf("Error in %s:%d at PvSimParse() ----> simulation setup too long\n", __FILE__, __LINE__);
+		return false;
+	}
+	strcpy(buffer,Spec);
+
+	for(pKey=buffer;pKey && *pKey;pKey=pNext)
+	{
+		pNext = strchr(pKey,',');
+		if(pNext)
+			*pNext++ = 0;
+		pValue = strchr(pKey,'=');
+		if(!pValue)
+		{
+			printf("Error in %s:%d at PvSimParse() ----> %s is not key=value\n", __FILE__, __LINE__, pKey);
+			return false;
+		}
+		*pValue++ = 0;
+
+		if(!strcmp(pKey,"cameras"))
+			pConfig->Cameras = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"uid"))
+			pConfig->FirstUID = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"fps"))
+			pConfig->FrameRate = (float)atof(pValue);
+		else if(!strcmp(pKey,"width"))
+			pConfig->Width = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"height"))
+			pConfig->Height = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"loss"))
+			pConfig->LossRate = atof(pValue);
+		else if(!strcmp(pKey,"missing"))
+			pConfig->MissingRate = atof(pValue);
+		else if(!strcmp(pKey,"jitter"))
+			pConfig->Jitter = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"unplug"))
+			pConfig->UnplugAfter = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"replug"))
+			pConfig->ReplugAfter = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"discovery"))
+			pConfig->Discovery = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"control"))
+			pConfig->Control = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"seed"))
+			pConfig->Seed = strtoul(pValue,NULL,10);
+		else if(!strcmp(pKey,"format"))
+		{
+			if(!SimFormatParse(pValue,&(pConfig->Format)))
+			{
+				printf("Error in %s:%d at PvSimParse() ----> unknown format %s\n", __FILE__, __LINE__, pValue);
+				return false;
+			}
+		}
+		else
+		{
+			printf("Error in %s:%d at PvSimParse() ----> unknown key %s\n", __FILE__, __LINE__, pKey);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+	Ranges of a configuration, PvSimConfigure() or PVSIM
+*/
+static bool SimConfigValid(const tPvSimConfig *pConfig)
+{
+	if(!pConfig->Cameras || pConfig->Cameras > SIM_MAX_CAMERAS || !pConfig->Width || !pConfig->Height ||
+		!SimFrameBytes(pConfig->Format,pConfig->Width,pConfig->Height) ||
+		pConfig->FrameRate < 0.0f || pConfig->FrameRate > SIM_MAX_FPS ||
+		pConfig->LossRate < 0.0 || pConfig->LossRate > 1.0 || pConfig->MissingRate < 0.0 || pConfig->MissingRate > 1.0)
+	{
+		printf("Error in %s:%d at SimConfigValid() ----> invalid simulation setup\n", __FILE__, __LINE__);
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Set the virtual cameras up, before PvInitialize()
+ * @param
+ *		configuration
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if the simulator is running or the configuration is not valid
+ */
+bool PvSimConfigure(const tPvSimConfig *pConfig)
+{
+	if(gSim.Initialized)
+	{
+		printf("Error in %s:%d at PvSimConfigure() ----> PvInitialize() was already called\n", __FILE__, __LINE__);
+		return false;
+	}
+	if(!SimConfigValid(pConfig))
+		return false;
+
+	gSim.Config = *pConfig;
+	gSim.Configured = true;
+
+	return true;
+}
+
+static tSimCamera *SimFind(unsigned long UID)
+{
+	unsigned long i;
+
+	for(i=0;i<gSim.Config.Cameras;i++)
+		if(gSim.Cameras[i].UID == UID)
+			return &(gSim.Cameras[i]);
+
+	return NULL;
+}
+
+/*!
+ * @brief
+ *		Unplug a camera now, from the world thread as a real unplug
+ * @param
+ *		UID of the camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if there is no such camera
+ */
+bool PvSimUnplug(unsigned long UID)
+{
+	tSimCamera *pCam = gSim.Initialized ? SimFind(UID) : NULL;
+
+	if(!pCam)
+		return false;
+
+	pCam->UnplugRequest = true;
+	EventSignal(&(gSim.Wake));
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Plug an unplugged camera back, as soon as the application has closed it
+ * @param
+ *		UID of the camera
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		false if there is no such camera
+ */
+bool PvSimPlug(unsigned long UID)
+{
+	tSimCamera *pCam = gSim.Initialized ? SimFind(UID) : NULL;
+
+	if(!pCam)
+		return false;
+
+	pCam->PlugRequest = true;
+	EventSignal(&(gSim.Wake));
+
+	return true;
+}
+
+
+//===== PvApi.h ===============================================================
+
+void PVDECL PvVersion(unsigned long* pMajor,unsigned long* pMinor)
+{
+	*pMajor = 1;
+	*pMinor = 24;
+}
+
+tPvErr PVDECL PvInitialize(void)
+{
+	tPvSimConfig config;
+	const char *pSpec;
+	unsigned long i;
+
+	if(gSim.Initialized)
+		return ePvErrSuccess;
+
+	// PVSIM is read again by every PvInitialize(), unless PvSimConfigure() was called
+	if(!gSim.Configured)
+	{
+		PvSimDefaults(&config);
+		pSpec = getenv("PVSIM");
+		if((pSpec && !PvSimParse(pSpec,&config)) || !SimConfigValid(&config))
+			return ePvErrBadParameter;
+		gSim.Config = config;
+	}
+
+	LockInit(&(gSim.Lock));
+	memset(gSim.Links,0,sizeof(gSim.Links));
+	EventInit(&(gSim.Wake));
+	memset(gSim.Cameras,0,sizeof(gSim.Cameras));
+	for(i=0;i<gSim.Config.Cameras;i++)
+	{
+		LockInit(&(gSim.Cameras[i].Lock));
+		EventInit(&(gSim.Cameras[i].Wake));
+		EventInit(&(gSim.Cameras[i].Done));
+		SimCameraReset(&(gSim.Cameras[i]),i);
+	}
+
+	gSim.Stop = false;
+	gSim.StartedAt = GetMicroseconds();
+	gSim.Initialized = true;
+	if(!ThreadSpawn(&(gSim.Thread),SimWorldThread,NULL))
+	{
+		printf("Error in %s:%d at PvInitialize() ----> could not start the simulator\n", __FILE__, __LINE__);
+		gSim.Initialized = false;
+		return ePvErrResources;
+	}
+
+	printf("PvAPI simulator: %lu camera(s) from %lu, %s %lux%lu, ",gSim.Config.Cameras,gSim.Config.FirstUID,
+		gSimFormats[gSim.Config.Format],gSim.Config.Width,gSim.Config.Height);
+	if(gSim.Config.FrameRate > 0.0f)
+		printf("%.1f fps",gSim.Config.FrameRate);
+	else
+		printf("FrameRate fps");
+	printf(", loss %.3f, missing %.3f, jitter %lu ms, unplug %lu s, replug %lu s, control %lu ms\n",gSim.Config.LossRate,
+		gSim.Config.MissingRate,gSim.Config.Jitter,gSim.Config.UnplugAfter,gSim.Config.ReplugAfter,gSim.Config.Control);
+
+	return ePvErrSuccess;
+}
+
+void PVDECL PvUnInitialize(void)
+{
+	tSimCamera *pCam;
+	unsigned long i;
+
+	if(!gSim.Initialized)
+		return;
+
+	gSim.Stop = true;
+	EventSignal(&(gSim.Wake));
+	ThreadJoin(&(gSim.Thread));
+
+	for(i=0;i<gSim.Config.Cameras;i++)
+	{
+		pCam = &(gSim.Cameras[i]);
+		SimCaptureStop(pCam);
+		SimQueueCancel(pCam);
+		free(pCam->Pattern);
+		pCam->Pattern = NULL;
+		EventDestroy(&(pCam->Done));
+		EventDestroy(&(pCam->Wake));
+		LockDestroy(&(pCam->Lock));
+	}
+	EventDestroy(&(gSim.Wake));
+	LockDestroy(&(gSim.Lock));
+	gSim.Initialized = false;
+}
+
+tPvErr PVDECL PvLinkCallbackRegister(tPvLinkCallback Callback,tPvLinkEvent Event,void* Context)
+{
+	tPvErr err = ePvErrResources;
+	unsigned long i;
+
+	if(!gSim.Initialized)
+		return ePvErrBadSequence;
+
+	LockAcquire(&(gSim.Lock));
+	for(i=0;i<SIM_MAX_CALLBACKS;i++)
+		if(!gSim.Links[i].Callback)
+		{
+			gSim.Links[i].Callback = Callback;
+			gSim.Links[i].Event = Event;
+			gSim.Links[i].Context = Context;
+			err = ePvErrSuccess;
+			break;
+		}
+	LockRelease(&(gSim.Lock));
+
+	return err;
+}
+
+tPvErr PVDECL PvLinkCallbackUnRegister(tPvLinkCallback Callback,tPvLinkEvent Event)
+{
+	tPvErr err = ePvErrNotFound;
+	unsigned long i;
+
+	if(!gSim.Initialized)
+		return ePvErrBadSequence;
+
+	LockAcquire(&(gSim.Lock));
+	for(i=0;i<SIM_MAX_CALLBACKS;i++)
+		if(gSim.Links[i].Callback == Callback && gSim.Links[i].Event == Event)
+		{
+			gSim.Links[i].Callback = NULL;
+			err = ePvErrSuccess;
+			break;
+		}
+	LockRelease(&(gSim.Lock));
+
+	return err;
+}
+
+static void SimCameraInfo(const tSimCamera *pCam,tPvCameraInfo *pInfo)
+{
+	memset(pInfo,0,sizeof(tPvCameraInfo));
+	pInfo->UniqueId = pCam->UID;
+	sprintf(pInfo->SerialString,"SIM%lu",pCam->UID);
+	pInfo->PartNumber = SIM_PART_NUMBER;
+	pInfo->PartVersion = 1;
+	pInfo->PermittedAccess = pCam->Open ? ePvAccessMonitor : ePvAccessMonitor | ePvAccessMaster;
+	pInfo->InterfaceId = 1;
+	pInfo->InterfaceType = ePvInterfaceEthernet;
+	sprintf(pInfo->DisplayName,"Sim%lu",(pCam->UID - gSim.Config.FirstUID) % 1000);
+}
+
+unsigned long PVDECL PvCameraList(tPvCameraInfo* pList,unsigned long ListLength,unsigned long* pConnectedNum)
+{
+	unsigned long i,listed = 0,connected = 0;
+
+	for(i=0;gSim.Initialized && i<gSim.Config.Cameras;i++)
+	{
+		if(!gSim.Cameras[i].Discovered || !gSim.Cameras[i].Plugged)
+			continue;
+		if(listed < ListLength)
+			SimCameraInfo(&(gSim.Cameras[i]),&(pList[listed++]));
+		connected++;
+	}
+	if(pConnectedNum)
+		*pConnectedNum = connected;
+
+	return listed;
+}
+
+unsigned long PVDECL PvCameraCount(void)
+{
+	unsigned long i,count = 0;
+
+	for(i=0;gSim.Initialized && i<gSim.Config.Cameras;i++)
+		if(gSim.Cameras[i].Discovered && gSim.Cameras[i].Plugged)
+			count++;
+
+	return count;
+}
+
+tPvErr PVDECL PvCameraInfo(unsigned long UniqueId,tPvCameraInfo* pInfo)
+{
+	tSimCamera *pCam = gSim.Initialized ? SimFind(UniqueId) : NULL;
+
+	if(!pCam || !pCam->Discovered || !pCam->Plugged)
+		return ePvErrNotFound;
+
+	SimCameraInfo(pCam,pInfo);
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCameraOpen(unsigned long UniqueId,tPvAccessFlags /*AccessFlag*/,tPvHandle* pCamera)
+{
+	tSimCamera *pCam = gSim.Initialized ? SimFind(UniqueId) : NULL;
+
+	if(!pCam || !pCam->Discovered || !pCam->Plugged)
+		return ePvErrNotFound;
+	if(pCam->Open)
+		return ePvErrAccessDenied;
+
+	SimControl();
+	pCam->AcquisitionCount = 0;
+	pCam->FramesCompleted = 0;
+	pCam->FramesDropped = 0;
+	pCam->PacketsMissed = 0;
+	pCam->PacketsErroneous = 0;
+	pCam->PacketsReceived = 0;
+	pCam->StatFrameRate = 0.0f;
+	pCam->EventCallback = NULL;
+	pCam->Open = true;
+	*pCamera = (tPvHandle)pCam;
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCameraClose(tPvHandle Camera)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+
+	if(!pCam)
+		return ePvErrBadHandle;
+
+	pCam->Acquiring = false;
+	SimCaptureStop(pCam);
+	SimQueueCancel(pCam);
+	pCam->EventCallback = NULL;
+	pCam->Open = false;
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCaptureStart(tPvHandle Camera)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+
+	if(!pCam)
+		return ePvErrBadHandle;
+	if(!pCam->Plugged)
+		return ePvErrUnplugged;
+	if(pCam->Capturing)
+		return ePvErrSuccess;
+
+	if(!SimPatternBuild(pCam))
+		return ePvErrResources;
+
+	pCam->Stop = false;
+	pCam->RateAt = GetMicroseconds();
+	pCam->RateFrames = 0;
+	if(!ThreadSpawn(&(pCam->Thread),SimCameraThread,pCam))
+		return ePvErrResources;
+	pCam->Capturing = true;
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCaptureEnd(tPvHandle Camera)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+
+	if(!pCam)
+		return ePvErrBadHandle;
+
+	SimCaptureStop(pCam);
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCaptureQuery(tPvHandle Camera,unsigned long* pIsStarted)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+
+	if(!pCam)
+		return ePvErrBadHandle;
+
+	*pIsStarted = pCam->Capturing ? 1 : 0;
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCaptureAdjustPacketSize(tPvHandle Camera,unsigned long MaximumPacketSize)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+
+	if(!pCam)
+		return ePvErrBadHandle;
+	if(!pCam->Plugged)
+		return ePvErrUnplugged;
+
+	pCam->PacketSize = MaximumPacketSize < 1500 ? 1500 : (MaximumPacketSize > 9000 ? 9000 : MaximumPacketSize);
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCaptureQueueFrame(tPvHandle Camera,tPvFrame* pFrame,tPvFrameCallback Callback)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+	tPvErr err = ePvErrSuccess;
+
+	if(!pCam)
+		return ePvErrBadHandle;
+	if(!pCam->Plugged)
+		return ePvErrUnplugged;
+	if(!pCam->Capturing)
+		return ePvErrBadSequence;
+
+	LockAcquire(&(pCam->Lock));
+	if(pCam->QueueCount == SIM_QUEUE_SIZE)
+		err = ePvErrQueueFull;
+	else
+	{
+		pCam->Queue[(pCam->QueueHead + pCam->QueueCount) % SIM_QUEUE_SIZE].pFrame = pFrame;
+		pCam->Queue[(pCam->QueueHead + pCam->QueueCount) % SIM_QUEUE_SIZE].Callback = Callback;
+		pCam->QueueCount++;
+	}
+	LockRelease(&(pCam->Lock));
+
+	return err;
+}
+
+tPvErr PVDECL PvCaptureQueueClear(tPvHandle Camera)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+
+	if(!pCam)
+		return ePvErrBadHandle;
+
+	SimQueueCancel(pCam);
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCaptureWaitForFrameDone(tPvHandle Camera,const tPvFrame* pFrame,unsigned long Timeout)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+	unsigned long long deadline,now;
+	unsigned long i,slice;
+	bool queued;
+
+	if(!pCam)
+		return ePvErrBadHandle;
+
+	deadline = GetMicroseconds() + (unsigned long long)Timeout * 1000;
+	while(1)
+	{
+		LockAcquire(&(pCam->Lock));
+		queued = pCam->InFlight == pFrame;
+		for(i=0;i<pCam->QueueCount && !queued;i++)
+			queued = pCam->Queue[(pCam->QueueHead + i) % SIM_QUEUE_SIZE].pFrame == pFrame;
+		LockRelease(&(pCam->Lock));
+		if(!queued)
+			return ePvErrSuccess;
+
+		now = GetMicroseconds();
+		if(Timeout != PVINFINITE && now >= deadline)
+			return ePvErrTimeout;
+		slice = Timeout != PVINFINITE && deadline - now < SIM_WAIT_SLICE * 1000 ? (unsigned long)((deadline - now) / 1000) + 1 : SIM_WAIT_SLICE;
+		EventWait(&(pCam->Done),slice);
+	}
+}
+
+tPvErr PVDECL PvAttrExists(tPvHandle Camera,const char* Name)
+{
+	if(!SimCamera(Camera))
+		return ePvErrBadHandle;
+
+	return SimAttribute(Name) ? ePvErrSuccess : ePvErrNotFound;
+}
+
+/*
+	From the description of the camera, without a control transaction: the
+	statistics and the values of the auto modes move on their own, the clock
+	frequency and the UniqueId never change
+*/
+tPvErr PVDECL PvAttrInfo(tPvHandle Camera,const char* Name,tPvAttributeInfo* pInfo)
+{
+	const tSimAttribute *pAttribute;
+
+	if(!SimCamera(Camera))
+		return ePvErrBadHandle;
+	if(!pInfo)
+		return ePvErrBadParameter;
+	pAttribute = SimAttribute(Name);
+	if(!pAttribute)
+		return ePvErrNotFound;
+
+	memset(pInfo,0,sizeof(tPvAttributeInfo));
+	pInfo->Datatype = pAttribute->Type;
+	pInfo->Category = "/";
+	pInfo->Impact = "";
+	if(pAttribute->Type == ePvDatatypeCommand)
+		pInfo->Flags = ePvFlagWrite;
+	else if(!strcmp(Name,"TimeStampFrequency") || !strcmp(Name,"UniqueId"))
+		pInfo->Flags = ePvFlagRead | ePvFlagConst;
+	else if(!strncmp(Name,"Stat",4) || !strcmp(Name,"ExposureValue") || !strcmp(Name,"GainValue") || !strncmp(Name,"WhitebalValue",13))
+		pInfo->Flags = ePvFlagRead | ePvFlagVolatile | (pAttribute->Writable ? (unsigned long)ePvFlagWrite : 0UL);
+	else
+		pInfo->Flags = ePvFlagRead | (pAttribute->Writable ? (unsigned long)ePvFlagWrite : 0UL);
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCommandRun(tPvHandle Camera,const char* Name)
+{
+	tSimCamera *pCam;
+	tPvErr err = SimAttributeCheck(Camera,Name,ePvDatatypeCommand,true,&pCam);
+
+	if(err)
+		return err;
+
+	if(!strcmp(Name,"AcquisitionStart"))
+	{
+		pCam->Acquiring = true;
+		SimCameraEvent(pCam,SIM_EVENT_ACQ_START);
+	}
+	else if(!strcmp(Name,"AcquisitionStop") || !strcmp(Name,"AcquisitionAbort"))
+	{
+		pCam->Acquiring = false;
+		SimCameraEvent(pCam,SIM_EVENT_ACQ_END);
+	}
+	else if(!strcmp(Name,"TimeStampReset"))
+		pCam->TimeStampBase = GetMicroseconds();
+	else if(!strcmp(Name,"FrameStartTriggerSoftware"))
+	{
+		if(pCam->TriggerMode != eSimTriggerSoftware || !pCam->Acquiring)
+			return ePvErrUnavailable;
+		AtomicIncrement(&(pCam->SoftTriggers));
+	}
+	EventSignal(&(pCam->Wake));
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvAttrEnumGet(tPvHandle Camera,const char* Name,char* pBuffer,unsigned long BufferSize,unsigned long* pSize)
+{
+	tSimCamera *pCam;
+	const char *pValue;
+	tPvErr err = SimAttributeCheck(Camera,Name,ePvDatatypeEnum,false,&pCam);
+
+	if(err)
+		return err;
+
+	if(!strcmp(Name,"ExposureMode"))
+		pValue = pCam->ExposureAuto ? "Auto" : "Manual";
+	else if(!strcmp(Name,"GainMode"))
+		pValue = pCam->GainAuto ? "Auto" : "Manual";
+	else if(!strcmp(Name,"WhitebalMode"))
+		pValue = pCam->WhitebalAuto ? "Auto" : "Manual";
+	else if(!strcmp(Name,"FrameStartTriggerMode"))
+		pValue = gSimTriggerModes[pCam->TriggerMode];
+	else if(!strcmp(Name,"EventNotification"))
+		pValue = pCam->EventNotification ? "On" : "Off";
+	else if(!strcmp(Name,"PixelFormat"))
+		pValue = gSimFormats[pCam->Format];
+	else
+		pValue = "Continuous";
+
+	if(pSize)
+		*pSize = (unsigned long)strlen(pValue);
+	if(strlen(pValue) >= BufferSize)
+		return ePvErrBadParameter;
+	strcpy(pBuffer,pValue);
+
+	return ePvErrSuccess;
+}
+
+/*
+	Manual, Auto or AutoOnce: AutoOnce takes one step of the auto mode and stays Manual
+*/
+static tPvErr SimAutoMode(tSimCamera *pCam,const char* Value,bool *pAuto)
+{
+	if(!strcmp(Value,"Manual") || !strcmp(Value,"AutoOnce"))
+		*pAuto = false;
+	else if(!strcmp(Value,"Auto"))
+		*pAuto = true;
+	else
+		return ePvErrOutOfRange;
+
+	if(!strcmp(Value,"AutoOnce"))
+	{
+		*pAuto = true;
+		pCam->AutoAt = 0;
+		SimAutoStep(pCam,GetMicroseconds());
+		*pAuto = false;
+	}
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvAttrEnumSet(tPvHandle Camera,const char* Name,const char* Value)
+{
+	tSimCamera *pCam;
+	tPvImageFormat format;
+	unsigned long i;
+	tPvErr err = SimAttributeCheck(Camera,Name,ePvDatatypeEnum,true,&pCam);
+
+	if(err)
+		return err;
+
+	if(!strcmp(Name,"ExposureMode"))
+		return SimAutoMode(pCam,Value,&(pCam->ExposureAuto));
+	if(!strcmp(Name,"GainMode"))
+		return SimAutoMode(pCam,Value,&(pCam->GainAuto));
+	if(!strcmp(Name,"WhitebalMode"))
+		return SimAutoMode(pCam,Value,&(pCam->WhitebalAuto));
+
+	if(!strcmp(Name,"FrameStartTriggerMode"))
+	{
+		for(i=0;i<eSimTriggerCount;i++)
+			if(!strcmp(Value,gSimTriggerModes[i]))
+			{
+				pCam->TriggerMode = i;
+				EventSignal(&(pCam->Wake));
+				return ePvErrSuccess;
+			}
+		return ePvErrOutOfRange;
+	}
+
+	if(!strcmp(Name,"EventNotification"))
+	{
+		if(strcmp(Value,"On") && strcmp(Value,"Off"))
+			return ePvErrOutOfRange;
+		pCam->EventNotification = !strcmp(Value,"On");
+		return ePvErrSuccess;
+	}
+
+	if(!strcmp(Name,"PixelFormat"))
+	{
+		if(!SimFormatParse(Value,&format))
+			return ePvErrOutOfRange;
+		if(pCam->Capturing)
+			return ePvErrForbidden;
+		pCam->Format = format;
+		return ePvErrSuccess;
+	}
+
+	return strcmp(Value,"Continuous") ? ePvErrOutOfRange : ePvErrSuccess;
+}
+
+tPvErr PVDECL PvAttrUint32Get(tPvHandle Camera,const char* Name,tPvUint32* pValue)
+{
+	tSimCamera *pCam;
+	tPvErr err = SimAttributeCheck(Camera,Name,ePvDatatypeUint32,false,&pCam);
+
+	if(err)
+		return err;
+
+	if(!strcmp(Name,"ExposureValue"))
+		*pValue = pCam->Exposure;
+	else if(!strcmp(Name,"GainValue"))
+		*pValue = pCam->Gain;
+	else if(!strcmp(Name,"WhitebalValueRed"))
+		*pValue = pCam->WhitebalRed;
+	else if(!strcmp(Name,"WhitebalValueBlue"))
+		*pValue = pCam->WhitebalBlue;
+	else if(!strcmp(Name,"ExposureAutoMax"))
+		*pValue = pCam->ExposureAutoMax;
+	else if(!strcmp(Name,"EventsEnable1"))
+		*pValue = pCam->EventsEnable1;
+	else if(!strcmp(Name,"PacketSize"))
+		*pValue = pCam->PacketSize;
+	else if(!strcmp(Name,"StreamBytesPerSecond"))
+		*pValue = pCam->StreamBytesPerSecond;
+	else if(!strcmp(Name,"Width"))
+		*pValue = pCam->Width;
+	else if(!strcmp(Name,"Height"))
+		*pValue = pCam->Height;
+	else if(!strcmp(Name,"NonImagePayloadSize"))
+		*pValue = pCam->ChunkMode ? CHUNK_SIZE : 0;
+	else if(!strcmp(Name,"TotalBytesPerFrame"))
+		*pValue = SimFrameBytes(pCam->Format,pCam->Width,pCam->Height);
+	else if(!strcmp(Name,"TimeStampFrequency"))
+		*pValue = SIM_TIMESTAMP_FREQUENCY;
+	else if(!strcmp(Name,"UniqueId"))
+		*pValue = pCam->UID;
+	else if(!strcmp(Name,"StatFramesCompleted"))
+		*pValue = pCam->FramesCompleted;
+	else if(!strcmp(Name,"StatFramesDropped"))
+		*pValue = pCam->FramesDropped;
+	else if(!strcmp(Name,"StatPacketsMissed"))
+		*pValue = pCam->PacketsMissed;
+	else if(!strcmp(Name,"StatPacketsErroneous"))
+		*pValue = pCam->PacketsErroneous;
+	else
+		*pValue = pCam->PacketsReceived;
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvAttrUint32Set(tPvHandle Camera,const char* Name,tPvUint32 Value)
+{
+	tSimCamera *pCam;
+	tPvErr err = SimAttributeCheck(Camera,Name,ePvDatatypeUint32,true,&pCam);
+
+	if(err)
+		return err;
+
+	if(!strcmp(Name,"ExposureValue"))
+	{
+		if(Value < SIM_EXPOSURE_MIN)
+			return ePvErrOutOfRange;
+		pCam->Exposure = Value;
+	}
+	else if(!strcmp(Name,"GainValue"))
+	{
+		if(Value > SIM_GAIN_MAX)
+			return ePvErrOutOfRange;
+		pCam->Gain = Value;
+	}
+	else if(!strcmp(Name,"WhitebalValueRed"))
+		pCam->WhitebalRed = Value;
+	else if(!strcmp(Name,"WhitebalValueBlue"))
+		pCam->WhitebalBlue = Value;
+	else if(!strcmp(Name,"ExposureAutoMax"))
+		pCam->ExposureAutoMax = Value < SIM_EXPOSURE_MIN ? SIM_EXPOSURE_MIN : Value;
+	else if(!strcmp(Name,"EventsEnable1"))
+		pCam->EventsEnable1 = Value;
+	else if(!strcmp(Name,"PacketSize"))
+	{
+		if(Value < 500 || Value > 9000)
+			return ePvErrOutOfRange;
+		pCam->PacketSize = Value;
+	}
+	else if(!strcmp(Name,"StreamBytesPerSecond"))
+		pCam->StreamBytesPerSecond = Value;
+	else
+	{
+		// the image size cannot change under the streamer
+		if(pCam->Capturing)
+			return ePvErrForbidden;
+		if(!Value || Value > 8192)
+			return ePvErrOutOfRange;
+		if(!strcmp(Name,"Width"))
+			pCam->Width = Value;
+		else
+			pCam->Height = Value;
+	}
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvAttrFloat32Get(tPvHandle Camera,const char* Name,tPvFloat32* pValue)
+{
+	tSimCamera *pCam;
+	tPvErr err = SimAttributeCheck(Camera,Name,ePvDatatypeFloat32,false,&pCam);
+
+	if(err)
+		return err;
+
+	*pValue = !strcmp(Name,"FrameRate") ? pCam->FrameRate : pCam->StatFrameRate;
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvAttrFloat32Set(tPvHandle Camera,const char* Name,tPvFloat32 Value)
+{
+	tSimCamera *pCam;
+	tPvErr err = SimAttributeCheck(Camera,Name,ePvDatatypeFloat32,true,&pCam);
+
+	if(err)
+		return err;
+	if(Value < 0.1f || Value > SIM_MAX_FPS)
+		return ePvErrOutOfRange;
+
+	pCam->FrameRate = Value;
+	EventSignal(&(pCam->Wake));
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvAttrBooleanGet(tPvHandle Camera,const char* Name,tPvBoolean* pValue)
+{
+	tSimCamera *pCam;
+	tPvErr err = SimAttributeCheck(Camera,Name,ePvDatatypeBoolean,false,&pCam);
+
+	if(err)
+		return err;
+
+	*pValue = pCam->ChunkMode ? 1 : 0;
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvAttrBooleanSet(tPvHandle Camera,const char* Name,tPvBoolean Value)
+{
+	tSimCamera *pCam;
+	tPvErr err = SimAttributeCheck(Camera,Name,ePvDatatypeBoolean,true,&pCam);
+
+	if(err)
+		return err;
+
+	pCam->ChunkMode = Value != 0;
+	return ePvErrSuccess;
+}
+
+/*
+	Stream statistics block, as many registers as asked in one control transaction.
+	The reads stop at the first address outside of the block
+*/
+tPvErr PVDECL PvRegisterRead(tPvHandle Camera,unsigned long NumReads,const unsigned long* pAddressArray,unsigned long* pDataArray,unsigned long* pNumComplete)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+	unsigned long i,index;
+	unsigned int bits;
+	float rate;
+
+	if(pNumComplete)
+		*pNumComplete = 0;
+	if(!pCam)
+		return ePvErrBadHandle;
+	if(!pCam->Plugged)
+		return ePvErrUnplugged;
+	if(!NumReads || !pAddressArray || !pDataArray)
+		return ePvErrBadParameter;
+
+	SimControl();
+	for(i=0;i<NumReads;i++)
+	{
+		if(pAddressArray[i] < SIM_REG_STATS || (pAddressArray[i] - SIM_REG_STATS) % 4)
+			return ePvErrAccessDenied;
+		index = (pAddressArray[i] - SIM_REG_STATS) / 4;
+		if(index >= SIM_REG_STATS_COUNT)
+			return ePvErrAccessDenied;
+
+		switch(index)
+		{
+		case 0: pDataArray[i] = pCam->FramesCompleted; break;
+		case 1: pDataArray[i] = pCam->FramesDropped; break;
+		case 2: pDataArray[i] = pCam->PacketsMissed; break;
+		case 3: pDataArray[i] = pCam->PacketsErroneous; break;
+		case 4: pDataArray[i] = pCam->PacketsReceived; break;
+		default:
+			rate = pCam->StatFrameRate;
+			memcpy(&bits,&rate,sizeof(bits));
+			pDataArray[i] = bits;
+			break;
+		}
+		if(pNumComplete)
+			(*pNumComplete)++;
+	}
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCameraEventCallbackRegister(tPvHandle Camera,tPvCameraEventCallback Callback,void* Context)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+
+	if(!pCam)
+		return ePvErrBadHandle;
+	if(pCam->EventCallback)
+		return ePvErrResources;
+
+	pCam->EventContext = Context;
+	pCam->EventCallback = Callback;
+
+	return ePvErrSuccess;
+}
+
+tPvErr PVDECL PvCameraEventCallbackUnRegister(tPvHandle Camera,tPvCameraEventCallback Callback)
+{
+	tSimCamera *pCam = SimCamera(Camera);
+
+	if(!pCam)
+		return ePvErrBadHandle;
+	if(pCam->EventCallback != Callback)
+		return ePvErrNotFound;
+
+	pCam->EventCallback = NULL;
+	return ePvErrSuccess;
+}
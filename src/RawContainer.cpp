@@ -0,0 +1,661 @@
+/*!
+ *  @file
+ *     RawContainer.cpp
+ *  @brief
+ *     OTC project: Append-only raw stream container. One open handle per camera,
+ *	   frames are appended to a preallocated segment, the index of the records is
+ *	   written at the end of the segment when it is rotated or closed
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "RawContainer.h"
+#include "AsyncStorage.h"
+#include "FrameArena.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#define RAW_INDEX_GROWTH	4096
+
+
+/*
+	Positional file helpers, the container always knows where the next byte
+	goes. RawFileWriteAt() is also used by the asynchronous storage workers
+*/
+
+/*!
+ * @brief
+ *		Create a new segment file, never an existing one. Not every file system
+ *		takes direct I/O (tmpfs, some network shares): the file is then written
+ *		behind, the closest thing
+ * @param
+ *		name of the file
+ * @param
+ *		file handle
+ * @param
+ *		how the file is written, eRawIoWriteBehind on return when direct I/O was refused
+ * @param
+ *		true on return when the file already exists
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		bool
+ */
+static bool RawFileOpen(const char *Filename,tRawFile *pFile,tRawIoMode *pIoMode,bool *pExists)
+{
+#ifdef _WINDOWS
+	DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN;
+
+	*pExists = false;
+	if(*pIoMode == eRawIoDirect)
+	{
+		*pFile = CreateFileA(Filename,GENERIC_WRITE,FILE_SHARE_READ,NULL,CREATE_NEW,
+			flags | FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH,NULL);
+		if(*pFile != INVALID_HANDLE_VALUE)
+			return true;
+		*pExists = GetLastError() == ERROR_FILE_EXISTS;
+		if(*pExists)
+			return false;
+		*pIoMode = eRawIoWriteBehind;
+	}
+	*pFile = CreateFileA(Filename,GENERIC_WRITE,FILE_SHARE_READ,NULL,CREATE_NEW,flags,NULL);
+	*pExists = *pFile == INVALID_HANDLE_VALUE && GetLastError() == ERROR_FILE_EXISTS;
+	return *pFile != INVALID_HANDLE_VALUE;
+#else
+	/*
+	O_DIRECT is set once the file is created: an open() refused for it may
+	leave the file behind
+	*/
+	*pFile = open(Filename,O_WRONLY | O_CREAT | O_EXCL,0644);
+	*pExists = *pFile < 0 && errno == EEXIST;
+	if(*pFile < 0)
+		return false;
+	if(*pIoMode == eRawIoDirect)
+	{
+#ifdef O_DIRECT
+		if(!fcntl(*pFile,F_SETFL,O_DIRECT))
+			return true;
+#endif
+		*pIoMode = eRawIoWriteBehind;
+	}
+	return true;
+#endif
+}
+
+bool RawFileWriteAt(tRawFile File,unsigned long long Offset,const void *pBuffer,unsigned long Size)
+{
+#ifdef _WINDOWS
+	OVERLAPPED position;
+	DWORD written;
+
+	memset(&position,0,sizeof(OVERLAPPED));
+	position.Offset = (DWORD)(Offset & 0xFFFFFFFF);
+	position.OffsetHigh = (DWORD)(Offset >> 32);
+
+	return WriteFile(File,pBuffer,Size,&written,&position) && written == Size;
+#else
+	const char *pData = (const char*)pBuffer;
+	ssize_t written;
+
+	while(Size)
+	{
+		written = pwrite(File,pData,Size,(off_t)Offset);
+		if(written <= 0)
+			return false;
+		pData += written;
+		Offset += written;
+		Size -= written;
+	}
+	return true;
+#endif
+}
+
+static bool RawFileSetSize(tRawFile File,unsigned long long Size,bool Reserve)
+{
+#ifdef _WINDOWS
+	LARGE_INTEGER position;
+
+	position.QuadPart = (LONGLONG)Size;
+	return SetFilePointerEx(File,position,NULL,FILE_BEGIN) && SetEndOfFile(File);
+#else
+	if(Reserve && !posix_fallocate(File,0,(off_t)Size))
+		return true;
+	return !ftruncate(File,(off_t)Size);
+#endif
+}
+
+static void RawFileClose(tRawFile File)
+{
+#ifdef _WINDOWS
+	CloseHandle(File);
+#else
+	close(File);
+#endif
+}
+
+/*
+	Write a small block (segment header, index) through an aligned copy, padded
+	to the alignment of the container so that it also works with direct I/O
+*/
+static bool RawContainerWriteBlock(tRawContainer *pContainer,unsigned long long Offset,
+								   const void *pFirst,unsigned long FirstSize,const void *pSecond,unsigned long SecondSize)
+{
+	unsigned long size = ARENA_ROUND_UP(FirstSize + SecondSize,pContainer->Alignment);
+	char *pBlock = (char*)AlignedAlloc(size,pContainer->Alignment);
+	bool success;
+
+	if(!pBlock)
+		return false;
+
+	memset(pBlock + FirstSize + SecondSize,0,size - FirstSize - SecondSize);
+	if(FirstSize)
+		memcpy(pBlock,pFirst,FirstSize);
+	if(SecondSize)
+		memcpy(pBlock + FirstSize,pSecond,SecondSize);
+
+	success = RawFileWriteAt(pContainer->File,Offset,pBlock,
+		pContainer->IoMode == eRawIoDirect ? size : FirstSize + SecondSize);
+	AlignedFree(pBlock);
+
+	return success;
+}
+
+/*!
+ * @brief
+ *		Write-behind: start the write-back of the last RAW_WRITE_BEHIND bytes
+ *		appended, wait for the window before it and drop it from the cache.
+ *		The recorder never reads the segments back, keeping them cached only
+ *		pushes the rest of the system out and ends up in long flush stalls
+ * @param
+ *		container
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+static void RawContainerWriteBehind(tRawContainer *pContainer)
+{
+#if defined(_LINUX) && defined(SYNC_FILE_RANGE_WRITE)
+	unsigned long long start = pContainer->WriteBehindOffset;
+
+	if(pContainer->WriteOffset - start < RAW_WRITE_BEHIND)
+		return;
+
+	sync_file_range(pContainer->File,(off64_t)start,(off64_t)(pContainer->WriteOffset - start),SYNC_FILE_RANGE_WRITE);
+
+	if(start > pContainer->DroppedOffset)
+	{
+		sync_file_range(pContainer->File,(off64_t)pContainer->DroppedOffset,(off64_t)(start - pContainer->DroppedOffset),
+			SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+		posix_fadvise(pContainer->File,(off_t)pContainer->DroppedOffset,(off_t)(start - pContainer->DroppedOffset),POSIX_FADV_DONTNEED);
+		pContainer->DroppedOffset = start;
+	}
+	pContainer->WriteBehindOffset = pContainer->WriteOffset;
+#else
+	/*
+	The lazy writer of the Windows cache manager already writes behind
+	*/
+	pContainer->WriteBehindOffset = pContainer->WriteOffset;
+#endif
+}
+
+/*
+	What a record stores: the payload when there is one, the image buffer otherwise
+*/
+const void *RawRecordData(const tPvFrame *pFrame,const tRawPayload *pPayload)
+{
+	return pPayload ? pPayload->pData : pFrame->ImageBuffer;
+}
+
+const char *RawContainerIoName(tRawIoMode IoMode)
+{
+	switch(IoMode)
+	{
+	case eRawIoDirect:
+		return "direct";
+	case eRawIoWriteBehind:
+		return "writebehind";
+	default:
+		return "buffered";
+	}
+}
+
+
+/*!
+ * @brief
+ *		Set up the recorder of a camera, no file is opened until the first frame
+ * @param
+ *		container
+ * @param
+ *		directory of the camera
+ * @param
+ *		UID of the camera
+ * @param
+ *		bytes reserved for each segment, in MB
+ * @param
+ *		a new segment is started after this many seconds
+ * @param
+ *		how the segments are written, eRawIoDirect needs the frames to come from a tFrameArena
+ * @param
+ *		block size of the frame arena, the alignment of direct I/O
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void RawContainerInit(tRawContainer *pContainer,const char *Directory,unsigned long UID,
+					  unsigned long SegmentMB,unsigned long SegmentSeconds,tRawIoMode IoMode,unsigned long BlockSize)
+{
+	memset(pContainer,0,sizeof(tRawContainer));
+	strncpy(pContainer->Directory,Directory,sizeof(pContainer->Directory) - 1);
+	pContainer->UID = UID;
+	pContainer->SegmentSize = (unsigned long long)SegmentMB * 1024 * 1024;
+	pContainer->SegmentSeconds = SegmentSeconds;
+	pContainer->IoMode = IoMode;
+	pContainer->Alignment = IoMode == eRawIoDirect ? BlockSize : RAW_ALIGNMENT;
+}
+
+/*!
+ * @brief
+ *		Keep the container of a camera that comes back to the same directory:
+ *		the numbering goes on after the segment it closed at the unplug, the
+ *		counters add up. Only the settings are taken again
+ * @param
+ *		container, closed
+ * @param
+ *		directory of the segments
+ * @param
+ *		UID of the camera
+ * @param
+ *		bytes reserved for each segment, in MB
+ * @param
+ *		a new segment is started after this many seconds
+ * @param
+ *		how the segments are written
+ * @param
+ *		block size of the frame arena
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		RawContainerInit(), FrameArenaReuse()
+ * @return
+ *		false if the container has to be initialized again
+ */
+bool RawContainerReuse(tRawContainer *pContainer,const char *Directory,unsigned long UID,
+					   unsigned long SegmentMB,unsigned long SegmentSeconds,tRawIoMode IoMode,unsigned long BlockSize)
+{
+	if(pContainer->IsOpen || pContainer->UID != UID ||
+		strncmp(pContainer->Directory,Directory,sizeof(pContainer->Directory) - 1))
+		return false;
+
+	pContainer->SegmentSize = (unsigned long long)SegmentMB * 1024 * 1024;
+	pContainer->SegmentSeconds = SegmentSeconds;
+	// direct I/O is tried again, it may have been given up for the last segment only
+	pContainer->IoMode = IoMode;
+	pContainer->Alignment = IoMode == eRawIoDirect ? BlockSize : RAW_ALIGNMENT;
+	// the storage is started again by CameraStart()
+	pContainer->pStorage = NULL;
+
+	return true;
+}
+
+static bool RawContainerOpenSegment(tRawContainer *pContainer)
+{
+	char filename[160];
+	tRawSegmentHeader header;
+	tRawIoMode ioMode = pContainer->IoMode;
+	bool exists = true;
+
+	/*
+	A segment is never overwritten: the ones already in the directory (an
+	earlier session of the camera) are skipped, the numbering goes on after them
+	*/
+	while(exists)
+	{
+		sprintf(filename,"%s/segment%05lu.avr",pContainer->Directory,pContainer->Segment);
+		if(RawFileOpen(filename,&(pContainer->File),&ioMode,&exists))
+			break;
+		if(!exists)
+		{
+			printf("Error in %s:%d at RawContainerOpenSegment() ----> could not create %s\n", __FILE__, __LINE__, filename);
+			return false;
+		}
+		pContainer->Segment++;
+	}
+	if(ioMode != pContainer->IoMode)
+	{
+		printf("Warning in %s:%d at RawContainerOpenSegment() ----> no direct I/O for %s, using write-behind\n", __FILE__, __LINE__, filename);
+		pContainer->IoMode = ioMode;
+		pContainer->Alignment = RAW_ALIGNMENT;
+	}
+
+	/*
+	Reserve the whole segment up front so that the file system hands out
+	contiguous blocks, the unused tail is cut when the segment is closed
+	*/
+	if(!RawFileSetSize(pContainer->File,pContainer->SegmentSize,true))
+		printf("Warning in %s:%d at RawContainerOpenSegment() ----> could not preallocate %s\n", __FILE__, __LINE__, filename);
+
+	memset(&header,0,sizeof(tRawSegmentHeader));
+	memcpy(header.Magic,RAW_SEGMENT_MAGIC,sizeof(header.Magic));
+	header.Version = RAW_VERSION;
+	header.HeaderSize = ARENA_ROUND_UP(sizeof(tRawSegmentHeader),pContainer->Alignment);
+	header.CameraUID = pContainer->UID;
+	header.Segment = pContainer->Segment;
+	header.CreatedAt = (unsigned long long)time(NULL);
+	header.Preallocated = pContainer->SegmentSize;
+	header.Alignment = pContainer->Alignment;
+
+	if(!RawContainerWriteBlock(pContainer,0,&header,sizeof(tRawSegmentHeader),NULL,0))
+	{
+		RawFileClose(pContainer->File);
+		return false;
+	}
+
+	if(pContainer->pStorage && !AsyncStorageSetFile(pContainer->pStorage,pContainer->File))
+		printf("Warning in %s:%d at RawContainerOpenSegment() ----> asynchronous storage could not take %s\n", __FILE__, __LINE__, filename);
+
+	pContainer->IsOpen = true;
+	pContainer->OpenedAt = (unsigned long)time(NULL);
+	pContainer->WriteOffset = header.HeaderSize;
+	pContainer->WriteBehindOffset = 0;
+	pContainer->DroppedOffset = 0;
+	pContainer->IndexCount = 0;
+	LockInit(&(pContainer->IndexLock));
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Write the index and the trailer after the last record, cut the unused
+ *		preallocated space and close the segment
+ * @param
+ *		container
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+static void RawContainerCloseSegment(tRawContainer *pContainer)
+{
+	tRawSegmentTrailer trailer;
+	unsigned long indexSize;
+	unsigned long i,kept;
+
+	if(!pContainer->IsOpen)
+		return;
+
+	/*
+	Every record of the segment must be on the disk before the index
+	*/
+	if(pContainer->pStorage)
+		AsyncStorageDrain(pContainer->pStorage);
+	LockDestroy(&(pContainer->IndexLock));
+
+	/*
+	Records whose write failed are left out, their space stays unused
+	*/
+	for(i=0,kept=0;i<pContainer->IndexCount;i++)
+	{
+		if(pContainer->Index[i].RecordSize)
+			pContainer->Index[kept++] = pContainer->Index[i];
+	}
+	pContainer->IndexCount = kept;
+	indexSize = pContainer->IndexCount * sizeof(tRawIndexEntry);
+
+	memset(&trailer,0,sizeof(tRawSegmentTrailer));
+	trailer.IndexOffset = pContainer->WriteOffset;
+	trailer.IndexCount = pContainer->IndexCount;
+	memcpy(trailer.Magic,RAW_TRAILER_MAGIC,sizeof(trailer.Magic));
+
+	if(!RawContainerWriteBlock(pContainer,pContainer->WriteOffset,pContainer->Index,indexSize,&trailer,sizeof(tRawSegmentTrailer)))
+		printf("Error in %s:%d at RawContainerCloseSegment() ----> could not write the index of segment %lu\n", __FILE__, __LINE__, pContainer->Segment);
+
+	RawFileSetSize(pContainer->File,pContainer->WriteOffset + indexSize + sizeof(tRawSegmentTrailer),false);
+	RawFileClose(pContainer->File);
+
+	pContainer->BytesWritten += indexSize + sizeof(tRawSegmentTrailer);
+	pContainer->IsOpen = false;
+	pContainer->SegmentsClosed++;
+	pContainer->Segment++;
+}
+
+/*!
+ * @brief
+ *		Make room for the record of a frame: rotate the segment when it is too
+ *		old or when the record would not fit in it, add the record to the index
+ *		and fill its header. The caller then writes the record at the returned
+ *		offset, synchronously or through the asynchronous storage. With direct
+ *		I/O the header and the metadata are also copied in the record block of
+ *		the frame (or of its payload), the whole record is then one write from
+ *		that block
+ * @param
+ *		container
+ * @param
+ *		frame to record
+ * @param
+ *		metadata of the frame
+ * @param
+ *		compressed image, NULL to store the image buffer
+ * @param
+ *		record header to fill
+ * @param
+ *		offset of the record in the current segment
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		RawContainerWrite(), AsyncStorageSubmit()
+ * @return
+ *		bool
+ */
+bool RawContainerReserve(tRawContainer *pContainer,tPvFrame *pFrame,const tRawMetadata *pMetadata,
+						 const tRawPayload *pPayload,tRawRecordHeader *pHeader,unsigned long long *pOffset)
+{
+	tRawIndexEntry *pEntry;
+	unsigned long long needed;
+	unsigned long headerSize,recordSize;
+	unsigned long storedSize = pPayload ? pPayload->Size : pFrame->ImageSize;
+	char *pBlock;
+
+	headerSize = ARENA_ROUND_UP(sizeof(tRawRecordHeader) + sizeof(tRawMetadata),pContainer->Alignment);
+	recordSize = headerSize + ARENA_ROUND_UP(storedSize,pContainer->Alignment);
+
+	/*
+	The record, its index entry and the trailer must fit in the reserved space
+	*/
+	needed = pContainer->WriteOffset + recordSize +
+		(pContainer->IndexCount + 1) * sizeof(tRawIndexEntry) + sizeof(tRawSegmentTrailer);
+
+	if(pContainer->IsOpen &&
+		((unsigned long)time(NULL) - pContainer->OpenedAt >= pContainer->SegmentSeconds ||
+		(pContainer->IndexCount && needed > pContainer->SegmentSize)))
+		RawContainerCloseSegment(pContainer);
+
+	if(!pContainer->IsOpen)
+	{
+		if(!RawContainerOpenSegment(pContainer))
+			return false;
+
+		/*
+		The alignment changes when direct I/O had to be given up
+		*/
+		headerSize = ARENA_ROUND_UP(sizeof(tRawRecordHeader) + sizeof(tRawMetadata),pContainer->Alignment);
+		recordSize = headerSize + ARENA_ROUND_UP(storedSize,pContainer->Alignment);
+	}
+	else if(pContainer->IoMode == eRawIoWriteBehind)
+		RawContainerWriteBehind(pContainer);
+
+	if(pContainer->IndexCount == pContainer->IndexCapacity)
+	{
+		/*
+		The storage threads may be dropping entries of the records in flight
+		*/
+		LockAcquire(&(pContainer->IndexLock));
+		pEntry = (tRawIndexEntry*)realloc(pContainer->Index,(pContainer->IndexCapacity + RAW_INDEX_GROWTH) * sizeof(tRawIndexEntry));
+		if(pEntry)
+		{
+			pContainer->Index = pEntry;
+			pContainer->IndexCapacity += RAW_INDEX_GROWTH;
+		}
+		LockRelease(&(pContainer->IndexLock));
+		if(!pEntry)
+			return false;
+	}
+
+	memset(pHeader,0,sizeof(tRawRecordHeader));
+	pHeader->Magic = RAW_RECORD_MAGIC;
+	pHeader->HeaderSize = headerSize;
+	pHeader->RecordSize = recordSize;
+	pHeader->Status = pFrame->Status;
+	pHeader->Width = pFrame->Width;
+	pHeader->Height = pFrame->Height;
+	pHeader->RegionX = pFrame->RegionX;
+	pHeader->RegionY = pFrame->RegionY;
+	pHeader->Format = pFrame->Format;
+	pHeader->BitDepth = pFrame->BitDepth;
+	pHeader->BayerPattern = pFrame->BayerPattern;
+	pHeader->FrameCount = pFrame->FrameCount;
+	pHeader->TimestampLo = pFrame->TimestampLo;
+	pHeader->TimestampHi = pFrame->TimestampHi;
+	pHeader->ImageSize = pFrame->ImageSize;
+	pHeader->MetadataSize = sizeof(tRawMetadata);
+	pHeader->Compression = pPayload ? pPayload->Compression : eRawCompressionNone;
+	pHeader->StoredSize = storedSize;
+
+	if(pContainer->IoMode == eRawIoDirect)
+	{
+		pBlock = (char*)RawRecordData(pFrame,pPayload) - headerSize;
+		memcpy(pBlock,pHeader,sizeof(tRawRecordHeader));
+		memcpy(pBlock + sizeof(tRawRecordHeader),pMetadata,sizeof(tRawMetadata));
+	}
+
+	pEntry = &(pContainer->Index[pContainer->IndexCount++]);
+	pEntry->Offset = pContainer->WriteOffset;
+	pEntry->Timestamp = ((unsigned long long)pFrame->TimestampHi << 32) | pFrame->TimestampLo;
+	pEntry->FrameCount = pFrame->FrameCount;
+	pEntry->RecordSize = recordSize;
+
+	*pOffset = pContainer->WriteOffset;
+	pContainer->WriteOffset += recordSize;
+	pContainer->BytesWritten += recordSize;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Append one frame and its metadata to the current segment, on the calling thread
+ * @param
+ *		container
+ * @param
+ *		frame to record
+ * @param
+ *		metadata of the frame
+ * @param
+ *		compressed image, NULL to store the image buffer
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		bool
+ */
+bool RawContainerWrite(tRawContainer *pContainer,tPvFrame *pFrame,const tRawMetadata *pMetadata,const tRawPayload *pPayload)
+{
+	static const char padding[RAW_ALIGNMENT] = {0};
+	struct
+	{
+		tRawRecordHeader	Header;
+		tRawMetadata		Metadata;
+	} record;
+	unsigned long long offset;
+	unsigned long padSize;
+	const char *pData = (const char*)RawRecordData(pFrame,pPayload);
+	bool success;
+
+	if(!RawContainerReserve(pContainer,pFrame,pMetadata,pPayload,&(record.Header),&offset))
+		return false;
+
+	if(pContainer->IoMode == eRawIoDirect)
+		success = RawFileWriteAt(pContainer->File,offset,pData - record.Header.HeaderSize,record.Header.RecordSize);
+	else
+	{
+		/*
+		Header and metadata fill the record header exactly at this alignment
+		*/
+		record.Metadata = *pMetadata;
+		padSize = record.Header.RecordSize - record.Header.HeaderSize - record.Header.StoredSize;
+		success = RawFileWriteAt(pContainer->File,offset,&record,record.Header.HeaderSize) &&
+			RawFileWriteAt(pContainer->File,offset + record.Header.HeaderSize,pData,record.Header.StoredSize) &&
+			(!padSize || RawFileWriteAt(pContainer->File,offset + record.Header.RecordSize - padSize,padding,padSize));
+	}
+
+	if(!success)
+	{
+		printf("Error in %s:%d at RawContainerWrite() ----> could not write frame %lu\n", __FILE__, __LINE__, pFrame->FrameCount);
+		/*
+		Nothing was reserved after this record, give its space back
+		*/
+		pContainer->IndexCount--;
+		pContainer->WriteOffset = offset;
+		pContainer->BytesWritten -= record.Header.RecordSize;
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Leave the record of a failed asynchronous write out of the index, so
+ *		that a reader never follows the entry to a partial record. Called from
+ *		the storage threads before the segment is drained
+ * @param
+ *		container
+ * @param
+ *		index entry of the record, as reserved
+ * @param
+ *		offset of the record, the entry is left alone if it does not match
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		RawContainerReserve(), AsyncStorageSubmit()
+ * @return
+ *		void
+ */
+void RawContainerDrop(tRawContainer *pContainer,unsigned long Entry,unsigned long long Offset)
+{
+	LockAcquire(&(pContainer->IndexLock));
+	if(Entry < pContainer->IndexCount && pContainer->Index[Entry].Offset == Offset)
+	{
+		pContainer->Index[Entry].RecordSize = 0;
+		pContainer->RecordsDropped++;
+	}
+	LockRelease(&(pContainer->IndexLock));
+}
+
+/*!
+ * @brief
+ *		Close the current segment (index and trailer included) and free the index
+ * @param
+ *		container
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void RawContainerClose(tRawContainer *pContainer)
+{
+	RawContainerCloseSegment(pContainer);
+	free(pContainer->Index);
+	pContainer->Index = NULL;
+	pContainer->IndexCount = 0;
+	pContainer->IndexCapacity = 0;
+}
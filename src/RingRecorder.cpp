@@ -0,0 +1,424 @@
+/*!
+ *  @file
+ *     RingRecorder.cpp
+ *  @brief
+ *     OTC project: Pre-trigger ring recorder. The writer thread of the camera
+ *	   keeps copies of the frames in RAM instead of writing them, a trigger
+ *	   flushes the pre-roll and opens a post-roll window during which the live
+ *	   frames are saved. The trigger listener takes the triggers sent to a
+ *	   local UDP port
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "mainHeader.h"
+#ifdef _WINDOWS
+#include <winsock2.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#endif
+
+#define RING_LISTEN_SLICE	250				// milliseconds between two checks of the stop flag
+#define RING_MESSAGE_SIZE	64
+
+
+/*!
+ * @brief
+ *		Allocate the slots of the recorder of a camera and arm it. The number of
+ *		slots is what the memory budget holds, the pre-roll keeps at most that many
+ * @param
+ *		Camera Instance
+ * @param
+ *		memory budget of the camera
+ * @param
+ *		seconds of frames flushed on a trigger
+ * @param
+ *		seconds of live frames saved after a trigger
+ * @param
+ *		TotalBytesPerFrame of the camera
+ * @param
+ *		packed area of the camera frames, 0 when the frames are not compressed
+ * @param
+ *		ancillary area of the camera frames, 0 without chunk data
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStart()
+ * @return
+ *		bool
+ */
+bool RingRecorderStart(tCamera *tCamInstance,unsigned long BudgetMB,unsigned long PreRollSeconds,
+					   unsigned long PostRollSeconds,unsigned long FrameSize,unsigned long PackedSize,
+					   unsigned long AncillarySize)
+{
+	tRingRecorder *pRecorder = &(tCamInstance->Recorder);
+	unsigned long slotSize;
+
+	memset(pRecorder,0,sizeof(tRingRecorder));
+
+	// same layout as the frame arena of the camera
+	slotSize = FrameArenaSlotSize(FrameSize,PackedSize,AncillarySize,ARENA_BLOCK_SIZE);
+
+	pRecorder->Count = (unsigned long)((unsigned long long)BudgetMB * 1024 * 1024 / slotSize);
+	if(pRecorder->Count < RING_MIN_SLOTS)
+	{
+		printf("Error in %s:%d at RingRecorderStart() ----> %lu MB do not hold %d frames of %lu bytes\n", __FILE__, __LINE__,
+			BudgetMB, RING_MIN_SLOTS, FrameSize);
+		return false;
+	}
+
+	pRecorder->Frames = (tPvFrame*)calloc(pRecorder->Count,sizeof(tPvFrame));
+	pRecorder->Metadata = (tRawMetadata*)calloc(pRecorder->Count,sizeof(tRawMetadata));
+	pRecorder->KeptAt = (unsigned long long*)calloc(pRecorder->Count,sizeof(unsigned long long));
+	pRecorder->QueueLatency = (unsigned long*)calloc(pRecorder->Count,sizeof(unsigned long));
+	if(!pRecorder->Frames || !pRecorder->Metadata || !pRecorder->KeptAt || !pRecorder->QueueLatency ||
+		!FrameArenaInit(&(pRecorder->Arena),pRecorder->Frames,pRecorder->Count,FrameSize,PackedSize,AncillarySize,ARENA_BLOCK_SIZE))
+	{
+		printf("Error in %s:%d at RingRecorderStart() ----> could not allocate %lu frame slots\n", __FILE__, __LINE__, pRecorder->Count);
+		free(pRecorder->Frames);
+		free(pRecorder->Metadata);
+		free(pRecorder->KeptAt);
+		free(pRecorder->QueueLatency);
+		memset(pRecorder,0,sizeof(tRingRecorder));
+		return false;
+	}
+
+	pRecorder->PreRoll = (unsigned long long)PreRollSeconds * 1000000;
+	pRecorder->PostRoll = (unsigned long long)PostRollSeconds * 1000000;
+	pRecorder->Enabled = true;
+
+	printf("ring recorder of camera %lu: %lu frames in %lu MB, %lu s pre-roll, %lu s post-roll\n",
+		tCamInstance->UID,pRecorder->Count,BudgetMB,PreRollSeconds,PostRollSeconds);
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Free the slots. The writer must be stopped, it flushes the triggers
+ *		still pending before it is over
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraUnsetup()
+ * @return
+ *		void
+ */
+void RingRecorderStop(tCamera *tCamInstance)
+{
+	tRingRecorder *pRecorder = &(tCamInstance->Recorder);
+
+	if(!pRecorder->Enabled)
+		return;
+
+	FrameArenaDestroy(&(pRecorder->Arena),pRecorder->Frames);
+	free(pRecorder->Frames);
+	free(pRecorder->Metadata);
+	free(pRecorder->KeptAt);
+	free(pRecorder->QueueLatency);
+	memset(pRecorder,0,sizeof(tRingRecorder));
+}
+
+/*!
+ * @brief
+ *		Ask for a flush. Never blocks, can be called from the threads that run
+ *		while the camera is attached: its frame done callback and writer, and the
+ *		control loop, which is the only one that detaches it
+ * @param
+ *		Camera Instance
+ * @param
+ *		what triggered the flush
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		RingRecorderService()
+ * @return
+ *		void
+ */
+void RingRecorderTrigger(tCamera *tCamInstance,tRingTrigger Reason)
+{
+	tRingRecorder *pRecorder = &(tCamInstance->Recorder);
+
+	if(!pRecorder->Enabled)
+		return;
+
+	pRecorder->LastTrigger = Reason;
+	AtomicIncrement(&(pRecorder->Triggers));
+
+	// the writer may be waiting for a frame
+	if(tCamInstance->Writer.Running)
+		FrameRingWake(&(tCamInstance->Writer.Ring));
+}
+
+/*!
+ * @brief
+ *		Copy a frame in the oldest slot when the recorder is armed. Runs on the
+ *		writer thread, the camera frame can be re-queued straight away
+ * @param
+ *		Camera Instance
+ * @param
+ *		completed frame
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameWriterThread()
+ * @return
+ *		false if the frame has to be saved: no recorder, flush or post-roll going on
+ */
+bool RingRecorderKeep(tCamera *tCamInstance,tPvFrame *pFrame)
+{
+	tRingRecorder *pRecorder = &(tCamInstance->Recorder);
+	tPvFrame *pSlot;
+	void *buffer,*ancillary;
+	unsigned long bufferSize,ancillarySize,index;
+
+	if(!pRecorder->Enabled || pRecorder->FlushLeft || pRecorder->PostRollUntil)
+		return false;
+
+	if(pRecorder->Used == pRecorder->Count)
+	{
+		pRecorder->Head = (pRecorder->Head + 1) % pRecorder->Count;
+		pRecorder->Used--;
+		pRecorder->FramesOverwritten++;
+	}
+
+	index = (pRecorder->Head + pRecorder->Used) % pRecorder->Count;
+	pSlot = &(pRecorder->Frames[index]);
+
+	/*
+	Everything but the buffers, Context included: the copy is saved like the frame
+	*/
+	buffer = pSlot->ImageBuffer;
+	bufferSize = pSlot->ImageBufferSize;
+	ancillary = pSlot->AncillaryBuffer;
+	ancillarySize = pSlot->AncillaryBufferSize;
+	*pSlot = *pFrame;
+	pSlot->ImageBuffer = buffer;
+	pSlot->ImageBufferSize = bufferSize;
+	pSlot->AncillaryBuffer = ancillary;
+	pSlot->AncillaryBufferSize = ancillarySize;
+	memcpy(buffer,pFrame->ImageBuffer,pFrame->ImageSize < bufferSize ? pFrame->ImageSize : bufferSize);
+	if(ancillary && pFrame->AncillaryBuffer)
+		memcpy(ancillary,pFrame->AncillaryBuffer,pFrame->AncillarySize < ancillarySize ? pFrame->AncillarySize : ancillarySize);
+	else
+		pSlot->AncillarySize = 0;
+
+	FrameReadMetadata(tCamInstance,pFrame,&(pRecorder->Metadata[index]));
+	pRecorder->KeptAt[index] = GetMicroseconds();
+	pRecorder->QueueLatency[index] = FrameQueueLatency(tCamInstance,pFrame);
+	pRecorder->Used++;
+	pRecorder->FramesKept++;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Serve the pending triggers and write one pre-roll frame. Called by the
+ *		writer thread between two live frames so a flush never holds the
+ *		camera frames back for long
+ * @param
+ *		Camera Instance
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		FrameWriterThread()
+ * @return
+ *		true while pre-roll frames are left to write
+ */
+bool RingRecorderService(tCamera *tCamInstance)
+{
+	tRingRecorder *pRecorder = &(tCamInstance->Recorder);
+	unsigned long long now;
+	long triggers;
+
+	if(!pRecorder->Enabled)
+		return false;
+
+	now = GetMicroseconds();
+	triggers = pRecorder->Triggers;
+	if(triggers != pRecorder->TriggersServed)
+	{
+		pRecorder->TriggersServed = triggers;
+
+		/*
+		Armed: what is older than the pre-roll is dropped, the rest is flushed.
+		In the post-roll the window is only extended
+		*/
+		if(!pRecorder->FlushLeft && !pRecorder->PostRollUntil)
+		{
+			while(pRecorder->Used && now - pRecorder->KeptAt[pRecorder->Head] > pRecorder->PreRoll)
+			{
+				pRecorder->Head = (pRecorder->Head + 1) % pRecorder->Count;
+				pRecorder->Used--;
+			}
+			pRecorder->FlushLeft = pRecorder->Used;
+			printf("\ncamera %lu triggered (%d), flushing %lu pre-roll frames\n",
+				tCamInstance->UID,(int)pRecorder->LastTrigger,pRecorder->FlushLeft);
+		}
+		pRecorder->PostRollUntil = now + pRecorder->PostRoll;
+	}
+
+	if(pRecorder->FlushLeft)
+	{
+		FrameSave(tCamInstance,&(pRecorder->Frames[pRecorder->Head]),&(pRecorder->Metadata[pRecorder->Head]));
+		pRecorder->Head = (pRecorder->Head + 1) % pRecorder->Count;
+		pRecorder->Used--;
+		pRecorder->FlushLeft--;
+		pRecorder->FramesFlushed++;
+		return pRecorder->FlushLeft != 0;
+	}
+
+	// post-roll over, back to RAM only
+	if(pRecorder->PostRollUntil && now >= pRecorder->PostRollUntil)
+		pRecorder->PostRollUntil = 0;
+
+	return false;
+}
+
+/*
+	Copies are written synchronously, the asynchronous storage only knows the camera frames
+*/
+bool RingRecorderOwns(const tRingRecorder *pRecorder,const tPvFrame *pFrame)
+{
+	return pRecorder->Enabled && pFrame >= pRecorder->Frames && pFrame < pRecorder->Frames + pRecorder->Count;
+}
+
+const char *RingRecorderState(const tRingRecorder *pRecorder)
+{
+	if(pRecorder->FlushLeft)
+		return "flush";
+	if(pRecorder->PostRollUntil)
+		return "post ";
+
+	return "armed";
+}
+
+
+/*
+	Trigger listener: one datagram "trigger" (every camera) or "trigger UID" on
+	127.0.0.1:Port per flush
+*/
+#ifdef _WINDOWS
+typedef SOCKET tRingSocket;
+#define RING_BAD_SOCKET		INVALID_SOCKET
+#define RingSocketClose		closesocket
+#else
+typedef int tRingSocket;
+#define RING_BAD_SOCKET		(-1)
+#define RingSocketClose		close
+#endif
+
+static tRingSocket gTriggerSocket = RING_BAD_SOCKET;
+static tThread gTriggerThread;
+static volatile bool gTriggerStop = false;
+static tRingTriggerCallback gTriggerCallback = NULL;
+
+static THREADPROC RingTriggerListener(void * /*pContext*/)
+{
+	char message[RING_MESSAGE_SIZE];
+	struct timeval timeout;
+	fd_set readable;
+	int received;
+
+	while(!gTriggerStop)
+	{
+		FD_ZERO(&readable);
+		FD_SET(gTriggerSocket,&readable);
+		timeout.tv_sec = 0;
+		timeout.tv_usec = RING_LISTEN_SLICE * 1000;
+		if(select((int)gTriggerSocket + 1,&readable,NULL,NULL,&timeout) <= 0)
+			continue;
+
+		received = recv(gTriggerSocket,message,RING_MESSAGE_SIZE - 1,0);
+		if(received <= 0)
+			continue;
+		message[received] = 0;
+
+		if(!strncmp(message,"trigger",7))
+			gTriggerCallback(strtoul(message + 7,NULL,10));
+		else
+			printf("Unknown trigger message %s\n",message);
+	}
+
+	return 0;
+}
+
+/*!
+ * @brief
+ *		Listen for triggers on a local UDP port
+ * @param
+ *		port, bound on the loopback interface only
+ * @param
+ *		called on the listener thread with the UID of the camera to flush, 0 for
+ *		all of them. The cameras may be detached meanwhile, it hands the trigger
+ *		over to the control loop
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		bool
+ */
+bool RingTriggerListenerStart(unsigned short Port,tRingTriggerCallback Callback)
+{
+	struct sockaddr_in address;
+
+#ifdef _WINDOWS
+	WSADATA wsaData;
+
+	if(WSAStartup(MAKEWORD(2,2),&wsaData))
+	{
+		printf("Error in %s:%d at RingTriggerListenerStart() ----> WSAStartup failed\n", __FILE__, __LINE__);
+		return false;
+	}
+#endif
+
+	gTriggerSocket = socket(AF_INET,SOCK_DGRAM,0);
+	if(gTriggerSocket == RING_BAD_SOCKET)
+	{
+		printf("Error in %s:%d at RingTriggerListenerStart() ----> could not create the socket\n", __FILE__, __LINE__);
+		return false;
+	}
+
+	memset(&address,0,sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(Port);
+	if(bind(gTriggerSocket,(struct sockaddr*)&address,sizeof(address)))
+	{
+		printf("Error in %s:%d at RingTriggerListenerStart() ----> could not bind port %u\n", __FILE__, __LINE__, Port);
+		RingSocketClose(gTriggerSocket);
+		gTriggerSocket = RING_BAD_SOCKET;
+		return false;
+	}
+
+	gTriggerCallback = Callback;
+	gTriggerStop = false;
+	if(!ThreadSpawn(&gTriggerThread,RingTriggerListener,NULL))
+	{
+		printf("Error in %s:%d at RingTriggerListenerStart() ----> could not start the listener thread\n", __FILE__, __LINE__);
+		RingSocketClose(gTriggerSocket);
+		gTriggerSocket = RING_BAD_SOCKET;
+		return false;
+	}
+
+	printf("listening for triggers on 127.0.0.1:%u\n",Port);
+	return true;
+}
+
+void RingTriggerListenerStop()
+{
+	if(gTriggerSocket == RING_BAD_SOCKET)
+		return;
+
+	gTriggerStop = true;
+	ThreadJoin(&gTriggerThread);
+	RingSocketClose(gTriggerSocket);
+	gTriggerSocket = RING_BAD_SOCKET;
+}
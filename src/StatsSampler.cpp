@@ -0,0 +1,343 @@
+/*!
+ *  @file
+ *     StatsSampler.cpp
+ *  @brief
+ *     OTC project: Stream statistics of a camera, in one batched register read
+ *	   where the register map of the camera is known, as attributes otherwise
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "StatsSampler.h"
+#include "PvRegIo.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define STATS_BENCH_CAMERAS		8
+
+/*!
+ * @brief
+ *		Registers of the statistics of a camera model, in the order of
+ *		tStatIndex, 0 for a statistic without one
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	unsigned long		PartNumber;
+	unsigned long		Address[eStatCount];
+
+} tStatsRegisterMap;
+
+static const tStatsRegisterMap gStatsMaps[] =
+{
+#ifdef PV_SIMULATOR
+	// PvAPI simulator, stream statistics block of PvSimulator.h (SIM_REG_STATS)
+	{ 2100,	{ 0x00011000, 0x00011004, 0x00011008, 0x0001100C, 0x00011014 } },
+#endif
+	// end of the maps, the array is never empty
+	{ 0,	{ 0 } }
+};
+
+static const char *gStatsNames[eStatCount] = { "StatFramesCompleted", "StatFramesDropped", "StatPacketsMissed", "StatPacketsErroneous", "StatFrameRate" };
+
+/*
+	One statistic as an attribute, through its handle
+*/
+static tPvErr StatsReadAttribute(tStatsSampler *pSampler,unsigned long Index,tStreamStats *pStats)
+{
+	tAttributeTable *pTable = pSampler->pTable;
+
+	AtomicIncrement(&(pSampler->Transactions));
+	switch(Index)
+	{
+	case eStatFramesCompleted:
+		return AttributeUint32Get(pTable,pTable->FramesCompleted,&(pStats->FramesCompleted));
+	case eStatFramesDropped:
+		return AttributeUint32Get(pTable,pTable->FramesDropped,&(pStats->FramesDropped));
+	case eStatPacketsMissed:
+		return AttributeUint32Get(pTable,pTable->PacketsMissed,&(pStats->PacketsMissed));
+	case eStatPacketsErroneous:
+		return AttributeUint32Get(pTable,pTable->PacketsErroneous,&(pStats->PacketsErroneous));
+	default:
+		return AttributeFloat32Get(pTable,pTable->FrameRate,&(pStats->FrameRate));
+	}
+}
+
+/*
+	One statistic from its register, 32 bits
+*/
+static void StatsStore(unsigned long Index,unsigned long Data,tStreamStats *pStats)
+{
+	unsigned int bits = (unsigned int)Data;
+
+	switch(Index)
+	{
+	case eStatFramesCompleted:
+		pStats->FramesCompleted = bits;
+		break;
+	case eStatFramesDropped:
+		pStats->FramesDropped = bits;
+		break;
+	case eStatPacketsMissed:
+		pStats->PacketsMissed = bits;
+		break;
+	case eStatPacketsErroneous:
+		pStats->PacketsErroneous = bits;
+		break;
+	default:
+		memcpy(&(pStats->FrameRate),&bits,sizeof(bits));
+		break;
+	}
+}
+
+/*!
+ * @brief
+ *		Set the sampler of a camera up once it is open: the registers of its
+ *		part number, if they are known
+ * @param
+ *		sampler
+ * @param
+ *		attribute table of the camera, open
+ * @param
+ *		UID of the camera
+ * @param
+ *		false to read every statistic as an attribute
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraSetup()
+ * @return
+ *		void
+ */
+void StatsSamplerOpen(tStatsSampler *pSampler,tAttributeTable *pTable,unsigned long UID,bool Registers)
+{
+	tPvCameraInfo info;
+	unsigned long i,s;
+
+	memset(pSampler,0,sizeof(tStatsSampler));
+	pSampler->pTable = pTable;
+	if(!Registers || PvCameraInfo(UID,&info))
+		return;
+
+	for(i=0;gStatsMaps[i].PartNumber;i++)
+	{
+		if(gStatsMaps[i].PartNumber != info.PartNumber)
+			continue;
+		for(s=0;s<eStatCount;s++)
+		{
+			pSampler->Address[s] = gStatsMaps[i].Address[s];
+			if(pSampler->Address[s])
+				pSampler->Mapped++;
+		}
+		break;
+	}
+}
+
+/*!
+ * @brief
+ *		Sample the stream statistics of a camera: the mapped ones in one
+ *		register read, the others as attributes
+ * @param
+ *		sampler
+ * @param
+ *		statistics, 0 for the ones that could not be read
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraStatsTask()
+ * @return
+ *		the first error, ePvErrSuccess if every statistic was read
+ */
+tPvErr StatsSamplerRead(tStatsSampler *pSampler,tStreamStats *pStats)
+{
+	unsigned long address[eStatCount];
+	unsigned long data[eStatCount];
+	unsigned long index[eStatCount];
+	unsigned long i,count = 0,complete = 0;
+	bool batched[eStatCount];
+	tPvErr err,first = ePvErrSuccess;
+
+	memset(pStats,0,sizeof(tStreamStats));
+	memset(batched,0,sizeof(batched));
+	for(i=0;i<eStatCount;i++)
+	{
+		if(!pSampler->Address[i])
+			continue;
+		address[count] = pSampler->Address[i];
+		index[count++] = i;
+	}
+
+	if(count)
+	{
+		err = PvRegisterRead(pSampler->pTable->Camera,count,address,data,&complete);
+		AtomicIncrement(&(pSampler->Transactions));
+		if(err == ePvErrUnplugged || err == ePvErrBadHandle)
+			return err;
+		if(err)
+		{
+			// the map is wrong for this camera, the attributes from now on
+			printf("Error in %s:%d at StatsSamplerRead() ----> register %s : ", __FILE__, __LINE__,
+				complete < count ? gStatsNames[index[complete]] : "batch");
+			convertandPrintErrorCode(err);
+			memset(pSampler->Address,0,sizeof(pSampler->Address));
+			pSampler->Mapped = 0;
+			count = 0;
+		}
+		for(i=0;i<count;i++)
+		{
+			StatsStore(index[i],data[i],pStats);
+			batched[index[i]] = true;
+		}
+	}
+
+	for(i=0;i<eStatCount;i++)
+	{
+		if(batched[i])
+			continue;
+		err = StatsReadAttribute(pSampler,i,pStats);
+		if(err && !first)
+			first = err;
+	}
+	AtomicIncrement(&(pSampler->Samples));
+
+	return first;
+}
+
+/*!
+ * @brief
+ *		Camera of the statistics benchmark, sampled by a thread of its own the
+ *		way the statistics threads did
+ *
+ * @author Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @version 1.0
+ */
+typedef struct
+{
+	tPvHandle			Handle;
+	tAttributeTable		Table;
+	tStatsSampler		Sampler;
+	tThread				Thread;
+	bool				Running;
+	volatile bool		Stop;
+	unsigned long long	Busy;				// microseconds in StatsSamplerRead()
+	tPvErr				Error;
+
+} tStatsBenchCamera;
+
+static THREADPROC StatsBenchThread(void *pContext)
+{
+	tStatsBenchCamera *pCamera = (tStatsBenchCamera*)pContext;
+	tStreamStats stats;
+	unsigned long long start;
+
+	while(!pCamera->Stop)
+	{
+		start = GetMicroseconds();
+		pCamera->Error = StatsSamplerRead(&(pCamera->Sampler),&stats);
+		pCamera->Busy += GetMicroseconds() - start;
+		if(pCamera->Error)
+			break;
+		Sleep(STATS_PERIOD);
+	}
+
+	return 0;
+}
+
+/*
+	Benchmark: control transactions of the statistics threads of every camera
+	found, statistics read as attributes then in batched register reads
+*/
+void StatsSamplerBenchmark()
+{
+	static char environment[] = "PVSIM=cameras=4,width=640,height=480,fps=30,discovery=0,control=1";
+	static tStatsBenchCamera cameras[STATS_BENCH_CAMERAS];
+	static const char *modes[] = { "attributes", "registers" };
+	tPvCameraInfo info[STATS_BENCH_CAMERAS];
+	unsigned long long start,elapsed,busy;
+	unsigned long count,i,m,waited = 0;
+	long samples,transactions;
+
+	// control transactions that take the time of a GigE round trip, unless they are set already
+	if(!getenv("PVSIM"))
+		putenv(environment);
+
+	printf("Statistics benchmark, one sample every %d ms per camera for %d s\n",STATS_PERIOD,STATS_BENCH_SECONDS);
+	if(PvInitialize())
+	{
+		printf("Error in %s:%d at StatsSamplerBenchmark() ----> PvInitialize failed\n", __FILE__, __LINE__);
+		return;
+	}
+	while(!PvCameraCount() && waited < 5000)
+	{
+		Sleep(250);
+		waited += 250;
+	}
+	count = PvCameraList(info,STATS_BENCH_CAMERAS,NULL);
+	for(i=0;i<count;i++)
+	{
+		memset(&(cameras[i]),0,sizeof(tStatsBenchCamera));
+		if(PvCameraOpen(info[i].UniqueId,ePvAccessMaster,&(cameras[i].Handle)))
+		{
+			printf("Error in %s:%d at StatsSamplerBenchmark() ----> camera %lu did not open\n", __FILE__, __LINE__, info[i].UniqueId);
+			break;
+		}
+		AttributeTableOpen(&(cameras[i].Table),cameras[i].Handle);
+	}
+	count = i;
+	if(!count)
+	{
+		printf("Error in %s:%d at StatsSamplerBenchmark() ----> no camera to open\n", __FILE__, __LINE__);
+		PvUnInitialize();
+		return;
+	}
+
+	for(m=0;m<2;m++)
+	{
+		for(i=0;i<count;i++)
+		{
+			StatsSamplerOpen(&(cameras[i].Sampler),&(cameras[i].Table),info[i].UniqueId,m != 0);
+			cameras[i].Stop = false;
+			cameras[i].Busy = 0;
+			cameras[i].Error = ePvErrSuccess;
+			cameras[i].Running = ThreadSpawn(&(cameras[i].Thread),StatsBenchThread,&(cameras[i]));
+			if(!cameras[i].Running)
+				printf("Error in %s:%d at StatsSamplerBenchmark() ----> could not start the sampler of camera %lu\n", __FILE__, __LINE__, info[i].UniqueId);
+		}
+
+		start = GetMicroseconds();
+		Sleep(STATS_BENCH_SECONDS * 1000);
+		for(i=0;i<count;i++)
+			cameras[i].Stop = true;
+		for(i=0;i<count;i++)
+			if(cameras[i].Running)
+				ThreadJoin(&(cameras[i].Thread));
+		elapsed = GetMicroseconds() - start;
+
+		samples = 0;
+		transactions = 0;
+		busy = 0;
+		for(i=0;i<count;i++)
+		{
+			samples += cameras[i].Sampler.Samples;
+			transactions += cameras[i].Sampler.Transactions;
+			busy += cameras[i].Busy;
+			if(cameras[i].Error)
+			{
+				printf("  camera %lu stopped : ",info[i].UniqueId);
+				convertandPrintErrorCode(cameras[i].Error);
+			}
+		}
+		printf("  %-10s : %lu camera(s), %lu of %d statistics batched, %7.1f samples/s, %7.1f transactions/s, %4.2f per sample, %6.2f ms per sample\n",
+			modes[m],count,cameras[0].Sampler.Mapped,eStatCount,(double)samples * 1000000.0 / (double)elapsed,
+			(double)transactions * 1000000.0 / (double)elapsed,samples ? (double)transactions / (double)samples : 0.0,
+			samples ? (double)busy / 1000.0 / (double)samples : 0.0);
+	}
+
+	for(i=0;i<count;i++)
+		PvCameraClose(cameras[i].Handle);
+	PvUnInitialize();
+}
@@ -0,0 +1,387 @@
+/*!
+ *  @file
+ *     TiffWriter.cpp
+ *  @brief
+ *     OTC project: Native TIFF writer. Replaces ImageWriteTiff() of ImageLib
+ *	   for the formats of our cameras, the header is prepared once per camera
+ *	   and the pixels are never copied
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "TiffWriter.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WINDOWS
+#include <ImageLib.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+/*
+	TIFF tags and field types used by the writer
+*/
+#define TIFF_SHORT					3
+#define TIFF_LONG					4
+#define TIFF_RATIONAL				5
+#define TIFF_BYTE					1
+
+#define TAG_IMAGEWIDTH				256
+#define TAG_IMAGELENGTH				257
+#define TAG_BITSPERSAMPLE			258
+#define TAG_COMPRESSION				259
+#define TAG_PHOTOMETRIC				262
+#define TAG_STRIPOFFSETS			273
+#define TAG_SAMPLESPERPIXEL			277
+#define TAG_ROWSPERSTRIP			278
+#define TAG_STRIPBYTECOUNTS			279
+#define TAG_XRESOLUTION				282
+#define TAG_YRESOLUTION				283
+#define TAG_PLANARCONFIG			284
+#define TAG_RESOLUTIONUNIT			296
+#define TAG_CFAREPEATPATTERNDIM		33421
+#define TAG_CFAPATTERN				33422
+
+#define PHOTOMETRIC_MINISBLACK		1
+#define PHOTOMETRIC_RGB				2
+#define PHOTOMETRIC_CFA				32803
+
+
+static void TiffPut16(unsigned char *p,unsigned long Value)
+{
+	p[0] = (unsigned char)(Value & 0xFF);
+	p[1] = (unsigned char)((Value >> 8) & 0xFF);
+}
+
+static void TiffPut32(unsigned char *p,unsigned long Value)
+{
+	TiffPut16(p,Value & 0xFFFF);
+	TiffPut16(p + 2,(Value >> 16) & 0xFFFF);
+}
+
+/*
+	One IFD entry, a SHORT value fitting in the entry is left-justified
+*/
+static unsigned char *TiffEntry(unsigned char *p,unsigned long Tag,unsigned long Type,unsigned long Count,unsigned long Value)
+{
+	TiffPut16(p,Tag);
+	TiffPut16(p + 2,Type);
+	TiffPut32(p + 4,Count);
+	TiffPut32(p + 8,0);
+	if(Type == TIFF_SHORT && Count == 1)
+		TiffPut16(p + 8,Value);
+	else
+		TiffPut32(p + 8,Value);
+	return p + 12;
+}
+
+/*!
+ * @brief
+ *		Build the header of the TIFF files of a frame description
+ * @param
+ *		writer of a camera
+ * @param
+ *		frame giving the format and the geometry
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+static void TiffWriterBuildHeader(tTiffWriter *pWriter,const tPvFrame *pFrame)
+{
+	/*
+	Color of each cell of the 2x2 Bayer tile for each tPvBayerPattern
+	(0 red, 1 green, 2 blue)
+	*/
+	static const unsigned char cfaPatterns[4][4] = {{0,1,1,2},{1,2,0,1},{1,0,2,1},{2,1,1,0}};
+	unsigned char *pHeader = pWriter->Header;
+	unsigned char *p;
+	unsigned long samples,bits,photometric,entries,extra,pixels;
+	bool bayer = false;
+
+	switch(pFrame->Format)
+	{
+	case ePvFmtMono8:
+		samples = 1; bits = 8; photometric = PHOTOMETRIC_MINISBLACK;
+		break;
+	case ePvFmtMono16:
+		samples = 1; bits = 16; photometric = PHOTOMETRIC_MINISBLACK;
+		break;
+	case ePvFmtBayer8:
+		samples = 1; bits = 8; photometric = PHOTOMETRIC_CFA; bayer = true;
+		break;
+	case ePvFmtBayer16:
+		samples = 1; bits = 16; photometric = PHOTOMETRIC_CFA; bayer = true;
+		break;
+	case ePvFmtRgb48:
+		samples = 3; bits = 16; photometric = PHOTOMETRIC_RGB;
+		break;
+	default:
+		samples = 3; bits = 8; photometric = PHOTOMETRIC_RGB;
+		break;
+	}
+
+	/*
+	Header, IFD, values not fitting in the IFD (BitsPerSample of RGB and the
+	resolutions), then the pixels on a 16 bytes boundary
+	*/
+	entries = bayer ? 15 : 13;
+	extra = 8 + 2 + entries * 12 + 4;
+	pixels = extra + 8 + 8 + 8;
+	pixels = (pixels + 15) & ~15UL;
+
+	memset(pHeader,0,TIFF_HEADER_MAX);
+	pHeader[0] = 'I';
+	pHeader[1] = 'I';
+	TiffPut16(pHeader + 2,42);
+	TiffPut32(pHeader + 4,8);
+	TiffPut16(pHeader + 8,entries);
+
+	p = pHeader + 10;
+	p = TiffEntry(p,TAG_IMAGEWIDTH,TIFF_LONG,1,pFrame->Width);
+	p = TiffEntry(p,TAG_IMAGELENGTH,TIFF_LONG,1,pFrame->Height);
+	if(samples == 1)
+		p = TiffEntry(p,TAG_BITSPERSAMPLE,TIFF_SHORT,1,bits);
+	else
+	{
+		p = TiffEntry(p,TAG_BITSPERSAMPLE,TIFF_SHORT,3,extra);
+		TiffPut16(pHeader + extra,bits);
+		TiffPut16(pHeader + extra + 2,bits);
+		TiffPut16(pHeader + extra + 4,bits);
+	}
+	p = TiffEntry(p,TAG_COMPRESSION,TIFF_SHORT,1,1);
+	p = TiffEntry(p,TAG_PHOTOMETRIC,TIFF_SHORT,1,photometric);
+	p = TiffEntry(p,TAG_STRIPOFFSETS,TIFF_LONG,1,pixels);
+	p = TiffEntry(p,TAG_SAMPLESPERPIXEL,TIFF_SHORT,1,samples);
+	p = TiffEntry(p,TAG_ROWSPERSTRIP,TIFF_LONG,1,pFrame->Height);
+	p = TiffEntry(p,TAG_STRIPBYTECOUNTS,TIFF_LONG,1,pFrame->ImageSize);
+	p = TiffEntry(p,TAG_XRESOLUTION,TIFF_RATIONAL,1,extra + 8);
+	p = TiffEntry(p,TAG_YRESOLUTION,TIFF_RATIONAL,1,extra + 16);
+	p = TiffEntry(p,TAG_PLANARCONFIG,TIFF_SHORT,1,1);
+	p = TiffEntry(p,TAG_RESOLUTIONUNIT,TIFF_SHORT,1,2);
+	if(bayer)
+	{
+		p = TiffEntry(p,TAG_CFAREPEATPATTERNDIM,TIFF_SHORT,2,0);
+		TiffPut16(p - 4,2);
+		TiffPut16(p - 2,2);
+		p = TiffEntry(p,TAG_CFAPATTERN,TIFF_BYTE,4,0);
+		memcpy(p - 4,cfaPatterns[pFrame->BayerPattern & 3],4);
+	}
+	TiffPut32(p,0);
+
+	// 72 dpi
+	TiffPut32(pHeader + extra + 8,72);
+	TiffPut32(pHeader + extra + 12,1);
+	TiffPut32(pHeader + extra + 16,72);
+	TiffPut32(pHeader + extra + 20,1);
+
+	pWriter->Format = pFrame->Format;
+	pWriter->Width = pFrame->Width;
+	pWriter->Height = pFrame->Height;
+	pWriter->BitDepth = pFrame->BitDepth;
+	pWriter->BayerPattern = pFrame->BayerPattern;
+	pWriter->ImageSize = pFrame->ImageSize;
+	pWriter->HeaderSize = pixels;
+	pWriter->HeadersBuilt++;
+}
+
+void TiffWriterInit(tTiffWriter *pWriter)
+{
+	memset(pWriter,0,sizeof(tTiffWriter));
+}
+
+/*!
+ * @brief
+ *		Tell if the native writer handles the format of a frame, ImageLib is
+ *		still needed for the others
+ * @param
+ *		frame
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		bool
+ */
+bool TiffWriterSupports(const tPvFrame *pFrame)
+{
+	switch(pFrame->Format)
+	{
+	case ePvFmtMono8:
+	case ePvFmtMono16:
+	case ePvFmtBayer8:
+	case ePvFmtBayer16:
+	case ePvFmtRgb24:
+	case ePvFmtRgb48:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*!
+ * @brief
+ *		Save a frame in a TIFF file: the cached header and the image buffer,
+ *		in one gathered write
+ * @param
+ *		writer of the camera
+ * @param
+ *		name of the file
+ * @param
+ *		frame to save
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		TiffWriterSupports()
+ * @return
+ *		bool
+ */
+bool TiffWriterWrite(tTiffWriter *pWriter,const char *Filename,const tPvFrame *pFrame)
+{
+	bool success;
+
+	if(!TiffWriterSupports(pFrame))
+		return false;
+
+	if(!pWriter->HeaderSize ||
+		pWriter->Format != pFrame->Format ||
+		pWriter->Width != pFrame->Width ||
+		pWriter->Height != pFrame->Height ||
+		pWriter->BitDepth != pFrame->BitDepth ||
+		pWriter->BayerPattern != pFrame->BayerPattern ||
+		pWriter->ImageSize != pFrame->ImageSize)
+		TiffWriterBuildHeader(pWriter,pFrame);
+
+#ifdef _WINDOWS
+	HANDLE file;
+	DWORD written;
+
+	/*
+	WriteFileGather() wants unbuffered page-aligned writes, two writes on the
+	same handle still avoid any copy of the pixels
+	*/
+	file = CreateFileA(Filename,GENERIC_WRITE,0,NULL,CREATE_ALWAYS,FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,NULL);
+	if(file == INVALID_HANDLE_VALUE)
+		return false;
+
+	success = WriteFile(file,pWriter->Header,pWriter->HeaderSize,&written,NULL) && written == pWriter->HeaderSize &&
+		WriteFile(file,pFrame->ImageBuffer,pFrame->ImageSize,&written,NULL) && written == pFrame->ImageSize;
+	CloseHandle(file);
+#else
+	struct iovec parts[2];
+	ssize_t expected = pWriter->HeaderSize + pFrame->ImageSize;
+	int file;
+
+	file = open(Filename,O_WRONLY | O_CREAT | O_TRUNC,0644);
+	if(file < 0)
+		return false;
+
+	parts[0].iov_base = pWriter->Header;
+	parts[0].iov_len = pWriter->HeaderSize;
+	parts[1].iov_base = pFrame->ImageBuffer;
+	parts[1].iov_len = pFrame->ImageSize;
+
+	success = writev(file,parts,2) == expected;
+	close(file);
+#endif
+
+	if(success)
+	{
+		pWriter->FilesWritten++;
+		pWriter->BytesWritten += pWriter->HeaderSize + pFrame->ImageSize;
+	}
+
+	return success;
+}
+
+
+/*
+	Benchmark: the same frame saved over and over in the current directory
+*/
+#define BENCH_TIFF_COUNT	200
+
+static void TiffWriterBenchRun(tPvImageFormat Format,unsigned long Width,unsigned long Height)
+{
+	static const char *formats[] = {"Mono8","Mono16","Bayer8","Bayer16","Rgb24","Rgb48"};
+	tTiffWriter writer;
+	tPvFrame frame;
+	char filename[32];
+	unsigned long bytesPerPixel;
+	unsigned long long start,native;
+	unsigned long i;
+
+	memset(&frame,0,sizeof(tPvFrame));
+	frame.Format = Format;
+	frame.Width = Width;
+	frame.Height = Height;
+	bytesPerPixel = (Format == ePvFmtMono16 || Format == ePvFmtBayer16) ? 2 :
+		Format == ePvFmtRgb24 ? 3 : Format == ePvFmtRgb48 ? 6 : 1;
+	frame.BitDepth = bytesPerPixel == 2 || bytesPerPixel == 6 ? 12 : 8;
+	frame.ImageSize = Width * Height * bytesPerPixel;
+	frame.ImageBufferSize = frame.ImageSize;
+	frame.ImageBuffer = malloc(frame.ImageSize);
+	if(!frame.ImageBuffer)
+		return;
+	for(i=0;i<frame.ImageSize;i++)
+		((unsigned char*)frame.ImageBuffer)[i] = (unsigned char)(i * 7);
+
+	TiffWriterInit(&writer);
+	start = GetMicroseconds();
+	for(i=0;i<BENCH_TIFF_COUNT;i++)
+	{
+		sprintf(filename,"./bench%03lu.tiff",i % 10);
+		if(!TiffWriterWrite(&writer,filename,&frame))
+			break;
+	}
+	native = GetMicroseconds() - start;
+
+	printf("%-7s %5lux%-5lu native   %8.1f MB/s %7.1f files/s",formats[Format],Width,Height,
+		(double)frame.ImageSize * i / (double)native,(double)i * 1000000.0 / (double)native);
+
+#ifdef _WINDOWS
+	unsigned long long imagelib;
+
+	start = GetMicroseconds();
+	for(i=0;i<BENCH_TIFF_COUNT;i++)
+	{
+		sprintf(filename,"./bench%03lu.tiff",i % 10);
+		if(!ImageWriteTiff(filename,&frame))
+			break;
+	}
+	imagelib = GetMicroseconds() - start;
+
+	printf(" | ImageLib %8.1f MB/s %7.1f files/s",
+		(double)frame.ImageSize * i / (double)imagelib,(double)i * 1000000.0 / (double)imagelib);
+#endif
+	printf("\n");
+
+	for(i=0;i<10;i++)
+	{
+		sprintf(filename,"./bench%03lu.tiff",i);
+		remove(filename);
+	}
+	free(frame.ImageBuffer);
+}
+
+/*!
+ * @brief
+ *		Compare the native TIFF writer with ImageWriteTiff() (Windows only) on
+ *		files created in the current directory
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void TiffWriterBenchmark()
+{
+	static const tPvImageFormat formats[] = {ePvFmtMono8,ePvFmtMono16,ePvFmtBayer8,ePvFmtBayer16,ePvFmtRgb24};
+	static const unsigned long sizes[][2] = {{640,480},{1360,1024},{2448,2050}};
+	unsigned int f,s;
+
+	printf("TIFF benchmark, %d files per run\n",BENCH_TIFF_COUNT);
+	for(f=0;f<sizeof(formats)/sizeof(formats[0]);f++)
+		for(s=0;s<sizeof(sizes)/sizeof(sizes[0]);s++)
+			TiffWriterBenchRun(formats[f],sizes[s][0],sizes[s][1]);
+}
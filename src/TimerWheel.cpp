@@ -0,0 +1,532 @@
+/*!
+ *  @file
+ *     TimerWheel.cpp
+ *  @brief
+ *     OTC project: Timer wheel, the periodic tasks of every camera on one
+ *	   scheduler thread
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "TimerWheel.h"
+#include "StatsSampler.h"
+#include <string.h>
+
+static tLock gWheelLock;						// the slots and the timers
+static tLock gWheelRunLock;						// held while the tasks of a tick run
+static tEvent gWheelWake;
+static tThread gWheelThread;
+static bool gWheelRunning = false;
+static volatile bool gWheelStop;
+static tWheelTimer gWheelTimers[WHEEL_MAX_TIMERS];
+static unsigned long gWheelSlots[WHEEL_SLOTS];	// first timer of each slot
+static unsigned long gWheelTickMs;
+static unsigned long long gWheelStart;			// GetMicroseconds() of tick 0
+static unsigned long long gWheelCurrent;		// first tick not handled yet
+static unsigned long long gWheelNext;			// tick the thread sleeps until
+static unsigned long gWheelWakeups;
+static unsigned long gWheelTicks;
+static unsigned long gWheelRuns;
+
+
+/*
+	Tick of now, the one in progress
+*/
+static unsigned long long WheelNow()
+{
+	return (GetMicroseconds() - gWheelStart) / (gWheelTickMs * 1000ULL);
+}
+
+/*
+	Put a timer in the slot of its tick, the lock held
+*/
+static void WheelLink(unsigned long Timer)
+{
+	unsigned long *pSlot = &(gWheelSlots[gWheelTimers[Timer].Due % WHEEL_SLOTS]);
+
+	gWheelTimers[Timer].Next = *pSlot;
+	*pSlot = Timer;
+}
+
+static void WheelUnlink(unsigned long Timer)
+{
+	unsigned long *pLink = &(gWheelSlots[gWheelTimers[Timer].Due % WHEEL_SLOTS]);
+
+	while(*pLink != WHEEL_NO_TIMER)
+	{
+		if(*pLink == Timer)
+		{
+			*pLink = gWheelTimers[Timer].Next;
+			return;
+		}
+		pLink = &(gWheelTimers[*pLink].Next);
+	}
+}
+
+/*
+	First tick from From on with a timer due, one revolution at most: the slots
+	also hold the timers of the next revolutions
+*/
+static unsigned long long WheelNextDue(unsigned long long From)
+{
+	unsigned long long tick;
+	unsigned long t;
+
+	for(tick=From;tick<From + WHEEL_SLOTS;tick++)
+		for(t=gWheelSlots[tick % WHEEL_SLOTS];t != WHEEL_NO_TIMER;t=gWheelTimers[t].Next)
+			if(gWheelTimers[t].Due == tick)
+				return tick;
+
+	return From + WHEEL_SLOTS;
+}
+
+/*
+	Scheduler thread: takes every timer due since the last wake-up, puts them
+	back for their next period and runs them together, then sleeps until the
+	next slot that has one
+*/
+static THREADPROC WheelThread(void * /*pContext*/)
+{
+	unsigned long batch[WHEEL_MAX_TIMERS];
+	unsigned long long due[WHEEL_MAX_TIMERS];
+	unsigned long count,i,*pLink;
+	unsigned long long now,at,late;
+	tWheelTimer *pTimer;
+
+	LockAcquire(&gWheelLock);
+	while(!gWheelStop)
+	{
+		now = WheelNow();
+		count = 0;
+		for(;gWheelCurrent <= now;gWheelCurrent++)
+		{
+			i = count;
+			pLink = &(gWheelSlots[gWheelCurrent % WHEEL_SLOTS]);
+			while(*pLink != WHEEL_NO_TIMER)
+			{
+				pTimer = &(gWheelTimers[*pLink]);
+				if(pTimer->Due != gWheelCurrent)
+				{
+					pLink = &(pTimer->Next);
+					continue;
+				}
+				due[count] = pTimer->Due;
+				batch[count++] = *pLink;
+				*pLink = pTimer->Next;
+			}
+			if(count > i)
+				gWheelTicks++;
+		}
+
+		if(count)
+		{
+			// next period, the ones missed while the thread was late are skipped
+			for(i=0;i<count;i++)
+			{
+				pTimer = &(gWheelTimers[batch[i]]);
+				pTimer->Due += pTimer->Period;
+				if(pTimer->Due <= now)
+					pTimer->Due = (now / pTimer->Period + 1) * pTimer->Period;
+				WheelLink(batch[i]);
+			}
+			// taken before gWheelLock is let go: a TimerWheelCancel() of a timer of
+			// the batch then waits for the batch. It never waits on gWheelRunLock
+			// with gWheelLock held
+			LockAcquire(&gWheelRunLock);
+			LockRelease(&gWheelLock);
+
+			for(i=0;i<count;i++)
+			{
+				pTimer = &(gWheelTimers[batch[i]]);
+				if(pTimer->Cancelled)
+					continue;
+				late = GetMicroseconds() - (gWheelStart + due[i] * gWheelTickMs * 1000ULL);
+				pTimer->Late += late;
+				if(late > pTimer->LateMax)
+					pTimer->LateMax = late;
+				pTimer->Runs++;
+				gWheelRuns++;
+				pTimer->Task(pTimer->pContext);
+			}
+			LockRelease(&gWheelRunLock);
+
+			// the ticks that went by while the tasks ran
+			LockAcquire(&gWheelLock);
+			continue;
+		}
+
+		gWheelNext = WheelNextDue(gWheelCurrent);
+		at = gWheelStart + gWheelNext * gWheelTickMs * 1000ULL;
+		now = GetMicroseconds();
+		LockRelease(&gWheelLock);
+		if(at > now)
+		{
+			EventWait(&gWheelWake,(unsigned long)((at - now + 999) / 1000));
+			gWheelWakeups++;
+		}
+		LockAcquire(&gWheelLock);
+	}
+	LockRelease(&gWheelLock);
+
+	return 0;
+}
+
+/*!
+ * @brief
+ *		Start the scheduler thread, with no timer
+ * @param
+ *		milliseconds of a tick, 0 for WHEEL_TICK_MS
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		main()
+ * @return
+ *		false if the thread could not be started
+ */
+bool TimerWheelStart(unsigned long TickMs)
+{
+	unsigned long i;
+
+	if(gWheelRunning)
+		return true;
+
+	LockInit(&gWheelLock);
+	LockInit(&gWheelRunLock);
+	EventInit(&gWheelWake);
+	memset(gWheelTimers,0,sizeof(gWheelTimers));
+	for(i=0;i<WHEEL_SLOTS;i++)
+		gWheelSlots[i] = WHEEL_NO_TIMER;
+	gWheelTickMs = TickMs ? TickMs : WHEEL_TICK_MS;
+	gWheelStart = GetMicroseconds();
+	gWheelCurrent = 0;
+	gWheelNext = 0;
+	gWheelWakeups = 0;
+	gWheelTicks = 0;
+	gWheelRuns = 0;
+	gWheelStop = false;
+
+	if(!ThreadSpawn(&gWheelThread,WheelThread,NULL))
+	{
+		printf("Error in %s:%d at TimerWheelStart() ----> could not start the scheduler thread\n", __FILE__, __LINE__);
+		EventDestroy(&gWheelWake);
+		LockDestroy(&gWheelRunLock);
+		LockDestroy(&gWheelLock);
+		return false;
+	}
+	gWheelRunning = true;
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Stop the scheduler thread, the timers still armed are dropped
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void TimerWheelStop()
+{
+	if(!gWheelRunning)
+		return;
+
+	gWheelStop = true;
+	EventSignal(&gWheelWake);
+	ThreadJoin(&gWheelThread);
+	gWheelRunning = false;
+
+	EventDestroy(&gWheelWake);
+	LockDestroy(&gWheelRunLock);
+	LockDestroy(&gWheelLock);
+}
+
+bool TimerWheelRunning()
+{
+	return gWheelRunning;
+}
+
+/*!
+ * @brief
+ *		Arm a periodic timer. Its first tick is the next multiple of its
+ *		period, so that it runs with the other timers of the same period
+ * @param
+ *		name of the task, a string literal
+ * @param
+ *		task, run on the scheduler thread
+ * @param
+ *		context of the task
+ * @param
+ *		period in milliseconds, rounded to the tick
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		TimerWheelCancel()
+ * @return
+ *		the timer, WHEEL_NO_TIMER if the wheel is not running or is full
+ */
+unsigned long TimerWheelAdd(const char *Name,tWheelTask Task,void *pContext,unsigned long Period)
+{
+	tWheelTimer *pTimer;
+	unsigned long t,ticks;
+	bool wake;
+
+	if(!gWheelRunning)
+		return WHEEL_NO_TIMER;
+
+	LockAcquire(&gWheelLock);
+	for(t=0;t<WHEEL_MAX_TIMERS && gWheelTimers[t].Used;t++);
+	if(t == WHEEL_MAX_TIMERS)
+	{
+		LockRelease(&gWheelLock);
+		printf("Error in %s:%d at TimerWheelAdd() ----> more than %d timers, %s is not armed\n", __FILE__, __LINE__, WHEEL_MAX_TIMERS, Name);
+		return WHEEL_NO_TIMER;
+	}
+
+	ticks = (Period + gWheelTickMs / 2) / gWheelTickMs;
+	if(!ticks)
+		ticks = 1;
+	pTimer = &(gWheelTimers[t]);
+	memset(pTimer,0,sizeof(tWheelTimer));
+	pTimer->Name = Name;
+	pTimer->Task = Task;
+	pTimer->pContext = pContext;
+	pTimer->Period = ticks;
+	pTimer->Due = (WheelNow() / ticks + 1) * ticks;
+	pTimer->Used = true;
+	WheelLink(t);
+	// the thread may be sleeping until a later tick
+	wake = pTimer->Due < gWheelNext;
+	LockRelease(&gWheelLock);
+
+	if(wake)
+		EventSignal(&gWheelWake);
+	return t;
+}
+
+/*!
+ * @brief
+ *		Disarm a timer. Returns once its task is over if it is running, not to
+ *		be called from a task
+ * @param
+ *		timer, WHEEL_NO_TIMER does nothing
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void TimerWheelCancel(unsigned long Timer)
+{
+	if(!gWheelRunning || Timer >= WHEEL_MAX_TIMERS)
+		return;
+
+	LockAcquire(&gWheelLock);
+	if(!gWheelTimers[Timer].Used || gWheelTimers[Timer].Cancelled)
+	{
+		LockRelease(&gWheelLock);
+		return;
+	}
+	// it is in its slot whenever the lock is free
+	WheelUnlink(Timer);
+	gWheelTimers[Timer].Cancelled = true;
+	LockRelease(&gWheelLock);
+
+	// the tick in progress may have taken it already
+	LockAcquire(&gWheelRunLock);
+	LockRelease(&gWheelRunLock);
+
+	LockAcquire(&gWheelLock);
+	gWheelTimers[Timer].Used = false;
+	gWheelTimers[Timer].Cancelled = false;
+	LockRelease(&gWheelLock);
+}
+
+/*!
+ * @brief
+ *		Counters of the scheduler thread, and how late the timers armed ran
+ * @param
+ *		counters
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		void
+ */
+void TimerWheelSnapshot(tWheelStats *pStats)
+{
+	unsigned long t,runs = 0;
+	unsigned long long late = 0,lateMax = 0;
+
+	memset(pStats,0,sizeof(tWheelStats));
+	if(!gWheelRunning)
+		return;
+
+	LockAcquire(&gWheelLock);
+	for(t=0;t<WHEEL_MAX_TIMERS;t++)
+	{
+		if(!gWheelTimers[t].Used)
+			continue;
+		pStats->Timers++;
+		runs += gWheelTimers[t].Runs;
+		late += gWheelTimers[t].Late;
+		if(gWheelTimers[t].LateMax > lateMax)
+			lateMax = gWheelTimers[t].LateMax;
+	}
+	pStats->Wakeups = gWheelWakeups;
+	pStats->Ticks = gWheelTicks;
+	pStats->Runs = gWheelRuns;
+	LockRelease(&gWheelLock);
+
+	pStats->LateAverage = runs ? (double)late / 1000.0 / (double)runs : 0.0;
+	pStats->LateMax = (double)lateMax / 1000.0;
+}
+
+
+/*
+	Benchmark: the four tasks of each camera, on a thread per camera the way
+	the statistics threads ran them, then on the wheel. The tasks only count
+	their runs, what is measured is the scheduling
+*/
+typedef struct
+{
+	tThread				Thread;
+	bool				Running;
+	unsigned long		Wakeups;
+	unsigned long		Runs;
+	unsigned long long	Last;				// previous statistics sample
+	unsigned long long	PeriodSum;
+	unsigned long long	PeriodMax;
+	unsigned long		Periods;
+
+} tWheelBenchCamera;
+
+static volatile bool gWheelBenchDone;
+
+static void WheelBenchStats(void *pContext)
+{
+	tWheelBenchCamera *pCamera = (tWheelBenchCamera*)pContext;
+	unsigned long long now = GetMicroseconds(),period;
+
+	if(pCamera->Last)
+	{
+		period = now - pCamera->Last;
+		pCamera->PeriodSum += period;
+		if(period > pCamera->PeriodMax)
+			pCamera->PeriodMax = period;
+		pCamera->Periods++;
+	}
+	pCamera->Last = now;
+	pCamera->Runs++;
+}
+
+static void WheelBenchTask(void *pContext)
+{
+	((tWheelBenchCamera*)pContext)->Runs++;
+}
+
+static THREADPROC WheelBenchThread(void *pContext)
+{
+	tWheelBenchCamera *pCamera = (tWheelBenchCamera*)pContext;
+	unsigned long long now,preview,alert,disk;
+
+	preview = alert = disk = GetMicroseconds();
+	while(!gWheelBenchDone)
+	{
+		WheelBenchStats(pCamera);
+		now = GetMicroseconds();
+		if(now - preview >= WHEEL_PREVIEW_MS * 1000ULL)
+		{
+			WheelBenchTask(pCamera);
+			preview = now;
+		}
+		if(now - alert >= WHEEL_ALERT_MS * 1000ULL)
+		{
+			WheelBenchTask(pCamera);
+			alert = now;
+		}
+		if(now - disk >= WHEEL_DISK_MS * 1000ULL)
+		{
+			WheelBenchTask(pCamera);
+			disk = now;
+		}
+		Sleep(STATS_PERIOD);
+		pCamera->Wakeups++;
+	}
+
+	return 0;
+}
+
+static void WheelBenchReport(const char *Name,unsigned long Threads,tWheelBenchCamera *pCameras,unsigned long Wakeups,
+	unsigned long long Cpu,unsigned long long Elapsed)
+{
+	unsigned long long sum = 0,max = 0;
+	unsigned long i,periods = 0,runs = 0;
+
+	for(i=0;i<WHEEL_BENCH_CAMERAS;i++)
+	{
+		sum += pCameras[i].PeriodSum;
+		periods += pCameras[i].Periods;
+		runs += pCameras[i].Runs;
+		if(pCameras[i].PeriodMax > max)
+			max = pCameras[i].PeriodMax;
+	}
+	printf("  %-18s : %2lu thread(s), %7.1f wake-ups/s, %7.1f tasks/s, statistics every %5.2f ms (max %6.2f), cpu %5.2f%% of one processor\n",
+		Name,Threads,(double)Wakeups * 1000000.0 / (double)Elapsed,(double)runs * 1000000.0 / (double)Elapsed,
+		periods ? (double)sum / 1000.0 / (double)periods : 0.0,(double)max / 1000.0,(double)Cpu * 100.0 / (double)Elapsed);
+}
+
+void TimerWheelBenchmark()
+{
+	static tWheelBenchCamera cameras[WHEEL_BENCH_CAMERAS];
+	unsigned long long start,cpu,elapsed;
+	unsigned long i,wakeups = 0;
+	tWheelStats stats;
+
+	printf("Scheduling benchmark, %d cameras with 4 tasks each (every %d, %d, %d and %d ms) for %d s\n",WHEEL_BENCH_CAMERAS,
+		STATS_PERIOD,WHEEL_ALERT_MS,WHEEL_PREVIEW_MS,WHEEL_DISK_MS,WHEEL_BENCH_SECONDS);
+
+	memset(cameras,0,sizeof(cameras));
+	gWheelBenchDone = false;
+	start = GetMicroseconds();
+	cpu = ProcessCpuMicroseconds();
+	for(i=0;i<WHEEL_BENCH_CAMERAS;i++)
+	{
+		cameras[i].Running = ThreadSpawn(&(cameras[i].Thread),WheelBenchThread,&(cameras[i]));
+		if(!cameras[i].Running)
+			printf("Error in %s:%d at TimerWheelBenchmark() ----> could not start the thread of camera %lu\n", __FILE__, __LINE__, i);
+	}
+	Sleep(WHEEL_BENCH_SECONDS * 1000);
+	gWheelBenchDone = true;
+	for(i=0;i<WHEEL_BENCH_CAMERAS;i++)
+	{
+		if(!cameras[i].Running)
+			continue;
+		ThreadJoin(&(cameras[i].Thread));
+		wakeups += cameras[i].Wakeups;
+	}
+	cpu = ProcessCpuMicroseconds() - cpu;
+	elapsed = GetMicroseconds() - start;
+	WheelBenchReport("thread per camera",WHEEL_BENCH_CAMERAS,cameras,wakeups,cpu,elapsed);
+
+	memset(cameras,0,sizeof(cameras));
+	if(!TimerWheelStart(0))
+		return;
+	start = GetMicroseconds();
+	cpu = ProcessCpuMicroseconds();
+	for(i=0;i<WHEEL_BENCH_CAMERAS;i++)
+	{
+		TimerWheelAdd("stats",WheelBenchStats,&(cameras[i]),STATS_PERIOD);
+		TimerWheelAdd("preview",WheelBenchTask,&(cameras[i]),WHEEL_PREVIEW_MS);
+		TimerWheelAdd("alert",WheelBenchTask,&(cameras[i]),WHEEL_ALERT_MS);
+		TimerWheelAdd("disk",WheelBenchTask,&(cameras[i]),WHEEL_DISK_MS);
+	}
+	Sleep(WHEEL_BENCH_SECONDS * 1000);
+	TimerWheelSnapshot(&stats);
+	TimerWheelStop();
+	cpu = ProcessCpuMicroseconds() - cpu;
+	elapsed = GetMicroseconds() - start;
+	WheelBenchReport("timer wheel",1,cameras,stats.Wakeups,cpu,elapsed);
+	printf("  %-18s : %lu timers, %.1f run per tick with a timer due, %.3f ms late on average (max %.3f)\n","",
+		stats.Timers,stats.Ticks ? (double)stats.Runs / (double)stats.Ticks : 0.0,stats.LateAverage,stats.LateMax);
+}
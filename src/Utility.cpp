@@ -10,7 +10,24 @@
  ***********************************************************************
  */
 
+#if defined(_LINUX) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE				// pthread_setaffinity_np()
+#endif
 #include"Utility.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef _WINDOWS
+#include <malloc.h>
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/resource.h>
+#endif
 
 /*!
  * @brief 
@@ -125,3 +142,517 @@ the attribute type is different \n");
 
 	}			   
 }			 
+
+/*!
+ * @brief 
+ *		Monotonic high resolution clock used by the latency counters
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		microseconds since an arbitrary origin
+ */
+unsigned long long GetMicroseconds()
+{
+#ifdef _WINDOWS
+	static LARGE_INTEGER frequency = {0};
+	LARGE_INTEGER counter;
+
+	if(!frequency.QuadPart)
+		QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+
+	return (unsigned long long)(counter.QuadPart / frequency.QuadPart) * 1000000 +
+		(unsigned long long)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC,&now);
+	return (unsigned long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+/*!
+ * @brief 
+ *		CPU time used by the process so far, all threads, user and system
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		microseconds
+ */
+unsigned long long ProcessCpuMicroseconds()
+{
+#ifdef _WINDOWS
+	FILETIME created,exited,kernel,user;
+
+	if(!GetProcessTimes(GetCurrentProcess(),&created,&exited,&kernel,&user))
+		return 0;
+
+	// 100 ns units
+	return ((((unsigned long long)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) +
+		(((unsigned long long)user.dwHighDateTime << 32) | user.dwLowDateTime)) / 10;
+#else
+	struct rusage usage;
+
+	if(getrusage(RUSAGE_SELF,&usage))
+		return 0;
+
+	return (unsigned long long)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+		usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#endif
+}
+
+/*!
+ * @brief 
+ *		Number of processors the worker pools can use
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		at least 1
+ */
+unsigned long ProcessorCount()
+{
+#ifdef _WINDOWS
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return count > 0 ? (unsigned long)count : 1;
+#endif
+}
+
+/*!
+ * @brief 
+ *		Create a directory without a shell, the camera threads call it at the
+ *		same time
+ * @param 
+ *		path of the directory
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		true if it exists now
+ */
+bool MakeDirectory(const char *Directory)
+{
+#ifdef _WINDOWS
+	if(!_mkdir(Directory))
+		return true;
+#else
+	if(!mkdir(Directory,0755))
+		return true;
+#endif
+	return errno == EEXIST;
+}
+
+/*!
+ * @brief 
+ *		Space left for the recording on the disk of a directory
+ * @param 
+ *		path of the directory
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		megabytes available to the process, 0 if the disk could not be queried
+ */
+unsigned long long DiskFreeMegabytes(const char *Directory)
+{
+#ifdef _WINDOWS
+	ULARGE_INTEGER available;
+
+	if(!GetDiskFreeSpaceExA(Directory,&available,NULL,NULL))
+		return 0;
+	return available.QuadPart >> 20;
+#else
+	struct statvfs disk;
+
+	if(statvfs(Directory,&disk))
+		return 0;
+	return ((unsigned long long)disk.f_bavail * disk.f_frsize) >> 20;
+#endif
+}
+
+/*!
+ * @brief 
+ *		Start a worker thread
+ * @param 
+ *		thread handle to fill
+ * @param 
+ *		thread procedure
+ * @param 
+ *		context handed to the thread procedure
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		bool
+ */
+bool ThreadSpawn(tThread *pThread,tThreadProc Proc,void *pContext)
+{
+#ifdef _WINDOWS
+	DWORD threadId;
+
+	*pThread = CreateThread(NULL,NULL,Proc,pContext,NULL,&threadId);
+	return *pThread != NULL;
+#else
+	return pthread_create(pThread,NULL,Proc,pContext) == 0;
+#endif
+}
+
+/*!
+ * @brief 
+ *		Pin the calling thread on one processor
+ * @param 
+ *		processor number, from 0
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		false if the thread cannot be pinned
+ */
+bool ThreadSetAffinity(unsigned long Processor)
+{
+#ifdef _WINDOWS
+	if(Processor >= sizeof(DWORD_PTR) * 8 || !SetThreadAffinityMask(GetCurrentThread(),(DWORD_PTR)1 << Processor))
+#elif defined(_LINUX)
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(Processor,&set);
+	if(pthread_setaffinity_np(pthread_self(),sizeof(set),&set))
+#else
+	if(true)
+#endif
+	{
+		printf("Error in %s:%d at ThreadSetAffinity() ----> could not pin the thread on processor %lu\n", __FILE__, __LINE__, Processor);
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * @brief 
+ *		Give the calling thread a real-time priority (needs the privilege on Linux)
+ * @param 
+ *		SCHED_FIFO priority on POSIX, 1 to 99. Windows only has one level: time critical
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		false if the priority could not be set, the thread keeps the normal one
+ */
+bool ThreadSetRealtime(int Priority)
+{
+#ifdef _WINDOWS
+	if(!SetThreadPriority(GetCurrentThread(),THREAD_PRIORITY_TIME_CRITICAL))
+#else
+	struct sched_param param;
+
+	memset(&param,0,sizeof(param));
+	param.sched_priority = Priority;
+	if(pthread_setschedparam(pthread_self(),SCHED_FIFO,&param))
+#endif
+	{
+		printf("Error in %s:%d at ThreadSetRealtime() ----> could not set priority %d\n", __FILE__, __LINE__, Priority);
+		return false;
+	}
+
+	return true;
+}
+
+/*!
+ * @brief 
+ *		Wait for a worker thread to finish and release its handle
+ * @param 
+ *		thread handle
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		void
+ */
+void ThreadJoin(tThread *pThread)
+{
+#ifdef _WINDOWS
+	if(*pThread)
+	{
+		WaitForSingleObject(*pThread,INFINITE);
+		CloseHandle(*pThread);
+		*pThread = NULL;
+	}
+#else
+	pthread_join(*pThread,NULL);
+#endif
+}
+
+void LockInit(tLock *pLock)
+{
+#ifdef _WINDOWS
+	InitializeCriticalSection(pLock);
+#else
+	pthread_mutex_init(pLock,NULL);
+#endif
+}
+
+void LockDestroy(tLock *pLock)
+{
+#ifdef _WINDOWS
+	DeleteCriticalSection(pLock);
+#else
+	pthread_mutex_destroy(pLock);
+#endif
+}
+
+void LockAcquire(tLock *pLock)
+{
+#ifdef _WINDOWS
+	EnterCriticalSection(pLock);
+#else
+	pthread_mutex_lock(pLock);
+#endif
+}
+
+void LockRelease(tLock *pLock)
+{
+#ifdef _WINDOWS
+	LeaveCriticalSection(pLock);
+#else
+	pthread_mutex_unlock(pLock);
+#endif
+}
+
+/*!
+ * @brief 
+ *		Allocate a buffer aligned for direct I/O
+ * @param 
+ *		size in bytes
+ * @param 
+ *		alignment, a power of two
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		the buffer, to release with AlignedFree(), or NULL
+ */
+void *AlignedAlloc(unsigned long Size,unsigned long Alignment)
+{
+#ifdef _WINDOWS
+	return _aligned_malloc(Size,Alignment);
+#else
+	void *pBuffer = NULL;
+
+	if(posix_memalign(&pBuffer,Alignment,Size))
+		return NULL;
+	return pBuffer;
+#endif
+}
+
+void AlignedFree(void *pBuffer)
+{
+#ifdef _WINDOWS
+	_aligned_free(pBuffer);
+#else
+	free(pBuffer);
+#endif
+}
+
+/*!
+ * @brief 
+ *		Interlocked counters, shared between a submitting and a completing thread
+ * @param 
+ *		counter
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		the new value
+ */
+long AtomicIncrement(volatile long *pValue)
+{
+#ifdef _WINDOWS
+	return InterlockedIncrement(pValue);
+#else
+	return __sync_add_and_fetch(pValue,1);
+#endif
+}
+
+long AtomicDecrement(volatile long *pValue)
+{
+#ifdef _WINDOWS
+	return InterlockedDecrement(pValue);
+#else
+	return __sync_sub_and_fetch(pValue,1);
+#endif
+}
+
+/*
+	Store a value and return the previous one, a full barrier
+*/
+long AtomicExchange(volatile long *pValue,long Value)
+{
+#ifdef _WINDOWS
+	return InterlockedExchange(pValue,Value);
+#else
+	__sync_synchronize();
+	return __sync_lock_test_and_set(pValue,Value);
+#endif
+}
+
+/*!
+ * @brief 
+ *		Create an auto-reset event (one waiter is released per signal)
+ * @param 
+ *		event to initialise
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		void
+ */
+void EventInit(tEvent *pEvent)
+{
+#ifdef _WINDOWS
+	*pEvent = CreateEvent(NULL,FALSE,FALSE,NULL);
+#else
+	pthread_mutex_init(&pEvent->Mutex,NULL);
+	pthread_cond_init(&pEvent->Cond,NULL);
+	pEvent->Signaled = false;
+#endif
+}
+
+void EventDestroy(tEvent *pEvent)
+{
+#ifdef _WINDOWS
+	if(*pEvent)
+		CloseHandle(*pEvent);
+	*pEvent = NULL;
+#else
+	pthread_cond_destroy(&pEvent->Cond);
+	pthread_mutex_destroy(&pEvent->Mutex);
+#endif
+}
+
+void EventSignal(tEvent *pEvent)
+{
+#ifdef _WINDOWS
+	SetEvent(*pEvent);
+#else
+	pthread_mutex_lock(&pEvent->Mutex);
+	pEvent->Signaled = true;
+	pthread_cond_signal(&pEvent->Cond);
+	pthread_mutex_unlock(&pEvent->Mutex);
+#endif
+}
+
+/*!
+ * @brief 
+ *		Block until the event is signaled or the timeout expires
+ * @param 
+ *		event to wait on
+ * @param 
+ *		timeout in milliseconds, EVENT_INFINITE to wait for ever
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		true if the event was signaled, false on timeout
+ */
+bool EventWait(tEvent *pEvent,unsigned long Timeout)
+{
+#ifdef _WINDOWS
+	return WaitForSingleObject(*pEvent,Timeout == EVENT_INFINITE ? INFINITE : Timeout) == WAIT_OBJECT_0;
+#else
+	bool signaled;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&pEvent->Mutex);
+	if(Timeout != EVENT_INFINITE)
+	{
+		clock_gettime(CLOCK_REALTIME,&deadline);
+		deadline.tv_sec += Timeout / 1000;
+		deadline.tv_nsec += (Timeout % 1000) * 1000000;
+		if(deadline.tv_nsec >= 1000000000)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+	while(!pEvent->Signaled)
+	{
+		if(Timeout == EVENT_INFINITE)
+			pthread_cond_wait(&pEvent->Cond,&pEvent->Mutex);
+		else if(pthread_cond_timedwait(&pEvent->Cond,&pEvent->Mutex,&deadline))
+			break;
+	}
+	signaled = pEvent->Signaled;
+	pEvent->Signaled = false;
+	pthread_mutex_unlock(&pEvent->Mutex);
+
+	return signaled;
+#endif
+}
+
+/*
+	Bucket of a latency: exact below 2 * LATENCY_SUB_BUCKETS microseconds, then
+	LATENCY_SUB_BUCKETS buckets per power of two (3% wide)
+*/
+static unsigned long LatencyBucket(unsigned long long Microseconds)
+{
+	unsigned long shift = 0;
+
+	while((Microseconds >> shift) >= 2 * LATENCY_SUB_BUCKETS)
+		shift++;
+	if(shift * LATENCY_SUB_BUCKETS + (unsigned long)(Microseconds >> shift) >= LATENCY_BUCKETS)
+		return LATENCY_BUCKETS - 1;
+
+	return shift * LATENCY_SUB_BUCKETS + (unsigned long)(Microseconds >> shift);
+}
+
+/*!
+ * @brief 
+ *		Count one latency, lock free, from any thread
+ * @param 
+ *		histogram
+ * @param 
+ *		microseconds
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		void
+ */
+void LatencyRecord(tLatencyHistogram *pHistogram,unsigned long long Microseconds)
+{
+	AtomicIncrement(&(pHistogram->Count[LatencyBucket(Microseconds)]));
+}
+
+/*!
+ * @brief 
+ *		Latency under which a share of the samples are
+ * @param 
+ *		histogram
+ * @param 
+ *		share of the samples, 0.99 for the 99th percentile
+ * @author 
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return 
+ *		microseconds, upper bound of the bucket, 0 without any sample
+ */
+unsigned long long LatencyPercentile(const tLatencyHistogram *pHistogram,double Fraction)
+{
+	unsigned long long total = 0,seen = 0,target;
+	unsigned long i,shift;
+
+	for(i=0;i<LATENCY_BUCKETS;i++)
+		total += (unsigned long)pHistogram->Count[i];
+	if(!total)
+		return 0;
+
+	target = (unsigned long long)(Fraction * (double)total);
+	if(target < 1)
+		target = 1;
+	for(i=0;i<LATENCY_BUCKETS-1;i++)
+	{
+		seen += (unsigned long)pHistogram->Count[i];
+		if(seen >= target)
+			break;
+	}
+
+	if(i < 2 * LATENCY_SUB_BUCKETS)
+		return i;
+	shift = i / LATENCY_SUB_BUCKETS - 1;
+	return ((unsigned long long)(i - shift * LATENCY_SUB_BUCKETS + 1) << shift) - 1;
+}
@@ -0,0 +1,396 @@
+/*!
+ *  @file
+ *     WorkPool.cpp
+ *  @brief
+ *     OTC project: Work-stealing pool. One queue per worker behind its own
+ *	   lock, the workers sleep on one event while no job is pending
+ *  @author
+ *   Main contributors (see contributors.h for copyright, address and affiliation details)
+ *   - Waazim Reza, Sagar Aghera , Rafael Giusti               <wreza@fau.edu,saghera@fau.edu,rgiusti@fau.edu>
+ ***********************************************************************
+ */
+
+#include "WorkPool.h"
+#include <string.h>
+
+#ifdef _WINDOWS
+#define WORK_U64	"%I64u"
+#else
+#define WORK_U64	"%llu"
+#endif
+
+typedef struct
+{
+	tLock				Lock;
+	tWorkJob*			Jobs[WORKPOOL_QUEUE_SIZE];
+	unsigned long		Head;				// oldest job
+	unsigned long		Tail;
+	unsigned long		Index;
+	tThread				Thread;
+	tWorkStats			Stats;				// the worker only
+	char				Pad[WORKPOOL_CACHE_LINE];	// the lock of the next queue is on another line
+
+} tWorkQueue;
+
+typedef struct
+{
+	bool				Running;
+	volatile bool		Stop;
+	tWorkQueue			Queues[WORKPOOL_MAX_THREADS];
+	unsigned long		QueueCount;
+	unsigned long		ThreadCount;
+	tEvent				Wake;				// a job was submitted while a worker slept
+	volatile long		Pending;			// jobs in all the queues
+	volatile long		Sleepers;
+	unsigned long long	StartedAt;
+	tLock				HelperLock;
+	tWorkStats			Helpers;
+
+} tWorkPool;
+
+static tWorkPool WorkPool;
+
+
+static bool WorkQueuePush(tWorkQueue *pQueue,tWorkJob *pJob)
+{
+	bool pushed = false;
+
+	LockAcquire(&(pQueue->Lock));
+	if(pQueue->Tail - pQueue->Head < WORKPOOL_QUEUE_SIZE)
+	{
+		pQueue->Jobs[pQueue->Tail++ & (WORKPOOL_QUEUE_SIZE - 1)] = pJob;
+		AtomicIncrement(&(WorkPool.Pending));
+		pushed = true;
+	}
+	LockRelease(&(pQueue->Lock));
+
+	return pushed;
+}
+
+static tWorkJob *WorkQueuePop(tWorkQueue *pQueue)
+{
+	tWorkJob *pJob = NULL;
+
+	LockAcquire(&(pQueue->Lock));
+	if(pQueue->Tail != pQueue->Head)
+	{
+		pJob = pQueue->Jobs[pQueue->Head++ & (WORKPOOL_QUEUE_SIZE - 1)];
+		AtomicDecrement(&(WorkPool.Pending));
+	}
+	LockRelease(&(pQueue->Lock));
+
+	return pJob;
+}
+
+/*
+	The queue of First, then the others in turn
+*/
+static tWorkJob *WorkPoolTake(unsigned long First,bool *pStolen)
+{
+	tWorkJob *pJob;
+	unsigned long i;
+
+	for(i=0;i<WorkPool.ThreadCount;i++)
+	{
+		pJob = WorkQueuePop(&(WorkPool.Queues[(First + i) % WorkPool.ThreadCount]));
+		if(pJob)
+		{
+			*pStolen = i != 0;
+			return pJob;
+		}
+	}
+
+	return NULL;
+}
+
+static void WorkPoolRun(tWorkJob *pJob,tWorkStats *pStats,bool Stolen)
+{
+	unsigned long long start = GetMicroseconds();
+
+	pJob->Run(pJob);
+
+	pStats->BusyTime += GetMicroseconds() - start;
+	pStats->JobsRun++;
+	if(Stolen)
+		pStats->Steals++;
+}
+
+static THREADPROC WorkPoolThread(void *pContext)
+{
+	tWorkQueue *pQueue = (tWorkQueue*)pContext;
+	tWorkJob *pJob;
+	bool stolen;
+
+	while(true)
+	{
+		pJob = WorkPoolTake(pQueue->Index,&stolen);
+		if(pJob)
+		{
+			/*
+			More work than awake workers, wake another one up
+			*/
+			if(WorkPool.Pending && WorkPool.Sleepers)
+				EventSignal(&(WorkPool.Wake));
+
+			WorkPoolRun(pJob,&(pQueue->Stats),stolen);
+			continue;
+		}
+		if(WorkPool.Stop)
+			break;
+
+		/*
+		Counted as a sleeper before Pending is read, a submitter counts its job
+		before it reads Sleepers: one of the two sees the other
+		*/
+		AtomicIncrement(&(WorkPool.Sleepers));
+		if(!WorkPool.Pending && !WorkPool.Stop)
+			EventWait(&(WorkPool.Wake),EVENT_INFINITE);
+		AtomicDecrement(&(WorkPool.Sleepers));
+	}
+
+	/*
+	Wake the next worker up so it sees Stop as well
+	*/
+	EventSignal(&(WorkPool.Wake));
+
+	return 0;
+}
+
+/*!
+ * @brief
+ *		Start the workers shared by the cameras. Without them the jobs run on
+ *		the thread that submits them
+ * @param
+ *		number of workers, up to WORKPOOL_MAX_THREADS
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		main()
+ * @return
+ *		bool
+ */
+bool WorkPoolStart(unsigned long Threads)
+{
+	unsigned long i;
+
+	if(WorkPool.Running || !Threads)
+		return true;
+	if(Threads > WORKPOOL_MAX_THREADS)
+		Threads = WORKPOOL_MAX_THREADS;
+
+	memset(&WorkPool,0,sizeof(tWorkPool));
+	EventInit(&(WorkPool.Wake));
+	LockInit(&(WorkPool.HelperLock));
+	for(i=0;i<Threads;i++)
+	{
+		LockInit(&(WorkPool.Queues[i].Lock));
+		WorkPool.Queues[i].Index = i;
+	}
+	// the workers take from every queue, they are all counted before the first one starts
+	WorkPool.QueueCount = Threads;
+	WorkPool.ThreadCount = Threads;
+	WorkPool.StartedAt = GetMicroseconds();
+	WorkPool.Running = true;
+
+	for(i=0;i<Threads;i++)
+	{
+		if(!ThreadSpawn(&(WorkPool.Queues[i].Thread),WorkPoolThread,&(WorkPool.Queues[i])))
+		{
+			printf("Error in %s:%d at WorkPoolStart() ----> could not start the workers\n", __FILE__, __LINE__);
+			// stop the ones that started, the jobs will run on the submitting threads
+			WorkPool.ThreadCount = i;
+			WorkPoolStop();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Run the jobs left and stop the workers, nothing may submit any more
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CameraUnsetup()
+ * @return
+ *		void
+ */
+void WorkPoolStop()
+{
+	unsigned long i;
+
+	if(!WorkPool.Running)
+		return;
+
+	WorkPool.Stop = true;
+	EventSignal(&(WorkPool.Wake));
+	for(i=0;i<WorkPool.ThreadCount;i++)
+		ThreadJoin(&(WorkPool.Queues[i].Thread));
+
+	for(i=0;i<WorkPool.QueueCount;i++)
+		LockDestroy(&(WorkPool.Queues[i].Lock));
+	LockDestroy(&(WorkPool.HelperLock));
+	EventDestroy(&(WorkPool.Wake));
+	WorkPool.Running = false;
+}
+
+bool WorkPoolRunning()
+{
+	return WorkPool.Running;
+}
+
+unsigned long WorkPoolThreadCount()
+{
+	return WorkPool.Running ? WorkPool.ThreadCount : 0;
+}
+
+/*!
+ * @brief
+ *		Hand a job to the pool. It runs right away on the calling thread when
+ *		the pool is not running, or when every queue is full
+ * @param
+ *		job, untouched by the caller until it has run
+ * @param
+ *		home of the caller (camera index), its jobs go to the same worker
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CompressFrame(), FrameWriterThread()
+ * @return
+ *		void
+ */
+void WorkPoolSubmit(tWorkJob *pJob,unsigned long Home)
+{
+	unsigned long i;
+
+	if(WorkPool.Running)
+	{
+		for(i=0;i<WorkPool.ThreadCount;i++)
+		{
+			if(WorkQueuePush(&(WorkPool.Queues[(Home + i) % WorkPool.ThreadCount]),pJob))
+			{
+				if(WorkPool.Sleepers)
+					EventSignal(&(WorkPool.Wake));
+				return;
+			}
+		}
+	}
+
+	pJob->Run(pJob);
+}
+
+/*!
+ * @brief
+ *		Run one job of the pool on the calling thread, for a thread waiting
+ *		for its own jobs
+ * @param
+ *		home of the caller, its queue is looked at first
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		CompressFrame()
+ * @return
+ *		false if no job is pending
+ */
+bool WorkPoolHelp(unsigned long Home)
+{
+	tWorkJob *pJob;
+	tWorkStats stats;
+	bool stolen;
+
+	if(!WorkPool.Running)
+		return false;
+
+	pJob = WorkPoolTake(Home % WorkPool.ThreadCount,&stolen);
+	if(!pJob)
+		return false;
+
+	memset(&stats,0,sizeof(tWorkStats));
+	WorkPoolRun(pJob,&stats,stolen);
+
+	LockAcquire(&(WorkPool.HelperLock));
+	WorkPool.Helpers.JobsRun += stats.JobsRun;
+	WorkPool.Helpers.Steals += stats.Steals;
+	WorkPool.Helpers.BusyTime += stats.BusyTime;
+	LockRelease(&(WorkPool.HelperLock));
+
+	return true;
+}
+
+/*!
+ * @brief
+ *		Counters of the workers and of the helpers
+ * @param
+ *		WORKPOOL_MAX_THREADS + 1 counters, the workers then the helpers
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @return
+ *		number of workers, 0 when the pool is not running
+ */
+unsigned long WorkPoolSnapshot(tWorkStats *pStats)
+{
+	unsigned long long elapsed;
+	unsigned long i;
+
+	memset(pStats,0,(WORKPOOL_MAX_THREADS + 1) * sizeof(tWorkStats));
+	if(!WorkPool.Running)
+		return 0;
+
+	elapsed = GetMicroseconds() - WorkPool.StartedAt;
+	for(i=0;i<WorkPool.ThreadCount;i++)
+	{
+		pStats[i] = WorkPool.Queues[i].Stats;
+		pStats[i].Elapsed = elapsed;
+	}
+
+	LockAcquire(&(WorkPool.HelperLock));
+	pStats[WORKPOOL_MAX_THREADS] = WorkPool.Helpers;
+	LockRelease(&(WorkPool.HelperLock));
+	pStats[WORKPOOL_MAX_THREADS].Elapsed = elapsed;
+
+	return WorkPool.ThreadCount;
+}
+
+/*!
+ * @brief
+ *		Print the utilization and the steals of every worker between two
+ *		snapshots
+ * @param
+ *		first snapshot, NULL for the start of the pool
+ * @param
+ *		last snapshot
+ * @author
+ *		Waazim Reza, Sagar Aghera , Rafael Giusti
+ * @see
+ *		WorkPoolSnapshot()
+ * @return
+ *		void
+ */
+void WorkPoolReport(const tWorkStats *pBegin,const tWorkStats *pEnd)
+{
+	tWorkStats zero[WORKPOOL_MAX_THREADS + 1];
+	unsigned long long elapsed;
+	unsigned long i;
+
+	if(!WorkPool.Running)
+		return;
+	if(!pBegin)
+	{
+		memset(zero,0,sizeof(zero));
+		pBegin = zero;
+	}
+
+	for(i=0;i<WorkPool.ThreadCount;i++)
+	{
+		elapsed = pEnd[i].Elapsed - pBegin[i].Elapsed;
+		printf("worker %2lu : busy %5.1f%% jobs " WORK_U64 " steals " WORK_U64 "\n",i,
+			elapsed ? (double)(pEnd[i].BusyTime - pBegin[i].BusyTime) * 100.0 / (double)elapsed : 0.0,
+			pEnd[i].JobsRun - pBegin[i].JobsRun,pEnd[i].Steals - pBegin[i].Steals);
+	}
+	i = WORKPOOL_MAX_THREADS;
+	printf("helpers   : busy %7.1f ms jobs " WORK_U64 " steals " WORK_U64 "\n",
+		(double)(pEnd[i].BusyTime - pBegin[i].BusyTime) / 1000.0,pEnd[i].JobsRun - pBegin[i].JobsRun,
+		pEnd[i].Steals - pBegin[i].Steals);
+}
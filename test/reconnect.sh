@@ -0,0 +1,68 @@
+#!/bin/sh
+#
+# OTC project: reconnect test over the simulated cameras (PvSimulator.h), run
+# by make test. The camera is unplugged and plugged back while it records:
+# the segment it closed at the unplug must stay as it was, the next session
+# goes on with the next segment number
+#
+#   sh test/reconnect.sh Linux/AVCameraThreaded
+#
+
+APP=${1:-Linux/AVCameraThreaded}
+APP="$(cd "$(dirname "$APP")" && pwd)/$(basename "$APP")"
+UID_=112322
+WORK=$(mktemp -d)
+trap 'kill -INT $PID 2>/dev/null; rm -rf "$WORK"' EXIT
+
+fail()
+{
+	echo "reconnect test FAILED: $1"
+	tail -20 "$WORK/log.txt"
+	exit 1
+}
+
+# a segment is closed once its trailer (index) is at the end of the file
+closed()
+{
+	[ -f "$1" ] && [ "$(tail -c 8 "$1")" = "AVRAWIDX" ]
+}
+
+mkdir "$WORK/run"
+cd "$WORK/run" || exit 1
+PVSIM="cameras=1,uid=$UID_,width=320,height=240,fps=30,unplug=2,replug=1,discovery=0,seed=7" \
+	"$APP" -raw > "$WORK/log.txt" 2>&1 &
+PID=$!
+
+# first session: recorded, then closed at the unplug
+i=0
+while :; do
+	FIRST=$(ls "$WORK"/Survey_*/$UID_/segment00000.avr 2>/dev/null)
+	[ -n "$FIRST" ] && closed "$FIRST" && break
+	i=$((i + 1))
+	[ $i -gt 150 ] && fail "segment00000.avr was never closed"
+	sleep 0.1
+done
+BEFORE=$(cksum < "$FIRST")
+DIR=$(dirname "$FIRST")
+
+# second session: plugged back, it records in the next segment
+i=0
+while [ ! -s "$DIR/segment00001.avr" ]; do
+	i=$((i + 1))
+	[ $i -gt 150 ] && fail "no segment00001.avr after the replug, the camera did not record again or went back to segment00000.avr"
+	sleep 0.1
+done
+sleep 1
+
+kill -INT $PID
+wait $PID
+PID=
+
+[ "$(cksum < "$FIRST")" = "$BEFORE" ] || fail "segment00000.avr changed after the reconnect"
+for SEGMENT in "$DIR"/segment*.avr; do
+	closed "$SEGMENT" || fail "$(basename "$SEGMENT") has no index"
+done
+[ "$(od -An -tu4 -j20 -N4 "$DIR/segment00001.avr" | tr -d ' ')" = "1" ] || fail "segment00001.avr is not segment 1"
+grep -q "reconnect(s)" "$WORK/log.txt" || fail "no reconnect reported"
+
+echo "reconnect test passed: $(ls "$DIR"/segment*.avr | wc -l) segment(s), segment00000.avr intact"